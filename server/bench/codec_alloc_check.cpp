@@ -0,0 +1,152 @@
+// 请求/响应往返的堆内存分配检查
+// 按三种分帧方式，把一条请求送入连接的解码器、分发给UdsService并把响应编码到
+// 复用的输出缓冲区，统计预热之后每次往返在当前线程上发生的堆分配次数。
+// 读请求、内联长度的写请求和负响应都应为0次；存入数据区的长值写入只在
+// 新开数据区段或压缩时分配，单独列出摊还次数。存在非0的热路径时返回1
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "uds_service.h"
+#include "did_manager.h"
+#include "frame_codec.h"
+
+using namespace uds;
+
+namespace {
+
+// 只统计打开了计数开关的线程，后台维护线程的分配不计入
+thread_local bool g_counting = false;
+size_t g_allocations = 0;
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (g_counting) {
+        ++g_allocations;
+    }
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+namespace {
+
+const size_t WARMUP = 1000;
+const size_t ITERATIONS = 100000;
+
+struct Scenario {
+    const char* name;
+    std::vector<uint8_t> request;
+    bool must_be_zero;
+};
+
+// 返回每次往返的平均分配次数
+double measure(UdsService& service, FramingMode mode, const std::vector<uint8_t>& request) {
+    std::vector<uint8_t> framed;
+    encode_request(mode, 0x0E00, DOIP_ENTITY_ADDRESS, request, framed);
+
+    FrameDecoder decoder(mode);
+    RequestHandler handler = [&service](const Frame& frame, std::vector<uint8_t>& out) {
+        service.process_request(frame.request.data, frame.request.size, out);
+        return true;
+    };
+    std::vector<uint8_t> out;
+
+    for (size_t i = 0; i < WARMUP + ITERATIONS; ++i) {
+        if (i == WARMUP) {
+            g_allocations = 0;
+            g_counting = true;
+        }
+        decoder.feed(framed.data(), framed.size());
+        out.clear();
+        process_frames(decoder, handler, out);
+    }
+    g_counting = false;
+
+    if (out.empty()) {
+        std::cerr << "no response produced" << std::endl;
+    }
+    return static_cast<double>(g_allocations) / ITERATIONS;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string data_file = argc > 1 ? argv[1] : "codec_alloc_check.json";
+
+    int failures = 0;
+    {
+        PersistenceOptions persistence;
+        persistence.fsync_policy = FsyncPolicy::NEVER;
+        DIDManager did_manager(data_file, persistence);
+        UdsService service(did_manager);
+
+        std::vector<uint8_t> short_value(4, 0x11);
+        std::vector<uint8_t> long_value(32, 0x22);
+        did_manager.write_did(0xF190, short_value);
+        did_manager.write_did(0xF191, long_value);
+
+        std::vector<Scenario> scenarios;
+        scenarios.push_back(Scenario{"read 4B", {0x22, 0xF1, 0x90}, true});
+        scenarios.push_back(Scenario{"read 32B", {0x22, 0xF1, 0x91}, true});
+        scenarios.push_back(Scenario{"read missing", {0x22, 0x12, 0x34}, true});
+        scenarios.push_back(Scenario{"read 3 DIDs", {0x22, 0xF1, 0x90, 0xF1, 0x91, 0x12, 0x34}, true});
+        scenarios.push_back(Scenario{"write 4B", {0x2E, 0xF1, 0x90, 0x01, 0x02, 0x03, 0x04}, true});
+        scenarios.push_back(Scenario{"session 01", {0x10, 0x01}, true});
+        scenarios.push_back(Scenario{"unsupported", {0x19, 0x02}, true});
+        std::vector<uint8_t> long_write = {0x2E, 0xF1, 0x91};
+        long_write.insert(long_write.end(), long_value.begin(), long_value.end());
+        scenarios.push_back(Scenario{"write 32B", long_write, false});
+
+        const FramingMode modes[] = {FramingMode::RAW, FramingMode::LENGTH_PREFIXED, FramingMode::DOIP};
+        const char* mode_names[] = {"raw", "length", "doip"};
+
+        std::cout << std::setw(16) << "request";
+        for (size_t m = 0; m < 3; ++m) {
+            std::cout << std::setw(10) << mode_names[m];
+        }
+        std::cout << "   (heap allocations per round trip)" << std::endl;
+
+        for (size_t s = 0; s < scenarios.size(); ++s) {
+            std::cout << std::setw(16) << scenarios[s].name;
+            for (size_t m = 0; m < 3; ++m) {
+                double allocations = measure(service, modes[m], scenarios[s].request);
+                std::cout << std::setw(10) << std::fixed << std::setprecision(4) << allocations;
+                if (scenarios[s].must_be_zero && allocations != 0) {
+                    ++failures;
+                }
+            }
+            std::cout << (scenarios[s].must_be_zero ? "" : "   (amortized arena growth)") << std::endl;
+        }
+    }
+
+    std::remove(data_file.c_str());
+    std::remove((data_file + ".wal").c_str());
+
+    if (failures > 0) {
+        std::cerr << failures << " hot-path case(s) allocated on the heap" << std::endl;
+        return 1;
+    }
+    std::cout << "OK: zero heap allocations on the hot path" << std::endl;
+    return 0;
+}
@@ -0,0 +1,227 @@
+// DID数据文件启动加载耗时
+// 生成一个包含指定数量DID的数据集，分别写成JSON和二进制数据库，比较：
+//   legacy JSON：原实现（stringstream读入 + substr/istringstream/stoi逐字节解析 + std::map）
+//   JSON       ：单遍解析到DidDatabase，数据区直接作为DID表的数据段
+//   binary     ：映射二进制数据库，只扫描条目表
+// 另外给出加载后首次读遍所有DID的耗时（映射的页面在此时才真正读入）。
+// 文件位于页缓存中，数字不包含磁盘I/O
+// 用法：did_load_bench [--dids=N] [--runs=N] [--dir=PATH]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+
+#include "did_database.h"
+#include "did_store.h"
+#include "epoch.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// 原DIDManager::parse_json的逐字复制，作为对照
+bool legacy_load(const std::string& path, DidStore::DidMap& parsed) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string json_str = buffer.str();
+
+    size_t dids_start = json_str.find("\"dids\": {");
+    if (dids_start == std::string::npos) {
+        return false;
+    }
+    dids_start += 8;
+    size_t dids_end = json_str.rfind("}");
+    if (dids_end == std::string::npos || dids_end <= dids_start) {
+        return false;
+    }
+
+    std::string dids_str = json_str.substr(dids_start, dids_end - dids_start);
+    size_t pos = 0;
+    while (pos < dids_str.size()) {
+        while (pos < dids_str.size() && std::isspace(dids_str[pos])) {
+            pos++;
+        }
+        size_t did_key_start = dids_str.find('"', pos);
+        if (did_key_start == std::string::npos) {
+            break;
+        }
+        size_t did_key_end = dids_str.find('"', did_key_start + 1);
+        if (did_key_end == std::string::npos) {
+            break;
+        }
+        std::string did_str = dids_str.substr(did_key_start + 1, did_key_end - did_key_start - 1);
+        DID did = static_cast<DID>(std::stoi(did_str, nullptr, 16));
+        size_t array_start = dids_str.find('[', did_key_end);
+        if (array_start == std::string::npos) {
+            break;
+        }
+        size_t array_end = dids_str.find(']', array_start);
+        if (array_end == std::string::npos) {
+            break;
+        }
+        std::vector<uint8_t> data;
+        std::string array_str = dids_str.substr(array_start + 1, array_end - array_start - 1);
+        std::istringstream array_iss(array_str);
+        std::string byte_str;
+        while (array_iss >> byte_str) {
+            if (byte_str.back() == ',') {
+                byte_str.pop_back();
+            }
+            try {
+                data.push_back(static_cast<uint8_t>(std::stoi(byte_str, nullptr, 10)));
+            } catch (...) {
+            }
+        }
+        parsed[did] = data;
+        pos = array_end + 1;
+    }
+    return true;
+}
+
+// 数据集：DID均匀分布，值长度在4/8/16/32字节间轮换
+void make_dataset(size_t count, DidDatabase& database) {
+    size_t stride = DidStore::SLOT_COUNT / count;
+    const size_t sizes[] = {4, 8, 16, 32};
+    std::vector<uint8_t> value(32);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 0; k < value.size(); ++k) {
+            value[k] = static_cast<uint8_t>(i * 7 + k);
+        }
+        database.append(static_cast<DID>(i * stride), value.data(), sizes[i % 4]);
+    }
+}
+
+bool write_file(const std::string& path, const void* data, size_t size) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, file) == size;
+    return std::fclose(file) == 0 && ok;
+}
+
+// 读遍全部DID，返回耗时
+double touch_all(const DidStore& store, uint64_t& checksum) {
+    Clock::time_point start = Clock::now();
+    EpochManager::Guard guard;
+    DidValueView view;
+    for (size_t did = 0; did < DidStore::SLOT_COUNT; ++did) {
+        if (store.read(static_cast<DID>(did), view)) {
+            checksum += view.data()[view.size() - 1];
+        }
+    }
+    return elapsed_ms(start);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t did_count = 65536;
+    int runs = 5;
+    std::string dir = ".";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--dids=") == 0) {
+            did_count = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 7, "--runs=") == 0) {
+            runs = std::stoi(arg.substr(7));
+        } else if (arg.compare(0, 6, "--dir=") == 0) {
+            dir = arg.substr(6);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--dids=N] [--runs=N] [--dir=PATH]" << std::endl;
+            return 1;
+        }
+    }
+    if (did_count == 0 || did_count > DidStore::SLOT_COUNT) {
+        std::cerr << "--dids must be in 1.." << DidStore::SLOT_COUNT << std::endl;
+        return 1;
+    }
+
+    std::string json_path = dir + "/did_load_bench.json";
+    std::string binary_path = dir + "/did_load_bench.bin";
+    {
+        DidDatabase source;
+        make_dataset(did_count, source);
+        std::string json = source.to_json();
+        std::vector<uint8_t> binary = source.to_binary();
+        if (!write_file(json_path, json.data(), json.size()) ||
+            !write_file(binary_path, binary.data(), binary.size())) {
+            std::cerr << "Failed to write test files in " << dir << std::endl;
+            return 1;
+        }
+        std::cout << did_count << " DIDs: JSON " << json.size() << " bytes, binary "
+                  << binary.size() << " bytes" << std::endl;
+    }
+
+    double legacy_ms = 0, json_ms = 0, binary_ms = 0;
+    double json_touch_ms = 0, binary_touch_ms = 0;
+    uint64_t checksum = 0;
+    std::string error;
+
+    for (int run = 0; run < runs; ++run) {
+        {
+            DidStore store;
+            Clock::time_point start = Clock::now();
+            DidStore::DidMap parsed;
+            legacy_load(json_path, parsed);
+            store.replace_all(parsed);
+            legacy_ms += elapsed_ms(start);
+        }
+        {
+            DidStore store;
+            Clock::time_point start = Clock::now();
+            std::shared_ptr<DidDatabase> database(new DidDatabase());
+            if (!database->load_json_file(json_path, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            store.replace_all(database);
+            json_ms += elapsed_ms(start);
+            json_touch_ms += touch_all(store, checksum);
+        }
+        {
+            DidStore store;
+            Clock::time_point start = Clock::now();
+            std::shared_ptr<DidDatabase> database(new DidDatabase());
+            if (!database->map_file(binary_path, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            store.replace_all(database);
+            binary_ms += elapsed_ms(start);
+            binary_touch_ms += touch_all(store, checksum);
+        }
+        EpochManager::instance().reclaim();
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(14) << "format" << std::setw(14) << "load ms" << std::setw(18) << "first scan ms" << std::endl;
+    std::cout << std::setw(14) << "legacy JSON" << std::setw(14) << legacy_ms / runs << std::setw(18) << "-" << std::endl;
+    std::cout << std::setw(14) << "JSON" << std::setw(14) << json_ms / runs << std::setw(18) << json_touch_ms / runs << std::endl;
+    std::cout << std::setw(14) << "binary" << std::setw(14) << binary_ms / runs << std::setw(18) << binary_touch_ms / runs << std::endl;
+
+    if (checksum == 0) {
+        std::cerr << "unexpected checksum" << std::endl;
+    }
+    std::remove(json_path.c_str());
+    std::remove(binary_path.c_str());
+    return 0;
+}
@@ -0,0 +1,208 @@
+// DID快照一致性与写入影响测试
+// 一个写线程按序号n把n（8字节小端）写入DID n % N，另一个线程反复导出：
+//   - snapshot：固定版本快照后校验、导出为数据库。版本V对应前V-1次写入（版本1为初始数据），
+//     每个DID的值必须等于不超过该次数的最后一次写入，否则计为不一致
+//   - live：旧的做法，持有Guard逐个读取当前表，以读到的最大序号为准做同样的校验
+// 输出写线程单独运行与伴随导出时的写吞吐和延迟，以及两种导出方式的不一致次数（快照应为0）
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+#include "did_store.h"
+#include "did_database.h"
+#include "epoch.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+enum class ExportMode { NONE, SNAPSHOT, LIVE };
+
+struct BenchOptions {
+    size_t did_count = 20000;
+    int duration_ms = 2000;
+};
+
+struct RoundResult {
+    uint64_t writes = 0;
+    double write_p99_us = 0;
+    double write_max_us = 0;
+    uint64_t exports = 0;
+    uint64_t inconsistent = 0;
+    double snapshot_ms = 0;  // 平均每次固定快照的耗时
+    double export_ms = 0;    // 平均每次导出（快照或逐个读取）的耗时
+};
+
+uint64_t decode_sequence(const uint8_t* data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size && i < 8; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+// 前writes次写入之后DID的值
+uint64_t expected_value(uint64_t writes, uint64_t did, uint64_t did_count) {
+    if (writes < did) {
+        return 0;
+    }
+    return writes - (writes - did) % did_count;
+}
+
+// 一次导出中读到的数据是否是某个写入前缀之后的状态
+bool is_consistent(const std::vector<uint64_t>& values, uint64_t writes) {
+    for (size_t did = 0; did < values.size(); ++did) {
+        if (values[did] != expected_value(writes, did, values.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RoundResult run_round(const BenchOptions& options, ExportMode mode) {
+    DidStore store;
+    DidStore::DidMap initial;
+    for (size_t did = 0; did < options.did_count; ++did) {
+        initial[static_cast<DID>(did)] = std::vector<uint8_t>(8, 0);
+    }
+    store.replace_all(initial);
+    const uint64_t base_version = store.version();
+
+    std::atomic<bool> stop(false);
+    RoundResult result;
+    std::vector<double> latencies;
+    latencies.reserve(4 * 1024 * 1024);
+
+    std::thread writer([&]() {
+        uint8_t payload[8];
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            ++n;
+            for (int i = 0; i < 8; ++i) {
+                payload[i] = static_cast<uint8_t>(n >> (8 * i));
+            }
+            Clock::time_point start = Clock::now();
+            store.write(static_cast<DID>(n % options.did_count), payload, sizeof(payload));
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            if (latencies.size() < latencies.capacity()) {
+                latencies.push_back(us);
+            }
+        }
+        result.writes = n;
+    });
+
+    std::thread exporter;
+    if (mode != ExportMode::NONE) {
+        exporter = std::thread([&]() {
+            std::vector<uint64_t> values(options.did_count);
+            DidDatabase database;
+            double snapshot_ms = 0;
+            double export_ms = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                Clock::time_point start = Clock::now();
+                uint64_t writes;
+                if (mode == ExportMode::SNAPSHOT) {
+                    std::shared_ptr<const DidSnapshot> snapshot = store.snapshot();
+                    snapshot_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                    snapshot->export_to(database);
+                    writes = snapshot->version() - base_version;
+                    for (size_t i = 0; i < snapshot->size(); ++i) {
+                        DidValueView view = snapshot->value(i);
+                        values[snapshot->did(i)] = decode_sequence(view.data(), view.size());
+                    }
+                } else {
+                    EpochManager::Guard guard;
+                    DidValueView view;
+                    writes = 0;
+                    for (size_t did = 0; did < options.did_count; ++did) {
+                        store.read(static_cast<DID>(did), view);
+                        values[did] = decode_sequence(view.data(), view.size());
+                        writes = std::max(writes, values[did]);
+                    }
+                }
+                export_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                if (!is_consistent(values, writes)) {
+                    ++result.inconsistent;
+                }
+                ++result.exports;
+            }
+            if (result.exports > 0) {
+                result.snapshot_ms = snapshot_ms / result.exports;
+                result.export_ms = export_ms / result.exports;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+    stop.store(true);
+    writer.join();
+    if (exporter.joinable()) {
+        exporter.join();
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        result.write_p99_us = latencies[latencies.size() * 99 / 100];
+        result.write_max_us = latencies.back();
+    }
+    return result;
+}
+
+void print_result(const char* name, const RoundResult& result, const BenchOptions& options) {
+    double seconds = options.duration_ms / 1000.0;
+    std::cout << std::left << std::setw(10) << name << std::right
+              << std::setw(14) << static_cast<uint64_t>(result.writes / seconds)
+              << std::setw(12) << result.write_p99_us
+              << std::setw(12) << result.write_max_us
+              << std::setw(10) << result.exports
+              << std::setw(14) << result.snapshot_ms
+              << std::setw(12) << result.export_ms
+              << std::setw(14) << result.inconsistent << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--dids=") == 0) {
+            options.did_count = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        } else if (arg.compare(0, 14, "--duration-ms=") == 0) {
+            options.duration_ms = std::atoi(arg.c_str() + 14);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--dids=N] [--duration-ms=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.did_count == 0 || options.did_count > DidStore::SLOT_COUNT || options.duration_ms <= 0) {
+        std::cerr << "Invalid options" << std::endl;
+        return 1;
+    }
+
+    std::cout << "DIDs: " << options.did_count << ", duration: " << options.duration_ms << " ms per round" << std::endl;
+    std::cout << std::left << std::setw(10) << "export" << std::right
+              << std::setw(14) << "writes/s"
+              << std::setw(12) << "p99(us)"
+              << std::setw(12) << "max(us)"
+              << std::setw(10) << "exports"
+              << std::setw(14) << "snapshot(ms)"
+              << std::setw(12) << "export(ms)"
+              << std::setw(14) << "inconsistent" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    print_result("none", run_round(options, ExportMode::NONE), options);
+    RoundResult snapshot = run_round(options, ExportMode::SNAPSHOT);
+    print_result("snapshot", snapshot, options);
+    print_result("live", run_round(options, ExportMode::LIVE), options);
+    return snapshot.inconsistent == 0 ? 0 : 1;
+}
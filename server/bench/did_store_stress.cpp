@@ -0,0 +1,174 @@
+// DID存储并发压力测试
+// 以读多写少的负载（默认95% 0x22读取 / 5% 0x2E写入）驱动DidStore，
+// 依次使用1、2、4…N个线程，输出每种线程数下的读吞吐以及相对单线程的加速比
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+#include "did_store.h"
+
+using namespace uds;
+
+namespace {
+
+struct StressOptions {
+    size_t max_threads = 0;      // 0表示按CPU核数
+    size_t did_count = 1000;
+    int duration_ms = 1000;
+    unsigned write_percent = 5;
+};
+
+struct StressResult {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t misses = 0;
+};
+
+// xorshift伪随机数，避免rand()的全局锁
+inline uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+StressResult run_round(DidStore& store, const StressOptions& options, size_t thread_count) {
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<StressResult> results(thread_count);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.push_back(std::thread([&, t]() {
+            uint32_t state = static_cast<uint32_t>(t * 2654435761u + 1);
+            std::vector<uint8_t> value;
+            std::vector<uint8_t> payload(4);
+            StressResult local;
+
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                // 每批执行一组操作再检查停止标志，降低标志读取开销
+                for (int i = 0; i < 256; ++i) {
+                    uint32_t r = next_random(state);
+                    DID did = static_cast<DID>(r % options.did_count);
+                    if ((r >> 16) % 100 < options.write_percent) {
+                        payload[0] = static_cast<uint8_t>(r);
+                        store.write(did, payload);
+                        ++local.writes;
+                    } else {
+                        if (!store.read(did, value)) {
+                            ++local.misses;
+                        }
+                        ++local.reads;
+                    }
+                }
+            }
+            results[t] = local;
+        }));
+    }
+
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+    stop.store(true);
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    StressResult total;
+    for (size_t t = 0; t < results.size(); ++t) {
+        total.reads += results[t].reads;
+        total.writes += results[t].writes;
+        total.misses += results[t].misses;
+    }
+    return total;
+}
+
+bool parse_options(int argc, char* argv[], StressOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 10, "--threads=") == 0) {
+            options.max_threads = std::stoul(arg.substr(10));
+        } else if (arg.compare(0, 7, "--dids=") == 0) {
+            options.did_count = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 14, "--duration-ms=") == 0) {
+            options.duration_ms = std::stoi(arg.substr(14));
+        } else if (arg.compare(0, 16, "--write-percent=") == 0) {
+            options.write_percent = static_cast<unsigned>(std::stoul(arg.substr(16)));
+        } else {
+            return false;
+        }
+    }
+    if (options.did_count == 0 || options.did_count > 65536 || options.write_percent > 100) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    StressOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--threads=N] [--dids=N] [--duration-ms=N] [--write-percent=N]" << std::endl;
+        return 1;
+    }
+    if (options.max_threads == 0) {
+        options.max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // 预填充数据
+    DidStore store;
+    DidStore::DidMap initial;
+    for (size_t i = 0; i < options.did_count; ++i) {
+        initial[static_cast<DID>(i)] = std::vector<uint8_t>{0x01, 0x02, 0x03, 0x04};
+    }
+    store.replace_all(initial);
+
+    std::cout << "DID store stress: " << options.did_count << " DIDs, "
+              << (100 - options.write_percent) << "% read / " << options.write_percent << "% write, "
+              << options.duration_ms << " ms per round" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "reads/s" << std::setw(16) << "writes/s"
+              << std::setw(18) << "reads/s/thread" << std::setw(10) << "scaling" << std::endl;
+
+    double baseline = 0.0;
+    std::vector<size_t> rounds;
+    for (size_t n = 1; n < options.max_threads; n *= 2) {
+        rounds.push_back(n);
+    }
+    rounds.push_back(options.max_threads);
+
+    for (size_t i = 0; i < rounds.size(); ++i) {
+        size_t n = rounds[i];
+        StressResult result = run_round(store, options, n);
+        double seconds = options.duration_ms / 1000.0;
+        double reads_per_second = result.reads / seconds;
+        if (i == 0) {
+            baseline = reads_per_second;
+        }
+
+        std::cout << std::setw(8) << n
+                  << std::setw(16) << std::fixed << std::setprecision(0) << reads_per_second
+                  << std::setw(16) << result.writes / seconds
+                  << std::setw(18) << reads_per_second / n
+                  << std::setw(9) << std::setprecision(2) << (baseline > 0 ? reads_per_second / baseline : 0.0)
+                  << "x" << std::endl;
+
+        if (result.misses != 0) {
+            std::cerr << "Unexpected missing DIDs: " << result.misses << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
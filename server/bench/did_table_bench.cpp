@@ -0,0 +1,185 @@
+// DID表与std::map的内存占用和查找延迟对比
+// 对不同的DID数量，分别用std::map<DID, std::vector<uint8_t>>（原实现）和
+// DidStore（65536槽位直接索引 + 连续数据区）存放同一组数据，
+// 统计堆内存占用以及随机查找的平均延迟
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "did_store.h"
+#include "epoch.h"
+
+using namespace uds;
+
+namespace {
+
+// 堆内存统计：在每块内存前记录其大小
+size_t g_heap_bytes = 0;
+const size_t ALLOC_HEADER = 16;
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* block = std::malloc(size + ALLOC_HEADER);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    g_heap_bytes += size;
+    return static_cast<char*>(block) + ALLOC_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - ALLOC_HEADER;
+    g_heap_bytes -= *static_cast<size_t*>(block);
+    std::free(block);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+typedef std::map<DID, std::vector<uint8_t>> DidMap;
+
+const size_t LOOKUPS = 2000000;
+
+inline uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// 生成测试数据：DID均匀分布在16位空间内，一半4字节值，一半16字节值
+DidMap make_dataset(size_t count) {
+    DidMap data;
+    size_t stride = DidStore::SLOT_COUNT / count;
+    for (size_t i = 0; i < count; ++i) {
+        DID did = static_cast<DID>(i * stride);
+        size_t size = (i % 2 == 0) ? 4 : 16;
+        std::vector<uint8_t> value(size);
+        for (size_t k = 0; k < size; ++k) {
+            value[k] = static_cast<uint8_t>(i + k);
+        }
+        data[did] = value;
+    }
+    return data;
+}
+
+std::vector<DID> make_lookup_keys(const DidMap& data) {
+    std::vector<DID> dids;
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        dids.push_back(it->first);
+    }
+    std::vector<DID> keys(LOOKUPS);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        keys[i] = dids[next_random(state) % dids.size()];
+    }
+    return keys;
+}
+
+double elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t sizes[] = {64, 1024, 16384, 65536};
+
+    // 预先初始化纪元管理器的线程记录，不计入内存统计
+    {
+        EpochManager::Guard guard;
+    }
+
+    std::cout << std::setw(8) << "DIDs"
+              << std::setw(14) << "map bytes" << std::setw(14) << "table bytes"
+              << std::setw(14) << "map ns" << std::setw(14) << "map+copy ns"
+              << std::setw(14) << "view ns" << std::setw(14) << "copy ns" << std::endl;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        DidMap source = make_dataset(sizes[s]);
+        std::vector<DID> keys = make_lookup_keys(source);
+
+        // 内存占用
+        size_t before = g_heap_bytes;
+        DidMap* map = new DidMap(source);
+        size_t map_bytes = g_heap_bytes - before;
+
+        before = g_heap_bytes;
+        DidStore* store = new DidStore();
+        store->replace_all(source);
+        EpochManager::instance().reclaim();
+        size_t table_bytes = g_heap_bytes - before;
+
+        uint64_t checksum = 0;
+
+        // std::map查找（引用访问，不复制）
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            auto it = map->find(keys[i]);
+            checksum += it->second[0] + it->second.size();
+        }
+        double map_ns = elapsed_ns(start) / LOOKUPS;
+
+        // std::map查找并复制到vector（原read_did的行为）
+        std::vector<uint8_t> value;
+        start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            auto it = map->find(keys[i]);
+            value = it->second;
+            checksum += value[0];
+        }
+        double map_copy_ns = elapsed_ns(start) / LOOKUPS;
+
+        // DidStore视图读取，每次查找都进出一次读临界区
+        start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            EpochManager::Guard guard;
+            DidValueView view;
+            store->read(keys[i], view);
+            checksum += view.data()[0] + view.size();
+        }
+        double view_ns = elapsed_ns(start) / LOOKUPS;
+
+        // DidStore读取并复制
+        start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            store->read(keys[i], value);
+            checksum += value[0];
+        }
+        double copy_ns = elapsed_ns(start) / LOOKUPS;
+
+        std::cout << std::setw(8) << sizes[s]
+                  << std::setw(14) << map_bytes << std::setw(14) << table_bytes
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << map_ns << std::setw(14) << map_copy_ns
+                  << std::setw(14) << view_ns << std::setw(14) << copy_ns << std::endl;
+
+        if (checksum == 0) {
+            std::cerr << "unexpected checksum" << std::endl;
+        }
+
+        delete map;
+        delete store;
+    }
+
+    return 0;
+}
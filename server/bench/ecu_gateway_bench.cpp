@@ -0,0 +1,204 @@
+// 虚拟网关的内存占用与路由开销
+// 用同一个模板创建大量ECU，统计：
+//   - 每个ECU的基础内存（模板数据只加载一次，由所有ECU共享）
+//   - 每个ECU写入若干DID后的内存增量（只有写入的DID进入覆盖层）
+//   - 经网关按目标地址路由的0x22请求耗时，与直接调用单个UdsService对比
+// 用法：ecu_gateway_bench [--ecus=N] [--template-dids=N] [--writes=N] [--dir=PATH]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "ecu_gateway.h"
+#include "did_database.h"
+#include "did_overlay.h"
+#include "epoch.h"
+
+using namespace uds;
+
+namespace {
+
+// 堆内存统计：在每块内存前记录其大小
+size_t g_heap_bytes = 0;
+const size_t ALLOC_HEADER = 16;
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* block = std::malloc(size + ALLOC_HEADER);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    g_heap_bytes += size;
+    return static_cast<char*>(block) + ALLOC_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - ALLOC_HEADER;
+    g_heap_bytes -= *static_cast<size_t*>(block);
+    std::free(block);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint16_t FIRST_ADDRESS = 0x2000;
+const size_t REQUESTS = 2000000;
+
+inline uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+double elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t ecu_count = 4096;
+    size_t template_dids = 2000;
+    size_t writes = 8;
+    std::string dir = ".";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--ecus=") == 0) {
+            ecu_count = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 16, "--template-dids=") == 0) {
+            template_dids = std::stoul(arg.substr(16));
+        } else if (arg.compare(0, 9, "--writes=") == 0) {
+            writes = std::stoul(arg.substr(9));
+        } else if (arg.compare(0, 6, "--dir=") == 0) {
+            dir = arg.substr(6);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--ecus=N] [--template-dids=N] [--writes=N] [--dir=PATH]" << std::endl;
+            return 1;
+        }
+    }
+    if (ecu_count == 0 || ecu_count > 65536 - FIRST_ADDRESS || template_dids == 0 || template_dids > 65536) {
+        std::cerr << "invalid --ecus or --template-dids" << std::endl;
+        return 1;
+    }
+
+    // 模板数据与配置文件
+    std::string template_path = dir + "/ecu_gateway_bench.bin";
+    std::string config_path = dir + "/ecu_gateway_bench.conf";
+    {
+        DidDatabase source;
+        std::vector<uint8_t> value(32, 0x5A);
+        for (size_t i = 0; i < template_dids; ++i) {
+            source.append(static_cast<DID>(i), value.data(), 4 + (i % 4) * 8);
+        }
+        std::vector<uint8_t> binary = source.to_binary();
+        std::ofstream template_file(template_path.c_str(), std::ios::binary);
+        template_file.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(binary.size()));
+        std::ofstream config(config_path.c_str());
+        config << std::hex << FIRST_ADDRESS << "-" << (FIRST_ADDRESS + ecu_count - 1)
+               << " ecu_gateway_bench.bin" << std::endl;
+    }
+
+    {
+        EpochManager::Guard guard;
+    }
+
+    size_t before = g_heap_bytes;
+    EcuGateway* gateway = new EcuGateway();
+    size_t gateway_bytes = g_heap_bytes - before;
+    std::string error;
+    if (!gateway->load_config(config_path, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    size_t loaded_bytes = g_heap_bytes - before - gateway_bytes;
+
+    // 每个ECU写入若干16字节的DID
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> write_request(3 + 16, 0xA5);
+    write_request[0] = 0x2E;
+    before = g_heap_bytes;
+    for (size_t e = 0; e < ecu_count; ++e) {
+        for (size_t w = 0; w < writes; ++w) {
+            DID did = static_cast<DID>((w * 997) % template_dids);
+            write_request[1] = static_cast<uint8_t>(did >> 8);
+            write_request[2] = static_cast<uint8_t>(did & 0xFF);
+            out.clear();
+            gateway->process_request(static_cast<uint16_t>(FIRST_ADDRESS + e), write_request.data(),
+                                     write_request.size(), out);
+        }
+    }
+    EpochManager::instance().reclaim();
+    size_t written_bytes = g_heap_bytes - before;
+
+    std::cout << ecu_count << " ECUs from one " << template_dids << "-DID template" << std::endl;
+    std::cout << "  routing table            " << gateway_bytes << " bytes" << std::endl;
+    std::cout << "  template + ECUs          " << loaded_bytes << " bytes ("
+              << loaded_bytes / ecu_count << " bytes/ECU)" << std::endl;
+    std::cout << "  after " << writes << " writes per ECU  +" << written_bytes << " bytes ("
+              << written_bytes / ecu_count << " bytes/ECU)" << std::endl;
+    {
+        before = g_heap_bytes;
+        DidStore* dense = new DidStore();
+        std::cout << "  (a private dense DidStore per ECU would cost " << (g_heap_bytes - before)
+                  << " bytes/ECU before any data)" << std::endl;
+        delete dense;
+    }
+
+    // 路由开销：随机目标地址 vs 单个ECU直接调用
+    std::vector<uint16_t> targets(4096);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        targets[i] = static_cast<uint16_t>(FIRST_ADDRESS + next_random(state) % ecu_count);
+    }
+    uint8_t read_request[3] = {0x22, 0x00, 0x05};
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < REQUESTS; ++i) {
+        out.clear();
+        gateway->process_request(targets[i % targets.size()], read_request, sizeof(read_request), out);
+    }
+    double routed_ns = elapsed_ns(start) / REQUESTS;
+
+    std::shared_ptr<DidDatabase> database(new DidDatabase());
+    database->map_file(template_path, error);
+    std::shared_ptr<DidStore> baseline(new DidStore());
+    baseline->replace_all(database);
+    LayeredDidSource single(baseline);
+    UdsService service(single);
+    start = Clock::now();
+    for (size_t i = 0; i < REQUESTS; ++i) {
+        out.clear();
+        service.process_request(read_request, sizeof(read_request), out);
+    }
+    double direct_ns = elapsed_ns(start) / REQUESTS;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "  0x22 via gateway (random ECU) " << routed_ns << " ns/request, "
+              << "single ECU direct " << direct_ns << " ns/request" << std::endl;
+
+    delete gateway;
+    std::remove(template_path.c_str());
+    std::remove(config_path.c_str());
+    return 0;
+}
@@ -0,0 +1,204 @@
+// ISO-TP（CAN）传输吞吐测试
+// 大量测试端通道经进程内的CAN回环总线同时访问网关中的ECU，每轮每个通道先用2E写入一段大数据（请求分段），
+// 再用22读回同样大小的DID（响应分段），所有通道的分段传输在总线上交错进行。统计：
+//   - 每秒完成的分段传输数、ISO-TP载荷吞吐和CAN帧速率（墙钟时间，总线本身不计传输时间）
+//   - 按STmin节奏发送时推进的模拟时间
+//   - 超时、错误与丢弃的传输数
+// 用法：isotp_bench [--channels=N] [--payload=N] [--rounds=N] [--bs=N] [--stmin=N] [--ecus=N]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+#include "isotp.h"
+#include "isotp_server.h"
+#include "can_bus.h"
+#include "ecu_gateway.h"
+#include "did_overlay.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const DID READ_DID = 0xF100;
+const DID WRITE_DID = 0xF101;
+const uint32_t REQUEST_ID_BASE = 0x10000;   // 29位扩展帧ID，每个通道一对
+const uint32_t RESPONSE_ID_BASE = 0x20000;
+
+// 每个测试端通道的进度：写入 -> 读取 -> 下一轮
+struct Tester {
+    bool reading;
+    size_t rounds;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t channel_count = 2000;
+    size_t payload = 4000;
+    size_t rounds = 5;
+    uint8_t block_size = 8;
+    uint8_t st_min = 0;
+    size_t ecu_count = 16;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 11, "--channels=") == 0) {
+            channel_count = std::stoul(arg.substr(11));
+        } else if (arg.compare(0, 10, "--payload=") == 0) {
+            payload = std::stoul(arg.substr(10));
+        } else if (arg.compare(0, 9, "--rounds=") == 0) {
+            rounds = std::stoul(arg.substr(9));
+        } else if (arg.compare(0, 5, "--bs=") == 0) {
+            block_size = static_cast<uint8_t>(std::stoul(arg.substr(5)));
+        } else if (arg.compare(0, 8, "--stmin=") == 0) {
+            st_min = static_cast<uint8_t>(std::stoul(arg.substr(8), nullptr, 0));
+        } else if (arg.compare(0, 7, "--ecus=") == 0) {
+            ecu_count = std::stoul(arg.substr(7));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--channels=N] [--payload=N] [--rounds=N] [--bs=N] [--stmin=N] [--ecus=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (channel_count == 0 || channel_count > 0x10000 || payload < 8 || payload > 0xFFFF || rounds == 0 ||
+        ecu_count == 0) {
+        std::cerr << "invalid arguments" << std::endl;
+        return 1;
+    }
+
+    // 所有ECU共享一份数据：0001为16字节版本号，F100为payload字节的大DID
+    std::shared_ptr<DidStore> store(new DidStore());
+    const uint8_t version[16] = {'V', '1', '.', '0', '.', '0'};
+    store->write(0x0001, version, sizeof(version));
+    std::vector<uint8_t> data(payload);
+    for (size_t i = 0; i < payload; ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    store->write(READ_DID, data.data(), data.size());
+    LayeredDidSource source(store);
+    EcuGateway gateway;
+    for (size_t i = 0; i < ecu_count; ++i) {
+        std::string error;
+        if (!gateway.add_ecu(static_cast<uint16_t>(0x1000 + i), source, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    IsoTpOptions options;
+    options.block_size = block_size;
+    options.st_min = st_min;
+    options.max_message_size = std::max<size_t>(options.max_message_size, 3 + payload);
+    CanLoopbackBus bus;
+    IsoTpServer server(gateway, bus, options);
+    IsoTpLayer tester(bus, options);
+    for (size_t c = 0; c < channel_count; ++c) {
+        uint32_t request_id = REQUEST_ID_BASE + static_cast<uint32_t>(c);
+        uint32_t response_id = RESPONSE_ID_BASE + static_cast<uint32_t>(c);
+        server.add_route(request_id, response_id, static_cast<uint16_t>(0x1000 + c % ecu_count), 0x0E00);
+        tester.add_channel(response_id, request_id);
+        bus.attach(request_id, &server.layer());
+        bus.attach(response_id, &tester);
+    }
+
+    // 推进总线直到没有帧可投递；需要等待STmin时推进模拟时间
+    uint64_t now_us = 0;
+    auto drive = [&](const std::function<bool()>& done) {
+        while (!done()) {
+            if (bus.pump() == 0) {
+                if (tester.timers_idle() && server.layer().timers_idle()) {
+                    return false;
+                }
+                now_us += options.tick_us;
+                tester.advance(now_us);
+                server.layer().advance(now_us);
+            }
+        }
+        return true;
+    };
+
+    // 先读一次16字节的版本号（首帧 + 2个连续帧）
+    std::vector<uint8_t> last_response;
+    tester.set_handler([&](size_t, const uint8_t* message, size_t size) {
+        last_response.assign(message, message + size);
+    });
+    const uint8_t read_version[] = {0x22, 0x00, 0x01};
+    tester.send(0, read_version, sizeof(read_version));
+    if (!drive([&]() { return !last_response.empty(); }) || last_response.size() != 3 + sizeof(version) ||
+        last_response[0] != 0x62 || last_response[3] != 'V') {
+        std::cerr << "version read over ISO-TP failed" << std::endl;
+        return 1;
+    }
+
+    // 每个通道：2E写入payload字节 -> 22读回payload字节
+    std::vector<uint8_t> write_request(3 + payload);
+    write_request[0] = 0x2E;
+    write_request[1] = static_cast<uint8_t>(WRITE_DID >> 8);
+    write_request[2] = static_cast<uint8_t>(WRITE_DID & 0xFF);
+    std::copy(data.begin(), data.end(), write_request.begin() + 3);
+    const uint8_t read_request[] = {0x22, static_cast<uint8_t>(READ_DID >> 8), static_cast<uint8_t>(READ_DID & 0xFF)};
+
+    std::vector<Tester> testers(channel_count);
+    size_t finished = 0;
+    size_t bad_responses = 0;
+    tester.set_handler([&](size_t channel, const uint8_t* message, size_t size) {
+        Tester& state = testers[channel];
+        if (!state.reading) {
+            if (size < 1 || message[0] != 0x6E) {
+                ++bad_responses;
+            }
+            state.reading = true;
+            tester.send(channel, read_request, sizeof(read_request));
+            return;
+        }
+        if (size != 3 + payload || message[0] != 0x62 || message[3 + payload - 1] != data[payload - 1]) {
+            ++bad_responses;
+        }
+        state.reading = false;
+        if (++state.rounds == rounds) {
+            ++finished;
+        } else {
+            tester.send(channel, write_request.data(), write_request.size());
+        }
+    });
+
+    uint64_t frames_before = bus.frames();
+    uint64_t virtual_start_us = now_us;
+    std::clock_t cpu_start = std::clock();
+    Clock::time_point start = Clock::now();
+    for (size_t c = 0; c < channel_count; ++c) {
+        testers[c].reading = false;
+        testers[c].rounds = 0;
+        tester.send(c, write_request.data(), write_request.size());
+    }
+    bool completed = drive([&]() { return finished == channel_count; });
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu_s = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    uint64_t transfers = static_cast<uint64_t>(channel_count) * rounds * 2;
+    uint64_t payload_bytes = transfers * (3 + payload);
+    uint64_t frames = bus.frames() - frames_before;
+    const IsoTpStats& tester_stats = tester.stats();
+    const IsoTpStats& server_stats = server.layer().stats();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << channel_count << " channels x " << rounds << " rounds of " << payload << "-byte 2E + 22 (BS "
+              << static_cast<int>(block_size) << ", STmin 0x" << std::hex << static_cast<int>(st_min) << std::dec
+              << ", " << ecu_count << " ECUs)" << std::endl;
+    std::cout << "  transfers      " << transfers / elapsed_s << "/s, payload " << payload_bytes / elapsed_s / 1e6
+              << " MB/s, " << frames / elapsed_s / 1e6 << " M frames/s (" << frames << " frames)" << std::endl;
+    std::cout << "  simulated time " << (now_us - virtual_start_us) / 1000.0 << " ms, wall " << elapsed_s * 1000
+              << " ms, CPU " << cpu_s * 1000 << " ms" << std::endl;
+    std::cout << "  failures       " << tester_stats.timeouts + server_stats.timeouts << " timeouts, "
+              << tester_stats.errors + server_stats.errors << " errors, " << server.dropped() << " dropped, "
+              << bad_responses << " bad responses" << std::endl;
+    return completed && bad_responses == 0 ? 0 : 1;
+}
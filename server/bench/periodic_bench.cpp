@@ -0,0 +1,161 @@
+// 0x2A周期调度器压力测试
+// 大量连接在多个ECU上以慢/中/快三种速率订阅周期DID，推送到进程内的计数通道（不经过socket），统计：
+//   - 订阅的建立耗时
+//   - 实际推送的报文数与按速率应推送的报文数
+//   - 每个节拍开始处理的延迟（抖动）和处理耗时，以及调度线程占用的CPU
+// 用法：periodic_bench [--connections=N] [--dids=N] [--ecus=N] [--seconds=N] [--framing=raw|length|doip]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <ctime>
+
+#include "uds_service.h"
+#include "periodic_scheduler.h"
+#include "push_channel.h"
+#include "did_overlay.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// 只计数的推送通道
+class CountingChannel : public PushChannel {
+public:
+    explicit CountingChannel(FramingMode framing) : PushChannel(framing), pushes(0), bytes(0) {}
+
+    bool push(const uint8_t*, size_t size, PushPolicy) override {
+        pushes.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::atomic<uint64_t> pushes;
+    std::atomic<uint64_t> bytes;
+};
+
+double ms(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t connections = 5000;
+    size_t dids_per_connection = 8;
+    size_t ecu_count = 16;
+    int seconds = 5;
+    FramingMode framing = FramingMode::DOIP;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 14, "--connections=") == 0) {
+            connections = std::stoul(arg.substr(14));
+        } else if (arg.compare(0, 7, "--dids=") == 0) {
+            dids_per_connection = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 7, "--ecus=") == 0) {
+            ecu_count = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 10, "--seconds=") == 0) {
+            seconds = std::stoi(arg.substr(10));
+        } else if (arg.compare(0, 10, "--framing=") == 0) {
+            if (!parse_framing_mode(arg.substr(10), framing)) {
+                std::cerr << "Unknown framing mode: " << arg.substr(10) << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--connections=N] [--dids=N] [--ecus=N] [--seconds=N] [--framing=raw|length|doip]" << std::endl;
+            return 1;
+        }
+    }
+    if (connections == 0 || ecu_count == 0 || dids_per_connection == 0 || dids_per_connection > 256) {
+        std::cerr << "invalid arguments" << std::endl;
+        return 1;
+    }
+
+    // 所有ECU共享一份数据：0xF200~0xF2FF各8字节
+    std::shared_ptr<DidStore> store(new DidStore());
+    uint8_t value[8] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80};
+    for (size_t i = 0; i < 256; ++i) {
+        value[0] = static_cast<uint8_t>(i);
+        store->write(static_cast<DID>(0xF200 + i), value, sizeof(value));
+    }
+    LayeredDidSource source(store);
+
+    PeriodicSchedulerOptions scheduler_options;
+    PeriodicScheduler scheduler(scheduler_options);
+    ServiceOptions service_options;
+    service_options.periodic_scheduler = &scheduler;
+    std::vector<std::unique_ptr<UdsService>> ecus;
+    for (size_t i = 0; i < ecu_count; ++i) {
+        ecus.push_back(std::unique_ptr<UdsService>(new UdsService(source, service_options)));
+    }
+
+    // 每个连接订阅若干周期DID，速率轮流取慢/中/快
+    std::vector<std::shared_ptr<CountingChannel>> channels;
+    const uint32_t periods_ms[] = {scheduler_options.slow_ms, scheduler_options.medium_ms, scheduler_options.fast_ms};
+    double expected_per_second = 0;
+    std::vector<uint8_t> request(3);
+    std::vector<uint8_t> out;
+    Clock::time_point start = Clock::now();
+    for (size_t c = 0; c < connections; ++c) {
+        channels.push_back(std::make_shared<CountingChannel>(framing));
+        RequestContext context;
+        context.connection_id = static_cast<uint32_t>(c + 1);
+        context.tester_address = static_cast<uint16_t>(0x0E00 + c % 256);
+        context.ecu_address = static_cast<uint16_t>(0x1000 + c % ecu_count);
+        context.channel = channels.back().get();
+        UdsService& service = *ecus[c % ecu_count];
+        for (size_t d = 0; d < dids_per_connection; ++d) {
+            size_t rate = (c + d) % 3;
+            request[0] = 0x2A;
+            request[1] = static_cast<uint8_t>(0x01 + rate);
+            request[2] = static_cast<uint8_t>((c * 7 + d) % 256);
+            out.clear();
+            service.process_request(context, request.data(), request.size(), out);
+            if (out.size() != 1 || out[0] != 0x6A) {
+                std::cerr << "subscription rejected" << std::endl;
+                return 1;
+            }
+            expected_per_second += 1000.0 / periods_ms[rate];
+        }
+    }
+    double subscribe_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    size_t subscriptions = scheduler.subscription_count();
+
+    std::clock_t cpu_start = std::clock();
+    start = Clock::now();
+    scheduler.start();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    scheduler.stop();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu_s = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    uint64_t pushes = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < channels.size(); ++i) {
+        pushes += channels[i]->pushes.load();
+        bytes += channels[i]->bytes.load();
+    }
+    PeriodicSchedulerStats stats = scheduler.stats();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << subscriptions << " subscriptions (" << connections << " connections x " << dids_per_connection
+              << " DIDs, " << ecu_count << " ECUs), subscribe " << subscribe_ns / subscriptions << " ns each" << std::endl;
+    std::cout << "  messages       " << stats.messages / elapsed_s << "/s (expected " << expected_per_second
+              << "/s), " << pushes / elapsed_s << " pushes/s, " << bytes / elapsed_s / 1e6 << " MB/s" << std::endl;
+    std::cout << std::setprecision(3);
+    std::cout << "  tick lateness  p50 " << ms(stats.lateness.percentile(50)) << " ms, p99 "
+              << ms(stats.lateness.percentile(99)) << " ms, max " << ms(stats.lateness.max()) << " ms" << std::endl;
+    std::cout << "  tick work      p50 " << ms(stats.tick_duration.percentile(50)) << " ms, p99 "
+              << ms(stats.tick_duration.percentile(99)) << " ms, max " << ms(stats.tick_duration.max()) << " ms"
+              << " over " << stats.ticks << " ticks" << std::endl;
+    std::cout << std::setprecision(1) << "  scheduler CPU  " << 100.0 * cpu_s / elapsed_s << "%" << std::endl;
+    return 0;
+}
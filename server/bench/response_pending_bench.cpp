@@ -0,0 +1,205 @@
+// 慢服务卸载（NRC 0x78 + 工作线程池）对比测试
+// 一个连接线程按固定间隔处理读写混合的请求，2E写入的落盘被模拟为固定耗时，分别在连接线程上直接处理和交给工作线程池，统计：
+//   - 0x22读取从计划到达到响应生成的延迟（直接处理时会被排在前面的慢写入拖住）
+//   - 交给线程池的写入从提交到最终响应推送出去的耗时，以及处理超过P2*时重复发送的0x78次数
+// 用法：response_pending_bench [--requests=N] [--interval-us=N] [--write-every=N] [--write-ms=N] [--workers=N] [--p2-star-ms=N]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "uds_service.h"
+#include "worker_pool.h"
+#include "push_channel.h"
+#include "did_overlay.h"
+#include "latency_histogram.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// 写入前等待固定时间，模拟阻塞的落盘
+class SlowWriteSource : public DidSource {
+public:
+    SlowWriteSource(DidSource& inner, uint32_t write_ms) : inner_(inner), write_ms_(write_ms) {}
+
+    size_t read_dids(DidLookup* lookups, size_t count) const override {
+        return inner_.read_dids(lookups, count);
+    }
+
+    bool write_did(DID did, const uint8_t* data, size_t size) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(write_ms_));
+        return inner_.write_did(did, data, size);
+    }
+
+private:
+    DidSource& inner_;
+    uint32_t write_ms_;
+};
+
+// 记录推送报文的通道（raw分帧，每次推送即一条报文）
+class RecordingChannel : public PushChannel {
+public:
+    RecordingChannel() : PushChannel(FramingMode::RAW), finals(0), pendings(0) {}
+
+    bool push(const uint8_t* data, size_t size, PushPolicy) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (size == 3 && data[0] == 0x7F && data[2] == 0x78) {
+            ++pendings;
+        } else {
+            completions.push_back(Clock::now());
+            ++finals;
+        }
+        return true;
+    }
+
+    std::mutex mutex;
+    std::vector<Clock::time_point> completions;
+    size_t finals;
+    size_t pendings;
+};
+
+double ms(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+// 按固定间隔处理一轮请求，记录0x22从计划到达时刻算起的延迟和每条写入的提交时刻
+void run(UdsService& service, RecordingChannel* channel, size_t requests, uint32_t interval_us, size_t write_every,
+         LatencyHistogram& reads, std::vector<Clock::time_point>& submits, double& elapsed_ms) {
+    RequestContext context;
+    context.connection_id = 1;
+    context.tester_address = 0x0E00;
+    context.ecu_address = 0x1000;
+    context.channel = channel;
+    const uint8_t read_request[] = {0x22, 0x12, 0x34};
+    uint8_t write_request[] = {0x2E, 0x12, 0x34, 0x00, 0x00, 0x00, 0x00};
+    std::vector<uint8_t> out;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        out.clear();
+        Clock::time_point scheduled = start + std::chrono::microseconds(static_cast<uint64_t>(interval_us) * i);
+        std::this_thread::sleep_until(scheduled);
+        Clock::time_point begin = Clock::now();
+        if (i % write_every == write_every - 1) {
+            write_request[3] = static_cast<uint8_t>(i);
+            service.process_request(context, write_request, sizeof(write_request), out);
+            submits.push_back(begin);
+        } else {
+            service.process_request(context, read_request, sizeof(read_request), out);
+            reads.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled).count()));
+        }
+    }
+    elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t requests = 500;
+    uint32_t interval_us = 1000;
+    size_t write_every = 10;
+    uint32_t write_ms = 20;
+    size_t workers = 2;
+    uint16_t p2_star_ms = 5000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 11, "--requests=") == 0) {
+            requests = std::stoul(arg.substr(11));
+        } else if (arg.compare(0, 14, "--interval-us=") == 0) {
+            interval_us = static_cast<uint32_t>(std::stoul(arg.substr(14)));
+        } else if (arg.compare(0, 14, "--write-every=") == 0) {
+            write_every = std::stoul(arg.substr(14));
+        } else if (arg.compare(0, 11, "--write-ms=") == 0) {
+            write_ms = static_cast<uint32_t>(std::stoul(arg.substr(11)));
+        } else if (arg.compare(0, 10, "--workers=") == 0) {
+            workers = std::stoul(arg.substr(10));
+        } else if (arg.compare(0, 13, "--p2-star-ms=") == 0) {
+            p2_star_ms = static_cast<uint16_t>(std::stoul(arg.substr(13)));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--requests=N] [--interval-us=N] [--write-every=N] [--write-ms=N]"
+                      << " [--workers=N] [--p2-star-ms=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (requests == 0 || write_every == 0 || workers == 0 || p2_star_ms < 10) {
+        std::cerr << "invalid arguments" << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<DidStore> store(new DidStore());
+    const uint8_t value[] = {0x03, 0x04, 0x05, 0x06};
+    store->write(0x1234, value, sizeof(value));
+    LayeredDidSource layered(store);
+    SlowWriteSource source(layered, write_ms);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << requests << " requests every " << interval_us << " us, one 2E in every " << write_every
+              << ", each write takes " << write_ms << " ms" << std::endl;
+
+    // 在连接线程上直接处理
+    {
+        UdsService service(source);
+        LatencyHistogram reads;
+        std::vector<Clock::time_point> submits;
+        double elapsed_ms;
+        run(service, nullptr, requests, interval_us, write_every, reads, submits, elapsed_ms);
+        std::cout << "  inline         0x22 p50 " << ms(reads.percentile(50)) << " ms, p99 "
+                  << ms(reads.percentile(99)) << " ms, max " << ms(reads.max()) << " ms; all requests in "
+                  << elapsed_ms << " ms" << std::endl;
+    }
+
+    // 写入交给工作线程池
+    {
+        WorkerPoolOptions pool_options;
+        pool_options.threads = workers;
+        WorkerPool pool(pool_options);
+        pool.start();
+        ServiceOptions service_options;
+        service_options.worker_pool = &pool;
+        service_options.offloaded_services.set(static_cast<uint8_t>(ServiceID::WRITE_DATA_BY_IDENTIFIER));
+        service_options.p2_star_ms = p2_star_ms;
+        UdsService service(source, service_options);
+        std::shared_ptr<RecordingChannel> channel = std::make_shared<RecordingChannel>();
+
+        LatencyHistogram reads;
+        std::vector<Clock::time_point> submits;
+        double elapsed_ms;
+        run(service, channel.get(), requests, interval_us, write_every, reads, submits, elapsed_ms);
+        while (pool.stats().queued > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        WorkerPoolStats stats = pool.stats();
+        pool.stop();
+
+        // 同一连接的写入按提交顺序完成（线程数为1时严格成立），这里只统计总体分布
+        LatencyHistogram completions;
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        std::vector<Clock::time_point> done = channel->completions;
+        std::sort(done.begin(), done.end());
+        for (size_t i = 0; i < done.size() && i < submits.size(); ++i) {
+            completions.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(done[i] - submits[i]).count()));
+        }
+        std::cout << "  offloaded      0x22 p50 " << ms(reads.percentile(50)) << " ms, p99 "
+                  << ms(reads.percentile(99)) << " ms, max " << ms(reads.max()) << " ms; all requests in "
+                  << elapsed_ms << " ms" << std::endl;
+        std::cout << "  final response p50 " << ms(completions.percentile(50)) << " ms, max "
+                  << ms(completions.max()) << " ms after submit; " << stats.completed << " completed, "
+                  << stats.rejected << " rejected, " << channel->pendings << " repeated 0x78 (P2* "
+                  << p2_star_ms << " ms)" << std::endl;
+        if (channel->finals != submits.size() || channel->pendings != stats.repeats) {
+            std::cerr << "unexpected pushes" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+// 诊断会话与S3超时压力测试
+// 大量测试端在多个ECU上进入扩展会话，之后每隔固定间隔发送一次TesterPresent（抑制肯定响应），
+// 其中一部分测试端在第一轮之后不再发送。直接调用服务（不经过socket），统计：
+//   - 单条TesterPresent的处理耗时
+//   - 停止发送的测试端是否都在S3之后超时、其余测试端是否都保持在扩展会话
+//   - 整个进程占用的CPU（包括超时检查线程）
+// 用法：session_bench [--testers=N] [--ecus=N] [--interval-ms=N] [--s3-ms=N] [--silent=N] [--seconds=N]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <ctime>
+
+#include "uds_service.h"
+#include "session_manager.h"
+#include "did_overlay.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t testers = 10000;
+    size_t ecu_count = 16;
+    uint32_t interval_ms = 2000;
+    uint32_t s3_ms = 5000;
+    size_t silent = 1000;
+    int seconds = 12;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 10, "--testers=") == 0) {
+            testers = std::stoul(arg.substr(10));
+        } else if (arg.compare(0, 7, "--ecus=") == 0) {
+            ecu_count = std::stoul(arg.substr(7));
+        } else if (arg.compare(0, 14, "--interval-ms=") == 0) {
+            interval_ms = static_cast<uint32_t>(std::stoul(arg.substr(14)));
+        } else if (arg.compare(0, 8, "--s3-ms=") == 0) {
+            s3_ms = static_cast<uint32_t>(std::stoul(arg.substr(8)));
+        } else if (arg.compare(0, 9, "--silent=") == 0) {
+            silent = std::stoul(arg.substr(9));
+        } else if (arg.compare(0, 10, "--seconds=") == 0) {
+            seconds = std::stoi(arg.substr(10));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--testers=N] [--ecus=N] [--interval-ms=N] [--s3-ms=N]"
+                      << " [--silent=N] [--seconds=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (testers == 0 || ecu_count == 0 || silent > testers || interval_ms == 0 || interval_ms >= s3_ms ||
+        static_cast<uint64_t>(seconds) * 1000 <= s3_ms) {
+        std::cerr << "invalid arguments (interval must be shorter than S3, run must be longer than S3)" << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<DidStore> store(new DidStore());
+    LayeredDidSource source(store);
+    SessionManagerOptions session_options;
+    session_options.s3_ms = s3_ms;
+    SessionManager sessions(session_options);
+    ServiceOptions service_options;
+    service_options.session_manager = &sessions;
+    std::vector<std::unique_ptr<UdsService>> ecus;
+    for (size_t i = 0; i < ecu_count; ++i) {
+        ecus.push_back(std::unique_ptr<UdsService>(new UdsService(source, service_options)));
+    }
+    sessions.start();
+
+    std::vector<RequestContext> contexts(testers);
+    for (size_t t = 0; t < testers; ++t) {
+        contexts[t].connection_id = static_cast<uint32_t>(t / 4 + 1);
+        contexts[t].tester_address = static_cast<uint16_t>(0x0E00 + t % 4);
+        contexts[t].ecu_address = static_cast<uint16_t>(0x1000 + t % ecu_count);
+    }
+
+    // 全部进入扩展会话
+    const uint8_t extended[] = {0x10, 0x03};
+    std::vector<uint8_t> out;
+    for (size_t t = 0; t < testers; ++t) {
+        out.clear();
+        ecus[t % ecu_count]->process_request(contexts[t], extended, sizeof(extended), out);
+        if (out.empty() || out[0] != 0x50) {
+            std::cerr << "session change rejected" << std::endl;
+            return 1;
+        }
+    }
+
+    // 每轮所有测试端各发一条TesterPresent，前silent个测试端只发第一轮
+    const uint8_t tester_present[] = {0x3E, 0x80};
+    uint64_t requests = 0;
+    double request_ns = 0;
+    std::clock_t cpu_start = std::clock();
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::seconds(seconds);
+    for (Clock::time_point round = start; round < end; round += std::chrono::milliseconds(interval_ms)) {
+        std::this_thread::sleep_until(round);
+        size_t first = round == start ? 0 : silent;
+        Clock::time_point begin = Clock::now();
+        for (size_t t = first; t < testers; ++t) {
+            out.clear();
+            ecus[t % ecu_count]->process_request(contexts[t], tester_present, sizeof(tester_present), out);
+            if (!out.empty()) {
+                std::cerr << "unexpected response to suppressed TesterPresent" << std::endl;
+                return 1;
+            }
+        }
+        request_ns += std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        requests += testers - first;
+    }
+    std::this_thread::sleep_until(end);
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu_s = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    size_t active = sessions.active_count();
+    uint64_t timeouts = sessions.timeouts();
+    sessions.stop();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << testers << " testers on " << ecu_count << " ECUs, TesterPresent every " << interval_ms
+              << " ms, S3 " << s3_ms << " ms, " << silent << " silent" << std::endl;
+    std::cout << "  TesterPresent  " << request_ns / requests << " ns each (" << requests << " requests)" << std::endl;
+    std::cout << "  sessions       " << active << " active (expected " << testers - silent << "), " << timeouts
+              << " timed out (expected " << silent << ")" << std::endl;
+    std::cout << std::setprecision(2) << "  process CPU    " << 100.0 * cpu_s / elapsed_s << "%" << std::endl;
+    return active == testers - silent && timeouts == silent ? 0 : 1;
+}
@@ -0,0 +1,344 @@
+// 块传输（0x34~0x37）吞吐测试
+// 连接到运行中的uds_server（需用--transfer-dir启用块传输，分帧为length或doip），每轮：
+//   1. 0x34下载一个size字节的映像，按服务端报告的最大块长度逐块0x36发送，0x37结束（映像生效）
+//   2. 0x35上传同一地址的映像，逐块0x36读回并与下载的数据逐字节比对，0x37结束
+// 统计每个方向的吞吐（MB/s）与每块往返时间。块必须逐个确认，吞吐受块长度与往返延迟共同影响
+// 用法：transfer_bench [--host=127.0.0.1] [--port=8888] [--framing=length|doip] [--size=MB] [--rounds=N]
+//                      [--block=N] [--address=0x10000] [--target=1000]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET SocketType;
+    #define INVALID_SOCKET_VALUE INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SocketType;
+    #define INVALID_SOCKET_VALUE -1
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+#include "frame_codec.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint16_t TESTER_ADDRESS = 0x0E00;
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 8888;
+    FramingMode framing = FramingMode::LENGTH_PREFIXED;
+    size_t size = 64 * 1024 * 1024;
+    size_t rounds = 3;
+    size_t block = 0;              // 每块数据字节数上限，0表示按服务端报告的最大块长度
+    uint32_t address = 0x10000;
+    uint16_t target = DOIP_ENTITY_ADDRESS;
+};
+
+bool parse_options(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg.compare(0, 7, "--host=") == 0) {
+                options.host = arg.substr(7);
+            } else if (arg.compare(0, 7, "--port=") == 0) {
+                options.port = std::stoi(arg.substr(7));
+            } else if (arg.compare(0, 10, "--framing=") == 0) {
+                if (!parse_framing_mode(arg.substr(10), options.framing) || options.framing == FramingMode::RAW) {
+                    return false;
+                }
+            } else if (arg.compare(0, 7, "--size=") == 0) {
+                options.size = static_cast<size_t>(std::stod(arg.substr(7)) * 1024 * 1024);
+            } else if (arg.compare(0, 9, "--rounds=") == 0) {
+                options.rounds = std::stoul(arg.substr(9));
+            } else if (arg.compare(0, 8, "--block=") == 0) {
+                options.block = std::stoul(arg.substr(8));
+            } else if (arg.compare(0, 10, "--address=") == 0) {
+                options.address = static_cast<uint32_t>(std::stoul(arg.substr(10), nullptr, 0));
+            } else if (arg.compare(0, 9, "--target=") == 0) {
+                options.target = static_cast<uint16_t>(std::stoul(arg.substr(9), nullptr, 16));
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return options.size > 0 && options.size <= 0xFFFFFFFFULL && options.rounds > 0;
+}
+
+bool send_all(SocketType sock, const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (offset < size) {
+        int sent = send(sock, reinterpret_cast<const char*>(data) + offset, static_cast<int>(size - offset), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// 一个连接上的同步请求/响应
+class Client {
+public:
+    Client(const BenchOptions& options) : options_(options), socket_(INVALID_SOCKET_VALUE), reader_(options.framing) {
+    }
+
+    ~Client() {
+        if (socket_ != INVALID_SOCKET_VALUE) {
+            CLOSE_SOCKET(socket_);
+        }
+    }
+
+    bool connect_to(std::string& error) {
+        socket_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (socket_ == INVALID_SOCKET_VALUE) {
+            error = "socket() failed";
+            return false;
+        }
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+        if (inet_pton(AF_INET, options_.host.c_str(), &addr.sin_addr) != 1 ||
+            connect(socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            error = "connect to " + options_.host + ":" + std::to_string(options_.port) + " failed";
+            return false;
+        }
+        int nodelay = 1;
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+        return true;
+    }
+
+    // 发送一条请求：head为UDS报文的开头部分，body（可为空）紧随其后，直接从调用者的缓冲区发出
+    bool request(const uint8_t* head, size_t head_size, const uint8_t* body, size_t body_size) {
+        header_.clear();
+        size_t uds_size = head_size + body_size;
+        if (options_.framing == FramingMode::DOIP) {
+            const uint8_t doip[] = {0x02, 0xFD, 0x80, 0x01};
+            header_.insert(header_.end(), doip, doip + sizeof(doip));
+            append_u32(static_cast<uint32_t>(4 + uds_size));
+            header_.push_back(static_cast<uint8_t>(TESTER_ADDRESS >> 8));
+            header_.push_back(static_cast<uint8_t>(TESTER_ADDRESS & 0xFF));
+            header_.push_back(static_cast<uint8_t>(options_.target >> 8));
+            header_.push_back(static_cast<uint8_t>(options_.target & 0xFF));
+        } else {
+            append_u32(static_cast<uint32_t>(uds_size));
+        }
+        header_.insert(header_.end(), head, head + head_size);
+        return send_all(socket_, header_.data(), header_.size()) && send_all(socket_, body, body_size);
+    }
+
+    // 等待下一条响应，payload在下一次调用前有效
+    bool response(ByteView& payload) {
+        bool nack;
+        while (!reader_.next(payload, nack)) {
+            int received = recv(socket_, reinterpret_cast<char*>(buffer_), sizeof(buffer_), 0);
+            if (received <= 0) {
+                return false;
+            }
+            reader_.feed(buffer_, static_cast<size_t>(received));
+        }
+        return !nack;
+    }
+
+private:
+    void append_u32(uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            header_.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    const BenchOptions& options_;
+    SocketType socket_;
+    ResponseDecoder reader_;
+    std::vector<uint8_t> header_;
+    uint8_t buffer_[256 * 1024];
+};
+
+std::string describe(const ByteView& payload) {
+    std::string text;
+    char hex[4];
+    for (size_t i = 0; i < payload.size && i < 4; ++i) {
+        std::snprintf(hex, sizeof(hex), "%02X ", payload.data[i]);
+        text += hex;
+    }
+    return text.empty() ? "(empty)" : text;
+}
+
+// 0x34/0x35：返回每块可携带的数据字节数，失败返回0
+size_t request_transfer(Client& client, const BenchOptions& options, uint8_t service_id, std::string& error) {
+    uint8_t request[11] = {service_id, 0x00, 0x44};
+    for (int i = 0; i < 4; ++i) {
+        request[3 + i] = static_cast<uint8_t>(options.address >> (24 - 8 * i));
+        request[7 + i] = static_cast<uint8_t>(options.size >> (24 - 8 * i));
+    }
+    ByteView payload;
+    if (!client.request(request, sizeof(request), nullptr, 0) || !client.response(payload)) {
+        error = "connection lost";
+        return 0;
+    }
+    if (payload.size < 3 || payload.data[0] != service_id + 0x40) {
+        error = "unexpected response " + describe(payload);
+        return 0;
+    }
+    size_t length_bytes = payload.data[1] >> 4;
+    uint32_t block_length = 0;
+    for (size_t i = 0; i < length_bytes && 2 + i < payload.size; ++i) {
+        block_length = (block_length << 8) | payload.data[2 + i];
+    }
+    size_t block = block_length > 2 ? block_length - 2 : 0;
+    if (options.block != 0 && options.block < block) {
+        block = options.block;
+    }
+    if (block == 0) {
+        error = "invalid maxNumberOfBlockLength";
+    }
+    return block;
+}
+
+bool transfer_exit(Client& client, std::string& error) {
+    const uint8_t request[] = {0x37};
+    ByteView payload;
+    if (!client.request(request, sizeof(request), nullptr, 0) || !client.response(payload)) {
+        error = "connection lost";
+        return false;
+    }
+    if (payload.size < 1 || payload.data[0] != 0x77) {
+        error = "0x37 failed: " + describe(payload);
+        return false;
+    }
+    return true;
+}
+
+bool download(Client& client, const BenchOptions& options, const std::vector<uint8_t>& image, size_t& blocks,
+              std::string& error) {
+    size_t block = request_transfer(client, options, 0x34, error);
+    if (block == 0) {
+        return false;
+    }
+    uint8_t counter = 0;
+    for (size_t offset = 0; offset < image.size(); offset += block) {
+        size_t length = std::min(block, image.size() - offset);
+        const uint8_t head[] = {0x36, ++counter};
+        ByteView payload;
+        if (!client.request(head, sizeof(head), image.data() + offset, length) || !client.response(payload)) {
+            error = "connection lost";
+            return false;
+        }
+        if (payload.size != 2 || payload.data[0] != 0x76 || payload.data[1] != counter) {
+            error = "0x36 failed: " + describe(payload);
+            return false;
+        }
+        ++blocks;
+    }
+    return transfer_exit(client, error);
+}
+
+bool upload(Client& client, const BenchOptions& options, const std::vector<uint8_t>& image, size_t& blocks,
+            std::string& error) {
+    if (request_transfer(client, options, 0x35, error) == 0) {
+        return false;
+    }
+    uint8_t counter = 0;
+    size_t offset = 0;
+    while (offset < image.size()) {
+        const uint8_t head[] = {0x36, ++counter};
+        ByteView payload;
+        if (!client.request(head, sizeof(head), nullptr, 0) || !client.response(payload)) {
+            error = "connection lost";
+            return false;
+        }
+        if (payload.size <= 2 || payload.data[0] != 0x76 || payload.data[1] != counter) {
+            error = "0x36 failed: " + describe(payload);
+            return false;
+        }
+        size_t length = payload.size - 2;
+        if (length > image.size() - offset || std::memcmp(payload.data + 2, image.data() + offset, length) != 0) {
+            error = "uploaded data differs from the downloaded image at offset " + std::to_string(offset);
+            return false;
+        }
+        offset += length;
+        ++blocks;
+    }
+    return transfer_exit(client, error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=8888] [--framing=length|doip] [--size=MB]"
+                  << " [--rounds=N] [--block=N] [--address=0x10000] [--target=1000]" << std::endl;
+        return 1;
+    }
+
+    #ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+    #endif
+
+    std::vector<uint8_t> image(options.size);
+    uint32_t seed = 0x12345678;
+    for (size_t i = 0; i < image.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        image[i] = static_cast<uint8_t>(seed >> 16);
+    }
+
+    Client client(options);
+    std::string error;
+    if (!client.connect_to(error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    double mb = static_cast<double>(options.size) / (1024 * 1024);
+    double best_down = 0;
+    double best_up = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t round = 0; round < options.rounds; ++round) {
+        size_t down_blocks = 0;
+        size_t up_blocks = 0;
+        Clock::time_point start = Clock::now();
+        if (!download(client, options, image, down_blocks, error)) {
+            std::cerr << "download: " << error << std::endl;
+            return 1;
+        }
+        Clock::time_point middle = Clock::now();
+        if (!upload(client, options, image, up_blocks, error)) {
+            std::cerr << "upload: " << error << std::endl;
+            return 1;
+        }
+        double down_s = std::chrono::duration<double>(middle - start).count();
+        double up_s = std::chrono::duration<double>(Clock::now() - middle).count();
+        best_down = std::max(best_down, mb / down_s);
+        best_up = std::max(best_up, mb / up_s);
+        std::cout << "round " << round + 1 << ": download " << mb / down_s << " MB/s (" << down_blocks << " blocks, "
+                  << down_s * 1e6 / down_blocks << " us/block), upload " << mb / up_s << " MB/s (" << up_blocks
+                  << " blocks, " << up_s * 1e6 / up_blocks << " us/block)" << std::endl;
+    }
+    std::cout << "best: download " << best_down << " MB/s, upload " << best_up << " MB/s for a " << mb
+              << " MB image" << std::endl;
+    return 0;
+}
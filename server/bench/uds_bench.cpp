@@ -0,0 +1,487 @@
+// UDS服务端压测工具
+// 打开N个TCP连接，按配置的0x22/0x2E比例发送请求，统计吞吐量与延迟分布（p50/p99/p999）：
+//   closed模式：每个连接收到响应后立即发送下一条（length/doip分帧下可用--pipeline保持多条在途），测最大吞吐
+//   open模式  ：按固定总速率发送，延迟从计划发送时刻算起，服务端变慢时排队时间也计入延迟
+// --reconnect=N时每个连接发完N条请求后断开重连，模拟大量测试端反复重连，另外统计建立连接的速率与耗时
+// 可用于uds_server（各种模式与分帧）和uds_server_simple（只支持raw分帧）
+// 用法：uds_bench [--host=127.0.0.1] [--port=8888] [--connections=N] [--duration=S] [--warmup=S]
+//                 [--mode=closed|open] [--rate=总请求数每秒] [--pipeline=N] [--framing=raw|length|doip]
+//                 [--write-percent=P] [--dids=F190,1234] [--write-dids=FD00] [--value-size=N]
+//                 [--target=1000] [--reconnect=N] [--json]
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET SocketType;
+    #define INVALID_SOCKET_VALUE INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SocketType;
+    #define INVALID_SOCKET_VALUE -1
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+#include "frame_codec.h"
+#include "latency_histogram.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::duration SPIN_WINDOW = std::chrono::microseconds(200);
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 8888;
+    size_t connections = 1;
+    double duration_s = 10;
+    double warmup_s = 1;
+    bool open_loop = false;
+    double rate = 0;               // open模式下所有连接合计的请求速率
+    size_t pipeline = 1;           // closed模式下每个连接的在途请求数
+    FramingMode framing = FramingMode::RAW;
+    int write_percent = 0;
+    std::vector<uint16_t> dids = {0x1234, 0x5678, 0x0001, 0x0002};
+    std::vector<uint16_t> write_dids = {0xFD00};
+    size_t value_size = 4;
+    uint16_t target_address = DOIP_ENTITY_ADDRESS;
+    size_t reconnect = 0;          // 每个连接发送的请求数，之后断开重连；0表示不重连
+    bool json = false;
+};
+
+// 每个连接的统计
+struct WorkerResult {
+    LatencyHistogram histogram;
+    LatencyHistogram connect_histogram;   // 重连时connect()的耗时
+    uint64_t connects = 0;                // 统计区间内的重连次数
+    uint64_t requests = 0;
+    uint64_t negative = 0;   // 负响应或DoIP否定确认
+    bool failed = false;
+    std::string error;
+};
+
+inline uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+bool parse_did_list(const std::string& text, std::vector<uint16_t>& dids) {
+    dids.clear();
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        try {
+            unsigned long value = std::stoul(item, nullptr, 16);
+            if (value > 0xFFFF) {
+                return false;
+            }
+            dids.push_back(static_cast<uint16_t>(value));
+        } catch (...) {
+            return false;
+        }
+    }
+    return !dids.empty();
+}
+
+SocketType connect_to(const BenchOptions& options, std::string& error) {
+    SocketType sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET_VALUE) {
+        error = "socket() failed";
+        return sock;
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) {
+        CLOSE_SOCKET(sock);
+        error = "invalid host " + options.host;
+        return INVALID_SOCKET_VALUE;
+    }
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        CLOSE_SOCKET(sock);
+        error = "connect to " + options.host + ":" + std::to_string(options.port) + " failed";
+        return INVALID_SOCKET_VALUE;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+    return sock;
+}
+
+bool send_all(SocketType sock, const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        int sent = send(sock, reinterpret_cast<const char*>(data.data()) + offset,
+                        static_cast<int>(data.size() - offset), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// 预先封装好的请求帧
+struct RequestSet {
+    std::vector<std::vector<uint8_t>> reads;
+    std::vector<std::vector<uint8_t>> writes;
+};
+
+RequestSet build_requests(const BenchOptions& options) {
+    RequestSet set;
+    for (size_t i = 0; i < options.dids.size(); ++i) {
+        std::vector<uint8_t> payload = {0x22, static_cast<uint8_t>(options.dids[i] >> 8),
+                                        static_cast<uint8_t>(options.dids[i] & 0xFF)};
+        std::vector<uint8_t> framed;
+        encode_request(options.framing, 0x0E00, options.target_address, payload, framed);
+        set.reads.push_back(framed);
+    }
+    for (size_t i = 0; i < options.write_dids.size(); ++i) {
+        std::vector<uint8_t> payload = {0x2E, static_cast<uint8_t>(options.write_dids[i] >> 8),
+                                        static_cast<uint8_t>(options.write_dids[i] & 0xFF)};
+        for (size_t k = 0; k < options.value_size; ++k) {
+            payload.push_back(static_cast<uint8_t>(k));
+        }
+        std::vector<uint8_t> framed;
+        encode_request(options.framing, 0x0E00, options.target_address, payload, framed);
+        set.writes.push_back(framed);
+    }
+    return set;
+}
+
+void run_worker(const BenchOptions& options, const RequestSet& requests, size_t index,
+                Clock::time_point start, Clock::time_point measure_start, Clock::time_point end,
+                WorkerResult& result) {
+    SocketType sock = connect_to(options, result.error);
+    if (sock == INVALID_SOCKET_VALUE) {
+        result.failed = true;
+        return;
+    }
+
+    ResponseDecoder reader(options.framing);
+    uint32_t random_state = static_cast<uint32_t>(2654435761u * (index + 1));
+    size_t depth = options.open_loop ? 1 : options.pipeline;
+
+    // 在途请求的计划发送时刻（环形队列）
+    std::vector<Clock::time_point> inflight(depth);
+    size_t head = 0;
+    size_t outstanding = 0;
+
+    // 当前连接上已发送的请求数（--reconnect）
+    size_t sent_on_connection = 0;
+
+    // open模式：各连接平分总速率，起始时刻错开
+    Clock::duration interval = Clock::duration::zero();
+    Clock::time_point next_send = start;
+    if (options.open_loop) {
+        interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(options.connections) / options.rate));
+        next_send = start + interval * static_cast<int>(index) / static_cast<int>(options.connections);
+    }
+
+    char buffer[16384];
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= end && outstanding == 0) {
+            break;
+        }
+
+        // 当前连接的请求都已完成：断开重连
+        if (options.reconnect > 0 && sent_on_connection >= options.reconnect && outstanding == 0) {
+            CLOSE_SOCKET(sock);
+            Clock::time_point connect_start = Clock::now();
+            sock = connect_to(options, result.error);
+            if (sock == INVALID_SOCKET_VALUE) {
+                result.failed = true;
+                return;
+            }
+            Clock::time_point connected = Clock::now();
+            if (connect_start >= measure_start && connected < end) {
+                result.connect_histogram.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(connected - connect_start).count()));
+                ++result.connects;
+            }
+            reader = ResponseDecoder(options.framing);
+            sent_on_connection = 0;
+            continue;
+        }
+
+        // 补足在途请求
+        while (outstanding < depth && now < end &&
+               (options.reconnect == 0 || sent_on_connection < options.reconnect)) {
+            if (options.open_loop) {
+                // 睡眠的唤醒误差有几十微秒，最后一小段改为让出CPU等待
+                if (next_send - now > SPIN_WINDOW) {
+                    std::this_thread::sleep_until(next_send - SPIN_WINDOW);
+                }
+                while (Clock::now() < next_send) {
+                    std::this_thread::yield();
+                }
+                // 延迟从计划时刻算起，发送落后于计划时不丢弃这段排队时间
+                inflight[(head + outstanding) % depth] = next_send;
+                next_send += interval;
+            } else {
+                inflight[(head + outstanding) % depth] = Clock::now();
+            }
+
+            bool write = options.write_percent > 0 &&
+                         static_cast<int>(next_random(random_state) % 100) < options.write_percent;
+            const std::vector<std::vector<uint8_t>>& pool = write ? requests.writes : requests.reads;
+            if (!send_all(sock, pool[next_random(random_state) % pool.size()])) {
+                result.failed = true;
+                result.error = "send failed";
+                CLOSE_SOCKET(sock);
+                return;
+            }
+            ++outstanding;
+            ++sent_on_connection;
+            now = Clock::now();
+        }
+
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            result.failed = true;
+            result.error = "connection closed by server";
+            CLOSE_SOCKET(sock);
+            return;
+        }
+        reader.feed(reinterpret_cast<const uint8_t*>(buffer), static_cast<size_t>(received));
+
+        ByteView response;
+        bool nack;
+        while (outstanding > 0 && reader.next(response, nack)) {
+            Clock::time_point done = Clock::now();
+            if (done >= measure_start) {
+                uint64_t latency = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(done - inflight[head]).count());
+                result.histogram.record(latency);
+                ++result.requests;
+                if (nack || response.size == 0 || response.data[0] == 0x7F) {
+                    ++result.negative;
+                }
+            }
+            head = (head + 1) % depth;
+            --outstanding;
+        }
+    }
+
+    CLOSE_SOCKET(sock);
+}
+
+bool parse_options(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--host") {
+                options.host = value;
+            } else if (key == "--port") {
+                options.port = std::stoi(value);
+            } else if (key == "--connections") {
+                options.connections = std::stoul(value);
+            } else if (key == "--duration") {
+                options.duration_s = std::stod(value);
+            } else if (key == "--warmup") {
+                options.warmup_s = std::stod(value);
+            } else if (key == "--mode") {
+                if (value != "open" && value != "closed") {
+                    return false;
+                }
+                options.open_loop = value == "open";
+            } else if (key == "--rate") {
+                options.rate = std::stod(value);
+            } else if (key == "--pipeline") {
+                options.pipeline = std::stoul(value);
+            } else if (key == "--framing") {
+                if (!parse_framing_mode(value, options.framing)) {
+                    return false;
+                }
+            } else if (key == "--write-percent") {
+                options.write_percent = std::stoi(value);
+            } else if (key == "--dids") {
+                if (!parse_did_list(value, options.dids)) {
+                    return false;
+                }
+            } else if (key == "--write-dids") {
+                if (!parse_did_list(value, options.write_dids)) {
+                    return false;
+                }
+            } else if (key == "--value-size") {
+                options.value_size = std::stoul(value);
+            } else if (key == "--target") {
+                options.target_address = static_cast<uint16_t>(std::stoul(value, nullptr, 16));
+            } else if (key == "--reconnect") {
+                options.reconnect = std::stoul(value);
+            } else if (key == "--json") {
+                options.json = true;
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+
+    if (options.connections == 0 || options.pipeline == 0 || options.duration_s <= 0 ||
+        options.write_percent < 0 || options.write_percent > 100) {
+        return false;
+    }
+    if (options.open_loop && options.rate <= 0) {
+        std::cerr << "--mode=open requires --rate" << std::endl;
+        return false;
+    }
+    if (options.framing == FramingMode::RAW && options.pipeline > 1) {
+        std::cerr << "--pipeline requires --framing=length or --framing=doip" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=8888] [--connections=N] [--duration=S]"
+                  << " [--warmup=S] [--mode=closed|open] [--rate=R] [--pipeline=N] [--framing=raw|length|doip]"
+                  << " [--write-percent=P] [--dids=F190,1234] [--write-dids=FD00] [--value-size=N]"
+                  << " [--target=1000] [--reconnect=N] [--json]" << std::endl;
+        return 1;
+    }
+
+    #ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+    #endif
+
+    RequestSet requests = build_requests(options);
+    std::vector<std::unique_ptr<WorkerResult>> results;
+    std::vector<std::thread> workers;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point measure_start = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.warmup_s));
+    Clock::time_point end = measure_start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.duration_s));
+
+    for (size_t i = 0; i < options.connections; ++i) {
+        results.push_back(std::unique_ptr<WorkerResult>(new WorkerResult()));
+        workers.push_back(std::thread(run_worker, std::cref(options), std::cref(requests), i,
+                                      start, measure_start, end, std::ref(*results[i])));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    LatencyHistogram total;
+    LatencyHistogram connect_total;
+    uint64_t connects = 0;
+    uint64_t requests_done = 0;
+    uint64_t negative = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        total.merge(results[i]->histogram);
+        connect_total.merge(results[i]->connect_histogram);
+        connects += results[i]->connects;
+        requests_done += results[i]->requests;
+        negative += results[i]->negative;
+        if (results[i]->failed) {
+            if (failed == 0) {
+                std::cerr << "connection " << i << ": " << results[i]->error << std::endl;
+            }
+            ++failed;
+        }
+    }
+
+    double throughput = static_cast<double>(requests_done) / options.duration_s;
+    double connect_rate = static_cast<double>(connects) / options.duration_s;
+    const double us = 1000.0;
+    const char* framing_names[] = {"raw", "length", "doip"};
+    const char* framing = framing_names[static_cast<int>(options.framing)];
+
+    if (options.json) {
+        std::cout << std::fixed << std::setprecision(3)
+                  << "{\"mode\": \"" << (options.open_loop ? "open" : "closed") << "\""
+                  << ", \"framing\": \"" << framing << "\""
+                  << ", \"connections\": " << options.connections
+                  << ", \"pipeline\": " << (options.open_loop ? 1 : options.pipeline)
+                  << ", \"target_rate\": " << options.rate
+                  << ", \"write_percent\": " << options.write_percent
+                  << ", \"duration_s\": " << options.duration_s
+                  << ", \"requests\": " << requests_done
+                  << ", \"negative_responses\": " << negative
+                  << ", \"failed_connections\": " << failed
+                  << ", \"throughput_rps\": " << throughput
+                  << ", \"latency_us\": {\"min\": " << total.min() / us
+                  << ", \"mean\": " << total.mean() / us
+                  << ", \"p50\": " << total.percentile(50) / us
+                  << ", \"p90\": " << total.percentile(90) / us
+                  << ", \"p99\": " << total.percentile(99) / us
+                  << ", \"p999\": " << total.percentile(99.9) / us
+                  << ", \"max\": " << total.max() / us << "}";
+        if (options.reconnect > 0) {
+            std::cout << ", \"reconnect\": " << options.reconnect
+                      << ", \"connects\": " << connects
+                      << ", \"connect_rate\": " << connect_rate
+                      << ", \"connect_latency_us\": {\"p50\": " << connect_total.percentile(50) / us
+                      << ", \"p99\": " << connect_total.percentile(99) / us
+                      << ", \"max\": " << connect_total.max() / us << "}";
+        }
+        std::cout << "}" << std::endl;
+    } else {
+        std::cout << (options.open_loop ? "open-loop" : "closed-loop") << ", " << options.connections
+                  << " connection(s), framing " << framing;
+        if (options.open_loop) {
+            std::cout << ", target " << options.rate << " req/s";
+        } else if (options.pipeline > 1) {
+            std::cout << ", pipeline " << options.pipeline;
+        }
+        std::cout << ", " << options.write_percent << "% writes, " << options.duration_s << " s" << std::endl;
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  requests   " << requests_done << " (" << negative << " negative, "
+                  << failed << " failed connection(s))" << std::endl
+                  << "  throughput " << throughput << " req/s" << std::endl
+                  << std::setprecision(2)
+                  << "  latency us min " << total.min() / us << "  mean " << total.mean() / us
+                  << "  p50 " << total.percentile(50) / us << "  p90 " << total.percentile(90) / us
+                  << "  p99 " << total.percentile(99) / us << "  p999 " << total.percentile(99.9) / us
+                  << "  max " << total.max() / us << std::endl;
+        if (options.reconnect > 0) {
+            std::cout << std::setprecision(1)
+                      << "  connects   " << connects << " (" << connect_rate << " /s, reconnect every "
+                      << options.reconnect << " request(s))" << std::endl
+                      << std::setprecision(2)
+                      << "  connect us p50 " << connect_total.percentile(50) / us
+                      << "  p99 " << connect_total.percentile(99) / us
+                      << "  max " << connect_total.max() / us << std::endl;
+        }
+    }
+
+    #ifdef _WIN32
+    WSACleanup();
+    #endif
+    return failed == options.connections ? 1 : 0;
+}
@@ -0,0 +1,533 @@
+// 协议编解码与DIDManager的微基准
+// 单独测量以下操作的单次耗时：
+//   protocol  ：parse_request、generate_response、bytes_to_did/did_to_bytes（以及原地解析/编码版本）
+//   did_manager：read_did/write_did，DID数量分别为16、1024、65536
+//   json      ：DidDatabase::parse_json/to_json，示例数据文件与65536个DID
+//   service   ：UdsService处理0x22请求，普通DID、0x2C动态DID与实时DID
+// 每项先校准迭代次数使单轮耗时不少于--min-time-ms，再重复--runs轮取中位数；
+// 数据集与随机序列固定，多次运行的结果可以直接比较。
+// 结果可写成CSV/JSON，并可与保存的基线（CSV）对比，超过阈值的退化以非零退出码报告
+// 用法：uds_microbench [--filter=子串] [--runs=N] [--min-time-ms=N] [--csv=FILE] [--json=FILE]
+//                     [--baseline=FILE] [--threshold=百分比] [--dir=PATH]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "uds_protocol.h"
+#include "did_manager.h"
+#include "did_database.h"
+#include "did_overlay.h"
+#include "live_did.h"
+#include "uds_service.h"
+#include "epoch.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// 防止被测代码的结果被优化掉
+volatile uint64_t g_sink = 0;
+
+inline uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+struct BenchOptions {
+    std::string filter;
+    int runs = 5;
+    double min_time_ms = 100;
+    std::string csv_path;
+    std::string json_path;
+    std::string baseline_path;
+    double threshold_percent = 10;
+    std::string dir = ".";
+};
+
+struct BenchResult {
+    std::string name;
+    double ns_per_op;   // 各轮的中位数
+    double min_ns;
+    double max_ns;
+    uint64_t iterations;  // 每轮迭代次数
+};
+
+// 被测操作：执行iterations次
+typedef std::function<void(uint64_t iterations)> BenchBody;
+
+double run_once(const BenchBody& body, uint64_t iterations) {
+    Clock::time_point start = Clock::now();
+    body(iterations);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+BenchResult measure(const std::string& name, const BenchBody& body, const BenchOptions& options) {
+    // 校准：迭代次数翻倍直到单轮耗时足够长，再按比例放大到目标时长
+    double target_ns = options.min_time_ms * 1e6;
+    uint64_t iterations = 1;
+    double elapsed = run_once(body, iterations);
+    while (elapsed < target_ns / 10) {
+        iterations *= 2;
+        elapsed = run_once(body, iterations);
+    }
+    iterations = std::max<uint64_t>(1, static_cast<uint64_t>(iterations * target_ns / elapsed));
+
+    std::vector<double> samples;
+    for (int run = 0; run < options.runs; ++run) {
+        samples.push_back(run_once(body, iterations) / static_cast<double>(iterations));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.ns_per_op = samples[samples.size() / 2];
+    result.min_ns = samples.front();
+    result.max_ns = samples.back();
+    result.iterations = iterations;
+    return result;
+}
+
+bool write_text_file(const std::string& path, const std::string& content) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+// 数据集：DID均匀分布，值长度在4/8/16/32字节间轮换
+void make_dataset(size_t count, DidDatabase& database) {
+    size_t stride = DidStore::SLOT_COUNT / count;
+    const size_t sizes[] = {4, 8, 16, 32};
+    std::vector<uint8_t> value(32);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 0; k < value.size(); ++k) {
+            value[k] = static_cast<uint8_t>(i * 7 + k);
+        }
+        database.append(static_cast<DID>(i * stride), value.data(), sizes[i % 4]);
+    }
+}
+
+std::vector<DID> collect_dids(const DidDatabase& database) {
+    std::vector<DID> dids;
+    for (size_t i = 0; i < database.count(); ++i) {
+        dids.push_back(database.entry(i).did);
+    }
+    return dids;
+}
+
+// 随机但固定的访问序列
+std::vector<DID> make_keys(const std::vector<DID>& dids, size_t count) {
+    std::vector<DID> keys(count);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = dids[next_random(state) % dids.size()];
+    }
+    return keys;
+}
+
+class MicroBench {
+public:
+    explicit MicroBench(const BenchOptions& options) : options_(options) {}
+
+    void add(const std::string& name, const BenchBody& body) {
+        if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos) {
+            return;
+        }
+        BenchResult result = measure(name, body, options_);
+        std::cout << std::left << std::setw(40) << result.name << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << result.ns_per_op
+                  << std::setw(14) << result.min_ns
+                  << std::setw(14) << result.max_ns
+                  << std::setw(14) << result.iterations << std::endl;
+        results_.push_back(result);
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+private:
+    const BenchOptions& options_;
+    std::vector<BenchResult> results_;
+};
+
+void bench_protocol(MicroBench& bench) {
+    const std::vector<uint8_t> read_request = {0x22, 0xF1, 0x90};
+    const std::vector<uint8_t> write_request = {0x2E, 0xF1, 0x90, 0x01, 0x02, 0x03, 0x04};
+
+    bench.add("protocol/parse_request", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            UdsMessage message = parse_request(write_request);
+            g_sink += message.did + message.data.size();
+        }
+    });
+
+    bench.add("protocol/parse_request_view", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            UdsRequestView request;
+            parse_request(read_request.data(), read_request.size(), request);
+            g_sink += request.did + request.payload.size;
+        }
+    });
+
+    UdsMessage response;
+    response.service_id = ServiceID::READ_DATA_BY_IDENTIFIER;
+    response.did = 0xF190;
+    response.data = {0x01, 0x02, 0x03, 0x04};
+    response.is_positive_response = true;
+    response.response_code = ResponseCode::POSITIVE_RESPONSE;
+    bench.add("protocol/generate_response", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::vector<uint8_t> out = generate_response(response);
+            g_sink += out.size();
+        }
+    });
+
+    std::vector<uint8_t> out;
+    out.reserve(64);
+    bench.add("protocol/encode_positive_response", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            out.clear();
+            encode_positive_response(response.service_id, response.did, response.data.data(),
+                                     response.data.size(), out);
+            g_sink += out.size();
+        }
+    });
+
+    bench.add("protocol/bytes_to_did", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            g_sink += bytes_to_did(read_request, 1);
+        }
+    });
+
+    bench.add("protocol/did_to_bytes", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::vector<uint8_t> bytes = did_to_bytes(static_cast<DID>(i));
+            g_sink += bytes[1];
+        }
+    });
+}
+
+void bench_did_manager(MicroBench& bench, const BenchOptions& options) {
+    const size_t sizes[] = {16, 1024, 65536};
+    const size_t KEY_COUNT = 4096;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        std::string suffix = "/" + std::to_string(sizes[s]);
+        std::string path = options.dir + "/uds_microbench_" + std::to_string(sizes[s]) + ".json";
+        std::vector<DID> keys;
+        {
+            DidDatabase database;
+            make_dataset(sizes[s], database);
+            std::string json = database.to_json();
+            if (!write_text_file(path, json)) {
+                std::cerr << "Failed to write " << path << std::endl;
+                return;
+            }
+            keys = make_keys(collect_dids(database), KEY_COUNT);
+        }
+
+        // 只测内存中的读写与日志追加：不fsync，测量期间不触发压缩
+        PersistenceOptions persistence;
+        persistence.fsync_policy = FsyncPolicy::NEVER;
+        persistence.compact_interval_ms = 3600 * 1000;
+        persistence.compact_journal_bytes = UINT64_MAX;
+        {
+            DIDManager manager(path, persistence);
+
+            std::vector<uint8_t> value;
+            bench.add("did_manager/read_did" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    manager.read_did(keys[i % KEY_COUNT], value);
+                    g_sink += value[0];
+                }
+            });
+
+            bench.add("did_manager/read_did_view" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    EpochManager::Guard guard;
+                    DidValueView view;
+                    manager.read_did(keys[i % KEY_COUNT], view);
+                    g_sink += view.data()[0];
+                }
+            });
+
+            std::vector<uint8_t> small(4, 0x11);
+            bench.add("did_manager/write_did" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    small[0] = static_cast<uint8_t>(i);
+                    manager.write_did(keys[i % KEY_COUNT], small);
+                }
+            });
+
+            std::vector<uint8_t> large(16, 0x22);
+            bench.add("did_manager/write_did_16B" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    large[0] = static_cast<uint8_t>(i);
+                    manager.write_did(keys[i % KEY_COUNT], large);
+                }
+            });
+        }
+        EpochManager::instance().reclaim();
+        std::remove(path.c_str());
+        std::remove((path + ".wal").c_str());
+        std::remove((path + ".wal.old").c_str());
+    }
+}
+
+void bench_json(MicroBench& bench) {
+    // 示例数据文件（与data/did_data.json相同的内容）
+    const std::string small_json =
+        "{\n"
+        "  \"version\": \"1.0\",\n"
+        "  \"description\": \"UDS DID Data\",\n"
+        "  \"dids\": {\n"
+        "    \"0001\": [86, 49, 46, 48, 46, 48, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0],\n"
+        "    \"0002\": [0, 100],\n"
+        "    \"0003\": [3, 232],\n"
+        "    \"0004\": [0, 0, 0, 1],\n"
+        "    \"1234\": [3, 4, 5, 6],\n"
+        "    \"5678\": [170, 187, 204, 221],\n"
+        "    \"9ABC\": [17, 34, 51, 68, 85, 102],\n"
+        "    \"DEFA\": [0, 0, 0, 0]\n"
+        "  }\n"
+        "}\n";
+    std::string large_json;
+    {
+        DidDatabase database;
+        make_dataset(65536, database);
+        large_json = database.to_json();
+    }
+
+    const std::string* texts[] = {&small_json, &large_json};
+    const char* names[] = {"small", "65536"};
+    for (size_t t = 0; t < 2; ++t) {
+        const std::string& text = *texts[t];
+        std::string error;
+        bench.add(std::string("json/parse_json/") + names[t], [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DidDatabase database;
+                if (!database.parse_json(text.data(), text.size(), error)) {
+                    std::cerr << error << std::endl;
+                    return;
+                }
+                g_sink += database.count();
+            }
+        });
+
+        DidDatabase database;
+        database.parse_json(text.data(), text.size(), error);
+        bench.add(std::string("json/generate_json/") + names[t], [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::string json = database.to_json();
+                g_sink += json.size();
+            }
+        });
+    }
+}
+
+void bench_service(MicroBench& bench) {
+    std::shared_ptr<DidStore> store(new DidStore());
+    const uint8_t value[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+    store->write(0x1234, value, 4);
+    store->write(0x5678, value, 8);
+    LayeredDidSource source(store);
+
+    LiveDidSource live(source);
+    std::map<std::string, std::string> params;
+    params["min"] = "0";
+    params["max"] = "120";
+    params["period-s"] = "60";
+    std::string error;
+    live.add(0x0002, create_signal_model("sine", params, "", error), 2, LiveDidSource::DEFAULT_TICK_MS, error);
+
+    // 动态DID由两个源DID的4个片段组成，其中相邻片段编译后合并
+    UdsService service(live);
+    std::vector<uint8_t> out;
+    const uint8_t define[] = {0x2C, 0x01, 0xF2, 0x00, 0x12, 0x34, 0x01, 0x02, 0x12, 0x34, 0x03, 0x02,
+                              0x56, 0x78, 0x05, 0x04, 0x12, 0x34, 0x01, 0x01};
+    service.process_request(define, sizeof(define), out);
+
+    const std::vector<uint8_t> requests[] = {{0x22, 0x12, 0x34}, {0x22, 0xF2, 0x00}, {0x22, 0x00, 0x02}};
+    const char* names[] = {"service/read_static", "service/read_dynamic", "service/read_live"};
+    out.reserve(64);
+    for (size_t r = 0; r < 3; ++r) {
+        const std::vector<uint8_t>& request = requests[r];
+        bench.add(names[r], [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                out.clear();
+                service.process_request(request.data(), request.size(), out);
+                g_sink += out.size();
+            }
+        });
+    }
+}
+
+std::string to_csv(const std::vector<BenchResult>& results) {
+    std::ostringstream oss;
+    oss << "name,ns_per_op,min_ns,max_ns,iterations\n";
+    oss << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < results.size(); ++i) {
+        oss << results[i].name << "," << results[i].ns_per_op << "," << results[i].min_ns << ","
+            << results[i].max_ns << "," << results[i].iterations << "\n";
+    }
+    return oss.str();
+}
+
+std::string to_json(const std::vector<BenchResult>& results) {
+    std::ostringstream oss;
+    oss << "{\n  \"results\": [\n";
+    oss << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < results.size(); ++i) {
+        oss << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].ns_per_op
+            << ", \"min_ns\": " << results[i].min_ns << ", \"max_ns\": " << results[i].max_ns
+            << ", \"iterations\": " << results[i].iterations << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    oss << "  ]\n}\n";
+    return oss.str();
+}
+
+// 读取基线CSV（忽略#开头的注释行和表头）
+bool load_baseline(const std::string& path, std::map<std::string, double>& baseline) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#' || line.compare(0, 5, "name,") == 0) {
+            continue;
+        }
+        size_t comma = line.find(',');
+        if (comma == std::string::npos) {
+            continue;
+        }
+        try {
+            baseline[line.substr(0, comma)] = std::stod(line.substr(comma + 1));
+        } catch (...) {
+        }
+    }
+    return true;
+}
+
+// 与基线对比，返回超过阈值的退化项数
+size_t compare_with_baseline(const std::vector<BenchResult>& results,
+                             const std::map<std::string, double>& baseline, double threshold_percent) {
+    size_t regressions = 0;
+    std::cout << std::endl << std::left << std::setw(40) << "vs baseline" << std::right
+              << std::setw(14) << "baseline ns" << std::setw(14) << "now ns" << std::setw(12) << "change" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::map<std::string, double>::const_iterator it = baseline.find(results[i].name);
+        if (it == baseline.end() || it->second <= 0) {
+            std::cout << std::left << std::setw(40) << results[i].name << std::right
+                      << std::setw(14) << "-" << std::setw(14) << results[i].ns_per_op << std::setw(12) << "new" << std::endl;
+            continue;
+        }
+        double change = (results[i].ns_per_op - it->second) / it->second * 100.0;
+        bool regressed = change > threshold_percent;
+        if (regressed) {
+            ++regressions;
+        }
+        std::ostringstream change_text;
+        change_text << std::showpos << std::fixed << std::setprecision(1) << change << "%";
+        std::cout << std::left << std::setw(40) << results[i].name << std::right
+                  << std::setw(14) << it->second << std::setw(14) << results[i].ns_per_op
+                  << std::setw(12) << change_text.str() << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+bool parse_options(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--filter") {
+                options.filter = value;
+            } else if (key == "--runs") {
+                options.runs = std::stoi(value);
+            } else if (key == "--min-time-ms") {
+                options.min_time_ms = std::stod(value);
+            } else if (key == "--csv") {
+                options.csv_path = value;
+            } else if (key == "--json") {
+                options.json_path = value;
+            } else if (key == "--baseline") {
+                options.baseline_path = value;
+            } else if (key == "--threshold") {
+                options.threshold_percent = std::stod(value);
+            } else if (key == "--dir") {
+                options.dir = value;
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return options.runs > 0 && options.min_time_ms > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--filter=SUBSTR] [--runs=N] [--min-time-ms=N] [--csv=FILE]"
+                  << " [--json=FILE] [--baseline=FILE] [--threshold=PERCENT] [--dir=PATH]" << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_path.empty() && !load_baseline(options.baseline_path, baseline)) {
+        std::cerr << "Failed to read baseline " << options.baseline_path << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right
+              << std::setw(14) << "ns/op" << std::setw(14) << "min" << std::setw(14) << "max"
+              << std::setw(14) << "iterations" << std::endl;
+
+    MicroBench bench(options);
+    bench_protocol(bench);
+    bench_did_manager(bench, options);
+    bench_json(bench);
+    bench_service(bench);
+
+    if (!options.csv_path.empty() && !write_text_file(options.csv_path, to_csv(bench.results()))) {
+        std::cerr << "Failed to write " << options.csv_path << std::endl;
+        return 1;
+    }
+    if (!options.json_path.empty() && !write_text_file(options.json_path, to_json(bench.results()))) {
+        std::cerr << "Failed to write " << options.json_path << std::endl;
+        return 1;
+    }
+
+    if (!baseline.empty()) {
+        size_t regressions = compare_with_baseline(bench.results(), baseline, options.threshold_percent);
+        if (regressions > 0) {
+            std::cout << regressions << " benchmark(s) slower than baseline by more than "
+                      << options.threshold_percent << "%" << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include "block_transfer.h"
+#include "uds_service.h"
+#include "push_channel.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+namespace uds {
+
+namespace {
+
+// 0x76响应中块序号之前的字节数（服务ID + 块序号）
+const size_t BLOCK_HEADER_SIZE = 2;
+
+} // namespace
+
+// 一个测试端在一个ECU上正在进行的传输；同一测试端的请求可能被不同的工作线程同时处理，状态由mutex保护
+struct BlockTransferManager::Transfer {
+    std::mutex mutex;
+    bool upload;
+    std::shared_ptr<SharedFile> file;
+    uint8_t* mapping;                   // 下载：映像的可写映射
+    uint64_t size;                      // memorySize
+    uint64_t offset;                    // 已传输的字节数
+    uint64_t block_offset;              // 上一个块的起点，重发时使用
+    uint8_t counter;                    // 上一个已接受的块序号
+    bool started;                       // 已接受过块
+    bool committed;                     // 下载已改名生效
+    std::string part_path;
+    std::string image_path;
+    bool has_channel;
+    std::weak_ptr<PushChannel> channel; // 连接关闭后传输由下一次0x34/0x35清理
+
+    Transfer()
+        : upload(false), mapping(nullptr), size(0), offset(0), block_offset(0), counter(0), started(false),
+          committed(false), has_channel(false) {
+    }
+
+    ~Transfer() {
+        unmap();
+#ifndef _WIN32
+        if (!upload && !committed && !part_path.empty()) {
+            unlink(part_path.c_str());
+        }
+#endif
+    }
+
+    void unmap() {
+#ifndef _WIN32
+        if (mapping != nullptr) {
+            munmap(mapping, static_cast<size_t>(size));
+            mapping = nullptr;
+        }
+#endif
+    }
+};
+
+size_t BlockTransferManager::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = (reinterpret_cast<uintptr_t>(key.service) >> 4) * 0x9E3779B97F4A7C15ULL;
+    hash ^= (static_cast<uint64_t>(key.connection_id) << 16 | key.tester_address) * 0xC2B2AE3D27D4EB4FULL;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+BlockTransferManager::BlockTransferManager(const BlockTransferOptions& options) : options_(options) {
+    stats_.downloads = 0;
+    stats_.uploads = 0;
+    stats_.aborted = 0;
+}
+
+BlockTransferManager::~BlockTransferManager() {
+}
+
+BlockTransferManager::Key BlockTransferManager::key_of(const UdsService& service, const RequestContext& context) {
+    Key key;
+    key.service = &service;
+    key.connection_id = context.connection_id;
+    key.tester_address = context.tester_address;
+    return key;
+}
+
+std::string BlockTransferManager::image_path(uint16_t ecu_address, uint32_t address) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%04X_%08X.bin", ecu_address, address);
+    return options_.directory + "/" + name;
+}
+
+bool BlockTransferManager::start(const UdsService& service, const RequestContext& context, bool upload,
+                                 uint32_t address, uint32_t memory_size, ResponseCode& nrc) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    remove_closed();
+    Key key = key_of(service, context);
+    if (transfers_.find(key) != transfers_.end()) {
+        nrc = ResponseCode::CONDITIONS_NOT_CORRECT;
+        return false;
+    }
+    if (transfers_.size() >= options_.max_transfers) {
+        nrc = ResponseCode::UPLOAD_DOWNLOAD_NOT_ACCEPTED;
+        return false;
+    }
+
+    std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>();
+    transfer->upload = upload;
+    transfer->size = memory_size;
+    transfer->image_path = image_path(context.ecu_address, address);
+    if (context.channel != nullptr) {
+        transfer->has_channel = true;
+        transfer->channel = context.channel->shared_from_this();
+    }
+
+#ifdef _WIN32
+    // Windows下没有mmap/sendfile，不支持块传输
+    nrc = ResponseCode::UPLOAD_DOWNLOAD_NOT_ACCEPTED;
+    return false;
+#else
+    if (upload) {
+        // 上传：映像文件须存在且不短于memorySize
+        int fd = open(transfer->image_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            nrc = ResponseCode::REQUEST_OUT_OF_RANGE;
+            return false;
+        }
+        transfer->file = std::make_shared<SharedFile>(fd);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < memory_size) {
+            nrc = ResponseCode::REQUEST_OUT_OF_RANGE;
+            return false;
+        }
+    } else {
+        // 下载：每个传输写自己的.part文件，扩展到memorySize后整体映射
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08X_%04X.part", context.connection_id, context.tester_address);
+        transfer->part_path = transfer->image_path + suffix;
+        int fd = open(transfer->part_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            UDS_LOG_WARN("Failed to create %s: %s", transfer->part_path.c_str(), std::strerror(errno));
+            transfer->part_path.clear();
+            nrc = ResponseCode::UPLOAD_DOWNLOAD_NOT_ACCEPTED;
+            return false;
+        }
+        transfer->file = std::make_shared<SharedFile>(fd);
+        void* mapping = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(memory_size)) == 0) {
+            mapping = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (mapping == MAP_FAILED) {
+            UDS_LOG_WARN("Failed to map %s (%u bytes): %s", transfer->part_path.c_str(), memory_size,
+                         std::strerror(errno));
+            nrc = ResponseCode::UPLOAD_DOWNLOAD_NOT_ACCEPTED;
+            return false;
+        }
+        transfer->mapping = static_cast<uint8_t*>(mapping);
+        madvise(mapping, memory_size, MADV_SEQUENTIAL);
+    }
+
+    transfers_[key] = transfer;
+    return true;
+#endif
+}
+
+bool BlockTransferManager::transfer(const UdsService& service, const RequestContext& context, uint8_t counter,
+                                    const uint8_t* data, size_t size, std::vector<uint8_t>& out,
+                                    ResponseCode& nrc) {
+    std::shared_ptr<Transfer> transfer = find(key_of(service, context));
+    if (!transfer) {
+        nrc = ResponseCode::REQUEST_SEQUENCE_ERROR;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(transfer->mutex);
+    bool repeat = transfer->started && counter == transfer->counter;
+    if (!repeat && counter != static_cast<uint8_t>(transfer->counter + 1)) {
+        nrc = ResponseCode::WRONG_BLOCK_SEQUENCE_COUNTER;
+        return false;
+    }
+    size_t max_data = options_.max_block_length - BLOCK_HEADER_SIZE;
+
+    if (!transfer->upload) {
+        if (size == 0 || size > max_data) {
+            nrc = ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT;
+            return false;
+        }
+        // 重发的块已经写入过，只需再次确认
+        if (!repeat) {
+            if (size > transfer->size - transfer->offset) {
+                nrc = ResponseCode::TRANSFER_DATA_SUSPENDED;
+                return false;
+            }
+            std::memcpy(transfer->mapping + transfer->offset, data, size);
+            transfer->block_offset = transfer->offset;
+            transfer->offset += size;
+            transfer->counter = counter;
+            transfer->started = true;
+        }
+        out.push_back(static_cast<uint8_t>(static_cast<uint8_t>(ServiceID::TRANSFER_DATA) + 0x40));
+        out.push_back(counter);
+        return true;
+    }
+
+    // 上传：请求只带块序号，重发时从上一个块的起点再读一次
+    if (size != 0) {
+        nrc = ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT;
+        return false;
+    }
+    uint64_t start = repeat ? transfer->block_offset : transfer->offset;
+    if (!repeat && start == transfer->size) {
+        nrc = ResponseCode::REQUEST_SEQUENCE_ERROR;
+        return false;
+    }
+    size_t length = static_cast<size_t>(std::min<uint64_t>(max_data, transfer->size - start));
+
+    FileSlice slice;
+    slice.file = transfer->file;
+    slice.offset = start;
+    slice.size = length;
+    size_t header_offset = out.size();
+    out.push_back(static_cast<uint8_t>(static_cast<uint8_t>(ServiceID::TRANSFER_DATA) + 0x40));
+    out.push_back(counter);
+    if (context.files != nullptr) {
+        slice.position = out.size();
+        context.files->push_back(slice);
+    } else if (!read_file_slice(slice, out)) {
+        out.resize(header_offset);
+        nrc = ResponseCode::TRANSFER_DATA_SUSPENDED;
+        return false;
+    }
+    if (!repeat) {
+        transfer->block_offset = start;
+        transfer->offset = start + length;
+        transfer->counter = counter;
+        transfer->started = true;
+    }
+    return true;
+}
+
+bool BlockTransferManager::finish(const UdsService& service, const RequestContext& context, ResponseCode& nrc) {
+    Key key = key_of(service, context);
+    std::shared_ptr<Transfer> transfer = find(key);
+    if (!transfer) {
+        nrc = ResponseCode::REQUEST_SEQUENCE_ERROR;
+        return false;
+    }
+
+    bool complete;
+    bool committed = false;
+    {
+        std::lock_guard<std::mutex> lock(transfer->mutex);
+        // 数据不完整时放弃传输，测试端可以重新发起
+        complete = transfer->offset == transfer->size;
+        if (complete) {
+            committed = true;
+            if (!transfer->upload) {
+                transfer->unmap();
+#ifndef _WIN32
+                committed = rename(transfer->part_path.c_str(), transfer->image_path.c_str()) == 0;
+#endif
+                transfer->committed = committed;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = transfers_.find(key);
+    if (it != transfers_.end() && it->second == transfer) {
+        transfers_.erase(it);
+    }
+    if (!committed) {
+        ++stats_.aborted;
+        nrc = complete ? ResponseCode::GENERAL_PROGRAMMING_FAILURE : ResponseCode::REQUEST_SEQUENCE_ERROR;
+        return false;
+    }
+    ++(transfer->upload ? stats_.uploads : stats_.downloads);
+    return true;
+}
+
+void BlockTransferManager::abort(const UdsService& service, const RequestContext& context) {
+    std::shared_ptr<Transfer> transfer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = transfers_.find(key_of(service, context));
+        if (it == transfers_.end()) {
+            return;
+        }
+        transfer = it->second;
+        transfers_.erase(it);
+        ++stats_.aborted;
+    }
+    // 在锁外释放：映射与.part文件在最后一个引用（可能是正在处理的块）释放时清理
+}
+
+std::shared_ptr<BlockTransferManager::Transfer> BlockTransferManager::find(const Key& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = transfers_.find(key);
+    return it != transfers_.end() ? it->second : std::shared_ptr<Transfer>();
+}
+
+void BlockTransferManager::remove_closed() {
+    for (auto it = transfers_.begin(); it != transfers_.end();) {
+        if (it->second->has_channel && it->second->channel.expired()) {
+            it = transfers_.erase(it);
+            ++stats_.aborted;
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t BlockTransferManager::active_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return transfers_.size();
+}
+
+BlockTransferStats BlockTransferManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace uds
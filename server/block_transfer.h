@@ -0,0 +1,102 @@
+#ifndef BLOCK_TRANSFER_H
+#define BLOCK_TRANSFER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "uds_protocol.h"
+#include "file_slice.h"
+
+namespace uds {
+
+class UdsService;
+class PushChannel;
+struct RequestContext;
+
+// 块传输参数
+struct BlockTransferOptions {
+    std::string directory = ".";          // 映像文件所在目录
+    uint32_t max_block_length = 65535;    // 0x74/0x75中报告的maxNumberOfBlockLength（含0x36与块序号）
+    size_t max_transfers = 256;           // 同时进行的传输数上限，超出时返回NRC 0x70
+};
+
+// 块传输统计
+struct BlockTransferStats {
+    uint64_t downloads;       // 完成的下载（0x37成功）
+    uint64_t uploads;         // 完成的上传
+    uint64_t aborted;         // 未完成即被放弃的传输
+};
+
+// RequestDownload/RequestUpload/TransferData/RequestTransferExit（0x34~0x37）的传输状态，所有ECU、所有连接共用
+// 传输按（ECU、连接、测试端地址）区分，每个测试端在每个ECU上同时只有一个传输。
+// 内存地址对应目录下的映像文件“<ECU地址>_<内存地址>.bin”（十六进制）：
+//   下载先写入同名的.part文件，按memorySize扩展后整体映射（MAP_SHARED），TransferData的数据直接复制到映射中的
+//   最终位置；0x37确认全部收到后解除映射并原子地改名为映像文件，中途放弃的传输删除.part文件。
+//   上传按块从映像文件读出：请求带有文件片段表时只登记文件片段，由传输层用sendfile从页缓存直接发到socket，
+//   否则读到响应中。
+// 块序号从1开始，0xFF之后回到0x00；重复上一个块序号视为重发，下载不再写入，上传重新发送同一块
+class BlockTransferManager {
+public:
+    explicit BlockTransferManager(const BlockTransferOptions& options = BlockTransferOptions());
+    ~BlockTransferManager();
+
+    // 开始下载（upload为false）或上传memory_size字节，失败时给出NRC
+    bool start(const UdsService& service, const RequestContext& context, bool upload, uint32_t address,
+               uint32_t memory_size, ResponseCode& nrc);
+
+    // TransferData：下载时写入data，上传时读出下一块；把正响应（0x76、块序号[、数据]）追加到out，失败时给出NRC
+    bool transfer(const UdsService& service, const RequestContext& context, uint8_t counter,
+                  const uint8_t* data, size_t size, std::vector<uint8_t>& out, ResponseCode& nrc);
+
+    // RequestTransferExit：结束传输，下载的映像在此时生效；失败时给出NRC
+    bool finish(const UdsService& service, const RequestContext& context, ResponseCode& nrc);
+
+    // 放弃测试端在service上正在进行的传输（回到默认会话时）
+    void abort(const UdsService& service, const RequestContext& context);
+
+    uint32_t max_block_length() const { return options_.max_block_length; }
+
+    // 映像文件路径
+    std::string image_path(uint16_t ecu_address, uint32_t address) const;
+
+    size_t active_count() const;
+    BlockTransferStats stats() const;
+
+private:
+    BlockTransferManager(const BlockTransferManager&);
+    BlockTransferManager& operator=(const BlockTransferManager&);
+
+    struct Key {
+        const UdsService* service;
+        uint32_t connection_id;
+        uint16_t tester_address;
+
+        bool operator==(const Key& other) const {
+            return service == other.service && connection_id == other.connection_id &&
+                   tester_address == other.tester_address;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Transfer;
+
+    static Key key_of(const UdsService& service, const RequestContext& context);
+    std::shared_ptr<Transfer> find(const Key& key) const;
+    void remove_closed();   // 调用者需持有mutex_
+
+    BlockTransferOptions options_;
+    mutable std::mutex mutex_;   // 保护以下成员；每个块只在查找传输时持有，数据复制与文件读写不持锁
+    std::unordered_map<Key, std::shared_ptr<Transfer>, KeyHash> transfers_;
+    BlockTransferStats stats_;
+};
+
+} // namespace uds
+
+#endif // BLOCK_TRANSFER_H
@@ -0,0 +1,45 @@
+#ifndef CACHE_ALIGNED_H
+#define CACHE_ALIGNED_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace uds {
+
+// 按缓存行对齐的堆对象基类
+// C++11的new只保证alignof(std::max_align_t)的对齐，alignas(64)的类型直接new出来时缓存行填充不一定成立；
+// 继承本类的类型由new/delete按64字节对齐分配和释放
+struct CacheAligned {
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    static void* operator new(size_t size) {
+        void* memory = nullptr;
+        #ifdef _WIN32
+        memory = _aligned_malloc(size, CACHE_LINE_SIZE);
+        #else
+        if (posix_memalign(&memory, CACHE_LINE_SIZE, size) != 0) {
+            memory = nullptr;
+        }
+        #endif
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    static void operator delete(void* memory) {
+        #ifdef _WIN32
+        _aligned_free(memory);
+        #else
+        std::free(memory);
+        #endif
+    }
+};
+
+} // namespace uds
+
+#endif // CACHE_ALIGNED_H
@@ -0,0 +1,46 @@
+#include "can_bus.h"
+
+namespace uds {
+
+CanLoopbackBus::CanLoopbackBus() : read_index_(0), frames_(0), dropped_(0) {
+}
+
+bool CanLoopbackBus::attach(uint32_t id, CanFrameSink* receiver) {
+    return receivers_.insert(std::make_pair(id, receiver)).second;
+}
+
+void CanLoopbackBus::detach(uint32_t id) {
+    receivers_.erase(id);
+}
+
+void CanLoopbackBus::on_frame(const CanFrame& frame) {
+    pending_.push_back(frame);
+}
+
+size_t CanLoopbackBus::pump(size_t max_frames) {
+    size_t delivered = 0;
+    while (delivered < max_frames) {
+        if (read_index_ == queue_.size()) {
+            if (pending_.empty()) {
+                break;
+            }
+            queue_.clear();
+            queue_.swap(pending_);
+            read_index_ = 0;
+        }
+
+        // 接收方可能发出新帧，先复制出当前帧
+        CanFrame frame = queue_[read_index_++];
+        auto it = receivers_.find(frame.id);
+        if (it != receivers_.end()) {
+            it->second->on_frame(frame);
+        } else {
+            ++dropped_;
+        }
+        ++frames_;
+        ++delivered;
+    }
+    return delivered;
+}
+
+} // namespace uds
@@ -0,0 +1,61 @@
+#ifndef CAN_BUS_H
+#define CAN_BUS_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace uds {
+
+// 经典CAN数据帧（最多8字节数据）
+struct CanFrame {
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+// CAN帧的接收方：ISO-TP层经它发出帧，总线经它把帧交给节点。
+// 可替换为真实的CAN接口（如SocketCAN）或测试用的计数/丢弃实现
+class CanFrameSink {
+public:
+    virtual ~CanFrameSink() {}
+
+    virtual void on_frame(const CanFrame& frame) = 0;
+};
+
+// 进程内模拟的CAN总线：发到总线上的帧按CAN ID交给登记的接收方
+// 帧先进入队列，由pump按发送顺序投递，接收方在处理中发出的帧（如流控帧）排在队尾，不会递归调用。
+// 不加锁，由使用者在一个线程中驱动
+class CanLoopbackBus : public CanFrameSink {
+public:
+    CanLoopbackBus();
+
+    // 把CAN ID为id的帧交给receiver；同一ID只能有一个接收方
+    bool attach(uint32_t id, CanFrameSink* receiver);
+
+    void detach(uint32_t id);
+
+    // 发送一帧（进入队列）
+    void on_frame(const CanFrame& frame) override;
+
+    // 投递队列中的帧，直到队列为空或投递了max_frames帧，返回投递的帧数；没有接收方的帧被丢弃
+    size_t pump(size_t max_frames = static_cast<size_t>(-1));
+
+    bool idle() const { return read_index_ == queue_.size() && pending_.empty(); }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    std::unordered_map<uint32_t, CanFrameSink*> receivers_;
+    std::vector<CanFrame> queue_;      // 正在投递的帧
+    size_t read_index_;
+    std::vector<CanFrame> pending_;    // 投递期间新发出的帧，下一轮投递；两个队列交替复用
+    uint64_t frames_;
+    uint64_t dropped_;
+};
+
+} // namespace uds
+
+#endif // CAN_BUS_H
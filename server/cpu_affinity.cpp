@@ -0,0 +1,41 @@
+#include "cpu_affinity.h"
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace uds {
+
+bool pin_current_thread(size_t index) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return false;
+    }
+    size_t count = static_cast<size_t>(CPU_COUNT(&allowed));
+    if (count == 0) {
+        return false;
+    }
+
+    size_t target = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        if (target-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        }
+    }
+    return false;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+} // namespace uds
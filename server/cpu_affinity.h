@@ -0,0 +1,14 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <cstddef>
+
+namespace uds {
+
+// 把调用线程绑定到进程可用CPU中的第index个（超出可用CPU数时取模），使各事件循环固定在不同的核上
+// 可用CPU按进程当前的亲和性（如taskset、cgroup cpuset）计算；不支持的平台或绑定失败时返回false
+bool pin_current_thread(size_t index);
+
+} // namespace uds
+
+#endif // CPU_AFFINITY_H
@@ -0,0 +1,538 @@
+#include "did_database.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace uds {
+
+namespace {
+
+const char DATABASE_MAGIC[8] = {'U', 'D', 'S', 'D', 'B', '0', '0', '1'};
+const size_t MAX_DIDS = 65536;
+const size_t MAX_VALUE_SIZE = 65535;
+
+uint16_t read_u16_le(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read_u32_le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void write_u16_le(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value & 0xFF);
+    p[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+void write_u32_le(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value & 0xFF);
+    p[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    p[2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    p[3] = static_cast<uint8_t>((value >> 24) & 0xFF);
+}
+
+// did_data.json的单遍扫描器：每个字符只检查一次，不构造中间字符串
+class JsonScanner {
+public:
+    JsonScanner(const char* text, size_t size) : begin_(text), p_(text), end_(text + size) {}
+
+    void skip_whitespace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            ++p_;
+        }
+    }
+
+    // 跳过空白后若下一个字符是c则消耗它
+    bool consume(char c) {
+        skip_whitespace();
+        if (p_ < end_ && *p_ == c) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool at_end() {
+        skip_whitespace();
+        return p_ == end_;
+    }
+
+    // 读取字符串，结果指向原文（不处理转义，转义字符原样保留）
+    bool parse_string(const char*& str, size_t& length) {
+        if (!consume('"')) {
+            return false;
+        }
+        str = p_;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\') {
+                ++p_;
+            }
+            ++p_;
+        }
+        if (p_ >= end_) {
+            return false;
+        }
+        length = static_cast<size_t>(p_ - str);
+        ++p_;
+        return true;
+    }
+
+    // 读取不超过max的非负整数
+    bool parse_uint(uint32_t max, uint32_t& value) {
+        skip_whitespace();
+        const char* start = p_;
+        value = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+            value = value * 10 + static_cast<uint32_t>(*p_ - '0');
+            if (value > max) {
+                return false;
+            }
+            ++p_;
+        }
+        return p_ != start;
+    }
+
+    // 跳过任意JSON值（用于不关心的字段）
+    bool skip_value(int depth) {
+        if (depth > 64) {
+            return false;
+        }
+        skip_whitespace();
+        if (p_ >= end_) {
+            return false;
+        }
+
+        const char* str;
+        size_t length;
+        switch (*p_) {
+            case '"':
+                return parse_string(str, length);
+
+            case '{':
+                ++p_;
+                if (consume('}')) {
+                    return true;
+                }
+                do {
+                    if (!parse_string(str, length) || !consume(':') || !skip_value(depth + 1)) {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume('}');
+
+            case '[':
+                ++p_;
+                if (consume(']')) {
+                    return true;
+                }
+                do {
+                    if (!skip_value(depth + 1)) {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume(']');
+
+            default:
+                // 数字、true、false、null
+                while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' &&
+                       *p_ != ' ' && *p_ != '\t' && *p_ != '\n' && *p_ != '\r') {
+                    ++p_;
+                }
+                return true;
+        }
+    }
+
+    size_t offset() const { return static_cast<size_t>(p_ - begin_); }
+
+private:
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+};
+
+// 解析1~4位十六进制DID键
+bool parse_did_key(const char* str, size_t length, DID& did) {
+    if (length == 0 || length > 4) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (size_t i = 0; i < length; ++i) {
+        char c = str[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = static_cast<uint32_t>(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            digit = static_cast<uint32_t>(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            digit = static_cast<uint32_t>(c - 'a' + 10);
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    did = static_cast<DID>(value);
+    return true;
+}
+
+std::string error_at(const char* what, size_t offset) {
+    return std::string(what) + " at offset " + std::to_string(offset);
+}
+
+void append_decimal(std::string& out, unsigned value) {
+    char digits[4];
+    size_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        out.push_back(digits[--n]);
+    }
+}
+
+} // namespace
+
+const size_t DidDatabase::HEADER_SIZE;
+const size_t DidDatabase::ENTRY_SIZE;
+
+DidDatabase::DidDatabase()
+    : data_(nullptr),
+      data_size_(0),
+      mapping_(nullptr),
+      mapping_size_(0) {
+}
+
+DidDatabase::~DidDatabase() {
+    clear();
+}
+
+void DidDatabase::clear() {
+    if (mapping_ != nullptr) {
+#ifdef _WIN32
+        delete[] static_cast<uint8_t*>(mapping_);
+#else
+        munmap(mapping_, mapping_size_);
+#endif
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+    entries_.clear();
+    owned_data_.clear();
+    data_ = nullptr;
+    data_size_ = 0;
+}
+
+bool DidDatabase::is_binary_file(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(DATABASE_MAGIC)];
+    bool binary = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                  std::memcmp(magic, DATABASE_MAGIC, sizeof(magic)) == 0;
+    std::fclose(file);
+    return binary;
+}
+
+bool DidDatabase::map_file(const std::string& path, std::string& error) {
+    clear();
+
+#ifdef _WIN32
+    // Windows下没有mmap，整体读入内存
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(file.tellg());
+    uint8_t* base = new uint8_t[file_size > 0 ? file_size : 1];
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(base), static_cast<std::streamsize>(file_size))) {
+        delete[] base;
+        error = "cannot read " + path;
+        return false;
+    }
+    mapping_ = base;
+    mapping_size_ = file_size;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+        close(fd);
+        error = "file too small: " + path;
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = "mmap failed: " + path;
+        return false;
+    }
+    mapping_ = base;
+    mapping_size_ = file_size;
+#endif
+
+    // 校验文件结构：魔数、长度、每个条目的范围与DID顺序
+    const uint8_t* p = static_cast<const uint8_t*>(mapping_);
+    if (file_size < HEADER_SIZE || std::memcmp(p, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) != 0) {
+        clear();
+        error = "not a DID database: " + path;
+        return false;
+    }
+    size_t count = read_u32_le(p + 8);
+    size_t data_size = read_u32_le(p + 12);
+    if (count > MAX_DIDS || file_size != HEADER_SIZE + count * ENTRY_SIZE + data_size) {
+        clear();
+        error = "truncated or corrupted DID database: " + path;
+        return false;
+    }
+
+    entries_.resize(count);
+    const uint8_t* index = p + HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* e = index + i * ENTRY_SIZE;
+        Entry& entry = entries_[i];
+        entry.did = read_u16_le(e);
+        entry.size = read_u16_le(e + 2);
+        entry.offset = read_u32_le(e + 4);
+        if ((i > 0 && entry.did <= entries_[i - 1].did) ||
+            static_cast<size_t>(entry.offset) + entry.size > data_size) {
+            clear();
+            error = "invalid index entry " + std::to_string(i) + " in " + path;
+            return false;
+        }
+    }
+
+    data_ = index + count * ENTRY_SIZE;
+    data_size_ = data_size;
+    return true;
+}
+
+bool DidDatabase::load_json_file(const std::string& path, std::string& error) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<char> text;
+    char chunk[65536];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.insert(text.end(), chunk, chunk + n);
+    }
+    bool read_ok = std::ferror(file) == 0;
+    std::fclose(file);
+    if (!read_ok) {
+        error = "cannot read " + path;
+        return false;
+    }
+    return parse_json(text.data(), text.size(), error);
+}
+
+bool DidDatabase::parse_json(const char* text, size_t size, std::string& error) {
+    clear();
+    JsonScanner scanner(text, size);
+
+    if (!scanner.consume('{')) {
+        error = error_at("expected '{'", scanner.offset());
+        return false;
+    }
+
+    bool found_dids = false;
+    bool sorted = true;
+    if (!scanner.consume('}')) {
+        do {
+            const char* key;
+            size_t key_length;
+            if (!scanner.parse_string(key, key_length) || !scanner.consume(':')) {
+                error = error_at("expected key", scanner.offset());
+                return false;
+            }
+
+            if (key_length != 4 || std::memcmp(key, "dids", 4) != 0) {
+                if (!scanner.skip_value(0)) {
+                    error = error_at("invalid value", scanner.offset());
+                    return false;
+                }
+                continue;
+            }
+
+            // "dids": { "XXXX": [b0, b1, ...], ... }
+            found_dids = true;
+            if (!scanner.consume('{')) {
+                error = error_at("expected '{' after \"dids\"", scanner.offset());
+                return false;
+            }
+            if (scanner.consume('}')) {
+                continue;
+            }
+            do {
+                const char* did_str;
+                size_t did_length;
+                DID did;
+                if (!scanner.parse_string(did_str, did_length) || !parse_did_key(did_str, did_length, did)) {
+                    error = error_at("invalid DID key", scanner.offset());
+                    return false;
+                }
+                if (!scanner.consume(':') || !scanner.consume('[')) {
+                    error = error_at("expected byte array", scanner.offset());
+                    return false;
+                }
+
+                size_t offset = owned_data_.size();
+                if (!scanner.consume(']')) {
+                    do {
+                        uint32_t byte;
+                        if (!scanner.parse_uint(255, byte)) {
+                            error = error_at("invalid byte value", scanner.offset());
+                            return false;
+                        }
+                        owned_data_.push_back(static_cast<uint8_t>(byte));
+                    } while (scanner.consume(','));
+                    if (!scanner.consume(']')) {
+                        error = error_at("expected ']'", scanner.offset());
+                        return false;
+                    }
+                }
+
+                size_t value_size = owned_data_.size() - offset;
+                if (value_size > MAX_VALUE_SIZE || owned_data_.size() > 0xFFFFFFFFu) {
+                    error = error_at("DID value too large", scanner.offset());
+                    return false;
+                }
+                if (!entries_.empty() && did <= entries_.back().did) {
+                    sorted = false;
+                }
+                Entry entry = {did, static_cast<uint16_t>(value_size), static_cast<uint32_t>(offset)};
+                entries_.push_back(entry);
+            } while (scanner.consume(','));
+            if (!scanner.consume('}')) {
+                error = error_at("expected '}' after DID entries", scanner.offset());
+                return false;
+            }
+        } while (scanner.consume(','));
+
+        if (!scanner.consume('}')) {
+            error = error_at("expected '}'", scanner.offset());
+            return false;
+        }
+    }
+
+    if (!scanner.at_end()) {
+        error = error_at("trailing data", scanner.offset());
+        return false;
+    }
+    if (!found_dids) {
+        error = "missing \"dids\" object";
+        return false;
+    }
+
+    // 本程序写出的文件总是有序的，手工编辑的文件才需要排序
+    if (!sorted) {
+        sort_entries();
+    }
+    data_ = owned_data_.data();
+    data_size_ = owned_data_.size();
+    return true;
+}
+
+void DidDatabase::sort_entries() {
+    std::stable_sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.did < b.did;
+    });
+
+    // 重复的DID只保留最后一个
+    size_t out = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (i + 1 < entries_.size() && entries_[i + 1].did == entries_[i].did) {
+            continue;
+        }
+        entries_[out++] = entries_[i];
+    }
+    entries_.resize(out);
+}
+
+void DidDatabase::append(DID did, const uint8_t* data, size_t size) {
+    Entry entry = {did, static_cast<uint16_t>(size), static_cast<uint32_t>(owned_data_.size())};
+    owned_data_.insert(owned_data_.end(), data, data + size);
+    entries_.push_back(entry);
+    data_ = owned_data_.data();
+    data_size_ = owned_data_.size();
+}
+
+std::string DidDatabase::to_json() const {
+    std::string json;
+    // 每个字节最多占5个字符（"255, "），加上每个条目的键与标点
+    json.reserve(128 + data_size_ * 5 + entries_.size() * 16);
+
+    json += "{\n";
+    json += "  \"version\": \"1.0\",\n";
+    json += "  \"description\": \"UDS DID Data\",\n";
+    json += "  \"dids\": {\n";
+
+    static const char HEX[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const Entry& entry = entries_[i];
+        char key[] = "    \"0000\": [";
+        key[5] = HEX[(entry.did >> 12) & 0xF];
+        key[6] = HEX[(entry.did >> 8) & 0xF];
+        key[7] = HEX[(entry.did >> 4) & 0xF];
+        key[8] = HEX[entry.did & 0xF];
+        json.append(key, sizeof(key) - 1);
+
+        const uint8_t* value = data_ + entry.offset;
+        for (size_t k = 0; k < entry.size; ++k) {
+            if (k > 0) {
+                json += ", ";
+            }
+            append_decimal(json, value[k]);
+        }
+        json += (i + 1 < entries_.size()) ? "],\n" : "]\n";
+    }
+
+    json += "  }\n";
+    json += "}\n";
+    return json;
+}
+
+std::vector<uint8_t> DidDatabase::to_binary() const {
+    size_t index_size = entries_.size() * ENTRY_SIZE;
+    std::vector<uint8_t> out(HEADER_SIZE + index_size);
+    std::memcpy(out.data(), DATABASE_MAGIC, sizeof(DATABASE_MAGIC));
+    write_u32_le(out.data() + 8, static_cast<uint32_t>(entries_.size()));
+
+    // 数据区按条目顺序重新排列，去掉追加过程中可能留下的无用字节
+    uint32_t offset = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        uint8_t* e = out.data() + HEADER_SIZE + i * ENTRY_SIZE;
+        write_u16_le(e, entries_[i].did);
+        write_u16_le(e + 2, entries_[i].size);
+        write_u32_le(e + 4, offset);
+        offset += entries_[i].size;
+    }
+    write_u32_le(out.data() + 12, offset);
+
+    out.reserve(out.size() + offset);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const uint8_t* value = data_ + entries_[i].offset;
+        out.insert(out.end(), value, value + entries_[i].size);
+    }
+    return out;
+}
+
+} // namespace uds
@@ -0,0 +1,84 @@
+#ifndef DID_DATABASE_H
+#define DID_DATABASE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "uds_protocol.h"
+
+namespace uds {
+
+// 紧凑的DID数据集合：按DID升序的条目表 + 连续的值数据区
+// 二进制数据库文件就是它的磁盘格式（小端）：
+//   [8字节魔数"UDSDB001"][4字节DID数量][4字节数据区长度][16字节保留]
+//   [DID数量 × (2字节DID, 2字节值长度, 4字节数据区偏移)][数据区]
+// 二进制文件整体映射进内存，DidStore直接引用映射中的值，启动时不复制数据；
+// JSON文件单遍解析到同样的结构中
+class DidDatabase {
+public:
+    struct Entry {
+        DID did;
+        uint16_t size;
+        uint32_t offset;
+    };
+
+    static const size_t HEADER_SIZE = 32;
+    static const size_t ENTRY_SIZE = 8;
+
+    DidDatabase();
+    ~DidDatabase();
+
+    // 判断文件是否为二进制数据库（按魔数识别）
+    static bool is_binary_file(const std::string& path);
+
+    // 映射二进制数据库文件并校验其结构
+    bool map_file(const std::string& path, std::string& error);
+
+    // 读取并单遍解析did_data.json格式的文件
+    bool load_json_file(const std::string& path, std::string& error);
+
+    // 单遍解析did_data.json格式的文本，耗时与文本长度成线性关系
+    bool parse_json(const char* text, size_t size, std::string& error);
+
+    // 在末尾追加一个DID，调用者需按DID升序追加（用于生成快照）
+    void append(DID did, const uint8_t* data, size_t size);
+
+    // 清空内容（解除映射）
+    void clear();
+
+    size_t count() const { return entries_.size(); }
+    const Entry& entry(size_t index) const { return entries_[index]; }
+    const uint8_t* value(const Entry& entry) const { return data_ + entry.offset; }
+
+    // 值数据区
+    const uint8_t* data() const { return data_; }
+    size_t data_size() const { return data_size_; }
+
+    // 数据区是否来自文件映射
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+    // 生成did_data.json格式的文本
+    std::string to_json() const;
+
+    // 生成二进制数据库文件内容
+    std::vector<uint8_t> to_binary() const;
+
+private:
+    DidDatabase(const DidDatabase&);
+    DidDatabase& operator=(const DidDatabase&);
+
+    // 按DID排序，重复的DID保留最后出现的值
+    void sort_entries();
+
+    std::vector<Entry> entries_;
+    std::vector<uint8_t> owned_data_;  // JSON解析或追加得到的数据区
+    const uint8_t* data_;
+    size_t data_size_;
+    void* mapping_;                    // 二进制文件的映射（或Windows下读入的副本）
+    size_t mapping_size_;
+};
+
+} // namespace uds
+
+#endif // DID_DATABASE_H
@@ -0,0 +1,361 @@
+#include "did_journal.h"
+#include "logger.h"
+#include <cstring>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace uds {
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = {'U', 'D', 'S', 'W', 'A', 'L', '0', '1'};
+const size_t RECORD_HEADER_SIZE = 8;
+// 单条记录载荷上限，用于识别损坏的长度字段
+const uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+// CRC32（IEEE 802.3）查表
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) {
+    static const Crc32Table table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void append_u32_le(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
+}
+
+uint32_t read_u32_le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+bool sync_file(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// 把文件截断到size字节
+bool truncate_file(std::FILE* file, uint64_t size) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), static_cast<__int64>(size)) == 0;
+#else
+    return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+bool parse_fsync_policy(const std::string& name, FsyncPolicy& policy) {
+    if (name == "always") {
+        policy = FsyncPolicy::ALWAYS;
+    } else if (name == "interval") {
+        policy = FsyncPolicy::INTERVAL;
+    } else if (name == "never") {
+        policy = FsyncPolicy::NEVER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+DidJournal::DidJournal()
+    : policy_(FsyncPolicy::INTERVAL),
+      file_(nullptr),
+      appended_seq_(0),
+      committed_seq_(0),
+      flushing_(false),
+      dirty_(false),
+      failed_(false),
+      file_bytes_(0) {
+}
+
+DidJournal::~DidJournal() {
+    close();
+}
+
+bool DidJournal::open(const std::string& path, FsyncPolicy policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    policy_ = policy;
+    return open_file_locked();
+}
+
+bool DidJournal::open_file_locked(bool sync_header) {
+    file_ = std::fopen(path_.c_str(), "wb");
+    if (file_ == nullptr) {
+        UDS_LOG_ERROR("Failed to open DID journal: %s", path_.c_str());
+        failed_ = true;
+        return false;
+    }
+    // 不落盘的文件头在崩溃后可能不完整，回放时视为空日志
+    bool ok = std::fwrite(JOURNAL_MAGIC, 1, sizeof(JOURNAL_MAGIC), file_) == sizeof(JOURNAL_MAGIC);
+    ok = (sync_header ? sync_file(file_) : std::fflush(file_) == 0) && ok;
+    if (!ok) {
+        UDS_LOG_ERROR("Failed to write DID journal header: %s", path_.c_str());
+        failed_ = true;
+        return false;
+    }
+    file_bytes_ = 0;
+    failed_ = false;
+    return true;
+}
+
+void DidJournal::close() {
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_ == nullptr) {
+            return;
+        }
+        seq = appended_seq_;
+    }
+    commit(seq);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_cv_.wait(lock, [this]() { return !flushing_; });
+    if (file_ != nullptr) {
+        if (policy_ != FsyncPolicy::NEVER) {
+            sync_file(file_);
+        }
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool DidJournal::replay(const std::string& path, const ApplyFunc& apply, size_t& records) {
+    records = 0;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return true;
+    }
+
+    char magic[sizeof(JOURNAL_MAGIC)];
+    size_t magic_read = std::fread(magic, 1, sizeof(magic), file);
+    if (magic_read < sizeof(magic)) {
+        // 创建日志时崩溃，文件头不完整，视为空日志
+        std::fclose(file);
+        return true;
+    }
+    if (std::memcmp(magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        UDS_LOG_ERROR("Invalid DID journal header: %s", path.c_str());
+        std::fclose(file);
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> data;
+    while (std::fread(header, 1, RECORD_HEADER_SIZE, file) == RECORD_HEADER_SIZE) {
+        uint32_t body_size = read_u32_le(header);
+        uint32_t crc = read_u32_le(header + 4);
+        if (body_size < 2 || body_size > MAX_RECORD_SIZE) {
+            break;
+        }
+
+        body.resize(body_size);
+        if (std::fread(body.data(), 1, body_size, file) != body_size) {
+            break;  // 尾部记录写到一半
+        }
+        if (crc32_update(0, body.data(), body.size()) != crc) {
+            break;
+        }
+
+        DID did = static_cast<DID>((body[0] << 8) | body[1]);
+        data.assign(body.begin() + 2, body.end());
+        apply(did, data);
+        ++records;
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+uint64_t DidJournal::append(DID did, const std::vector<uint8_t>& data) {
+    return append(did, data.data(), data.size());
+}
+
+uint64_t DidJournal::append(DID did, const uint8_t* data, size_t size) {
+    uint8_t did_bytes[2] = {static_cast<uint8_t>((did >> 8) & 0xFF), static_cast<uint8_t>(did & 0xFF)};
+    uint32_t crc = crc32_update(0, did_bytes, sizeof(did_bytes));
+    crc = crc32_update(crc, data, size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_u32_le(buffer_, static_cast<uint32_t>(sizeof(did_bytes) + size));
+    append_u32_le(buffer_, crc);
+    buffer_.insert(buffer_.end(), did_bytes, did_bytes + sizeof(did_bytes));
+    buffer_.insert(buffer_.end(), data, data + size);
+    return ++appended_seq_;
+}
+
+bool DidJournal::commit(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<uint8_t> batch;
+
+    while (committed_seq_ < seq) {
+        if (failed_ || file_ == nullptr) {
+            return false;
+        }
+        if (flushing_) {
+            // 其他线程正在写出，等待它完成后再检查（可能已经包含本记录）
+            flushed_cv_.wait(lock);
+            continue;
+        }
+
+        // 成为leader：写出缓冲区中所有记录，一次完成多个写者的提交
+        flushing_ = true;
+        batch.swap(buffer_);
+        uint64_t last_seq = appended_seq_;
+        lock.unlock();
+
+        bool ok = write_batch(batch, policy_ == FsyncPolicy::ALWAYS);
+
+        lock.lock();
+        flushing_ = false;
+        if (ok) {
+            committed_seq_ = last_seq;
+            file_bytes_ += batch.size();
+            dirty_ = dirty_ || policy_ == FsyncPolicy::INTERVAL;
+        } else {
+            UDS_LOG_ERROR("Failed to write DID journal: %s", path_.c_str());
+            failed_ = true;
+        }
+        // 复用本批次的缓冲区容量
+        batch.clear();
+        if (buffer_.empty()) {
+            buffer_.swap(batch);
+        }
+        flushed_cv_.notify_all();
+    }
+    return true;
+}
+
+bool DidJournal::write_batch(const std::vector<uint8_t>& batch, bool do_sync) {
+    if (!batch.empty() && std::fwrite(batch.data(), 1, batch.size(), file_) != batch.size()) {
+        return false;
+    }
+    if (do_sync) {
+        return sync_file(file_);
+    }
+    return std::fflush(file_) == 0;
+}
+
+// 与rotate()在同一个维护线程中调用
+bool DidJournal::sync() {
+    std::FILE* file;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dirty_ || file_ == nullptr) {
+            return true;
+        }
+        dirty_ = false;
+        file = file_;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool DidJournal::rotate(const std::string& rotated_path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_cv_.wait(lock, [this]() { return !flushing_; });
+    if (file_ == nullptr) {
+        return false;
+    }
+
+    // 把缓冲区中的记录写入旧日志并落盘，保证切分点之前的记录都在旧日志中；
+    // 之前的提交写出失败时不再切分，按下面的失败处理去掉它留在文件末尾的残留
+    bool ok = !failed_ && write_batch(buffer_, true);
+    std::fclose(file_);
+    file_ = nullptr;
+    if (ok) {
+        committed_seq_ = appended_seq_;
+        file_bytes_ += buffer_.size();
+        buffer_.clear();
+        dirty_ = false;
+    }
+
+    std::remove(rotated_path.c_str());
+    if (!ok || std::rename(path_.c_str(), rotated_path.c_str()) != 0) {
+        // 切分失败时继续追加到原日志，不丢弃已有记录。写出失败时文件末尾可能留有半个批次，
+        // 重新打开后先截断到最后一次完整提交的位置，否则之后追加的记录在回放时会被这段残留挡住；
+        // 未写出的记录仍在缓冲区中，由下一次提交重新写出
+        UDS_LOG_ERROR("Failed to rotate DID journal: %s", path_.c_str());
+        file_ = std::fopen(path_.c_str(), "ab");
+        failed_ = file_ == nullptr || !truncate_file(file_, sizeof(JOURNAL_MAGIC) + file_bytes_);
+        if (failed_) {
+            UDS_LOG_ERROR("Failed to reopen DID journal: %s", path_.c_str());
+        }
+        flushed_cv_.notify_all();
+        return false;
+    }
+
+    ok = open_file_locked();
+    flushed_cv_.notify_all();
+    return ok;
+}
+
+bool DidJournal::discard(const std::string& discarded_path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_cv_.wait(lock, [this]() { return !flushing_; });
+    if (file_ == nullptr) {
+        return false;
+    }
+
+    buffer_.clear();
+    committed_seq_ = appended_seq_;
+    dirty_ = false;
+    std::fclose(file_);
+    file_ = nullptr;
+
+    // 改名失败时新建日志会截断原文件，旧记录同样被丢弃
+#ifdef _WIN32
+    std::remove(discarded_path.c_str());
+#endif
+    std::rename(path_.c_str(), discarded_path.c_str());
+    bool ok = open_file_locked(false);
+    flushed_cv_.notify_all();
+    return ok;
+}
+
+uint64_t DidJournal::size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_bytes_ + buffer_.size();
+}
+
+} // namespace uds
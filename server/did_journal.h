@@ -0,0 +1,92 @@
+#ifndef DID_JOURNAL_H
+#define DID_JOURNAL_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "uds_protocol.h"
+
+namespace uds {
+
+// 日志落盘策略
+enum class FsyncPolicy {
+    ALWAYS,    // 每次组提交后fsync，写入返回时数据已落盘
+    INTERVAL,  // 写入返回时数据已交给操作系统，后台定期fsync（默认）
+    NEVER      // 只交给操作系统，从不fsync
+};
+
+// 解析落盘策略名称（always/interval/never）
+bool parse_fsync_policy(const std::string& name, FsyncPolicy& policy);
+
+// 刷新stdio缓冲区并把文件数据落盘
+bool sync_file(std::FILE* file);
+
+// 只追加的二进制DID写入日志（WAL）
+// 记录格式：[4字节载荷长度][4字节CRC32][2字节DID][数据]，长度与CRC为小端
+// 并发写入通过组提交合并：第一个等待的写者成为leader，把期间积累的所有记录一次写出
+class DidJournal {
+public:
+    typedef std::function<void(DID, const std::vector<uint8_t>&)> ApplyFunc;
+
+    DidJournal();
+    ~DidJournal();
+
+    // 新建（截断）日志文件
+    bool open(const std::string& path, FsyncPolicy policy);
+
+    // 写出剩余记录并关闭日志
+    void close();
+
+    // 按顺序回放日志中的有效记录，遇到不完整或校验失败的尾部记录即停止
+    // 文件不存在时返回true且records为0
+    static bool replay(const std::string& path, const ApplyFunc& apply, size_t& records);
+
+    // 把一条记录追加到内存缓冲区，返回其序号（不等待写出）
+    uint64_t append(DID did, const std::vector<uint8_t>& data);
+    uint64_t append(DID did, const uint8_t* data, size_t size);
+
+    // 等待序号不大于seq的记录按落盘策略完成提交
+    bool commit(uint64_t seq);
+
+    // 对已写出但未fsync的数据执行fsync（INTERVAL策略的后台线程调用）
+    bool sync();
+
+    // 写出并fsync当前日志，将其改名为rotated_path，然后在原路径新建空日志；
+    // 失败时截断到最后一次完整提交的位置，继续追加到原日志
+    bool rotate(const std::string& rotated_path);
+
+    // 丢弃日志中的全部记录（整体替换数据集时，旧数据集上的写入随之作废）：
+    // 缓冲区中的记录不再写出，当前日志不fsync直接改名为discarded_path，然后在原路径新建空日志；
+    // 等待这些记录提交的写者照常返回。discarded_path由调用者在锁外删除
+    bool discard(const std::string& discarded_path);
+
+    // 当前日志中记录的总字节数（含未写出的缓冲区，不含文件头）
+    uint64_t size_bytes() const;
+
+private:
+    bool open_file_locked(bool sync_header = true);
+    bool write_batch(const std::vector<uint8_t>& batch, bool do_sync);
+
+    std::string path_;
+    FsyncPolicy policy_;
+    std::FILE* file_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_cv_;
+    std::vector<uint8_t> buffer_;  // 等待写出的记录
+    uint64_t appended_seq_;        // 已追加到缓冲区的最大序号
+    uint64_t committed_seq_;       // 已按策略提交的最大序号
+    bool flushing_;                // 是否有线程正在写文件
+    bool dirty_;                   // 是否有已写出但未fsync的数据
+    bool failed_;                  // 发生过I/O错误
+    uint64_t file_bytes_;
+};
+
+} // namespace uds
+
+#endif // DID_JOURNAL_H
@@ -1,208 +1,420 @@
 #include "did_manager.h"
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <iomanip>
+#include "logger.h"
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 namespace uds {
 
-DIDManager::DIDManager(const std::string& data_file_path)
-    : data_file_path_(data_file_path) {
+namespace {
+
+bool has_binary_extension(const std::string& path) {
+    const std::string extension = ".bin";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// 已存在的文件按魔数判断格式，新文件按扩展名（.bin）判断
+bool is_binary_path(const std::string& path) {
+    return DidDatabase::is_binary_file(path) || has_binary_extension(path);
+}
+
+// 导出文件名：在数据文件名的扩展名前插入UTC时间和版本号，如did_data.20260101T120000Z.v42.json
+std::string export_path_for(const std::string& data_file_path, uint64_t version) {
+    size_t name_start = data_file_path.find_last_of("/\\");
+    size_t dot = data_file_path.find_last_of('.');
+    if (dot == std::string::npos || (name_start != std::string::npos && dot < name_start)) {
+        dot = data_file_path.size();
+    }
+    char stamp[64];
+    std::time_t now = std::time(nullptr);
+    size_t length = std::strftime(stamp, sizeof(stamp), ".%Y%m%dT%H%M%SZ", std::gmtime(&now));
+    std::snprintf(stamp + length, sizeof(stamp) - length, ".v%llu", static_cast<unsigned long long>(version));
+    return data_file_path.substr(0, dot) + stamp + data_file_path.substr(dot);
+}
+
+} // namespace
+
+DIDManager::DIDManager(const std::string& data_file_path, const PersistenceOptions& options)
+    : data_file_path_(data_file_path),
+      journal_path_(data_file_path + ".wal"),
+      rotated_journal_path_(data_file_path + ".wal.old"),
+      discarded_journal_path_(data_file_path + ".wal.discarded"),
+      options_(options),
+      binary_format_(is_binary_path(data_file_path)),
+      journal_open_(false),
+      stopping_(false),
+      reload_requested_(false),
+      export_requested_(false) {
     // 构造函数中尝试加载数据
     load_data();
+    
+    // 回放上次运行遗留的日志，然后启动后台维护线程
+    recover_journal();
+    if (journal_open_) {
+        maintenance_thread_ = std::thread(&DIDManager::maintenance_loop, this);
+    }
 }
 
-// 从JSON字符串中解析DID数据
-bool DIDManager::parse_json(const std::string& json_str) {
-    did_data_.clear();
+DIDManager::~DIDManager() {
+    {
+        std::lock_guard<std::mutex> lock(maintenance_mutex_);
+        stopping_ = true;
+    }
+    maintenance_cv_.notify_all();
+    if (maintenance_thread_.joinable()) {
+        maintenance_thread_.join();
+    }
     
-    // 简单的JSON解析，仅处理我们需要的格式
-    size_t dids_start = json_str.find("\"dids\": {");
-    if (dids_start == std::string::npos) {
-        return false;
+    // 退出前把日志压缩进数据文件
+    if (journal_open_ && journal_.size_bytes() > 0) {
+        save_data();
+    }
+    journal_.close();
+}
+
+bool DIDManager::FileStamp::operator==(const FileStamp& other) const {
+    return exists == other.exists && inode == other.inode && size == other.size && mtime == other.mtime;
+}
+
+// 文件改名替换后inode不同，原地修改后大小或修改时间不同
+DIDManager::FileStamp DIDManager::stamp_file(const std::string& path) {
+    FileStamp stamp;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return stamp;
+    }
+    stamp.exists = true;
+    stamp.inode = static_cast<uint64_t>(st.st_ino);
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    stamp.mtime = static_cast<int64_t>(st.st_mtime) * 1000000000;
+    #ifdef __linux__
+    stamp.mtime += st.st_mtim.tv_nsec;
+    #endif
+    return stamp;
+}
+
+// 二进制数据库直接映射，JSON文件单遍解析；得到的数据区直接作为DID表的数据段，不再逐个复制
+std::shared_ptr<DidDatabase> DIDManager::parse_data_file(bool binary, std::string& error) const {
+    std::shared_ptr<DidDatabase> database(new DidDatabase());
+    bool ok = binary ? database->map_file(data_file_path_, error)
+                     : database->load_json_file(data_file_path_, error);
+    if (!ok) {
+        database.reset();
+    }
+    return database;
+}
+
+// 数据文件不存在时不算被修改，下次保存会重新生成它
+bool DIDManager::data_file_changed() const {
+    FileStamp stamp = stamp_file(data_file_path_);
+    return stamp.exists && !(stamp == file_stamp_);
+}
+
+// 加载DID数据
+bool DIDManager::load_data() {
+    std::FILE* probe = std::fopen(data_file_path_.c_str(), "rb");
+    if (probe == nullptr) {
+        UDS_LOG_WARN("Failed to open DID data file: %s", data_file_path_.c_str());
+        // 如果文件不存在，创建默认数据
+        DidStore::DidMap defaults;
+        defaults[0x1234] = {0x01, 0x02, 0x03, 0x04}; // 示例DID 1234
+        defaults[0x5678] = {0xAA, 0xBB, 0xCC, 0xDD}; // 示例DID 5678
+        defaults[0x0001] = {0x56, 0x31, 0x2E, 0x30, 0x2E, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // 版本号 V1.0.0
+        defaults[0x0002] = {0x00, 0x64}; // 车速 100 km/h
+        defaults[0x0003] = {0x03, 0xE8}; // 发动机转速 1000 rpm
+        defaults[0x0004] = {0x00, 0x00, 0x00, 0x01}; // 功能配置字
+        did_data_.replace_all(defaults);
+        save_data();
+        return true;
     }
+    std::fclose(probe);
     
-    dids_start += 8; // 跳过 "dids": {
-    size_t dids_end = json_str.rfind("}");
-    if (dids_end == std::string::npos || dids_end <= dids_start) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    file_stamp_ = stamp_file(data_file_path_);
+    std::string error;
+    std::shared_ptr<DidDatabase> database = parse_data_file(binary_format_, error);
+    if (!database) {
+        UDS_LOG_ERROR("Failed to parse DID data file: %s (%s)", data_file_path_.c_str(), error.c_str());
         return false;
     }
+    did_data_.replace_all(database);
     
-    // 解析每个DID条目
-    std::string dids_str = json_str.substr(dids_start, dids_end - dids_start);
-    size_t pos = 0;
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    UDS_LOG_INFO("Loaded %zu DIDs from %s%s in %.1f ms", database->count(), data_file_path_.c_str(),
+                 binary_format_ ? " (binary, mapped)" : " (JSON)", elapsed_ms);
+    return true;
+}
+
+// 保存DID数据
+bool DIDManager::save_data() {
+    std::lock_guard<std::mutex> lock(save_mutex_);
     
-    while (pos < dids_str.size()) {
-        // 跳过空白字符
-        while (pos < dids_str.size() && std::isspace(dids_str[pos])) {
-            pos++;
-        }
-        
-        // 查找DID键（"XXXX":）
-        size_t did_key_start = dids_str.find('"', pos);
-        if (did_key_start == std::string::npos) {
-            break;
-        }
-        
-        size_t did_key_end = dids_str.find('"', did_key_start + 1);
-        if (did_key_end == std::string::npos) {
-            break;
-        }
-        
-        // 解析DID
-        std::string did_str = dids_str.substr(did_key_start + 1, did_key_end - did_key_start - 1);
-        DID did = static_cast<DID>(std::stoi(did_str, nullptr, 16));
-        
-        // 查找数据数组（[ ... ]）
-        size_t array_start = dids_str.find('[', did_key_end);
-        if (array_start == std::string::npos) {
-            break;
-        }
-        
-        size_t array_end = dids_str.find(']', array_start);
-        if (array_end == std::string::npos) {
-            break;
+    // 数据文件被外部替换过（如更换测试数据集）时以新文件为准，不用内存中的旧数据覆盖它
+    if (data_file_changed()) {
+        UDS_LOG_WARN("DID data file %s changed on disk, reloading it instead of saving", data_file_path_.c_str());
+        return reload_locked();
+    }
+    
+    // 上次压缩失败留下的旧日志尚未删除时不再切分，新写入继续留在当前日志中
+    bool rotate = false;
+    if (journal_open_) {
+        std::FILE* rotated = std::fopen(rotated_journal_path_.c_str(), "rb");
+        if (rotated != nullptr) {
+            std::fclose(rotated);
+        } else {
+            rotate = true;
         }
-        
-        // 解析数据数组
-        std::vector<uint8_t> data;
-        std::string array_str = dids_str.substr(array_start + 1, array_end - array_start - 1);
-        std::istringstream array_iss(array_str);
-        std::string byte_str;
-        
-        while (array_iss >> byte_str) {
-            // 移除逗号
-            if (byte_str.back() == ',') {
-                byte_str.pop_back();
-            }
-            
-            try {
-                uint8_t byte = static_cast<uint8_t>(std::stoi(byte_str, nullptr, 10));
-                data.push_back(byte);
-            } catch (...) {
-                // 忽略无效数据
-            }
+    }
+    
+    // 切分日志与固定快照在同一次写入锁内完成：快照恰好包含切分点之前的全部写入，
+    // 之后的写入只在新日志中。文件在快照上生成，期间写入照常进行
+    std::shared_ptr<const DidSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        if (rotate) {
+            journal_.rotate(rotated_journal_path_);
         }
-        
-        // 添加到DID数据映射
-        did_data_[did] = data;
-        
-        // 移动到下一个条目
-        pos = array_end + 1;
+        snapshot = did_data_.snapshot();
     }
+    if (!write_snapshot_file(*snapshot, data_file_path_, binary_format_)) {
+        return false;
+    }
+    file_stamp_ = stamp_file(data_file_path_);
     
+    // 快照已包含旧日志中的全部写入
+    std::remove(rotated_journal_path_.c_str());
     return true;
 }
 
-// 生成JSON字符串
-std::string DIDManager::generate_json() const {
-    std::stringstream json_ss;
+// 重新加载DID数据
+bool DIDManager::reload_data() {
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    return reload_locked();
+}
+
+void DIDManager::request_reload() {
+    reload_requested_.store(true);
+}
+
+// 解析在调用线程上进行，不持有写入锁，读写请求照常处理；只有最后的表替换与写入互斥
+bool DIDManager::reload_locked() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // 先取文件标识再解析：解析期间文件又被替换时，下次检查仍能发现
+    FileStamp stamp = stamp_file(data_file_path_);
+    bool binary = is_binary_path(data_file_path_);
+    std::string error;
+    std::shared_ptr<DidDatabase> database = parse_data_file(binary, error);
+    file_stamp_ = stamp;
+    if (!database) {
+        UDS_LOG_ERROR("Failed to reload DID data file: %s (%s), keeping current data",
+                      data_file_path_.c_str(), error.c_str());
+        return false;
+    }
     
-    json_ss << "{" << std::endl;
-    json_ss << "  \"version\": \"1.0\"," << std::endl;
-    json_ss << "  \"description\": \"UDS DID Data\"," << std::endl;
-    json_ss << "  \"dids\": {" << std::endl;
+    // 新表同样在写入锁外构建
+    DidStore::PreparedTable table = did_data_.prepare(database);
     
-    // 写入所有DID数据
-    auto it = did_data_.begin();
-    while (it != did_data_.end()) {
-        // 格式化DID为4位十六进制字符串
-        std::stringstream did_ss;
-        did_ss << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << it->first;
-        std::string did_str = did_ss.str();
-        
-        // 写入DID键
-        json_ss << "    \"" << did_str << "\": [";
-        
-        // 写入数据数组
-        const auto& data = it->second;
-        for (size_t i = 0; i < data.size(); ++i) {
-            if (i > 0) {
-                json_ss << ", ";
-            }
-            json_ss << static_cast<int>(data[i]);
+    // 旧数据集上的写入随日志一起作废。写入锁内只切换日志和换上新表：
+    // 并发的写入要么进入旧表和被丢弃的日志，要么进入新表和新日志，崩溃恢复时不会混入旧数据集的写入。
+    // 作废的日志不写出也不fsync，改名后在锁外删除；压缩未完成时遗留的旧日志同属旧数据集
+    std::remove(rotated_journal_path_.c_str());
+    {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        if (journal_open_) {
+            journal_.discard(discarded_journal_path_);
         }
-        
-        json_ss << "]";
-        
-        // 检查是否是最后一个条目
-        ++it;
-        if (it != did_data_.end()) {
-            json_ss << ",";
-        }
-        json_ss << std::endl;
+        did_data_.publish(table);
     }
+    std::remove(discarded_journal_path_.c_str());
+    binary_format_ = binary;
     
-    json_ss << "  }" << std::endl;
-    json_ss << "}" << std::endl;
-    
-    return json_ss.str();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    UDS_LOG_INFO("Reloaded %zu DIDs from %s in %.1f ms", database->count(), data_file_path_.c_str(), elapsed_ms);
+    return true;
 }
 
-// 加载DID数据
-bool DIDManager::load_data() {
-    std::ifstream file(data_file_path_);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open DID data file: " << data_file_path_ << std::endl;
-        // 如果文件不存在，创建默认数据
-        did_data_[0x1234] = {0x01, 0x02, 0x03, 0x04}; // 示例DID 1234
-        did_data_[0x5678] = {0xAA, 0xBB, 0xCC, 0xDD}; // 示例DID 5678
-        did_data_[0x0001] = {0x56, 0x31, 0x2E, 0x30, 0x2E, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // 版本号 V1.0.0
-        did_data_[0x0002] = {0x00, 0x64}; // 车速 100 km/h
-        did_data_[0x0003] = {0x03, 0xE8}; // 发动机转速 1000 rpm
-        did_data_[0x0004] = {0x00, 0x00, 0x00, 0x01}; // 功能配置字
-        save_data();
-        return true;
+// 导出快照
+bool DIDManager::export_snapshot(const std::string& path, uint64_t& version) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<const DidSnapshot> snapshot = did_data_.snapshot();
+    version = snapshot->version();
+    std::string export_path = path.empty() ? export_path_for(data_file_path_, version) : path;
+    if (!write_snapshot_file(*snapshot, export_path, has_binary_extension(export_path))) {
+        return false;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    UDS_LOG_INFO("Exported %zu DIDs (version %llu) to %s in %.1f ms", snapshot->size(),
+                 static_cast<unsigned long long>(version), export_path.c_str(), elapsed_ms);
+    return true;
+}
+
+void DIDManager::request_export() {
+    export_requested_.store(true);
+}
+
+std::shared_ptr<const DidSnapshot> DIDManager::snapshot() const {
+    return did_data_.snapshot();
+}
+
+// 原子地写入快照文件
+bool DIDManager::write_snapshot_file(const DidSnapshot& snapshot, const std::string& path, bool binary) {
+    std::string tmp_path = path + ".tmp";
+    std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (file == nullptr) {
+        UDS_LOG_ERROR("Failed to open DID data file for writing: %s", tmp_path.c_str());
+        return false;
     }
     
-    // 读取整个文件内容
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string json_str = buffer.str();
+    DidDatabase database;
+    snapshot.export_to(database);
+    bool ok;
+    if (binary) {
+        std::vector<uint8_t> content = database.to_binary();
+        ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    } else {
+        std::string content = database.to_json();
+        ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    }
     
-    // 解析JSON
-    if (!parse_json(json_str)) {
-        std::cerr << "Failed to parse DID data file: " << data_file_path_ << std::endl;
-        file.close();
+    // 落盘后再替换正式文件，崩溃时不会留下写了一半的数据文件；
+    // 正在被映射的旧文件改名覆盖后仍保持有效，直到映射解除
+    ok = sync_file(file) && ok;
+    std::fclose(file);
+    if (!ok) {
+        UDS_LOG_ERROR("Failed to write DID data file: %s", tmp_path.c_str());
+        std::remove(tmp_path.c_str());
         return false;
     }
     
-    file.close();
+    #ifdef _WIN32
+    std::remove(path.c_str());
+    #endif
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        UDS_LOG_ERROR("Failed to replace DID data file: %s", path.c_str());
+        return false;
+    }
     return true;
 }
 
-// 保存DID数据
-bool DIDManager::save_data() {
-    std::ofstream file(data_file_path_);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open DID data file for writing: " << data_file_path_ << std::endl;
-        return false;
+// 回放日志恢复写入
+void DIDManager::recover_journal() {
+    DidJournal::ApplyFunc apply = [this](DID did, const std::vector<uint8_t>& data) {
+        did_data_.write(did, data);
+    };
+    
+    // 先回放压缩未完成时遗留的旧日志，再回放当前日志
+    size_t rotated_records = 0;
+    size_t records = 0;
+    bool ok = DidJournal::replay(rotated_journal_path_, apply, rotated_records);
+    ok = DidJournal::replay(journal_path_, apply, records) && ok;
+    if (!ok) {
+        UDS_LOG_ERROR("DID journal is corrupted, keeping it for inspection: %s", journal_path_.c_str());
+        return;
     }
     
-    // 生成JSON字符串
-    std::string json_str = generate_json();
+    if (rotated_records + records > 0) {
+        UDS_LOG_INFO("Recovered %zu DID write(s) from journal", rotated_records + records);
+        // 恢复的数据写入快照后才能截断日志
+        if (!write_snapshot_file(*did_data_.snapshot(), data_file_path_, binary_format_)) {
+            return;
+        }
+        file_stamp_ = stamp_file(data_file_path_);
+    }
+    std::remove(rotated_journal_path_.c_str());
+    std::remove(discarded_journal_path_.c_str());
     
-    // 写入文件
-    file << json_str;
+    journal_open_ = journal_.open(journal_path_, options_.fsync_policy);
+}
+
+// 后台维护线程
+void DIDManager::maintenance_loop() {
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::milliseconds tick(100);
+    Clock::time_point last_sync = Clock::now();
+    Clock::time_point last_compact = Clock::now();
     
-    file.close();
-    return true;
+    std::unique_lock<std::mutex> lock(maintenance_mutex_);
+    while (!stopping_) {
+        maintenance_cv_.wait_for(lock, tick);
+        if (stopping_) {
+            break;
+        }
+        lock.unlock();
+        
+        Clock::time_point now = Clock::now();
+        if (options_.fsync_policy == FsyncPolicy::INTERVAL &&
+            now - last_sync >= std::chrono::milliseconds(options_.fsync_interval_ms)) {
+            journal_.sync();
+            last_sync = now;
+        }
+        
+        // 收到重新加载请求，或监视数据文件时发现文件被替换
+        bool reload = reload_requested_.exchange(false);
+        if (reload || options_.watch_file) {
+            std::lock_guard<std::mutex> save_lock(save_mutex_);
+            if (reload || data_file_changed()) {
+                reload_locked();
+                last_compact = Clock::now();
+            }
+        }
+        
+        // 导出在固定的快照上进行，不阻塞写入，也不影响日志压缩
+        if (export_requested_.exchange(false)) {
+            uint64_t version;
+            export_snapshot(std::string(), version);
+        }
+        
+        uint64_t journal_bytes = journal_.size_bytes();
+        if (journal_bytes > 0 &&
+            (journal_bytes >= options_.compact_journal_bytes ||
+             now - last_compact >= std::chrono::milliseconds(options_.compact_interval_ms))) {
+            save_data();
+            last_compact = Clock::now();
+        }
+        
+        lock.lock();
+    }
 }
 
 // 读取DID值
 bool DIDManager::read_did(DID did, std::vector<uint8_t>& data) {
-    auto it = did_data_.find(did);
-    if (it != did_data_.end()) {
-        data = it->second;
-        return true;
-    }
-    return false;
+    return did_data_.read(did, data);
+}
+
+// 读取DID值的视图
+bool DIDManager::read_did(DID did, DidValueView& view) const {
+    return did_data_.read(did, view);
+}
+
+// 批量读取DID值的视图
+size_t DIDManager::read_dids(DidLookup* lookups, size_t count) const {
+    return did_data_.read_batch(lookups, count);
 }
 
 // 写入DID值
 bool DIDManager::write_did(DID did, const std::vector<uint8_t>& data) {
-    did_data_[did] = data;
-    return save_data();
+    return write_did(did, data.data(), data.size());
+}
+
+bool DIDManager::write_did(DID did, const uint8_t* data, size_t size) {
+    if (!journal_open_ || size > DidStore::MAX_VALUE_SIZE) {
+        return false;
+    }
+    
+    // 日志记录与存储更新在同一把锁内完成，顺序一致
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        seq = journal_.append(did, data, size);
+        did_data_.write(did, data, size);
+    }
+    
+    // 组提交：锁外等待日志写出，多个并发写入合并为一次I/O
+    return journal_.commit(seq);
 }
 
 } // namespace uds
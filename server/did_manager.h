@@ -5,37 +5,132 @@
 #include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 #include "uds_protocol.h"
+#include "did_store.h"
+#include "did_journal.h"
+#include "did_database.h"
+#include "did_source.h"
 
 namespace uds {
 
-class DIDManager {
+// DID数据持久化参数
+struct PersistenceOptions {
+    FsyncPolicy fsync_policy = FsyncPolicy::INTERVAL;
+    int fsync_interval_ms = 1000;     // INTERVAL策略下的fsync周期
+    int compact_interval_ms = 5000;   // 把日志压缩进数据文件的周期
+    uint64_t compact_journal_bytes = 4 * 1024 * 1024;  // 日志超过该大小时提前压缩
+    bool watch_file = false;          // 后台线程发现数据文件被替换或修改时自动重新加载
+};
+
+// DID数据管理
+// 数据文件可以是JSON（did_data.json）或二进制数据库（*.bin，启动时直接映射）；
+// 写入先追加到二进制日志（<数据文件>.wal），再由后台线程定期压缩进数据文件；
+// 启动时加载数据文件并回放日志，恢复上次崩溃前已提交的写入。
+// 运行期间可以重新加载数据文件：新数据在后台线程解析成完整的新表后原子替换，
+// 正在进行的读取继续使用旧表，旧表由EpochManager在读者离开后释放。
+// 保存、导出等需要一致数据的读者固定一个版本的快照（DidSnapshot），0x2E写入照常进行
+class DIDManager : public DidSource {
 public:
-    DIDManager(const std::string& data_file_path);
-    ~DIDManager() = default;
+    DIDManager(const std::string& data_file_path,
+               const PersistenceOptions& options = PersistenceOptions());
+    ~DIDManager();
     
     // 加载DID数据
     bool load_data();
     
-    // 保存DID数据
+    // 保存DID数据：把当前全部数据写入数据文件并清空已压缩的日志
+    // 数据文件在上次加载或保存后被外部替换过时，改为重新加载该文件，不覆盖它
     bool save_data();
     
-    // 读取DID值
+    // 重新加载数据文件，替换当前全部数据；此前尚未压缩的写入随旧数据一起丢弃。
+    // 解析失败时保留当前数据并返回false
+    bool reload_data();
+    
+    // 请求后台线程重新加载数据文件后立即返回；只写一个原子标志，可在信号处理函数中调用
+    void request_reload();
+    
+    // 把某一版本的全部数据写入path（.bin结尾时为二进制数据库，否则为JSON），version返回导出的版本号；
+    // path为空时写到数据文件旁，文件名为<数据文件名>.<UTC时间>.v<版本号>.<扩展名>
+    bool export_snapshot(const std::string& path, uint64_t& version);
+    
+    // 请求后台线程导出一份快照（path为空的export_snapshot）后立即返回；可在信号处理函数中调用
+    void request_export();
+    
+    // 固定当前版本的快照，供备份、复制等读者按DID升序读出，不阻塞写入
+    std::shared_ptr<const DidSnapshot> snapshot() const;
+    
+    // 读取DID值（可被多个线程并发调用）
     bool read_did(DID did, std::vector<uint8_t>& data);
     
-    // 写入DID值
-    bool write_did(DID did, const std::vector<uint8_t>& data);
+    // 读取DID值的视图，不复制数据；调用者需持有EpochManager::Guard
+    bool read_did(DID did, DidValueView& view) const;
+    
+    // 批量读取DID值的视图，返回找到的个数；调用者需持有EpochManager::Guard
+    size_t read_dids(DidLookup* lookups, size_t count) const override;
     
+    // 写入DID值（可被多个线程并发调用），按落盘策略提交日志后返回
+    bool write_did(DID did, const std::vector<uint8_t>& data);
+    bool write_did(DID did, const uint8_t* data, size_t size) override;
+
 private:
-    // 从JSON字符串中解析DID数据
-    bool parse_json(const std::string& json_str);
+    // 数据文件的标识，用于发现文件被外部替换或修改
+    struct FileStamp {
+        bool exists;
+        uint64_t inode;
+        uint64_t size;
+        int64_t mtime;
+        
+        FileStamp() : exists(false), inode(0), size(0), mtime(0) {}
+        bool operator==(const FileStamp& other) const;
+    };
+    
+    static FileStamp stamp_file(const std::string& path);
+    
+    // 按文件内容的格式解析数据文件
+    std::shared_ptr<DidDatabase> parse_data_file(bool binary, std::string& error) const;
+    
+    // 数据文件在上次加载或保存后是否被外部替换或修改，调用者需持有save_mutex_
+    bool data_file_changed() const;
     
-    // 生成JSON字符串
-    std::string generate_json() const;
+    // 重新加载数据文件，调用者需持有save_mutex_
+    bool reload_locked();
+    
+    // 原子地把快照写入文件（先写临时文件再改名）
+    bool write_snapshot_file(const DidSnapshot& snapshot, const std::string& path, bool binary);
+    
+    // 回放日志恢复写入，并打开新的日志
+    void recover_journal();
+    
+    // 后台维护线程：定期fsync日志并压缩
+    void maintenance_loop();
     
     std::string data_file_path_;
+    std::string journal_path_;
+    std::string rotated_journal_path_;
+    std::string discarded_journal_path_;  // 重新加载时作废的日志，改名后在锁外删除
+    PersistenceOptions options_;
+    bool binary_format_;  // 数据文件是否为二进制数据库
+    FileStamp file_stamp_;  // 上次加载或保存后数据文件的标识，受save_mutex_保护
     // 存储DID数据：key为DID，value为数据字节数组
-    std::map<DID, std::vector<uint8_t>> did_data_;
+    DidStore did_data_;
+    DidJournal journal_;
+    bool journal_open_;
+    // 保证日志记录与存储更新的顺序一致，日志切分时用作切分点
+    std::mutex write_mutex_;
+    // 串行化文件写入
+    std::mutex save_mutex_;
+    
+    std::thread maintenance_thread_;
+    std::mutex maintenance_mutex_;
+    std::condition_variable maintenance_cv_;
+    bool stopping_;
+    std::atomic<bool> reload_requested_;
+    std::atomic<bool> export_requested_;
 };
 
 } // namespace uds
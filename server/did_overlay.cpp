@@ -0,0 +1,158 @@
+#include "did_overlay.h"
+#include "epoch.h"
+#include <cstring>
+
+namespace uds {
+
+namespace {
+
+const uint64_t TAG_SHIFT = 62;
+const uint64_t TAG_INLINE = 1;
+const uint64_t TAG_HEAP = 2;
+const uint64_t POINTER_MASK = (static_cast<uint64_t>(1) << TAG_SHIFT) - 1;
+const size_t VALUE_HEADER_SIZE = 4;  // 单独分配的值前4字节保存长度
+
+uint8_t* heap_block(uint64_t word) {
+    return reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(word & POINTER_MASK));
+}
+
+uint32_t heap_size(const uint8_t* block) {
+    uint32_t size;
+    std::memcpy(&size, block, sizeof(size));
+    return size;
+}
+
+} // namespace
+
+const size_t DidOverlay::PAGE_SIZE;
+const size_t DidOverlay::PAGE_COUNT;
+
+DidOverlay::DidOverlay() : count_(0), value_bytes_(0), page_count_(0) {
+    for (size_t i = 0; i < PAGE_COUNT; ++i) {
+        pages_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+DidOverlay::~DidOverlay() {
+    for (size_t i = 0; i < PAGE_COUNT; ++i) {
+        Page* page = pages_[i].load(std::memory_order_relaxed);
+        if (page == nullptr) {
+            continue;
+        }
+        for (size_t k = 0; k < PAGE_SIZE; ++k) {
+            free_value(page->slots[k].load(std::memory_order_relaxed));
+        }
+        delete page;
+    }
+}
+
+void DidOverlay::free_value(uint64_t word) {
+    if (word >> TAG_SHIFT == TAG_HEAP) {
+        delete[] heap_block(word);
+    }
+}
+
+bool DidOverlay::read(DID did, DidValueView& view) const {
+    const Page* page = pages_[did / PAGE_SIZE].load(std::memory_order_acquire);
+    if (page == nullptr) {
+        return false;
+    }
+    uint64_t word = page->slots[did % PAGE_SIZE].load(std::memory_order_acquire);
+    switch (word >> TAG_SHIFT) {
+        case TAG_INLINE:
+            view.data_ = nullptr;
+            view.size_ = static_cast<size_t>((word >> 48) & 0x7);
+            for (size_t i = 0; i < view.size_; ++i) {
+                view.inline_[i] = static_cast<uint8_t>(word >> (8 * i));
+            }
+            return true;
+
+        case TAG_HEAP: {
+            const uint8_t* block = heap_block(word);
+            view.data_ = block + VALUE_HEADER_SIZE;
+            view.size_ = heap_size(block);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool DidOverlay::write(DID did, const uint8_t* data, size_t size) {
+    if (size > DidStore::MAX_VALUE_SIZE) {
+        return false;
+    }
+
+    // 在锁外准备好新描述符
+    uint64_t word;
+    if (size <= DidStore::MAX_INLINE_SIZE) {
+        word = (TAG_INLINE << TAG_SHIFT) | (static_cast<uint64_t>(size) << 48);
+        for (size_t i = 0; i < size; ++i) {
+            word |= static_cast<uint64_t>(data[i]) << (8 * i);
+        }
+    } else {
+        uint8_t* block = new uint8_t[VALUE_HEADER_SIZE + size];
+        uint32_t size32 = static_cast<uint32_t>(size);
+        std::memcpy(block, &size32, sizeof(size32));
+        std::memcpy(block + VALUE_HEADER_SIZE, data, size);
+        word = (TAG_HEAP << TAG_SHIFT) | static_cast<uint64_t>(reinterpret_cast<uintptr_t>(block));
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    Page* page = pages_[did / PAGE_SIZE].load(std::memory_order_relaxed);
+    if (page == nullptr) {
+        page = new Page();
+        for (size_t i = 0; i < PAGE_SIZE; ++i) {
+            page->slots[i].store(0, std::memory_order_relaxed);
+        }
+        // release保证读者看到页指针时槽位已清零
+        pages_[did / PAGE_SIZE].store(page, std::memory_order_release);
+        ++page_count_;
+    }
+
+    uint64_t previous = page->slots[did % PAGE_SIZE].exchange(word, std::memory_order_acq_rel);
+    if (word >> TAG_SHIFT == TAG_HEAP) {
+        value_bytes_ += VALUE_HEADER_SIZE + size;
+    }
+    if (previous == 0) {
+        ++count_;
+    } else if (previous >> TAG_SHIFT == TAG_HEAP) {
+        // 旧值可能仍被读者引用，等读者离开后再释放
+        value_bytes_ -= VALUE_HEADER_SIZE + heap_size(heap_block(previous));
+        EpochManager::instance().retire([previous]() { free_value(previous); });
+    }
+    return true;
+}
+
+size_t DidOverlay::size() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return count_;
+}
+
+size_t DidOverlay::memory_usage() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return page_count_ * sizeof(Page) + value_bytes_;
+}
+
+LayeredDidSource::LayeredDidSource(const std::shared_ptr<const DidStore>& baseline)
+    : baseline_(baseline) {
+}
+
+size_t LayeredDidSource::read_dids(DidLookup* lookups, size_t count) const {
+    // 先在共享基线中批量查找，再用覆盖层中写入过的值替换
+    size_t found = baseline_->read_batch(lookups, count);
+    for (size_t i = 0; i < count; ++i) {
+        if (overlay_.read(lookups[i].did, lookups[i].view) && !lookups[i].found) {
+            lookups[i].found = true;
+            ++found;
+        }
+    }
+    return found;
+}
+
+bool LayeredDidSource::write_did(DID did, const uint8_t* data, size_t size) {
+    return overlay_.write(did, data, size);
+}
+
+} // namespace uds
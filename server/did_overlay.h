@@ -0,0 +1,76 @@
+#ifndef DID_OVERLAY_H
+#define DID_OVERLAY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "uds_protocol.h"
+#include "did_store.h"
+#include "did_source.h"
+
+namespace uds {
+
+// 稀疏的DID覆盖层，只保存写入过的DID
+// 16位DID空间分为256页、每页256个槽位，页在第一次写入时才分配；
+// 槽位描述符与DidStore相同：不超过6字节的值内联，更长的值单独分配。
+// 读取不加锁，被覆盖的值由EpochManager延迟释放
+class DidOverlay {
+public:
+    DidOverlay();
+    ~DidOverlay();
+
+    // 读取覆盖层中的值，调用者需持有EpochManager::Guard；未写入过时返回false
+    bool read(DID did, DidValueView& view) const;
+
+    // 写入DID值，超过DidStore::MAX_VALUE_SIZE时返回false
+    bool write(DID did, const uint8_t* data, size_t size);
+
+    // 写入过的DID数量
+    size_t size() const;
+
+    // 页与单独分配的值占用的内存字节数
+    size_t memory_usage() const;
+
+private:
+    DidOverlay(const DidOverlay&);
+    DidOverlay& operator=(const DidOverlay&);
+
+    static const size_t PAGE_SIZE = 256;
+    static const size_t PAGE_COUNT = 65536 / PAGE_SIZE;
+
+    struct Page {
+        std::atomic<uint64_t> slots[PAGE_SIZE];
+    };
+
+    static void free_value(uint64_t word);
+
+    std::atomic<Page*> pages_[PAGE_COUNT];
+    mutable std::mutex write_mutex_;  // 只在写者之间互斥
+    size_t count_;
+    size_t value_bytes_;
+    size_t page_count_;
+};
+
+// 基线 + 覆盖层组成的DID集合
+// 基线是模板数据，由同一模板创建的所有实例共享且只读；写入只进入实例自己的覆盖层，
+// 因此每个实例的内存只随它实际写入的DID增长
+class LayeredDidSource : public DidSource {
+public:
+    explicit LayeredDidSource(const std::shared_ptr<const DidStore>& baseline);
+
+    size_t read_dids(DidLookup* lookups, size_t count) const override;
+    bool write_did(DID did, const uint8_t* data, size_t size) override;
+
+    const DidOverlay& overlay() const { return overlay_; }
+
+private:
+    std::shared_ptr<const DidStore> baseline_;
+    DidOverlay overlay_;
+};
+
+} // namespace uds
+
+#endif // DID_OVERLAY_H
@@ -0,0 +1,26 @@
+#ifndef DID_SOURCE_H
+#define DID_SOURCE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "uds_protocol.h"
+#include "did_store.h"
+
+namespace uds {
+
+// UdsService访问DID数据的接口
+// 由持久化的DIDManager和网关中基于模板的ECU分别实现，实现需允许多线程并发调用
+class DidSource {
+public:
+    virtual ~DidSource() {}
+
+    // 批量读取DID值的视图，返回找到的个数；调用者需持有EpochManager::Guard
+    virtual size_t read_dids(DidLookup* lookups, size_t count) const = 0;
+
+    // 写入DID值，失败时返回false
+    virtual bool write_did(DID did, const uint8_t* data, size_t size) = 0;
+};
+
+} // namespace uds
+
+#endif // DID_SOURCE_H
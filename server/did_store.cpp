@@ -0,0 +1,345 @@
+#include "did_store.h"
+#include "epoch.h"
+#include "did_database.h"
+#include <cstring>
+#include <algorithm>
+
+namespace uds {
+
+namespace {
+
+const uint64_t TAG_SHIFT = 62;
+const uint64_t TAG_INLINE = 1;
+const uint64_t TAG_ARENA = 2;
+
+} // namespace
+
+const size_t DidStore::SLOT_COUNT;
+const size_t DidStore::MAX_INLINE_SIZE;
+const size_t DidStore::MAX_VALUE_SIZE;
+const size_t DidStore::MIN_SEGMENT_SIZE;
+const size_t DidStore::SEGMENT_SIZE;
+const size_t DidStore::MAX_SEGMENTS;
+
+// 一张完整的DID表：槽位数组 + 数据区
+// 槽位和数据区段基址由读者无锁访问，其余字段只由持有写锁的写者访问
+struct DidStore::Table {
+    std::atomic<uint64_t> slots[SLOT_COUNT];
+    std::atomic<const uint8_t*> segment_bases[MAX_SEGMENTS];
+
+    std::vector<uint8_t*> segments;
+    std::vector<size_t> segment_sizes;
+    std::shared_ptr<const DidDatabase> database;  // 非空时0号段是数据库的数据区，不归本表所有
+    size_t segment_offset;      // 最后一个数据区段中已使用的字节数
+    size_t arena_bytes;         // 数据区已使用的字节数（含垃圾）
+    size_t live_bytes;          // 数据区中仍被槽位引用的字节数
+    std::atomic<size_t> count;  // 存在的DID数量
+
+    Table() : segment_offset(0), arena_bytes(0), live_bytes(0), count(0) {
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            slots[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < MAX_SEGMENTS; ++i) {
+            segment_bases[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~Table() {
+        for (size_t i = database ? 1 : 0; i < segments.size(); ++i) {
+            delete[] segments[i];
+        }
+    }
+};
+
+DidStore::DidStore() : table_(nullptr), current_(new Table()), version_(0) {
+    table_.store(current_.get(), std::memory_order_relaxed);
+}
+
+DidStore::~DidStore() {
+}
+
+uint64_t DidStore::make_inline(const uint8_t* data, size_t size) {
+    uint64_t word = (TAG_INLINE << TAG_SHIFT) | (static_cast<uint64_t>(size) << 48);
+    for (size_t i = 0; i < size; ++i) {
+        word |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return word;
+}
+
+uint64_t DidStore::make_arena(size_t segment, size_t offset, size_t size) {
+    return (TAG_ARENA << TAG_SHIFT) | (static_cast<uint64_t>(segment) << 48) |
+           (static_cast<uint64_t>(size) << 32) | static_cast<uint64_t>(offset);
+}
+
+bool DidStore::decode(const Table& table, uint64_t word, DidValueView& view) {
+    switch (word >> TAG_SHIFT) {
+        case TAG_INLINE:
+            view.data_ = nullptr;
+            view.size_ = static_cast<size_t>((word >> 48) & 0x7);
+            for (size_t i = 0; i < view.size_; ++i) {
+                view.inline_[i] = static_cast<uint8_t>(word >> (8 * i));
+            }
+            return true;
+
+        case TAG_ARENA: {
+            size_t segment = static_cast<size_t>((word >> 48) & 0x3FFF);
+            // 段基址在描述符发布之前写入，已由槽位的acquire加载保证可见
+            const uint8_t* base = table.segment_bases[segment].load(std::memory_order_relaxed);
+            view.data_ = base + (word & 0xFFFFFFFFu);
+            view.size_ = static_cast<size_t>((word >> 32) & 0xFFFF);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool DidStore::read(DID did, DidValueView& view) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+    uint64_t word = table->slots[did].load(std::memory_order_acquire);
+    return decode(*table, word, view);
+}
+
+size_t DidStore::read_batch(DidLookup* lookups, size_t count) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+
+#if defined(__GNUC__)
+    // 先发出所有槽位的预取，多个缓存未命中可以并行等待
+    for (size_t i = 0; i < count; ++i) {
+        __builtin_prefetch(&table->slots[lookups[i].did]);
+    }
+#endif
+
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t word = table->slots[lookups[i].did].load(std::memory_order_acquire);
+        lookups[i].found = decode(*table, word, lookups[i].view);
+        if (lookups[i].found) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+bool DidStore::read(DID did, std::vector<uint8_t>& data) const {
+    EpochManager::Guard guard;
+    DidValueView view;
+    if (!read(did, view)) {
+        return false;
+    }
+    data.assign(view.data(), view.data() + view.size());
+    return true;
+}
+
+bool DidStore::store_value(Table& table, DID did, const uint8_t* data, size_t size) {
+    if (size > MAX_VALUE_SIZE) {
+        return false;
+    }
+
+    uint64_t word;
+    if (size <= MAX_INLINE_SIZE) {
+        word = make_inline(data, size);
+    } else {
+        // 当前段放不下时新开一段，旧段剩余空间不再使用
+        if (table.segments.empty() || table.segment_offset + size > table.segment_sizes.back()) {
+            if (table.segments.size() >= MAX_SEGMENTS) {
+                return false;
+            }
+            // 段大小从4KB起倍增到1MB，小数据集不必预留整段内存
+            bool first_owned = table.segment_sizes.empty() ||
+                               (table.database && table.segments.size() == 1);
+            size_t segment_size = first_owned
+                ? MIN_SEGMENT_SIZE : std::min(SEGMENT_SIZE, table.segment_sizes.back() * 2);
+            segment_size = std::max(segment_size, size);
+            uint8_t* segment = new uint8_t[segment_size];
+            table.segments.push_back(segment);
+            table.segment_sizes.push_back(segment_size);
+            table.segment_bases[table.segments.size() - 1].store(segment, std::memory_order_relaxed);
+            table.segment_offset = 0;
+        }
+
+        size_t segment_index = table.segments.size() - 1;
+        std::memcpy(table.segments[segment_index] + table.segment_offset, data, size);
+        word = make_arena(segment_index, table.segment_offset, size);
+        table.segment_offset += size;
+        table.arena_bytes += size;
+        table.live_bytes += size;
+    }
+
+    uint64_t previous = table.slots[did].load(std::memory_order_relaxed);
+    if (previous >> TAG_SHIFT == TAG_ARENA) {
+        table.live_bytes -= static_cast<size_t>((previous >> 32) & 0xFFFF);
+    } else if (previous == 0) {
+        table.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // release保证读者看到新描述符时，数据区中的内容与段基址都已写好
+    table.slots[did].store(word, std::memory_order_release);
+    return true;
+}
+
+bool DidStore::write(DID did, const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!store_value(*current_, did, data, size)) {
+        return false;
+    }
+    ++version_;
+    compact_if_needed();
+    return true;
+}
+
+bool DidStore::write(DID did, const std::vector<uint8_t>& data) {
+    return write(did, data.data(), data.size());
+}
+
+void DidStore::compact_if_needed() {
+    Table* table = current_.get();
+    size_t garbage = table->arena_bytes - table->live_bytes;
+    if (garbage < SEGMENT_SIZE || garbage < table->live_bytes) {
+        return;
+    }
+
+    // 只复制仍有效的值，旧表在所有读者离开后释放
+    std::shared_ptr<Table> next(new Table());
+    DidValueView view;
+    for (size_t did = 0; did < SLOT_COUNT; ++did) {
+        uint64_t word = table->slots[did].load(std::memory_order_relaxed);
+        if (decode(*table, word, view)) {
+            store_value(*next, static_cast<DID>(did), view.data(), view.size());
+        }
+    }
+    install(next);
+}
+
+void DidStore::replace_all(const DidMap& data) {
+    std::shared_ptr<Table> next(new Table());
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        store_value(*next, it->first, it->second.data(), it->second.size());
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    install(next);
+    ++version_;
+}
+
+void DidStore::replace_all(const std::shared_ptr<const DidDatabase>& database) {
+    publish(prepare(database));
+}
+
+DidStore::PreparedTable DidStore::prepare(const std::shared_ptr<const DidDatabase>& database) const {
+    std::shared_ptr<Table> next(new Table());
+    if (database->data_size() > 0) {
+        // 数据库的数据区作为已写满的只读段，后续写入总是新开段
+        next->database = database;
+        next->segments.push_back(const_cast<uint8_t*>(database->data()));
+        next->segment_sizes.push_back(database->data_size());
+        next->segment_bases[0].store(database->data(), std::memory_order_relaxed);
+        next->segment_offset = database->data_size();
+        next->arena_bytes = database->data_size();
+    }
+
+    for (size_t i = 0; i < database->count(); ++i) {
+        const DidDatabase::Entry& entry = database->entry(i);
+        uint64_t word;
+        if (entry.size <= MAX_INLINE_SIZE) {
+            word = make_inline(database->value(entry), entry.size);
+        } else {
+            word = make_arena(0, entry.offset, entry.size);
+            next->live_bytes += entry.size;
+        }
+        if (next->slots[entry.did].exchange(word, std::memory_order_relaxed) == 0) {
+            next->count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 数据区中内联长度的值不被槽位引用，计为垃圾参与压缩判断
+    return next;
+}
+
+void DidStore::publish(const PreparedTable& prepared) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    install(prepared);
+    ++version_;
+}
+
+std::shared_ptr<const DidSnapshot> DidStore::snapshot() const {
+    std::shared_ptr<DidSnapshot> snapshot(new DidSnapshot());
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const Table& table = *current_;
+    snapshot->entries_.reserve(table.count.load(std::memory_order_relaxed));
+    for (size_t did = 0; did < SLOT_COUNT; ++did) {
+        uint64_t word = table.slots[did].load(std::memory_order_relaxed);
+        if (word != 0) {
+            DidSnapshot::Entry entry;
+            entry.word = word;
+            entry.did = static_cast<DID>(did);
+            snapshot->entries_.push_back(entry);
+        }
+    }
+    snapshot->table_ = current_;
+    snapshot->version_ = version_;
+    return snapshot;
+}
+
+uint64_t DidStore::version() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return version_;
+}
+
+size_t DidStore::size() const {
+    EpochManager::Guard guard;
+    return table_.load(std::memory_order_acquire)->count.load(std::memory_order_relaxed);
+}
+
+size_t DidStore::memory_usage() const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const Table* table = current_.get();
+    size_t bytes = sizeof(Table);
+    for (size_t i = 0; i < table->segment_sizes.size(); ++i) {
+        bytes += table->segment_sizes[i];
+    }
+    return bytes;
+}
+
+// 旧表的所有权交给EpochManager，读者离开后释放；仍被快照持有时由最后一个快照释放
+void DidStore::install(const std::shared_ptr<Table>& next) {
+    std::shared_ptr<Table> previous = current_;
+    current_ = next;
+    table_.store(next.get(), std::memory_order_release);
+    EpochManager::instance().retire([previous]() mutable { previous.reset(); });
+}
+
+DidValueView DidSnapshot::value(size_t index) const {
+    DidValueView view;
+    DidStore::decode(*table_, entries_[index].word, view);
+    return view;
+}
+
+bool DidSnapshot::read(DID did, DidValueView& view) const {
+    size_t low = 0;
+    size_t high = entries_.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (entries_[middle].did < did) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == entries_.size() || entries_[low].did != did) {
+        return false;
+    }
+    return DidStore::decode(*table_, entries_[low].word, view);
+}
+
+void DidSnapshot::export_to(DidDatabase& database) const {
+    database.clear();
+    DidValueView view;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        DidStore::decode(*table_, entries_[i].word, view);
+        database.append(entries_[i].did, view.data(), view.size());
+    }
+}
+
+} // namespace uds
@@ -0,0 +1,177 @@
+#ifndef DID_STORE_H
+#define DID_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "uds_protocol.h"
+
+namespace uds {
+
+class DidDatabase;
+class DidSnapshot;
+
+// DID值的只读视图，不持有数据也不分配内存
+// 指向数据区的视图只在读取时所持有的EpochManager::Guard存活期间有效；
+// 不超过6字节的值直接复制在视图内部
+class DidValueView {
+public:
+    DidValueView() : data_(nullptr), size_(0) {}
+
+    const uint8_t* data() const { return data_ != nullptr ? data_ : inline_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    friend class DidStore;
+    friend class DidOverlay;
+    friend class LiveDidSource;
+    friend class DynamicDidTable;
+
+    const uint8_t* data_;
+    size_t size_;
+    uint8_t inline_[8];
+};
+
+// 批量读取中的一项：调用者填写did，读取后填写found与view
+struct DidLookup {
+    DID did;
+    bool found;
+    DidValueView view;
+};
+
+// 线程安全、读优化的DID存储
+// 以DID直接索引的65536个槽位覆盖整个16位DID空间，每个槽位是一个64位描述符：
+// 不超过6字节的值内联在描述符中，更长的值存放在连续的字节数据区（arena）中。
+// 读取只需一次按下标的原子加载，不加锁也不等待写者；
+// 写者串行地把新值追加到数据区后原子替换描述符，旧值占用的空间在垃圾超过
+// 有效数据时整体压缩：构建新表并替换，旧表由EpochManager延迟释放。
+// 数据区只追加不改写，因此某一版本的快照只需复制描述符并持有当时的表（见DidSnapshot）
+class DidStore {
+    struct Table;
+
+public:
+    typedef std::map<DID, std::vector<uint8_t>> DidMap;
+
+    static const size_t SLOT_COUNT = 65536;
+    static const size_t MAX_INLINE_SIZE = 6;
+    static const size_t MAX_VALUE_SIZE = 65535;
+
+    DidStore();
+    ~DidStore();
+
+    // 读取DID值的视图，调用者需持有EpochManager::Guard
+    bool read(DID did, DidValueView& view) const;
+
+    // 批量读取DID值的视图，返回找到的个数；调用者需持有EpochManager::Guard
+    // 所有查找基于同一张表，结果彼此一致
+    size_t read_batch(DidLookup* lookups, size_t count) const;
+
+    // 读取DID值并复制
+    bool read(DID did, std::vector<uint8_t>& data) const;
+
+    // 写入DID值，超过MAX_VALUE_SIZE时返回false
+    bool write(DID did, const uint8_t* data, size_t size);
+    bool write(DID did, const std::vector<uint8_t>& data);
+
+    // 用给定数据整体替换存储内容
+    void replace_all(const DidMap& data);
+
+    // 用数据库整体替换存储内容：数据库的数据区直接作为只读数据段引用，不复制值，
+    // 数据库（及其文件映射）由存储持有到不再被任何表引用为止
+    void replace_all(const std::shared_ptr<const DidDatabase>& database);
+
+    // 按数据库构建好、尚未发布的表
+    typedef std::shared_ptr<Table> PreparedTable;
+
+    // replace_all(database)拆成两步，供需要把替换与其他操作放在同一临界区内的调用者使用：
+    // prepare在调用线程上构建新表，不加锁，读写照常进行；publish只在写锁内换上新表。
+    // 每个prepare的结果只能publish一次
+    PreparedTable prepare(const std::shared_ptr<const DidDatabase>& database) const;
+    void publish(const PreparedTable& prepared);
+
+    // 固定当前版本的快照：在写锁内复制所有描述符，之后的写入不影响快照内容
+    std::shared_ptr<const DidSnapshot> snapshot() const;
+
+    // 当前版本号：每次写入或整体替换后加1
+    uint64_t version() const;
+
+    // DID数量
+    size_t size() const;
+
+    // 当前表与数据区占用的内存字节数
+    size_t memory_usage() const;
+
+private:
+    static const size_t MIN_SEGMENT_SIZE = 4096;
+    static const size_t SEGMENT_SIZE = 1024 * 1024;
+    static const size_t MAX_SEGMENTS = 16384;
+
+    friend class DidSnapshot;
+
+    // 描述符编码：高2位为类型（0不存在/1内联/2数据区）
+    static uint64_t make_inline(const uint8_t* data, size_t size);
+    static uint64_t make_arena(size_t segment, size_t offset, size_t size);
+    static bool decode(const Table& table, uint64_t word, DidValueView& view);
+
+    // 在数据区中分配空间并复制值，调用者需持有写锁
+    static bool store_value(Table& table, DID did, const uint8_t* data, size_t size);
+
+    // 垃圾超过有效数据时重建数据区，调用者需持有写锁
+    void compact_if_needed();
+
+    // 换上新表并回收旧表，调用者需持有写锁
+    void install(const std::shared_ptr<Table>& next);
+
+    std::atomic<Table*> table_;
+    std::shared_ptr<Table> current_;  // 当前表的所有权，快照和等待回收的旧表各持有一份；受写锁保护
+    uint64_t version_;                // 受写锁保护
+    mutable std::mutex write_mutex_;  // 只在写者之间互斥
+};
+
+// DidStore某一版本的只读快照，供导出、备份或复制按DID升序读出全部数据
+// 快照只含描述符，值仍在它持有的表的数据区中；快照存活期间写入照常进行，
+// 表（连同数据区和二进制数据库的映射）在存储与所有快照都不再引用后才释放。
+// 读取快照不需要EpochManager::Guard
+class DidSnapshot {
+public:
+    // 创建快照时存储的版本号
+    uint64_t version() const { return version_; }
+
+    // DID数量
+    size_t size() const { return entries_.size(); }
+
+    // 第index个DID（按DID升序）及其值
+    DID did(size_t index) const { return entries_[index].did; }
+    DidValueView value(size_t index) const;
+
+    // 读取快照中的DID值
+    bool read(DID did, DidValueView& view) const;
+
+    // 把快照中的全部数据按DID升序导出到database
+    void export_to(DidDatabase& database) const;
+
+private:
+    friend class DidStore;
+
+    struct Entry {
+        uint64_t word;
+        DID did;
+    };
+
+    DidSnapshot() : version_(0) {}
+    DidSnapshot(const DidSnapshot&);
+    DidSnapshot& operator=(const DidSnapshot&);
+
+    std::shared_ptr<const DidStore::Table> table_;
+    std::vector<Entry> entries_;
+    uint64_t version_;
+};
+
+} // namespace uds
+
+#endif // DID_STORE_H
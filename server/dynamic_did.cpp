@@ -0,0 +1,210 @@
+#include "dynamic_did.h"
+#include "epoch.h"
+#include <algorithm>
+#include <cstring>
+
+namespace uds {
+
+const DID DynamicDidTable::FIRST_DID;
+const DID DynamicDidTable::LAST_DID;
+const size_t DynamicDidTable::MAX_ELEMENTS;
+const size_t DynamicDidTable::DID_COUNT;
+
+namespace {
+
+// 每个线程一份临时数组，容量增长后复用
+thread_local std::vector<DidLookup> t_source_lookups;
+thread_local std::vector<const DynamicDidPlan*> t_plans;
+thread_local std::vector<uint8_t> t_values;
+
+// 按计划读取源DID并拼接到dest，源DID不存在或比定义时短时返回false
+bool execute_plan(const DynamicDidPlan& plan, const DidSource& source, uint8_t* dest) {
+    std::vector<DidLookup>& lookups = t_source_lookups;
+    if (lookups.size() < plan.sources.size()) {
+        lookups.resize(plan.sources.size());
+    }
+    for (size_t i = 0; i < plan.sources.size(); ++i) {
+        lookups[i].did = plan.sources[i];
+        lookups[i].found = false;
+    }
+    source.read_dids(lookups.data(), plan.sources.size());
+    for (size_t i = 0; i < plan.sources.size(); ++i) {
+        if (!lookups[i].found || lookups[i].view.size() < plan.min_source_sizes[i]) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < plan.steps.size(); ++i) {
+        const DynamicDidPlan::Step& step = plan.steps[i];
+        std::memcpy(dest, lookups[step.source_index].view.data() + step.offset, step.size);
+        dest += step.size;
+    }
+    return true;
+}
+
+} // namespace
+
+DynamicDidPlan* DynamicDidPlan::compile(const std::vector<DynamicDidElement>& elements) {
+    DynamicDidPlan* plan = new DynamicDidPlan();
+    plan->elements = elements;
+    plan->size = 0;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        const DynamicDidElement& element = elements[i];
+        size_t index = static_cast<size_t>(
+            std::find(plan->sources.begin(), plan->sources.end(), element.source) - plan->sources.begin());
+        if (index == plan->sources.size()) {
+            plan->sources.push_back(element.source);
+            plan->min_source_sizes.push_back(0);
+        }
+
+        uint16_t offset = static_cast<uint16_t>(element.position - 1);
+        uint16_t end = static_cast<uint16_t>(offset + element.size);
+        plan->min_source_sizes[index] = std::max(plan->min_source_sizes[index], end);
+        plan->size += element.size;
+
+        // 与上一步来自同一源且首尾相接时合并为一次复制
+        if (!plan->steps.empty()) {
+            Step& last = plan->steps.back();
+            if (last.source_index == index && last.offset + last.size == offset) {
+                last.size = static_cast<uint16_t>(last.size + element.size);
+                continue;
+            }
+        }
+        Step step;
+        step.source_index = static_cast<uint16_t>(index);
+        step.offset = offset;
+        step.size = element.size;
+        plan->steps.push_back(step);
+    }
+    return plan;
+}
+
+DynamicDidTable::DynamicDidTable() : defined_(0) {
+    for (size_t i = 0; i < DID_COUNT; ++i) {
+        plans_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+DynamicDidTable::~DynamicDidTable() {
+    for (size_t i = 0; i < DID_COUNT; ++i) {
+        delete plans_[i].load(std::memory_order_relaxed);
+    }
+}
+
+bool DynamicDidTable::define(DID did, const DynamicDidElement* elements, size_t count, const DidSource& source,
+                             ResponseCode& nrc) {
+    nrc = ResponseCode::REQUEST_OUT_OF_RANGE;
+    if (!is_dynamic(did) || count == 0) {
+        return false;
+    }
+
+    // 检查源DID当前的值能覆盖定义的范围
+    {
+        EpochManager::Guard guard;
+        DidLookup lookup;
+        for (size_t i = 0; i < count; ++i) {
+            const DynamicDidElement& element = elements[i];
+            lookup.did = element.source;
+            lookup.found = false;
+            if (element.position == 0 || element.size == 0 || is_dynamic(element.source) ||
+                source.read_dids(&lookup, 1) == 0 ||
+                static_cast<size_t>(element.position - 1) + element.size > lookup.view.size()) {
+                return false;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const DynamicDidPlan* previous = plans_[did - FIRST_DID].load(std::memory_order_relaxed);
+    std::vector<DynamicDidElement> combined;
+    if (previous != nullptr) {
+        combined = previous->elements;
+    }
+    if (combined.size() + count > MAX_ELEMENTS) {
+        return false;
+    }
+    combined.insert(combined.end(), elements, elements + count);
+    publish(did, DynamicDidPlan::compile(combined));
+    return true;
+}
+
+void DynamicDidTable::clear(DID did) {
+    if (!is_dynamic(did)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    publish(did, nullptr);
+}
+
+void DynamicDidTable::clear_all() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    for (size_t i = 0; i < DID_COUNT; ++i) {
+        if (plans_[i].load(std::memory_order_relaxed) != nullptr) {
+            publish(static_cast<DID>(FIRST_DID + i), nullptr);
+        }
+    }
+}
+
+// 调用者需持有写锁
+void DynamicDidTable::publish(DID did, DynamicDidPlan* plan) {
+    DynamicDidPlan* previous = plans_[did - FIRST_DID].exchange(plan, std::memory_order_acq_rel);
+    if (previous == nullptr && plan != nullptr) {
+        defined_.fetch_add(1, std::memory_order_relaxed);
+    } else if (previous != nullptr && plan == nullptr) {
+        defined_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (previous != nullptr) {
+        // 旧计划可能仍被读者使用，等读者离开后再释放
+        EpochManager::instance().retire([previous]() { delete previous; });
+    }
+}
+
+size_t DynamicDidTable::resolve(const DidSource& source, DidLookup* lookups, size_t count) const {
+    if (defined_.load(std::memory_order_relaxed) == 0) {
+        return 0;
+    }
+
+    // 先取出所有计划并算出总长度，一次准备好缓冲区，拼接过程中视图指针不会失效
+    std::vector<const DynamicDidPlan*>& plans = t_plans;
+    if (plans.size() < count) {
+        plans.resize(count);
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        plans[i] = is_dynamic(lookups[i].did)
+                       ? plans_[lookups[i].did - FIRST_DID].load(std::memory_order_acquire)
+                       : nullptr;
+        if (plans[i] != nullptr) {
+            total += plans[i]->size;
+        }
+    }
+    if (total == 0) {
+        return 0;
+    }
+    std::vector<uint8_t>& values = t_values;
+    if (values.size() < total) {
+        values.resize(total);
+    }
+
+    size_t found = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (plans[i] == nullptr) {
+            continue;
+        }
+        uint8_t* dest = values.data() + offset;
+        offset += plans[i]->size;
+        if (!execute_plan(*plans[i], source, dest)) {
+            continue;
+        }
+        lookups[i].view.data_ = dest;
+        lookups[i].view.size_ = plans[i]->size;
+        if (!lookups[i].found) {
+            lookups[i].found = true;
+            ++found;
+        }
+    }
+    return found;
+}
+
+} // namespace uds
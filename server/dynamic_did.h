@@ -0,0 +1,86 @@
+#ifndef DYNAMIC_DID_H
+#define DYNAMIC_DID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include "uds_protocol.h"
+#include "did_store.h"
+#include "did_source.h"
+
+namespace uds {
+
+// 动态定义DID（0x2C）的一个组成部分：源DID中从position（从1开始）起的size个字节
+struct DynamicDidElement {
+    DID source;
+    uint8_t position;
+    uint8_t size;
+};
+
+// 一个动态DID编译后的复制计划
+// 定义时解析一次：每个源DID只读取一次，相邻且连续的片段合并为一步复制；
+// 读取时只需一次批量查找加若干次memcpy，不再解析定义
+struct DynamicDidPlan {
+    struct Step {
+        uint16_t source_index;    // 在sources中的下标
+        uint16_t offset;          // 源值中的起始偏移
+        uint16_t size;
+    };
+
+    std::vector<DynamicDidElement> elements;   // 原始定义，追加定义时据此重新编译
+    std::vector<DID> sources;                  // 去重后的源DID
+    std::vector<uint16_t> min_source_sizes;    // 各源值至少应有的长度
+    std::vector<Step> steps;
+    size_t size;                               // 拼出的值的长度
+
+    // 按定义编译复制计划
+    static DynamicDidPlan* compile(const std::vector<DynamicDidElement>& elements);
+};
+
+// 一个ECU的动态DID表（0xF200-0xF3FF）
+// 每个DID对应一个原子的计划指针，读取不加锁；重新定义或清除时发布新计划，
+// 旧计划由EpochManager延迟释放
+class DynamicDidTable {
+public:
+    static const DID FIRST_DID = 0xF200;
+    static const DID LAST_DID = 0xF3FF;
+    static const size_t MAX_ELEMENTS = 64;       // 一个动态DID最多由多少个片段组成
+
+    static bool is_dynamic(DID did) { return did >= FIRST_DID && did <= LAST_DID; }
+
+    DynamicDidTable();
+    ~DynamicDidTable();
+
+    // 追加定义（ISO 14229：对同一DID的多次定义依次拼接）；源DID必须存在且范围不越界，
+    // 源DID不能是动态DID。失败时返回false，nrc为应答的负响应码
+    bool define(DID did, const DynamicDidElement* elements, size_t count, const DidSource& source,
+                ResponseCode& nrc);
+
+    // 清除一个动态DID
+    void clear(DID did);
+
+    // 清除全部动态DID
+    void clear_all();
+
+    // 用复制计划拼出lookups中动态DID的值，替换数据源中的结果，返回新找到的个数
+    // 拼出的值存放在线程局部缓冲区中，在同一线程下次调用前有效；调用者需持有EpochManager::Guard
+    size_t resolve(const DidSource& source, DidLookup* lookups, size_t count) const;
+
+private:
+    DynamicDidTable(const DynamicDidTable&);
+    DynamicDidTable& operator=(const DynamicDidTable&);
+
+    static const size_t DID_COUNT = LAST_DID - FIRST_DID + 1;
+
+    void publish(DID did, DynamicDidPlan* plan);
+
+    std::atomic<DynamicDidPlan*> plans_[DID_COUNT];
+    std::atomic<size_t> defined_;    // 已定义的个数，为0时读取直接返回
+    std::mutex write_mutex_;         // 只在写者之间互斥
+};
+
+} // namespace uds
+
+#endif // DYNAMIC_DID_H
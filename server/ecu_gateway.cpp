@@ -0,0 +1,193 @@
+#include "ecu_gateway.h"
+#include "did_database.h"
+#include "did_overlay.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace uds {
+
+namespace {
+
+const size_t ADDRESS_COUNT = 65536;
+
+bool parse_hex_address(const std::string& text, uint16_t& address) {
+    std::string digits = text;
+    if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+        digits = digits.substr(2);
+    }
+    if (digits.empty() || digits.size() > 4) {
+        return false;
+    }
+    unsigned long value = 0;
+    for (size_t i = 0; i < digits.size(); ++i) {
+        char c = digits[i];
+        if (c >= '0' && c <= '9') {
+            value = value * 16 + static_cast<unsigned long>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value = value * 16 + static_cast<unsigned long>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            value = value * 16 + static_cast<unsigned long>(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    address = static_cast<uint16_t>(value);
+    return true;
+}
+
+std::string format_address(uint16_t address) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << address;
+    return oss.str();
+}
+
+bool is_absolute_path(const std::string& path) {
+    if (!path.empty() && (path[0] == '/' || path[0] == '\\')) {
+        return true;
+    }
+    return path.size() > 1 && path[1] == ':';
+}
+
+} // namespace
+
+struct EcuGateway::Ecu {
+    std::unique_ptr<DidSource> owned_source;  // 模板ECU自己的DID数据
+    UdsService service;
+
+    Ecu(std::unique_ptr<DidSource> owned, DidSource& source, const ServiceOptions& options)
+        : owned_source(std::move(owned)), service(source, options) {}
+};
+
+EcuGateway::EcuGateway(const ServiceOptions& options)
+    : options_(options), routes_(ADDRESS_COUNT, nullptr) {
+}
+
+EcuGateway::~EcuGateway() {
+}
+
+bool EcuGateway::add(uint16_t address, std::unique_ptr<DidSource> owned_source, DidSource& source,
+                     std::string& error) {
+    if (routes_[address] != nullptr) {
+        error = "target address " + format_address(address) + " is already in use";
+        return false;
+    }
+    std::unique_ptr<Ecu> ecu(new Ecu(std::move(owned_source), source, options_));
+    routes_[address] = ecu.get();
+    ecus_.push_back(std::move(ecu));
+    return true;
+}
+
+bool EcuGateway::add_ecu(uint16_t address, DidSource& source, std::string& error) {
+    return add(address, std::unique_ptr<DidSource>(), source, error);
+}
+
+bool EcuGateway::add_template_ecu(uint16_t address, const std::string& template_path, std::string& error) {
+    if (routes_[address] != nullptr) {
+        error = "target address " + format_address(address) + " is already in use";
+        return false;
+    }
+    std::shared_ptr<const DidStore> baseline = load_template(template_path, error);
+    if (!baseline) {
+        return false;
+    }
+    std::unique_ptr<DidSource> source(new LayeredDidSource(baseline));
+    DidSource& ref = *source;
+    return add(address, std::move(source), ref, error);
+}
+
+std::shared_ptr<const DidStore> EcuGateway::load_template(const std::string& path, std::string& error) {
+    auto it = templates_.find(path);
+    if (it != templates_.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<DidDatabase> database(new DidDatabase());
+    bool ok = DidDatabase::is_binary_file(path) ? database->map_file(path, error)
+                                                : database->load_json_file(path, error);
+    if (!ok) {
+        error = "failed to load template " + path + ": " + error;
+        return std::shared_ptr<const DidStore>();
+    }
+
+    std::shared_ptr<DidStore> store(new DidStore());
+    store->replace_all(database);
+    templates_[path] = store;
+    return store;
+}
+
+bool EcuGateway::load_config(const std::string& path, std::string& error) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        error = "cannot open ECU config " + path;
+        return false;
+    }
+
+    std::string base_dir;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        base_dir = path.substr(0, slash + 1);
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::istringstream iss(line);
+        std::string addresses;
+        std::string template_path;
+        if (!(iss >> addresses) || addresses[0] == '#') {
+            continue;
+        }
+        std::string extra;
+        if (!(iss >> template_path) || (iss >> extra && extra[0] != '#')) {
+            error = path + ":" + std::to_string(line_number) + ": expected '<address[-address]> <template file>'";
+            return false;
+        }
+
+        uint16_t first;
+        uint16_t last;
+        size_t dash = addresses.find('-');
+        bool ok = dash == std::string::npos
+            ? parse_hex_address(addresses, first) && parse_hex_address(addresses, last)
+            : parse_hex_address(addresses.substr(0, dash), first) &&
+              parse_hex_address(addresses.substr(dash + 1), last);
+        if (!ok || last < first) {
+            error = path + ":" + std::to_string(line_number) + ": invalid target address '" + addresses + "'";
+            return false;
+        }
+
+        if (!is_absolute_path(template_path)) {
+            template_path = base_dir + template_path;
+        }
+        for (uint32_t address = first; address <= last; ++address) {
+            if (!add_template_ecu(static_cast<uint16_t>(address), template_path, error)) {
+                error = path + ":" + std::to_string(line_number) + ": " + error;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool EcuGateway::process_request(uint16_t target_address, const uint8_t* request, size_t size,
+                                 std::vector<uint8_t>& out) {
+    Ecu* ecu = routes_[target_address];
+    if (ecu == nullptr) {
+        return false;
+    }
+    ecu->service.process_request(request, size, out);
+    return true;
+}
+
+bool EcuGateway::process_request(const RequestContext& context, const uint8_t* request, size_t size,
+                                 std::vector<uint8_t>& out) {
+    Ecu* ecu = routes_[context.ecu_address];
+    if (ecu == nullptr) {
+        return false;
+    }
+    ecu->service.process_request(context, request, size, out);
+    return true;
+}
+
+} // namespace uds
@@ -0,0 +1,65 @@
+#ifndef ECU_GATEWAY_H
+#define ECU_GATEWAY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <memory>
+#include "uds_protocol.h"
+#include "uds_service.h"
+#include "did_store.h"
+#include "did_source.h"
+
+namespace uds {
+
+// 虚拟网关：一个进程内承载多个按目标地址（如DoIP逻辑地址）区分的ECU
+// 目标地址直接索引65536项的路由表，每次请求的路由开销是常数；
+// 由同一模板创建的ECU共享只读的模板数据，各自的写入进入独立的稀疏覆盖层（写时复制）。
+// 模板ECU的写入只保存在内存中，不落盘。ECU须在开始服务前全部登记
+class EcuGateway {
+public:
+    explicit EcuGateway(const ServiceOptions& options = ServiceOptions());
+    ~EcuGateway();
+
+    // 在address上登记一个使用外部DID数据的ECU（如持久化的默认ECU），source须比网关存活更久
+    bool add_ecu(uint16_t address, DidSource& source, std::string& error);
+
+    // 在address上创建一个基于模板数据文件（JSON或二进制数据库）的ECU；同一文件只加载一次
+    bool add_template_ecu(uint16_t address, const std::string& template_path, std::string& error);
+
+    // 按配置文件批量创建模板ECU，每行一项：
+    //   <目标地址或地址范围（十六进制，如1001或2000-27FF）> <模板数据文件>
+    // 空行和#开头的行被忽略，相对路径相对于配置文件所在目录
+    bool load_config(const std::string& path, std::string& error);
+
+    // 把请求交给目标地址上的ECU处理，响应追加到out；地址上没有ECU时返回false且不写out
+    bool process_request(uint16_t target_address, const uint8_t* request, size_t size,
+                         std::vector<uint8_t>& out);
+
+    // 同上，按context.ecu_address路由，并把请求来源交给ECU（连接相关的服务需要）
+    bool process_request(const RequestContext& context, const uint8_t* request, size_t size,
+                         std::vector<uint8_t>& out);
+
+    size_t ecu_count() const { return ecus_.size(); }
+    size_t template_count() const { return templates_.size(); }
+
+private:
+    EcuGateway(const EcuGateway&);
+    EcuGateway& operator=(const EcuGateway&);
+
+    struct Ecu;
+
+    bool add(uint16_t address, std::unique_ptr<DidSource> owned_source, DidSource& source, std::string& error);
+    std::shared_ptr<const DidStore> load_template(const std::string& path, std::string& error);
+
+    ServiceOptions options_;
+    std::vector<Ecu*> routes_;                 // 按目标地址直接索引，65536项
+    std::vector<std::unique_ptr<Ecu>> ecus_;
+    std::map<std::string, std::shared_ptr<const DidStore>> templates_;
+};
+
+} // namespace uds
+
+#endif // ECU_GATEWAY_H
@@ -0,0 +1,153 @@
+#include "epoch.h"
+
+namespace uds {
+
+namespace {
+
+// 待回收对象积累到该数量后，retire()顺带执行一次回收
+const size_t RECLAIM_THRESHOLD = 64;
+
+} // namespace
+
+// 线程退出时归还本线程的记录，供后续线程复用
+struct ThreadRecordHolder {
+    EpochManager::ThreadRecord* record;
+
+    ThreadRecordHolder() : record(nullptr) {}
+
+    ~ThreadRecordHolder() {
+        if (record != nullptr) {
+            EpochManager::instance().release_record(record);
+        }
+    }
+};
+
+namespace {
+
+thread_local ThreadRecordHolder tls_record;
+
+} // namespace
+
+EpochManager::Guard::Guard() {
+    EpochManager::instance().enter();
+}
+
+EpochManager::Guard::~Guard() {
+    EpochManager::instance().exit();
+}
+
+EpochManager& EpochManager::instance() {
+    // 有意不析构，避免与线程局部记录的析构顺序冲突
+    static EpochManager* manager = new EpochManager();
+    return *manager;
+}
+
+EpochManager::EpochManager()
+    : global_epoch_(1), records_(nullptr) {
+}
+
+EpochManager::ThreadRecord* EpochManager::acquire_record() {
+    // 优先复用已退出线程留下的记录
+    for (ThreadRecord* record = records_.load(std::memory_order_acquire); record != nullptr;
+         record = record->next) {
+        bool expected = false;
+        if (!record->in_use.load(std::memory_order_relaxed) &&
+            record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            record->depth = 0;
+            return record;
+        }
+    }
+
+    // 没有空闲记录时新建并挂到链表头部，记录永不释放
+    ThreadRecord* record = new ThreadRecord();
+    record->epoch.store(0, std::memory_order_relaxed);
+    record->in_use.store(true, std::memory_order_relaxed);
+    record->depth = 0;
+    ThreadRecord* head = records_.load(std::memory_order_relaxed);
+    do {
+        record->next = head;
+    } while (!records_.compare_exchange_weak(head, record, std::memory_order_release,
+                                              std::memory_order_relaxed));
+    return record;
+}
+
+void EpochManager::release_record(ThreadRecord* record) {
+    record->epoch.store(0, std::memory_order_release);
+    record->in_use.store(false, std::memory_order_release);
+}
+
+EpochManager::ThreadRecord* EpochManager::current_record() {
+    if (tls_record.record == nullptr) {
+        tls_record.record = acquire_record();
+    }
+    return tls_record.record;
+}
+
+void EpochManager::enter() {
+    ThreadRecord* record = current_record();
+    if (record->depth++ == 0) {
+        // seq_cst保证此后对共享指针的读取不会被重排到登记纪元之前
+        record->epoch.store(global_epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+void EpochManager::exit() {
+    ThreadRecord* record = tls_record.record;
+    if (--record->depth == 0) {
+        record->epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochManager::retire(const std::function<void()>& deleter) {
+    Retired retired;
+    // 旧对象已不可达；纪元推进后进入的读者不可能再看到它
+    retired.epoch = global_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    retired.deleter = deleter;
+
+    std::lock_guard<std::mutex> lock(retire_mutex_);
+    retired_.push_back(retired);
+    if (retired_.size() >= RECLAIM_THRESHOLD) {
+        reclaim_locked();
+    }
+}
+
+void EpochManager::reclaim() {
+    std::lock_guard<std::mutex> lock(retire_mutex_);
+    reclaim_locked();
+}
+
+size_t EpochManager::pending() const {
+    std::lock_guard<std::mutex> lock(retire_mutex_);
+    return retired_.size();
+}
+
+uint64_t EpochManager::min_active_epoch() const {
+    uint64_t min_epoch = UINT64_MAX;
+    for (ThreadRecord* record = records_.load(std::memory_order_acquire); record != nullptr;
+         record = record->next) {
+        uint64_t epoch = record->epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0 && epoch < min_epoch) {
+            min_epoch = epoch;
+        }
+    }
+    return min_epoch;
+}
+
+void EpochManager::reclaim_locked() {
+    uint64_t min_epoch = min_active_epoch();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_.size(); ++i) {
+        if (retired_[i].epoch < min_epoch) {
+            retired_[i].deleter();
+        } else {
+            if (kept != i) {
+                retired_[kept] = std::move(retired_[i]);
+            }
+            ++kept;
+        }
+    }
+    retired_.resize(kept);
+}
+
+} // namespace uds
@@ -0,0 +1,77 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "cache_aligned.h"
+
+namespace uds {
+
+// 基于纪元（epoch）的内存回收，进程内全局唯一
+// 读者进入临界区时只写本线程的记录，不加锁也不等待写者；
+// 写者发布新版本后把旧版本交给retire()，等所有可能看到旧版本的读者离开后再释放
+class EpochManager {
+public:
+    // 读临界区守卫：存活期间通过原子指针读到的对象不会被释放，可嵌套
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+    };
+
+    static EpochManager& instance();
+
+    // 登记待释放的对象，deleter在安全时被调用
+    void retire(const std::function<void()>& deleter);
+
+    // 立即尝试回收所有已安全的对象
+    void reclaim();
+
+    // 当前等待回收的对象数量
+    size_t pending() const;
+
+private:
+    // 每个线程一条记录，按缓存行对齐避免伪共享（堆上分配同样对齐）
+    struct alignas(64) ThreadRecord : CacheAligned {
+        std::atomic<uint64_t> epoch;  // 0表示不在读临界区
+        std::atomic<bool> in_use;
+        ThreadRecord* next;
+        size_t depth;  // 仅所属线程访问，支持嵌套Guard
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    EpochManager();
+    EpochManager(const EpochManager&);
+    EpochManager& operator=(const EpochManager&);
+
+    ThreadRecord* acquire_record();
+    void release_record(ThreadRecord* record);
+    ThreadRecord* current_record();
+    void enter();
+    void exit();
+    uint64_t min_active_epoch() const;
+    void reclaim_locked();
+
+    std::atomic<uint64_t> global_epoch_;
+    std::atomic<ThreadRecord*> records_;
+    mutable std::mutex retire_mutex_;
+    std::vector<Retired> retired_;
+
+    friend class Guard;
+    friend struct ThreadRecordHolder;
+};
+
+} // namespace uds
+
+#endif // EPOCH_H
@@ -0,0 +1,552 @@
+#include "epoll_reactor.h"
+#include "push_channel.h"
+#include "cpu_affinity.h"
+#include "metrics.h"
+#include "logger.h"
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+#endif
+
+namespace uds {
+
+#ifdef __linux__
+
+namespace {
+
+const int MAX_EVENTS = 64;
+const int BUFFER_SIZE = 16384;
+// 每次监听socket就绪时最多接受的连接数，避免单个循环抢占全部新连接
+const int MAX_ACCEPTS_PER_WAKEUP = 16;
+// 可丢弃的推送数据：通道内排队或连接未发出的数据超过该值时丢弃新数据，避免不读数据的对端占用无限内存；
+// 不能丢弃的推送数据另算一份同样的上限，超过时关闭连接
+const size_t MAX_PENDING_PUSH_BYTES = 256 * 1024;
+
+bool set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+} // namespace
+
+// 连接的推送通道：其他线程推送的数据先在通道内排队，再唤醒事件循环，由事件循环线程追加到连接的输出缓冲区
+// 可丢弃与不能丢弃的数据分开排队，各自计算上限；两者都是整条报文，分开追加不会把报文拆开
+class EpollReactor::Channel : public PushChannel {
+public:
+    Channel(FramingMode framing, Loop& loop, Connection& connection)
+        : PushChannel(framing), loop_(loop), connection_(&connection), closed_(false), overflowed_(false),
+          ready_(false) {
+    }
+
+    bool push(const uint8_t* data, size_t size, PushPolicy policy) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || overflowed_) {
+            return false;
+        }
+        std::vector<uint8_t>& queue = policy == PushPolicy::RELIABLE ? reliable_ : lossy_;
+        if (queue.size() + size > MAX_PENDING_PUSH_BYTES) {
+            if (policy == PushPolicy::LOSSY) {
+                Metrics::instance().record_push_dropped();
+                return true;
+            }
+            // 不能丢弃的数据排不下：由事件循环关闭连接，之后的推送都返回false
+            overflowed_ = true;
+            Metrics::instance().record_push_overflow_disconnect();
+        } else {
+            queue.insert(queue.end(), data, data + size);
+        }
+        if (!ready_) {
+            ready_ = true;
+            {
+                std::lock_guard<std::mutex> ready_lock(loop_.push_mutex);
+                loop_.push_ready.push_back(std::static_pointer_cast<Channel>(shared_from_this()));
+            }
+            uint64_t one = 1;
+            ssize_t ignored = write(loop_.wakeup_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+        return !overflowed_;
+    }
+
+    // 事件循环线程调用：把排队的数据追加到连接的输出缓冲区，连接已关闭时返回nullptr
+    // 连接积压过多时丢弃可丢弃的数据；不能丢弃的数据总是追加，排不下过的连接发完已排队的数据后关闭
+    Connection* drain() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_ = false;
+        if (closed_) {
+            return nullptr;
+        }
+        std::vector<uint8_t>& out = connection_->pending_output;
+        if (!connection_->close_after_flush) {
+            out.insert(out.end(), reliable_.begin(), reliable_.end());
+            if (!lossy_.empty()) {
+                if (out.size() - connection_->pending_offset <= MAX_PENDING_PUSH_BYTES) {
+                    out.insert(out.end(), lossy_.begin(), lossy_.end());
+                } else {
+                    Metrics::instance().record_push_dropped();
+                }
+            }
+            if (overflowed_) {
+                UDS_LOG_WARN("Push queue overflow, closing client: %s", connection_->client_ip.c_str());
+                connection_->close_after_flush = true;
+            }
+        }
+        reliable_.clear();
+        lossy_.clear();
+        return connection_;
+    }
+
+    // 事件循环线程在关闭连接前调用，之后的推送返回false
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        reliable_.clear();
+        lossy_.clear();
+    }
+
+private:
+    Loop& loop_;
+    Connection* connection_;      // 只在事件循环线程中、未关闭时访问
+    std::mutex mutex_;
+    std::vector<uint8_t> reliable_;  // 不能丢弃的推送数据
+    std::vector<uint8_t> lossy_;     // 可丢弃的推送数据
+    bool closed_;
+    bool overflowed_;             // 不能丢弃的数据排不下，连接等待关闭
+    bool ready_;                  // 已登记在loop_.push_ready中
+};
+
+EpollReactor::EpollReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler)
+    : options_(options),
+      framing_(framing),
+      handler_(handler),
+      is_running_(false) {
+    if (options_.loops == 0) {
+        options_.loops = 1;
+    }
+}
+
+EpollReactor::~EpollReactor() {
+    stop();
+}
+
+bool EpollReactor::is_supported() {
+    return true;
+}
+
+bool EpollReactor::start(const std::vector<int>& listen_sockets) {
+    if (listen_sockets.size() != 1 && listen_sockets.size() != options_.loops) {
+        UDS_LOG_ERROR("%zu listen sockets for %zu event loops", listen_sockets.size(), options_.loops);
+        return false;
+    }
+    for (size_t i = 0; i < listen_sockets.size(); ++i) {
+        if (!set_non_blocking(listen_sockets[i])) {
+            UDS_LOG_ERROR("Failed to set listen socket non-blocking");
+            return false;
+        }
+    }
+    bool shared = listen_sockets.size() == 1;
+
+    for (size_t i = 0; i < options_.loops; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+        loop->index = i;
+        loop->listen_fd = listen_sockets[shared ? 0 : i];
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd < 0 || loop->wakeup_fd < 0) {
+            UDS_LOG_ERROR("Failed to create epoll instance");
+            if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+            if (loop->wakeup_fd >= 0) close(loop->wakeup_fd);
+            stop();
+            return false;
+        }
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wakeup_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wakeup_fd, &ev);
+
+        // 所有循环共享同一个监听socket时，EPOLLEXCLUSIVE避免惊群
+        ev.events = EPOLLIN | (shared ? static_cast<uint32_t>(EPOLLEXCLUSIVE) : 0u);
+        ev.data.fd = loop->listen_fd;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, &ev) < 0) {
+            UDS_LOG_ERROR("Failed to register listen socket with epoll");
+            close(loop->epoll_fd);
+            close(loop->wakeup_fd);
+            stop();
+            return false;
+        }
+
+        loops_.push_back(std::move(loop));
+    }
+
+    is_running_ = true;
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        Loop* loop = loops_[i].get();
+        loop->thread = std::thread(&EpollReactor::run_loop, this, std::ref(*loop));
+    }
+
+    UDS_LOG_INFO("Epoll reactor started with %zu event loop(s), %s listen socket%s", loops_.size(),
+                 shared ? "shared" : "per-loop SO_REUSEPORT", options_.pin_cpus ? ", pinned to CPUs" : "");
+    return true;
+}
+
+void EpollReactor::stop() {
+    is_running_ = false;
+
+    // 唤醒并等待所有事件循环退出
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loops_[i]->wakeup_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        Loop& loop = *loops_[i];
+        if (loop.thread.joinable()) {
+            loop.thread.join();
+        }
+        for (auto& entry : loop.connections) {
+            entry.second->channel->close();
+            close(entry.first);
+            Metrics::instance().connection_closed();
+        }
+        loop.connections.clear();
+        loop.push_ready.clear();
+        close(loop.epoll_fd);
+        close(loop.wakeup_fd);
+    }
+    loops_.clear();
+}
+
+void EpollReactor::run_loop(Loop& loop) {
+    epoll_event events[MAX_EVENTS];
+    if (options_.pin_cpus && !pin_current_thread(loop.index)) {
+        UDS_LOG_WARN("Failed to pin event loop %zu to a CPU", loop.index);
+    }
+
+    while (is_running_) {
+        int count = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            UDS_LOG_ERROR("epoll_wait failed: %s", std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == loop.wakeup_fd) {
+                uint64_t value;
+                ssize_t ignored = read(loop.wakeup_fd, &value, sizeof(value));
+                (void)ignored;
+                drain_pushes(loop);
+                continue;
+            }
+
+            if (fd == loop.listen_fd) {
+                accept_clients(loop);
+                continue;
+            }
+
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) {
+                continue;
+            }
+            Connection& conn = *it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                UDS_LOG_INFO("Client disconnected: %s", conn.client_ip.c_str());
+                close_connection(loop, fd);
+                continue;
+            }
+
+            if (events[i].events & EPOLLOUT) {
+                if (!serve_requests(loop, conn)) {
+                    if (!conn.close_after_flush) {
+                        UDS_LOG_WARN("Send failed to client: %s", conn.client_ip.c_str());
+                    }
+                    close_connection(loop, fd);
+                    continue;
+                }
+            }
+
+            if ((events[i].events & EPOLLIN) && !conn.close_after_flush) {
+                handle_readable(loop, conn);
+            }
+        }
+    }
+}
+
+void EpollReactor::accept_clients(Loop& loop) {
+    for (int i = 0; i < MAX_ACCEPTS_PER_WAKEUP; ++i) {
+        sockaddr_in client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+
+        int client_socket = accept4(loop.listen_fd,
+                                    reinterpret_cast<struct sockaddr*>(&client_addr),
+                                    &client_addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && is_running_) {
+                UDS_LOG_ERROR("Accept failed: %s", std::strerror(errno));
+            }
+            return;
+        }
+
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
+        UDS_LOG_INFO("New client connected: %s", client_ip);
+
+        // 关闭Nagle：带MSG_MORE的响应头与sendfile片段合并后，最后不满一段的数据不等延迟ACK
+        int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        std::unique_ptr<Connection> conn(new Connection(framing_));
+        conn->fd = client_socket;
+        conn->client_ip = client_ip;
+        conn->channel = std::make_shared<Channel>(framing_, loop, *conn);
+        conn->decoder.set_push_channel(conn->channel.get());
+        conn->decoder.set_file_slices(&conn->pending_files);
+        conn->events = EPOLLIN | EPOLLRDHUP;
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = conn->events;
+        ev.data.fd = client_socket;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            UDS_LOG_ERROR("Failed to register client socket with epoll");
+            close(client_socket);
+            continue;
+        }
+
+        loop.connections[client_socket] = std::move(conn);
+        Metrics::instance().connection_opened();
+    }
+}
+
+void EpollReactor::handle_readable(Loop& loop, Connection& conn) {
+    // 直接接收到连接的重组缓冲区中，不经过中转；大报文未收全时按剩余长度一次接收
+    size_t size = std::max<size_t>(BUFFER_SIZE, conn.decoder.missing());
+    uint8_t* buffer = conn.decoder.prepare(size);
+    ssize_t bytes_received = recv(conn.fd, buffer, size, 0);
+
+    if (bytes_received <= 0) {
+        if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        if (bytes_received == 0) {
+            UDS_LOG_INFO("Client disconnected: %s", conn.client_ip.c_str());
+        } else {
+            UDS_LOG_WARN("Receive failed from client: %s", conn.client_ip.c_str());
+        }
+        close_connection(loop, conn.fd);
+        return;
+    }
+
+    conn.decoder.commit(static_cast<size_t>(bytes_received));
+    Metrics::instance().add_bytes_received(static_cast<size_t>(bytes_received));
+    if (!serve_requests(loop, conn)) {
+        if (!conn.close_after_flush) {
+            UDS_LOG_WARN("Send failed to client: %s", conn.client_ip.c_str());
+        }
+        close_connection(loop, conn.fd);
+    }
+}
+
+// 把其他线程推送的数据追加到各连接的输出缓冲区并发送
+void EpollReactor::drain_pushes(Loop& loop) {
+    {
+        std::lock_guard<std::mutex> lock(loop.push_mutex);
+        loop.push_draining.swap(loop.push_ready);
+    }
+    for (size_t i = 0; i < loop.push_draining.size(); ++i) {
+        Connection* conn = loop.push_draining[i]->drain();
+        if (conn != nullptr && !serve_requests(loop, *conn)) {
+            if (!conn->close_after_flush) {
+                UDS_LOG_WARN("Send failed to client: %s", conn->client_ip.c_str());
+            }
+            close_connection(loop, conn->fd);
+        }
+    }
+    loop.push_draining.clear();
+}
+
+// 重组请求，缓冲区中的完整请求按顺序处理，响应合并发送
+// 只解码到待发数据达到output_limit为止，剩余的请求留在解码器中：暂停读取期间不处理，
+// 发出一半恢复读取（或全部发出）后先处理它们，一次接收中的大量请求不会在输出缓冲区中一次积压
+bool EpollReactor::serve_requests(Loop& loop, Connection& conn) {
+    while (true) {
+        if (!conn.read_paused && !conn.close_after_flush) {
+            size_t unsent = unsent_bytes(conn);
+            size_t budget = unsent < options_.output_limit ? options_.output_limit - unsent : 0;
+            if (!process_frames(conn.decoder, handler_, conn.pending_output, budget)) {
+                conn.close_after_flush = true;
+                Metrics::instance().record_invalid_frame();
+            }
+            conn.frames_held = !conn.close_after_flush && unsent_bytes(conn) - unsent >= budget;
+        }
+        bool was_paused = conn.read_paused;
+        if (!flush_output(loop, conn)) {
+            return false;
+        }
+        // 没有留下的请求、仍在暂停，或本轮的响应还没发完（等可写后再处理）时结束
+        if (!conn.frames_held || conn.read_paused || (!was_paused && unsent_bytes(conn) > 0)) {
+            return true;
+        }
+    }
+}
+
+// 尽可能发送待发数据；发不完时注册EPOLLOUT等待可写
+// 输出缓冲区发到下一个文件片段的位置时改用sendfile发出片段，再继续发送缓冲区
+bool EpollReactor::flush_output(Loop& loop, Connection& conn) {
+    while (conn.pending_offset < conn.pending_output.size() || conn.file_index < conn.pending_files.size()) {
+        ssize_t bytes_sent;
+        bool file = conn.file_index < conn.pending_files.size() &&
+                    conn.pending_files[conn.file_index].position == conn.pending_offset;
+        if (file) {
+            bytes_sent = send_file_slice(conn.fd, conn.pending_files[conn.file_index], conn.file_sent);
+        } else {
+            // 后面紧跟文件片段时带MSG_MORE：片段前的响应头与片段数据合并成满长度的TCP段发出
+            bool before_file = conn.file_index < conn.pending_files.size();
+            size_t end = before_file ? conn.pending_files[conn.file_index].position : conn.pending_output.size();
+            bytes_sent = send(conn.fd, conn.pending_output.data() + conn.pending_offset, end - conn.pending_offset,
+                              before_file ? MSG_NOSIGNAL | MSG_MORE : MSG_NOSIGNAL);
+        }
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 对端读得比请求产生响应慢：积压到上限时暂停读取，读走一半后恢复
+                // 解码器中留有请求时同样暂停，不再继续读入新的请求
+                compact_output(conn);
+                size_t unsent = unsent_bytes(conn);
+                bool paused = conn.read_paused ? unsent > options_.output_limit / 2
+                                               : unsent >= options_.output_limit || conn.frames_held;
+                if (paused && !conn.read_paused) {
+                    UDS_LOG_DEBUG("Pausing reads from slow client %s (%zu bytes unsent)", conn.client_ip.c_str(),
+                                  unsent);
+                    Metrics::instance().record_read_pause();
+                }
+                conn.read_paused = paused;
+                update_interest(loop, conn, true);
+                return true;
+            }
+            return false;
+        }
+        if (file) {
+            if (bytes_sent == 0) {
+                // 文件在发送期间被截短，连接上的报文已无法对齐
+                return false;
+            }
+            conn.file_sent += static_cast<size_t>(bytes_sent);
+            if (conn.file_sent == conn.pending_files[conn.file_index].size) {
+                ++conn.file_index;
+                conn.file_sent = 0;
+            }
+        } else {
+            conn.pending_offset += static_cast<size_t>(bytes_sent);
+        }
+        Metrics::instance().add_bytes_sent(static_cast<size_t>(bytes_sent));
+    }
+
+    conn.pending_output.clear();
+    conn.pending_offset = 0;
+    conn.pending_files.clear();
+    conn.file_index = 0;
+    if (conn.close_after_flush) {
+        return false;
+    }
+    conn.read_paused = false;
+    update_interest(loop, conn, false);
+    return true;
+}
+
+// 尚未发出的字节数，包括未发完的文件片段
+size_t EpollReactor::unsent_bytes(const Connection& conn) const {
+    size_t unsent = conn.pending_output.size() - conn.pending_offset - conn.file_sent;
+    for (size_t i = conn.file_index; i < conn.pending_files.size(); ++i) {
+        unsent += conn.pending_files[i].size;
+    }
+    return unsent;
+}
+
+// 已发出的部分超过缓冲区一半时移出缓冲区，对端持续慢读时缓冲区不会无限增长；未发完的文件片段位置随之前移
+void EpollReactor::compact_output(Connection& conn) {
+    if (conn.pending_offset == 0 || conn.pending_offset < conn.pending_output.size() / 2) {
+        return;
+    }
+    conn.pending_output.erase(conn.pending_output.begin(), conn.pending_output.begin() + conn.pending_offset);
+    conn.pending_files.erase(conn.pending_files.begin(), conn.pending_files.begin() + conn.file_index);
+    for (size_t i = 0; i < conn.pending_files.size(); ++i) {
+        conn.pending_files[i].position -= conn.pending_offset;
+    }
+    conn.pending_offset = 0;
+    conn.file_index = 0;
+}
+
+// 暂停读取时不登记EPOLLIN/EPOLLRDHUP，内核接收缓冲区写满后由TCP流控让对端停止发送
+void EpollReactor::update_interest(Loop& loop, Connection& conn, bool want_write) {
+    uint32_t events = (conn.read_paused ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+                      (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    if (conn.events == events) {
+        return;
+    }
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = conn.fd;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.events = events;
+}
+
+void EpollReactor::close_connection(Loop& loop, int fd) {
+    auto it = loop.connections.find(fd);
+    if (it != loop.connections.end()) {
+        it->second->channel->close();
+    }
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    loop.connections.erase(fd);
+    Metrics::instance().connection_closed();
+}
+
+#else // !__linux__
+
+EpollReactor::EpollReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler)
+    : options_(options), framing_(framing), handler_(handler), is_running_(false) {
+}
+
+EpollReactor::~EpollReactor() {
+}
+
+bool EpollReactor::is_supported() {
+    return false;
+}
+
+bool EpollReactor::start(const std::vector<int>&) {
+    UDS_LOG_ERROR("Epoll reactor is only available on Linux");
+    return false;
+}
+
+void EpollReactor::stop() {
+}
+
+#endif // __linux__
+
+} // namespace uds
@@ -0,0 +1,95 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "frame_codec.h"
+#include "reactor_options.h"
+
+namespace uds {
+
+// 基于epoll的事件驱动服务核心（仅Linux）
+// 固定数量的事件循环线程共同服务所有连接，替代每客户端一个线程的模型
+// 各循环可以共享一个监听socket，也可以各自使用一个SO_REUSEPORT监听socket，由内核把新连接分给各循环
+// 连接待发的数据超过options.output_limit时暂停读取该连接，对端读走一半后恢复；
+// 一次接收中的请求也只解码到待发数据达到上限为止，其余的留在解码器中，恢复后先处理它们再读取
+class EpollReactor {
+public:
+    EpollReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler);
+    ~EpollReactor();
+
+    // 当前平台是否支持epoll
+    static bool is_supported();
+
+    // 在已处于监听状态的socket上启动所有事件循环
+    // listen_sockets只有一个时所有循环共享，否则须与循环数相同，第i个循环只接受第i个socket上的连接
+    bool start(const std::vector<int>& listen_sockets);
+
+    // 停止所有事件循环并关闭全部客户端连接
+    void stop();
+
+private:
+    class Channel;
+
+    // 单个客户端连接的状态
+    struct Connection {
+        int fd;
+        std::string client_ip;
+        FrameDecoder decoder;                 // 请求重组缓冲区
+        std::vector<uint8_t> pending_output;  // 待发送的响应数据，发完后清空但保留容量供下次复用
+        size_t pending_offset;
+        std::vector<FileSlice> pending_files; // 响应中按位置插入pending_output的文件片段，用sendfile发送
+        size_t file_index;                    // 下一个未发完的文件片段
+        size_t file_sent;                     // 该片段已发出的字节数
+        uint32_t events;         // 当前在epoll中登记的事件
+        bool read_paused;        // 待发数据过多，暂停读取请求
+        bool frames_held;        // 待发数据达到上限时停止了解码，解码器中可能还留有完整的请求
+        bool close_after_flush;  // 发送完剩余数据后关闭连接
+        std::shared_ptr<Channel> channel;     // 推送通道，其他线程推送的数据经它交给事件循环发送
+
+        explicit Connection(FramingMode framing)
+            : fd(-1), decoder(framing), pending_offset(0), file_index(0), file_sent(0), events(0),
+              read_paused(false), frames_held(false), close_after_flush(false) {
+        }
+    };
+
+    // 单个事件循环：一个epoll实例 + 一个线程
+    struct Loop {
+        size_t index;
+        int epoll_fd;
+        int listen_fd;
+        int wakeup_fd;  // eventfd，用于通知循环退出或有推送数据待发送
+        std::thread thread;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::mutex push_mutex;
+        std::vector<std::shared_ptr<Channel>> push_ready;     // 有推送数据待发送的通道
+        std::vector<std::shared_ptr<Channel>> push_draining;  // 仅事件循环线程使用
+    };
+
+    void run_loop(Loop& loop);
+    void accept_clients(Loop& loop);
+    void handle_readable(Loop& loop, Connection& conn);
+    void drain_pushes(Loop& loop);
+    bool serve_requests(Loop& loop, Connection& conn);
+    bool flush_output(Loop& loop, Connection& conn);
+    size_t unsent_bytes(const Connection& conn) const;
+    void compact_output(Connection& conn);
+    void update_interest(Loop& loop, Connection& conn, bool want_write);
+    void close_connection(Loop& loop, int fd);
+
+    ReactorOptions options_;
+    FramingMode framing_;
+    RequestHandler handler_;
+    std::atomic<bool> is_running_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+} // namespace uds
+
+#endif // EPOLL_REACTOR_H
@@ -0,0 +1,83 @@
+#include "file_slice.h"
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+#ifdef __linux__
+    #include <sys/sendfile.h>
+#endif
+
+namespace uds {
+
+SharedFile::~SharedFile() {
+#ifdef _WIN32
+    _close(fd_);
+#else
+    close(fd_);
+#endif
+}
+
+size_t file_slice_bytes(const std::vector<FileSlice>& slices, size_t first) {
+    size_t total = 0;
+    for (size_t i = first; i < slices.size(); ++i) {
+        total += slices[i].size;
+    }
+    return total;
+}
+
+long send_file_slice(int socket_fd, const FileSlice& slice, size_t sent) {
+#if defined(__linux__)
+    off_t offset = static_cast<off_t>(slice.offset + sent);
+    ssize_t bytes_sent = sendfile(socket_fd, slice.file->fd(), &offset, slice.size - sent);
+    return static_cast<long>(bytes_sent);
+#elif defined(_WIN32)
+    // Windows下不产生文件片段（块传输不可用）
+    (void)socket_fd;
+    (void)slice;
+    (void)sent;
+    return -1;
+#else
+    uint8_t buffer[16384];
+    size_t chunk = slice.size - sent < sizeof(buffer) ? slice.size - sent : sizeof(buffer);
+    ssize_t bytes_read = pread(slice.file->fd(), buffer, chunk, static_cast<off_t>(slice.offset + sent));
+    if (bytes_read <= 0) {
+        if (bytes_read == 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+    return static_cast<long>(send(socket_fd, buffer, static_cast<size_t>(bytes_read), 0));
+#endif
+}
+
+bool read_file_slice(const FileSlice& slice, std::vector<uint8_t>& out) {
+#ifdef _WIN32
+    (void)slice;
+    (void)out;
+    return false;
+#else
+    size_t start = out.size();
+    out.resize(start + slice.size);
+    size_t done = 0;
+    while (done < slice.size) {
+        ssize_t bytes_read = pread(slice.file->fd(), out.data() + start + done, slice.size - done,
+                                   static_cast<off_t>(slice.offset + done));
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            out.resize(start);
+            return false;
+        }
+        done += static_cast<size_t>(bytes_read);
+    }
+    return true;
+#endif
+}
+
+} // namespace uds
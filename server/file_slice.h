@@ -0,0 +1,48 @@
+#ifndef FILE_SLICE_H
+#define FILE_SLICE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace uds {
+
+// 打开的文件描述符，最后一个引用释放时关闭；文件片段经它引用文件，
+// 发送前传输结束或文件被替换也不影响已排队的片段
+class SharedFile {
+public:
+    explicit SharedFile(int fd) : fd_(fd) {}
+    ~SharedFile();
+
+    int fd() const { return fd_; }
+
+private:
+    SharedFile(const SharedFile&);
+    SharedFile& operator=(const SharedFile&);
+
+    int fd_;
+};
+
+// 响应中直接从文件发送的一段数据：逻辑上插在输出缓冲区的position处，
+// 传输层发到该位置时改用sendfile从文件发出，数据不经过用户态缓冲区
+struct FileSlice {
+    size_t position;                    // 在输出缓冲区中的插入位置
+    std::shared_ptr<SharedFile> file;
+    uint64_t offset;                    // 文件中的起始偏移
+    size_t size;
+};
+
+// 一组文件片段的总字节数，从first开始计
+size_t file_slice_bytes(const std::vector<FileSlice>& slices, size_t first = 0);
+
+// 把片段中从sent开始的数据发到socket，返回发出的字节数；出错返回-1（errno说明原因，
+// 非阻塞socket发不出时为EAGAIN）。Linux下使用sendfile，其他平台读到栈上缓冲区再发送
+long send_file_slice(int socket_fd, const FileSlice& slice, size_t sent);
+
+// 读出片段的数据追加到out（不支持零拷贝发送的传输层使用）；读取失败返回false
+bool read_file_slice(const FileSlice& slice, std::vector<uint8_t>& out);
+
+} // namespace uds
+
+#endif // FILE_SLICE_H
@@ -0,0 +1,326 @@
+#include "frame_capture.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace uds {
+
+const uint8_t TraceRecord::FLAG_UNROUTED;
+const size_t FrameCapture::FILE_HEADER_SIZE;
+const size_t FrameCapture::RECORD_HEADER_SIZE;
+const size_t FrameCapture::RING_CAPACITY;
+const int FrameCapture::FLUSH_INTERVAL_MS;
+
+namespace {
+
+const char TRACE_MAGIC[8] = {'U', 'D', 'S', 'T', 'R', 'C', '0', '1'};
+const size_t MAX_PAYLOAD_SIZE = 16 * 1024 * 1024;
+
+uint16_t read_u16_le(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read_u32_le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t read_u64_le(const uint8_t* p) {
+    return static_cast<uint64_t>(read_u32_le(p)) | (static_cast<uint64_t>(read_u32_le(p + 4)) << 32);
+}
+
+void write_u16_le(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value & 0xFF);
+    p[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+void write_u32_le(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value & 0xFF);
+    p[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    p[2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    p[3] = static_cast<uint8_t>((value >> 24) & 0xFF);
+}
+
+void write_u64_le(uint8_t* p, uint64_t value) {
+    write_u32_le(p, static_cast<uint32_t>(value));
+    write_u32_le(p + 4, static_cast<uint32_t>(value >> 32));
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+} // namespace
+
+bool load_trace(const std::string& path, Trace& trace, std::string& error) {
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(path.c_str(), "rb"));
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    uint8_t header[FrameCapture::FILE_HEADER_SIZE];
+    if (std::fread(header, 1, sizeof(header), file.get()) != sizeof(header) ||
+        std::memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        error = path + " is not a capture file";
+        return false;
+    }
+    trace.start_time_ns = read_u64_le(header + 8);
+    if (header[16] > static_cast<uint8_t>(FramingMode::DOIP)) {
+        error = "unknown framing mode in " + path;
+        return false;
+    }
+    trace.framing = static_cast<FramingMode>(header[16]);
+    trace.records.clear();
+
+    // 抓包进程被强行结束时最后一条记录可能不完整，丢弃即可
+    uint8_t record_header[FrameCapture::RECORD_HEADER_SIZE];
+    while (std::fread(record_header, 1, sizeof(record_header), file.get()) == sizeof(record_header)) {
+        TraceRecord record;
+        record.timestamp_ns = read_u64_le(record_header);
+        record.connection_id = read_u32_le(record_header + 8);
+        record.source_address = read_u16_le(record_header + 12);
+        record.target_address = read_u16_le(record_header + 14);
+        record.direction = record_header[16];
+        record.flags = record_header[17];
+        size_t length = read_u32_le(record_header + 20);
+        if (length > MAX_PAYLOAD_SIZE || record.direction > TraceRecord::PUSH) {
+            error = "corrupt record in " + path;
+            return false;
+        }
+        record.payload.resize(length);
+        if (length > 0 && std::fread(record.payload.data(), 1, length, file.get()) != length) {
+            break;
+        }
+        trace.records.push_back(std::move(record));
+    }
+    return true;
+}
+
+// 线程退出时归还本线程的缓冲区，未写出的记录仍由写文件线程写出
+struct CaptureRingHolder {
+    FrameCapture::Ring* ring;
+
+    CaptureRingHolder() : ring(nullptr) {}
+
+    ~CaptureRingHolder() {
+        if (ring != nullptr) {
+            FrameCapture::instance().release_ring(ring);
+        }
+    }
+};
+
+namespace {
+
+thread_local CaptureRingHolder tls_ring;
+
+} // namespace
+
+FrameCapture::Ring::Ring() : next(nullptr), data(RING_CAPACITY) {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    in_use.store(false, std::memory_order_relaxed);
+}
+
+FrameCapture& FrameCapture::instance() {
+    // 有意不析构，避免与线程局部缓冲区的析构顺序冲突
+    static FrameCapture* capture = new FrameCapture();
+    return *capture;
+}
+
+FrameCapture::FrameCapture()
+    : active_(false), rings_(nullptr), file_(nullptr), write_failed_(false), stopping_(false) {
+}
+
+bool FrameCapture::start(const std::string& path, FramingMode framing, std::string& error) {
+    if (active()) {
+        error = "capture already running";
+        return false;
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        error = "cannot create " + path;
+        return false;
+    }
+
+    uint8_t header[FILE_HEADER_SIZE];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    write_u64_le(header + 8, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    header[16] = static_cast<uint8_t>(framing);
+    if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+        std::fclose(file_);
+        file_ = nullptr;
+        error = "cannot write " + path;
+        return false;
+    }
+
+    start_time_ = std::chrono::steady_clock::now();
+    write_failed_ = false;
+    stopping_ = false;
+    write_thread_ = std::thread(&FrameCapture::write_loop, this);
+    active_.store(true, std::memory_order_release);
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (!active_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        stopping_ = true;
+        write_cv_.notify_all();
+    }
+    if (write_thread_.joinable()) {
+        write_thread_.join();
+    }
+    drain();
+
+    if (std::fclose(file_) != 0) {
+        write_failed_ = true;
+    }
+    file_ = nullptr;
+    if (write_failed_) {
+        UDS_LOG_ERROR("Failed to write capture file, trace is incomplete");
+    }
+    uint64_t lost = dropped();
+    if (lost > 0) {
+        UDS_LOG_WARN("%llu capture record(s) dropped (buffer full)", static_cast<unsigned long long>(lost));
+    }
+}
+
+FrameCapture::Ring* FrameCapture::acquire_ring() {
+    // 优先复用已退出线程留下的缓冲区
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        bool expected = false;
+        if (!ring->in_use.load(std::memory_order_relaxed) &&
+            ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return ring;
+        }
+    }
+
+    // 没有空闲缓冲区时新建并挂到链表头部，缓冲区永不释放
+    Ring* ring = new Ring();
+    ring->in_use.store(true, std::memory_order_relaxed);
+    Ring* head = rings_.load(std::memory_order_relaxed);
+    do {
+        ring->next = head;
+    } while (!rings_.compare_exchange_weak(head, ring, std::memory_order_release,
+                                           std::memory_order_relaxed));
+    return ring;
+}
+
+void FrameCapture::release_ring(Ring* ring) {
+    ring->in_use.store(false, std::memory_order_release);
+}
+
+FrameCapture::Ring* FrameCapture::current_ring() {
+    if (tls_ring.ring == nullptr) {
+        tls_ring.ring = acquire_ring();
+    }
+    return tls_ring.ring;
+}
+
+// 在调用线程上把记录头和载荷拷贝到缓冲区，缓冲区满时丢弃
+void FrameCapture::record(TraceRecord::Direction direction, const Frame& frame,
+                          const uint8_t* payload, size_t size, uint8_t flags) {
+    record(direction, frame.connection_id, frame.source_address, frame.target_address, payload, size, flags);
+}
+
+void FrameCapture::record(TraceRecord::Direction direction, uint32_t connection_id, uint16_t source_address,
+                          uint16_t target_address, const uint8_t* payload, size_t size, uint8_t flags) {
+    if (!active()) {
+        return;
+    }
+    uint64_t timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time_).count());
+
+    Ring* ring = current_ring();
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t total = RECORD_HEADER_SIZE + size;
+    if (total > RING_CAPACITY - (tail - ring->head.load(std::memory_order_acquire))) {
+        ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    write_u64_le(header, timestamp_ns);
+    write_u32_le(header + 8, connection_id);
+    write_u16_le(header + 12, source_address);
+    write_u16_le(header + 14, target_address);
+    header[16] = static_cast<uint8_t>(direction);
+    header[17] = flags;
+    write_u16_le(header + 18, 0);
+    write_u32_le(header + 20, static_cast<uint32_t>(size));
+
+    // 记录可能跨越缓冲区末尾，分两段拷贝
+    uint8_t* data = ring->data.data();
+    size_t position = static_cast<size_t>(tail % RING_CAPACITY);
+    const uint8_t* parts[2] = {header, payload};
+    size_t sizes[2] = {RECORD_HEADER_SIZE, size};
+    for (size_t i = 0; i < 2; ++i) {
+        if (sizes[i] == 0) {
+            continue;
+        }
+        size_t first = std::min(sizes[i], RING_CAPACITY - position);
+        std::memcpy(data + position, parts[i], first);
+        std::memcpy(data, parts[i] + first, sizes[i] - first);
+        position = (position + sizes[i]) % RING_CAPACITY;
+    }
+
+    ring->tail.store(tail + total, std::memory_order_release);
+}
+
+uint64_t FrameCapture::dropped() const {
+    uint64_t total = 0;
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void FrameCapture::write_loop() {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    while (!stopping_) {
+        write_cv_.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS),
+                           [this]() { return stopping_; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+// 把所有缓冲区中的完整记录原样追加到文件
+void FrameCapture::drain() {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    if (file_ == nullptr) {
+        return;
+    }
+
+    bool wrote = false;
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        if (head == tail) {
+            continue;
+        }
+        size_t position = static_cast<size_t>(head % RING_CAPACITY);
+        size_t size = static_cast<size_t>(tail - head);
+        size_t first = std::min(size, RING_CAPACITY - position);
+        if (std::fwrite(ring->data.data() + position, 1, first, file_) != first ||
+            std::fwrite(ring->data.data(), 1, size - first, file_) != size - first) {
+            write_failed_ = true;
+        }
+        ring->head.store(tail, std::memory_order_release);
+        wrote = true;
+    }
+    if (wrote && std::fflush(file_) != 0) {
+        write_failed_ = true;
+    }
+}
+
+} // namespace uds
@@ -0,0 +1,122 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "frame_codec.h"
+#include "cache_aligned.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace uds {
+
+// 抓包文件格式（小端）：
+//   文件头32字节：魔数"UDSTRC01"、开始抓包时的墙上时间（纳秒，u64）、分帧方式（u8）、保留
+//   记录头24字节：相对开始时刻的时间戳（纳秒，u64）、连接编号（u32）、源地址（u16）、目标地址（u16）、
+//                 方向（u8）、标志（u8）、保留（u16）、UDS载荷长度（u32），其后紧跟UDS载荷
+// 同一连接的记录按时间顺序排列，不同连接（不同线程）的记录在文件中可能交错；
+// 服务端主动发送、不是某条请求的直接响应的报文（0x2A周期数据等）记为PUSH，
+// 由产生它的线程记录，与同一连接的请求/响应记录之间的先后只按时间戳近似
+struct TraceRecord {
+    enum Direction : uint8_t {
+        REQUEST = 0,
+        RESPONSE = 1,
+        PUSH = 2
+    };
+
+    static const uint8_t FLAG_UNROUTED = 0x01;   // 目标地址没有对应的ECU，服务端回否定确认
+
+    uint64_t timestamp_ns = 0;
+    uint32_t connection_id = 0;
+    uint16_t source_address = 0;
+    uint16_t target_address = 0;
+    uint8_t direction = REQUEST;
+    uint8_t flags = 0;
+    std::vector<uint8_t> payload;
+};
+
+struct Trace {
+    uint64_t start_time_ns = 0;    // 开始抓包时的墙上时间
+    FramingMode framing = FramingMode::RAW;
+    std::vector<TraceRecord> records;
+};
+
+// 读取抓包文件（供回放工具使用）
+bool load_trace(const std::string& path, Trace& trace, std::string& error);
+
+// 请求/响应抓包
+// 请求处理线程只把记录拷贝到本线程的无锁环形缓冲区（单生产者单消费者），不做I/O；
+// 后台线程定期收集所有缓冲区并追加写入文件。缓冲区满时丢弃记录并计数
+class FrameCapture {
+public:
+    static const size_t FILE_HEADER_SIZE = 32;
+    static const size_t RECORD_HEADER_SIZE = 24;
+    static const size_t RING_CAPACITY = 1 << 20;   // 每个线程缓冲的字节数
+    static const int FLUSH_INTERVAL_MS = 10;
+
+    static FrameCapture& instance();
+
+    bool start(const std::string& path, FramingMode framing, std::string& error);
+
+    // 停止后台线程并写出剩余记录；停止前应先停止请求处理线程
+    void stop();
+
+    bool active() const { return active_.load(std::memory_order_acquire); }
+
+    void record(TraceRecord::Direction direction, const Frame& frame,
+                const uint8_t* payload, size_t size, uint8_t flags);
+
+    // 推送的报文没有对应的请求帧，直接给出所属连接和地址（测试端为源地址，ECU为目标地址）
+    void record(TraceRecord::Direction direction, uint32_t connection_id, uint16_t source_address,
+                uint16_t target_address, const uint8_t* payload, size_t size, uint8_t flags);
+
+    // 缓冲区满时丢弃的记录条数
+    uint64_t dropped() const;
+
+private:
+    // 单生产者（所属线程）单消费者（写文件线程）字节环形缓冲区，每条记录连续写入后才推进tail；
+    // 堆上按缓存行对齐分配
+    struct Ring : CacheAligned {
+        alignas(64) std::atomic<uint64_t> head;   // 消费者位置
+        alignas(64) std::atomic<uint64_t> tail;   // 生产者位置
+        std::atomic<uint64_t> dropped;            // 只有所属线程写入
+        std::atomic<bool> in_use;
+        Ring* next;
+        std::vector<uint8_t> data;
+
+        Ring();
+    };
+
+    FrameCapture();
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator=(const FrameCapture&);
+
+    Ring* acquire_ring();
+    void release_ring(Ring* ring);
+    Ring* current_ring();
+    void write_loop();
+    void drain();
+
+    std::atomic<bool> active_;
+    std::atomic<Ring*> rings_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::FILE* file_;
+    bool write_failed_;
+    std::mutex drain_mutex_;   // 串行化消费者（写文件线程与stop）
+    std::mutex write_mutex_;
+    std::condition_variable write_cv_;
+    bool stopping_;
+    std::thread write_thread_;
+
+    friend struct CaptureRingHolder;
+};
+
+} // namespace uds
+
+#endif // FRAME_CAPTURE_H
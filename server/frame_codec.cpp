@@ -0,0 +1,470 @@
+#include "frame_codec.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace uds {
+
+namespace {
+
+const size_t LENGTH_PREFIX_SIZE = 4;
+const size_t DOIP_HEADER_SIZE = 8;
+const uint8_t DOIP_DEFAULT_VERSION = 0x02;
+const uint8_t DOIP_ROUTING_ACTIVATION_SUCCESS = 0x10;
+const uint8_t DOIP_DIAGNOSTIC_ACK_OK = 0x00;
+const size_t DOIP_DIAGNOSTIC_ACK_LENGTH = 5;
+
+// 连接编号，每个解码器取一个
+std::atomic<uint32_t> g_next_connection_id(1);
+
+uint16_t read_u16_be(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t read_u32_be(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+void append_u16_be(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+void append_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+void write_u32_be(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>((value >> 24) & 0xFF);
+    p[1] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    p[2] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    p[3] = static_cast<uint8_t>(value & 0xFF);
+}
+
+void append_doip_header(std::vector<uint8_t>& out, uint8_t version,
+                        DoipPayloadType type, uint32_t payload_length) {
+    out.push_back(version);
+    out.push_back(static_cast<uint8_t>(~version));
+    append_u16_be(out, static_cast<uint16_t>(type));
+    append_u32_be(out, payload_length);
+}
+
+} // namespace
+
+bool parse_framing_mode(const std::string& name, FramingMode& mode) {
+    if (name == "raw") {
+        mode = FramingMode::RAW;
+    } else if (name == "length") {
+        mode = FramingMode::LENGTH_PREFIXED;
+    } else if (name == "doip") {
+        mode = FramingMode::DOIP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+FrameDecoder::FrameDecoder(FramingMode mode, size_t max_payload_size)
+    : mode_(mode),
+      max_payload_size_(max_payload_size),
+      read_offset_(0),
+      write_offset_(0),
+      discard_remaining_(0),
+      connection_id_(g_next_connection_id.fetch_add(1, std::memory_order_relaxed)),
+      channel_(nullptr),
+      files_(nullptr) {
+}
+
+void FrameDecoder::feed(const uint8_t* data, size_t size) {
+    std::memcpy(prepare(size), data, size);
+    commit(size);
+}
+
+uint8_t* FrameDecoder::prepare(size_t size) {
+    // 回收已解析的前缀，避免缓冲区无限增长
+    if (read_offset_ == write_offset_) {
+        read_offset_ = 0;
+        write_offset_ = 0;
+    } else if (read_offset_ > 4096 && read_offset_ * 2 > write_offset_) {
+        std::memmove(buffer_.data(), buffer_.data() + read_offset_, write_offset_ - read_offset_);
+        write_offset_ -= read_offset_;
+        read_offset_ = 0;
+    }
+
+    if (buffer_.size() < write_offset_ + size) {
+        buffer_.resize(write_offset_ + size);
+    }
+    return buffer_.data() + write_offset_;
+}
+
+void FrameDecoder::commit(size_t size) {
+    // DoIP中丢弃超长报文的剩余载荷
+    if (discard_remaining_ > 0) {
+        size_t skip = static_cast<size_t>(std::min<uint64_t>(discard_remaining_, size));
+        discard_remaining_ -= skip;
+        uint8_t* data = buffer_.data() + write_offset_;
+        std::memmove(data, data + skip, size - skip);
+        size -= skip;
+    }
+    write_offset_ += size;
+}
+
+DecodeResult FrameDecoder::next(Frame& frame) {
+    frame.request = ByteView();
+    frame.reply.clear();
+    frame.connection_id = connection_id_;
+    frame.channel = channel_;
+    frame.files = files_;
+
+    switch (mode_) {
+        case FramingMode::RAW:
+            // 无分帧：把当前收到的全部数据当作一条请求
+            if (read_offset_ >= write_offset_) {
+                return DecodeResult::NEED_MORE;
+            }
+            frame.request = ByteView(buffer_.data() + read_offset_, write_offset_ - read_offset_);
+            consume(write_offset_ - read_offset_);
+            return DecodeResult::REQUEST;
+
+        case FramingMode::LENGTH_PREFIXED:
+            return next_length_prefixed(frame);
+
+        case FramingMode::DOIP:
+            return next_doip(frame);
+    }
+    return DecodeResult::CLOSE;
+}
+
+size_t FrameDecoder::missing() const {
+    size_t available = write_offset_ - read_offset_;
+    const uint8_t* p = buffer_.data() + read_offset_;
+    size_t frame_size = 0;
+    if (mode_ == FramingMode::LENGTH_PREFIXED && available >= LENGTH_PREFIX_SIZE) {
+        uint32_t length = read_u32_be(p);
+        if (length <= max_payload_size_) {
+            frame_size = LENGTH_PREFIX_SIZE + length;
+        }
+    } else if (mode_ == FramingMode::DOIP && available >= DOIP_HEADER_SIZE && discard_remaining_ == 0) {
+        uint32_t length = read_u32_be(p + 4);
+        if (length <= max_payload_size_) {
+            frame_size = DOIP_HEADER_SIZE + length;
+        }
+    }
+    return frame_size > available ? frame_size - available : 0;
+}
+
+DecodeResult FrameDecoder::next_length_prefixed(Frame& frame) {
+    size_t available = write_offset_ - read_offset_;
+    if (available < LENGTH_PREFIX_SIZE) {
+        return DecodeResult::NEED_MORE;
+    }
+
+    const uint8_t* p = buffer_.data() + read_offset_;
+    uint32_t length = read_u32_be(p);
+    if (length == 0 || length > max_payload_size_) {
+        return DecodeResult::CLOSE;
+    }
+    if (available < LENGTH_PREFIX_SIZE + length) {
+        return DecodeResult::NEED_MORE;
+    }
+
+    frame.request = ByteView(p + LENGTH_PREFIX_SIZE, length);
+    consume(LENGTH_PREFIX_SIZE + length);
+    return DecodeResult::REQUEST;
+}
+
+DecodeResult FrameDecoder::next_doip(Frame& frame) {
+    size_t available = write_offset_ - read_offset_;
+    if (available < DOIP_HEADER_SIZE) {
+        return DecodeResult::NEED_MORE;
+    }
+
+    const uint8_t* p = buffer_.data() + read_offset_;
+    uint8_t version = p[0];
+    if (static_cast<uint8_t>(~p[1]) != version) {
+        // 报文头格式错误：回复NACK后必须关闭连接
+        make_doip_nack(frame, DoipHeaderNack::INCORRECT_PATTERN_FORMAT);
+        read_offset_ = 0;
+        write_offset_ = 0;
+        return DecodeResult::CLOSE;
+    }
+
+    uint16_t payload_type = read_u16_be(p + 2);
+    uint32_t payload_length = read_u32_be(p + 4);
+    frame.protocol_version = version == 0xFF ? DOIP_DEFAULT_VERSION : version;
+
+    if (payload_length > max_payload_size_) {
+        // 超长报文：回复NACK并丢弃其载荷
+        consume(DOIP_HEADER_SIZE);
+        size_t in_buffer = std::min<size_t>(payload_length, write_offset_ - read_offset_);
+        consume(in_buffer);
+        discard_remaining_ = payload_length - in_buffer;
+        make_doip_nack(frame, DoipHeaderNack::MESSAGE_TOO_LARGE);
+        return DecodeResult::REPLY;
+    }
+
+    if (available < DOIP_HEADER_SIZE + payload_length) {
+        return DecodeResult::NEED_MORE;
+    }
+
+    const uint8_t* payload = p + DOIP_HEADER_SIZE;
+    switch (static_cast<DoipPayloadType>(payload_type)) {
+        case DoipPayloadType::DIAGNOSTIC_MESSAGE:
+            if (payload_length < 5) {
+                consume(DOIP_HEADER_SIZE + payload_length);
+                make_doip_nack(frame, DoipHeaderNack::INVALID_PAYLOAD_LENGTH);
+                return DecodeResult::REPLY;
+            }
+            frame.source_address = read_u16_be(payload);
+            frame.target_address = read_u16_be(payload + 2);
+            frame.request = ByteView(payload + 4, payload_length - 4);
+            consume(DOIP_HEADER_SIZE + payload_length);
+            return DecodeResult::REQUEST;
+
+        case DoipPayloadType::ROUTING_ACTIVATION_REQUEST: {
+            if (payload_length != 7 && payload_length != 11) {
+                consume(DOIP_HEADER_SIZE + payload_length);
+                make_doip_nack(frame, DoipHeaderNack::INVALID_PAYLOAD_LENGTH);
+                return DecodeResult::REPLY;
+            }
+            uint16_t tester_address = read_u16_be(payload);
+            consume(DOIP_HEADER_SIZE + payload_length);
+
+            // 模拟器接受所有路由激活请求
+            append_doip_header(frame.reply, frame.protocol_version,
+                               DoipPayloadType::ROUTING_ACTIVATION_RESPONSE, 9);
+            append_u16_be(frame.reply, tester_address);
+            append_u16_be(frame.reply, DOIP_ENTITY_ADDRESS);
+            frame.reply.push_back(DOIP_ROUTING_ACTIVATION_SUCCESS);
+            append_u32_be(frame.reply, 0);
+            return DecodeResult::REPLY;
+        }
+
+        default:
+            consume(DOIP_HEADER_SIZE + payload_length);
+            make_doip_nack(frame, DoipHeaderNack::UNKNOWN_PAYLOAD_TYPE);
+            return DecodeResult::REPLY;
+    }
+}
+
+void FrameDecoder::make_doip_nack(Frame& frame, DoipHeaderNack code) {
+    frame.reply.clear();
+    append_doip_header(frame.reply, frame.protocol_version, DoipPayloadType::GENERIC_HEADER_NACK, 1);
+    frame.reply.push_back(static_cast<uint8_t>(code));
+}
+
+void FrameDecoder::consume(size_t size) {
+    // 只移动读位置，不回收空间：已取出帧的请求视图在下次写入前仍然有效
+    read_offset_ += size;
+}
+
+void encode_response(FramingMode mode, const Frame& request,
+                     const std::vector<uint8_t>& payload, std::vector<uint8_t>& out) {
+    size_t header_offset = begin_response(mode, request, out);
+    out.insert(out.end(), payload.begin(), payload.end());
+    end_response(mode, header_offset, out);
+}
+
+size_t begin_response(FramingMode mode, const Frame& request, std::vector<uint8_t>& out) {
+    size_t header_offset = out.size();
+    switch (mode) {
+        case FramingMode::RAW:
+            break;
+
+        case FramingMode::LENGTH_PREFIXED:
+            append_u32_be(out, 0);
+            break;
+
+        case FramingMode::DOIP:
+            // 先确认收到诊断报文，再发送诊断响应；响应中源/目标地址互换
+            append_doip_header(out, request.protocol_version,
+                               DoipPayloadType::DIAGNOSTIC_MESSAGE_POSITIVE_ACK, DOIP_DIAGNOSTIC_ACK_LENGTH);
+            append_u16_be(out, request.target_address);
+            append_u16_be(out, request.source_address);
+            out.push_back(DOIP_DIAGNOSTIC_ACK_OK);
+
+            header_offset = begin_message(mode, request.target_address, request.source_address,
+                                          request.protocol_version, out);
+            break;
+    }
+    return header_offset;
+}
+
+size_t begin_message(FramingMode mode, uint16_t source_address, uint16_t target_address,
+                     uint8_t protocol_version, std::vector<uint8_t>& out) {
+    size_t header_offset = out.size();
+    switch (mode) {
+        case FramingMode::RAW:
+            break;
+
+        case FramingMode::LENGTH_PREFIXED:
+            append_u32_be(out, 0);
+            break;
+
+        case FramingMode::DOIP:
+            append_doip_header(out, protocol_version, DoipPayloadType::DIAGNOSTIC_MESSAGE, 0);
+            append_u16_be(out, source_address);
+            append_u16_be(out, target_address);
+            break;
+    }
+    return header_offset;
+}
+
+void end_response(FramingMode mode, size_t header_offset, std::vector<uint8_t>& out, size_t extra_size) {
+    switch (mode) {
+        case FramingMode::RAW:
+            break;
+
+        case FramingMode::LENGTH_PREFIXED:
+            write_u32_be(out.data() + header_offset,
+                         static_cast<uint32_t>(out.size() + extra_size - header_offset - LENGTH_PREFIX_SIZE));
+            break;
+
+        case FramingMode::DOIP:
+            // DoIP载荷长度包含4字节地址
+            write_u32_be(out.data() + header_offset + 4,
+                         static_cast<uint32_t>(out.size() + extra_size - header_offset - DOIP_HEADER_SIZE));
+            break;
+    }
+}
+
+bool process_frames(FrameDecoder& decoder, const RequestHandler& handler, std::vector<uint8_t>& out,
+                    size_t output_budget) {
+    Frame frame;
+    size_t produced = 0;
+    while (produced < output_budget) {
+        size_t frame_offset = out.size();
+        size_t file_bytes = 0;
+        switch (decoder.next(frame)) {
+            case DecodeResult::NEED_MORE:
+                return true;
+
+            case DecodeResult::REQUEST: {
+                // 响应直接写入out中帧头之后，不经过中间缓冲区
+                size_t header_offset = begin_response(decoder.mode(), frame, out);
+                size_t body_offset = out.size();
+                size_t first_file = frame.files != nullptr ? frame.files->size() : 0;
+                if (handler(frame, out)) {
+                    file_bytes = frame.files != nullptr ? file_slice_bytes(*frame.files, first_file) : 0;
+                    if (out.size() == body_offset && file_bytes == 0) {
+                        // 抑制了肯定响应：不发送空的诊断报文，DoIP下保留确认
+                        out.resize(header_offset);
+                    } else {
+                        end_response(decoder.mode(), header_offset, out, file_bytes);
+                    }
+                    break;
+                }
+
+                // 目标地址上没有ECU：撤销已写入的确认、帧头和文件片段，DoIP改为回复否定确认
+                out.resize(frame_offset);
+                if (frame.files != nullptr) {
+                    frame.files->resize(first_file);
+                }
+                if (decoder.mode() == FramingMode::DOIP) {
+                    append_doip_header(out, frame.protocol_version,
+                                       DoipPayloadType::DIAGNOSTIC_MESSAGE_NEGATIVE_ACK, DOIP_DIAGNOSTIC_ACK_LENGTH);
+                    append_u16_be(out, frame.target_address);
+                    append_u16_be(out, frame.source_address);
+                    out.push_back(static_cast<uint8_t>(DoipDiagnosticNack::UNKNOWN_TARGET_ADDRESS));
+                }
+                break;
+            }
+
+            case DecodeResult::REPLY:
+                out.insert(out.end(), frame.reply.begin(), frame.reply.end());
+                break;
+
+            case DecodeResult::CLOSE:
+                out.insert(out.end(), frame.reply.begin(), frame.reply.end());
+                return false;
+        }
+        produced += out.size() - frame_offset + file_bytes;
+    }
+    return true;
+}
+
+void encode_request(FramingMode mode, uint16_t source_address, uint16_t target_address,
+                    const std::vector<uint8_t>& payload, std::vector<uint8_t>& out) {
+    if (mode == FramingMode::DOIP) {
+        append_doip_header(out, DOIP_DEFAULT_VERSION, DoipPayloadType::DIAGNOSTIC_MESSAGE,
+                           static_cast<uint32_t>(4 + payload.size()));
+        append_u16_be(out, source_address);
+        append_u16_be(out, target_address);
+        out.insert(out.end(), payload.begin(), payload.end());
+        return;
+    }
+
+    Frame request;
+    encode_response(mode, request, payload, out);
+}
+
+ResponseDecoder::ResponseDecoder(FramingMode mode) : mode_(mode), offset_(0) {
+}
+
+void ResponseDecoder::feed(const uint8_t* data, size_t size) {
+    // 上次的数据已全部取出时从头复用缓冲区
+    if (offset_ > 0 && offset_ == buffer_.size()) {
+        buffer_.clear();
+        offset_ = 0;
+    }
+    buffer_.insert(buffer_.end(), data, data + size);
+}
+
+bool ResponseDecoder::next(ByteView& payload, bool& nack) {
+    nack = false;
+    for (;;) {
+        size_t available = buffer_.size() - offset_;
+        const uint8_t* p = buffer_.data() + offset_;
+        switch (mode_) {
+            case FramingMode::RAW:
+                if (available == 0) {
+                    return false;
+                }
+                payload = ByteView(p, available);
+                offset_ = buffer_.size();
+                return true;
+
+            case FramingMode::LENGTH_PREFIXED: {
+                if (available < LENGTH_PREFIX_SIZE) {
+                    return false;
+                }
+                size_t length = read_u32_be(p);
+                if (available < LENGTH_PREFIX_SIZE + length) {
+                    return false;
+                }
+                payload = ByteView(p + LENGTH_PREFIX_SIZE, length);
+                offset_ += LENGTH_PREFIX_SIZE + length;
+                return true;
+            }
+
+            case FramingMode::DOIP: {
+                if (available < DOIP_HEADER_SIZE) {
+                    return false;
+                }
+                uint16_t type = read_u16_be(p + 2);
+                size_t length = read_u32_be(p + 4);
+                if (available < DOIP_HEADER_SIZE + length) {
+                    return false;
+                }
+                offset_ += DOIP_HEADER_SIZE + length;
+                if (type == static_cast<uint16_t>(DoipPayloadType::DIAGNOSTIC_MESSAGE) && length >= 4) {
+                    payload = ByteView(p + DOIP_HEADER_SIZE + 4, length - 4);
+                    return true;
+                }
+                if (type == static_cast<uint16_t>(DoipPayloadType::DIAGNOSTIC_MESSAGE_NEGATIVE_ACK)) {
+                    payload = ByteView();
+                    nack = true;
+                    return true;
+                }
+                // 诊断确认、路由激活响应等控制报文不对应UDS响应，跳过
+                break;
+            }
+        }
+    }
+}
+
+} // namespace uds
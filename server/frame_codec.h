@@ -0,0 +1,174 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <functional>
+#include "uds_protocol.h"
+#include "file_slice.h"
+
+namespace uds {
+
+class PushChannel;
+
+// TCP传输层分帧方式
+enum class FramingMode {
+    RAW,              // 无分帧：每次recv视为一条UDS请求（兼容网页客户端/桥接服务）
+    LENGTH_PREFIXED,  // 4字节大端长度前缀 + UDS报文
+    DOIP              // ISO 13400 DoIP通用报文头（8字节） + 载荷
+};
+
+// DoIP载荷类型
+enum class DoipPayloadType : uint16_t {
+    GENERIC_HEADER_NACK = 0x0000,
+    ROUTING_ACTIVATION_REQUEST = 0x0005,
+    ROUTING_ACTIVATION_RESPONSE = 0x0006,
+    DIAGNOSTIC_MESSAGE = 0x8001,
+    DIAGNOSTIC_MESSAGE_POSITIVE_ACK = 0x8002,
+    DIAGNOSTIC_MESSAGE_NEGATIVE_ACK = 0x8003
+};
+
+// DoIP诊断报文否定确认码
+enum class DoipDiagnosticNack : uint8_t {
+    UNKNOWN_TARGET_ADDRESS = 0x03
+};
+
+// DoIP通用报文头否定应答码
+enum class DoipHeaderNack : uint8_t {
+    INCORRECT_PATTERN_FORMAT = 0x00,
+    UNKNOWN_PAYLOAD_TYPE = 0x01,
+    MESSAGE_TOO_LARGE = 0x02,
+    INVALID_PAYLOAD_LENGTH = 0x04
+};
+
+// 解码出的一帧
+struct Frame {
+    ByteView request;              // UDS请求报文，指向解码器缓冲区，下次写入解码器前有效
+    std::vector<uint8_t> reply;    // 需直接回复给对端的控制报文
+    uint16_t source_address = 0;   // DoIP源地址（测试端逻辑地址）
+    uint16_t target_address = 0;   // DoIP目标地址（ECU逻辑地址）
+    uint8_t protocol_version = 0x02;  // DoIP协议版本，响应沿用请求的版本
+    uint32_t connection_id = 0;    // 所属连接的编号（每个解码器一个，进程内唯一）
+    PushChannel* channel = nullptr;   // 所属连接的推送通道，传输层不支持推送时为空
+    std::vector<FileSlice>* files = nullptr;  // 所属连接的文件片段表，传输层不支持零拷贝发送时为空
+};
+
+// 本DoIP实体的逻辑地址（路由激活响应中使用，也是默认ECU的地址）
+const uint16_t DOIP_ENTITY_ADDRESS = 0x1000;
+
+// 请求处理回调：输入一帧UDS请求（frame.request及其DoIP地址），把响应报文追加到out
+// 请求数据指向解码器的接收缓冲区，只在回调期间有效；目标地址上没有ECU时返回false
+typedef std::function<bool(const Frame& frame, std::vector<uint8_t>& out)> RequestHandler;
+
+// 解码结果
+enum class DecodeResult {
+    NEED_MORE,  // 缓冲区中没有完整的帧
+    REQUEST,    // 得到一条UDS请求
+    REPLY,      // 得到一条需原样发送给对端的传输层控制报文（如DoIP NACK）
+    CLOSE       // 数据流无法恢复，应关闭连接（reply非空时先发送它）
+};
+
+// 解析分帧模式名称（raw/length/doip）
+bool parse_framing_mode(const std::string& name, FramingMode& mode);
+
+// 每个连接一个的流式解码器，负责把TCP字节流重组为完整报文
+// 一次接收中包含的多条请求会依次解出，被拆开的请求会等待后续数据
+class FrameDecoder {
+public:
+    explicit FrameDecoder(FramingMode mode, size_t max_payload_size = 1024 * 1024);
+
+    // 追加从socket收到的数据
+    void feed(const uint8_t* data, size_t size);
+
+    // 在缓冲区末尾预留至少size字节供recv直接写入，避免再复制一次
+    // 之前取出的帧中的请求视图随之失效
+    uint8_t* prepare(size_t size);
+
+    // 确认prepare()返回的空间中实际写入了size字节
+    void commit(size_t size);
+
+    // 取出下一帧
+    DecodeResult next(Frame& frame);
+
+    // 缓冲区开头的不完整帧还差多少字节；帧长未知（帧头不完整、raw分帧）时返回0。
+    // 传输层据此一次接收整个大报文（如0x36的数据块），不必按固定大小多次接收
+    size_t missing() const;
+
+    FramingMode mode() const { return mode_; }
+    uint32_t connection_id() const { return connection_id_; }
+
+    // 设置所属连接的推送通道，之后解出的帧都带上它；通道由连接持有，须比解码器存活更久
+    void set_push_channel(PushChannel* channel) { channel_ = channel; }
+
+    // 设置所属连接的文件片段表（与输出缓冲区配对），之后解出的帧都带上它，处理函数可把文件数据以片段形式放入响应
+    void set_file_slices(std::vector<FileSlice>* files) { files_ = files; }
+
+private:
+    DecodeResult next_length_prefixed(Frame& frame);
+    DecodeResult next_doip(Frame& frame);
+    void make_doip_nack(Frame& frame, DoipHeaderNack code);
+    void consume(size_t size);
+
+    FramingMode mode_;
+    size_t max_payload_size_;
+    std::vector<uint8_t> buffer_;  // 重组缓冲区，只增不减，连接内反复复用
+    size_t read_offset_;           // 缓冲区中尚未解析数据的起始位置
+    size_t write_offset_;          // 缓冲区中有效数据的结束位置
+    uint64_t discard_remaining_;   // DoIP中需丢弃的超长载荷剩余字节数
+    uint32_t connection_id_;
+    PushChannel* channel_;
+    std::vector<FileSlice>* files_;
+};
+
+// 按分帧方式封装一条UDS响应并追加到out；request为对应的请求帧（DoIP需要其地址信息）
+void encode_response(FramingMode mode, const Frame& request,
+                     const std::vector<uint8_t>& payload, std::vector<uint8_t>& out);
+
+// 原地封装：先写入帧头并预留长度字段，返回帧头位置；响应报文直接追加到out后，
+// 再由end_response回填长度，整个过程不需要中间缓冲区；extra_size为报文中以文件片段发送、不在out中的字节数
+size_t begin_response(FramingMode mode, const Frame& request, std::vector<uint8_t>& out);
+void end_response(FramingMode mode, size_t header_offset, std::vector<uint8_t>& out, size_t extra_size = 0);
+
+// 服务端主动发送的报文（不对应某条请求，DoIP下没有确认报文）：写入帧头，返回帧头位置，
+// 报文追加到out后同样由end_response回填长度
+size_t begin_message(FramingMode mode, uint16_t source_address, uint16_t target_address,
+                     uint8_t protocol_version, std::vector<uint8_t>& out);
+
+// 解出解码器中所有完整的帧，依次交给handler处理，并把响应按请求顺序追加到out；
+// handler拒绝的DoIP诊断报文回复否定确认（0x8003，未知目标地址），其他分帧方式不回复；
+// handler未写出响应（抑制肯定响应）时不发送诊断报文，DoIP下只回复确认；
+// 帧带有文件片段表时，handler追加的片段计入响应长度，片段位置相对out
+// 本次写出的数据（含文件片段）达到output_budget后不再解码，剩余的帧留在解码器中，由下次调用处理；
+// 单条响应超出预算时仍完整写出
+// 返回false表示连接应在发送out之后关闭
+bool process_frames(FrameDecoder& decoder, const RequestHandler& handler, std::vector<uint8_t>& out,
+                    size_t output_budget = SIZE_MAX);
+
+// 按分帧方式封装一条UDS请求并追加到out（供测试端/工具使用）
+void encode_request(FramingMode mode, uint16_t source_address, uint16_t target_address,
+                    const std::vector<uint8_t>& payload, std::vector<uint8_t>& out);
+
+// 测试端的响应解码器：从服务端的TCP字节流中取出UDS响应（供测试端/工具使用）
+// raw分帧没有边界，已收到的全部数据视为一条响应，因此raw下同一时刻只能有一条在途请求
+class ResponseDecoder {
+public:
+    explicit ResponseDecoder(FramingMode mode);
+
+    void feed(const uint8_t* data, size_t size);
+
+    // 取出下一条响应；DoIP诊断确认（0x8002）等控制报文被跳过，
+    // 诊断否定确认（0x8003）以nack为true、payload为空的形式返回
+    // payload指向内部缓冲区，下次调用feed前有效
+    bool next(ByteView& payload, bool& nack);
+
+private:
+    FramingMode mode_;
+    std::vector<uint8_t> buffer_;
+    size_t offset_;
+};
+
+} // namespace uds
+
+#endif // FRAME_CODEC_H
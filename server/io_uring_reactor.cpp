@@ -0,0 +1,810 @@
+#include "io_uring_reactor.h"
+#include "push_channel.h"
+#include "cpu_affinity.h"
+#include "metrics.h"
+#include "logger.h"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef __linux__
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+    #include <sys/mman.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+    #include <sys/utsname.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+// multishot accept/recv需要内核6.0的头文件
+#if defined(__linux__) && defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+    #define UDS_HAVE_IO_URING 1
+#endif
+
+namespace uds {
+
+#ifdef UDS_HAVE_IO_URING
+
+namespace {
+
+const unsigned SQ_ENTRIES = 256;
+const unsigned CQ_ENTRIES = 4096;
+// 接收缓冲区环：数量须为2的幂，每个缓冲区大小与epoll模式一次recv的大小相同
+const unsigned RECV_BUFFER_COUNT = 256;
+const unsigned RECV_BUFFER_SIZE = 16384;
+const uint16_t RECV_BUFFER_GROUP = 0;
+// 可丢弃的推送数据：通道内排队或连接未发出的数据超过该值时丢弃新数据，避免不读数据的对端占用无限内存；
+// 不能丢弃的推送数据另算一份同样的上限，超过时关闭连接
+const size_t MAX_PENDING_PUSH_BYTES = 256 * 1024;
+
+// user_data低位标记操作类型，高位为连接指针（至少8字节对齐）
+const uint64_t OP_ACCEPT = 0;
+const uint64_t OP_WAKEUP = 1;
+const uint64_t OP_RECV = 2;
+const uint64_t OP_SEND = 3;
+const uint64_t OP_PROVIDE = 4;
+const uint64_t OP_CANCEL = 5;
+const uint64_t OP_MASK = 7;
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+} // namespace
+
+// 一个io_uring实例：提交队列、完成队列的共享内存映射，以及交给内核的接收缓冲区
+// 只由所属事件循环线程访问（stop时循环线程已退出）
+struct IoUringReactor::Ring {
+    int fd;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;       // 已填好但尚未提交的SQE的结尾
+    unsigned submitted;      // 已交给内核的SQE的结尾
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    uint8_t* buffers;
+    unsigned buffer_count;
+
+    Ring()
+        : fd(-1), sq_map(MAP_FAILED), sq_map_size(0), cq_map(MAP_FAILED), cq_map_size(0),
+          sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), sqes_size(0), sq_head(nullptr), sq_tail(nullptr),
+          sq_mask(0), sq_entries(0), sqe_tail(0), submitted(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(0),
+          cqes(nullptr), buffers(static_cast<uint8_t*>(MAP_FAILED)), buffer_count(0) {
+    }
+
+    ~Ring() {
+        if (buffers != MAP_FAILED) munmap(buffers, static_cast<size_t>(buffer_count) * RECV_BUFFER_SIZE);
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+        if (cq_map != MAP_FAILED && cq_map != sq_map) munmap(cq_map, cq_map_size);
+        if (sq_map != MAP_FAILED) munmap(sq_map, sq_map_size);
+        if (fd >= 0) close(fd);
+    }
+
+    // 创建实例并映射队列
+    bool setup(unsigned entries, unsigned cq_entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = cq_entries;
+#ifdef IORING_SETUP_COOP_TASKRUN
+        // 完成事件只由本线程收割，不需要内核打断线程投递
+        params.flags |= IORING_SETUP_COOP_TASKRUN;
+        fd = sys_io_uring_setup(entries, &params);
+        if (fd < 0 && errno == EINVAL) {
+            std::memset(&params, 0, sizeof(params));
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = cq_entries;
+            fd = sys_io_uring_setup(entries, &params);
+        }
+#else
+        fd = sys_io_uring_setup(entries, &params);
+#endif
+        if (fd < 0) {
+            return false;
+        }
+
+        sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_map_size = cq_map_size = std::max(sq_map_size, cq_map_size);
+        }
+        sq_map = mmap(nullptr, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+        if (sq_map == MAP_FAILED) {
+            return false;
+        }
+        cq_map = single_mmap ? sq_map
+                             : mmap(nullptr, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                    IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) {
+            return false;
+        }
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(sq_map);
+        uint8_t* cq = static_cast<uint8_t*>(cq_map);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        // SQE按下标一一对应，索引数组只需填一次
+        unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; ++i) {
+            array[i] = i;
+        }
+        sqe_tail = submitted = *sq_tail;
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // 分配接收缓冲区并整组交给内核（缓冲区组RECV_BUFFER_GROUP），multishot recv每次从中取一个，处理完再归还
+    // 交还缓冲区的SQE与其他操作一起提交，不单独进入内核
+    bool setup_buffers(unsigned count) {
+        buffer_count = count;
+        buffers = static_cast<uint8_t*>(mmap(nullptr, static_cast<size_t>(count) * RECV_BUFFER_SIZE,
+                                             PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (buffers == MAP_FAILED) {
+            return false;
+        }
+        return provide_buffers(0, count);
+    }
+
+    uint8_t* buffer(uint16_t id) {
+        return buffers + static_cast<size_t>(id) * RECV_BUFFER_SIZE;
+    }
+
+    // 把从first开始的count个缓冲区交给内核；成功时不产生完成事件
+    bool provide_buffers(uint16_t first, unsigned count) {
+        io_uring_sqe* sqe = get_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int32_t>(count);
+        sqe->addr = reinterpret_cast<uint64_t>(buffer(first));
+        sqe->len = RECV_BUFFER_SIZE;
+        sqe->off = first;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+#ifdef IOSQE_CQE_SKIP_SUCCESS
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+#endif
+        sqe->user_data = OP_PROVIDE;
+        return true;
+    }
+
+    // 取一个空闲SQE；提交队列已满时先把已填好的提交给内核
+    io_uring_sqe* get_sqe() {
+        if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submit(0);
+            if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+                return nullptr;
+            }
+        }
+        io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++sqe_tail;
+        return sqe;
+    }
+
+    // 提交所有已填好的SQE，并等待至少wait_nr个完成事件；返回io_uring_enter的结果（失败时为-errno）
+    int submit(unsigned wait_nr) {
+        unsigned to_submit = sqe_tail - submitted;
+        if (to_submit == 0 && wait_nr == 0) {
+            return 0;
+        }
+        __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+        submitted = sqe_tail;
+        int ret = sys_io_uring_enter(fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0);
+        return ret < 0 ? -errno : ret;
+    }
+
+    // 取下一个完成事件，没有时返回nullptr；处理完须调用cqe_seen
+    io_uring_cqe* peek_cqe() {
+        unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &cqes[head & cq_mask];
+    }
+
+    void cqe_seen() {
+        __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+    }
+};
+
+// 连接的推送通道：其他线程推送的数据先在通道内排队，再唤醒事件循环，由事件循环线程追加到连接的输出缓冲区
+// 可丢弃与不能丢弃的数据分开排队，各自计算上限；两者都是整条报文，分开追加不会把报文拆开
+class IoUringReactor::Channel : public PushChannel {
+public:
+    Channel(FramingMode framing, Loop& loop, Connection& connection)
+        : PushChannel(framing), loop_(loop), connection_(&connection), closed_(false), overflowed_(false),
+          ready_(false) {
+    }
+
+    bool push(const uint8_t* data, size_t size, PushPolicy policy) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || overflowed_) {
+            return false;
+        }
+        std::vector<uint8_t>& queue = policy == PushPolicy::RELIABLE ? reliable_ : lossy_;
+        if (queue.size() + size > MAX_PENDING_PUSH_BYTES) {
+            if (policy == PushPolicy::LOSSY) {
+                Metrics::instance().record_push_dropped();
+                return true;
+            }
+            // 不能丢弃的数据排不下：由事件循环关闭连接，之后的推送都返回false
+            overflowed_ = true;
+            Metrics::instance().record_push_overflow_disconnect();
+        } else {
+            queue.insert(queue.end(), data, data + size);
+        }
+        if (!ready_) {
+            ready_ = true;
+            {
+                std::lock_guard<std::mutex> ready_lock(loop_.push_mutex);
+                loop_.push_ready.push_back(std::static_pointer_cast<Channel>(shared_from_this()));
+            }
+            uint64_t one = 1;
+            ssize_t ignored = write(loop_.wakeup_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+        return !overflowed_;
+    }
+
+    // 事件循环线程调用：把排队的数据追加到连接的输出缓冲区，连接已关闭时返回nullptr
+    // 连接积压过多时丢弃可丢弃的数据；不能丢弃的数据总是追加，排不下过的连接发完已排队的数据后关闭
+    Connection* drain() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_ = false;
+        if (closed_) {
+            return nullptr;
+        }
+        std::vector<uint8_t>& out = connection_->pending_output;
+        if (!connection_->close_after_flush) {
+            out.insert(out.end(), reliable_.begin(), reliable_.end());
+            if (!lossy_.empty()) {
+                size_t unsent = out.size() + connection_->sending.size() - connection_->sending_offset;
+                if (unsent <= MAX_PENDING_PUSH_BYTES) {
+                    out.insert(out.end(), lossy_.begin(), lossy_.end());
+                } else {
+                    Metrics::instance().record_push_dropped();
+                }
+            }
+            if (overflowed_) {
+                UDS_LOG_WARN("Push queue overflow, closing client: %s", connection_->client_ip.c_str());
+                connection_->close_after_flush = true;
+            }
+        }
+        reliable_.clear();
+        lossy_.clear();
+        return connection_;
+    }
+
+    // 事件循环线程在关闭连接前调用，之后的推送返回false
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        reliable_.clear();
+        lossy_.clear();
+    }
+
+private:
+    Loop& loop_;
+    Connection* connection_;      // 只在事件循环线程中、未关闭时访问
+    std::mutex mutex_;
+    std::vector<uint8_t> reliable_;  // 不能丢弃的推送数据
+    std::vector<uint8_t> lossy_;     // 可丢弃的推送数据
+    bool closed_;
+    bool overflowed_;             // 不能丢弃的数据排不下，连接等待关闭
+    bool ready_;                  // 已登记在loop_.push_ready中
+};
+
+IoUringReactor::Loop::Loop() : index(0), listen_fd(-1), wakeup_fd(-1), wakeup_value(0) {
+}
+
+IoUringReactor::Loop::~Loop() {
+}
+
+IoUringReactor::IoUringReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler)
+    : options_(options),
+      framing_(framing),
+      handler_(handler),
+      is_running_(false) {
+    if (options_.loops == 0) {
+        options_.loops = 1;
+    }
+}
+
+IoUringReactor::~IoUringReactor() {
+    stop();
+}
+
+bool IoUringReactor::is_supported() {
+    // multishot recv从6.0开始提供，旧内核上建环成功但提交时才会报错，先按版本号排除
+    struct utsname name;
+    int major = 0;
+    int minor = 0;
+    if (uname(&name) != 0 || std::sscanf(name.release, "%d.%d", &major, &minor) != 2 || major < 6) {
+        return false;
+    }
+
+    // 在socketpair上实际收一次数据，排除io_uring被禁用（io_uring_disabled、seccomp）或功能不完整的内核
+    Ring ring;
+    if (!ring.setup(4, 8) || !ring.setup_buffers(2)) {
+        return false;
+    }
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+        return false;
+    }
+    bool supported = false;
+    io_uring_sqe* sqe = ring.get_sqe();
+    if (sqe != nullptr && send(pair[1], "x", 1, MSG_NOSIGNAL) == 1) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = pair[0];
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+        sqe->user_data = OP_RECV;
+        if (ring.submit(1) >= 0) {
+            io_uring_cqe* cqe;
+            while ((cqe = ring.peek_cqe()) != nullptr) {
+                if (cqe->user_data == OP_RECV) {
+                    supported = cqe->res == 1 && (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+                }
+                ring.cqe_seen();
+            }
+        }
+    }
+    close(pair[0]);
+    close(pair[1]);
+    return supported;
+}
+
+bool IoUringReactor::start(const std::vector<int>& listen_sockets) {
+    if (listen_sockets.size() != 1 && listen_sockets.size() != options_.loops) {
+        UDS_LOG_ERROR("%zu listen sockets for %zu event loops", listen_sockets.size(), options_.loops);
+        return false;
+    }
+    bool shared = listen_sockets.size() == 1;
+
+    for (size_t i = 0; i < options_.loops; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+        loop->index = i;
+        loop->listen_fd = listen_sockets[shared ? 0 : i];
+        loop->ring.reset(new Ring());
+        loop->wakeup_fd = eventfd(0, EFD_CLOEXEC);
+        if (loop->wakeup_fd < 0 || !loop->ring->setup(SQ_ENTRIES, CQ_ENTRIES) ||
+            !loop->ring->setup_buffers(RECV_BUFFER_COUNT)) {
+            UDS_LOG_ERROR("Failed to create io_uring instance: %s", std::strerror(errno));
+            if (loop->wakeup_fd >= 0) close(loop->wakeup_fd);
+            stop();
+            return false;
+        }
+        loops_.push_back(std::move(loop));
+    }
+
+    is_running_ = true;
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        Loop* loop = loops_[i].get();
+        loop->thread = std::thread(&IoUringReactor::run_loop, this, std::ref(*loop));
+    }
+
+    UDS_LOG_INFO("io_uring reactor started with %zu event loop(s), %s listen socket%s", loops_.size(),
+                 shared ? "shared" : "per-loop SO_REUSEPORT", options_.pin_cpus ? ", pinned to CPUs" : "");
+    return true;
+}
+
+void IoUringReactor::stop() {
+    is_running_ = false;
+
+    // 唤醒并等待所有事件循环退出；连接由各循环线程在退出前关闭
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loops_[i]->wakeup_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        Loop& loop = *loops_[i];
+        if (loop.thread.joinable()) {
+            loop.thread.join();
+        }
+        for (auto& entry : loop.connections) {
+            entry.second->channel->close();
+            close(entry.first);
+            Metrics::instance().connection_closed();
+        }
+        loop.connections.clear();
+        loop.push_ready.clear();
+        // 关闭环时内核取消仍在途的操作（此时只剩accept与eventfd读）
+        loop.ring.reset();
+        close(loop.wakeup_fd);
+    }
+    loops_.clear();
+}
+
+void IoUringReactor::run_loop(Loop& loop) {
+    Ring& ring = *loop.ring;
+    if (options_.pin_cpus && !pin_current_thread(loop.index)) {
+        UDS_LOG_WARN("Failed to pin event loop %zu to a CPU", loop.index);
+    }
+    arm_wakeup(loop);
+    arm_accept(loop);
+
+    bool draining = false;
+    while (true) {
+        if (!is_running_ && !draining) {
+            // 退出前关闭所有连接，等它们的recv/send完成，避免关闭环后内核仍引用连接的缓冲区
+            draining = true;
+            std::vector<Connection*> open;
+            for (auto& entry : loop.connections) {
+                open.push_back(entry.second.get());
+            }
+            for (size_t i = 0; i < open.size(); ++i) {
+                close_connection(loop, *open[i]);
+            }
+        }
+        if (draining && loop.connections.empty()) {
+            break;
+        }
+
+        // 上一轮产生的所有SQE在这里一次提交，同时等待新的完成事件
+        int ret = ring.submit(1);
+        if (ret < 0 && ret != -EINTR && ret != -EBUSY && ret != -EAGAIN) {
+            UDS_LOG_ERROR("io_uring_enter failed: %s", std::strerror(-ret));
+            break;
+        }
+
+        io_uring_cqe* cqe;
+        while ((cqe = ring.peek_cqe()) != nullptr) {
+            uint64_t user_data = cqe->user_data;
+            int result = cqe->res;
+            uint32_t flags = cqe->flags;
+            ring.cqe_seen();
+
+            Connection* conn = reinterpret_cast<Connection*>(user_data & ~OP_MASK);
+            switch (user_data & OP_MASK) {
+            case OP_ACCEPT:
+                on_accept(loop, result, flags);
+                break;
+            case OP_WAKEUP:
+                drain_pushes(loop);
+                if (is_running_) {
+                    arm_wakeup(loop);
+                }
+                break;
+            case OP_RECV:
+                on_recv(loop, *conn, result, flags);
+                break;
+            case OP_SEND:
+                on_send(loop, *conn, result);
+                break;
+            case OP_PROVIDE:
+                if (result < 0) {
+                    UDS_LOG_ERROR("Failed to provide receive buffers: %s", std::strerror(-result));
+                }
+                break;
+            case OP_CANCEL:
+                // 取消的结果不需要处理，recv本身会以ECANCELED完成
+                break;
+            }
+        }
+    }
+}
+
+void IoUringReactor::arm_accept(Loop& loop) {
+    io_uring_sqe* sqe = loop.ring->get_sqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = loop.listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = OP_ACCEPT;
+}
+
+void IoUringReactor::arm_wakeup(Loop& loop) {
+    io_uring_sqe* sqe = loop.ring->get_sqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = loop.wakeup_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&loop.wakeup_value);
+    sqe->len = sizeof(loop.wakeup_value);
+    sqe->user_data = OP_WAKEUP;
+}
+
+bool IoUringReactor::arm_recv(Loop& loop, Connection& conn) {
+    io_uring_sqe* sqe = loop.ring->get_sqe();
+    if (sqe == nullptr) {
+        UDS_LOG_WARN("io_uring submission queue full, closing client: %s", conn.client_ip.c_str());
+        close_connection(loop, conn);
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = reinterpret_cast<uint64_t>(&conn) | OP_RECV;
+    conn.recv_armed = true;
+    return true;
+}
+
+void IoUringReactor::on_accept(Loop& loop, int result, uint32_t flags) {
+    // multishot accept失效（出错或内核主动结束）时重新提交
+    if (!(flags & IORING_CQE_F_MORE) && is_running_) {
+        arm_accept(loop);
+    }
+    if (result < 0) {
+        if (result != -EINTR && result != -EAGAIN && result != -ECANCELED && is_running_) {
+            UDS_LOG_ERROR("Accept failed: %s", std::strerror(-result));
+        }
+        return;
+    }
+    int client_socket = result;
+    if (!is_running_) {
+        close(client_socket);
+        return;
+    }
+
+    sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    char client_ip[INET_ADDRSTRLEN] = "unknown";
+    if (getpeername(client_socket, reinterpret_cast<struct sockaddr*>(&client_addr), &client_addr_len) == 0) {
+        inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
+    }
+    UDS_LOG_INFO("New client connected: %s", client_ip);
+
+    std::unique_ptr<Connection> conn(new Connection(framing_));
+    conn->fd = client_socket;
+    conn->client_ip = client_ip;
+    conn->channel = std::make_shared<Channel>(framing_, loop, *conn);
+    conn->decoder.set_push_channel(conn->channel.get());
+    Connection& ref = *conn;
+    loop.connections[client_socket] = std::move(conn);
+    Metrics::instance().connection_opened();
+    arm_recv(loop, ref);
+}
+
+void IoUringReactor::on_recv(Loop& loop, Connection& conn, int result, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        conn.recv_armed = false;
+    }
+    if (result > 0) {
+        // 数据在环的缓冲区中，复制进连接的重组缓冲区后立即归还
+        uint16_t id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (!conn.closing && !conn.close_after_flush) {
+            conn.decoder.feed(loop.ring->buffer(id), static_cast<size_t>(result));
+        }
+        loop.ring->provide_buffers(id, 1);
+        Metrics::instance().add_bytes_received(static_cast<size_t>(result));
+    }
+    if (conn.closing) {
+        release_if_idle(loop, conn);
+        return;
+    }
+
+    if (result <= 0 && result != -ENOBUFS && result != -ECANCELED) {
+        if (result == 0) {
+            UDS_LOG_INFO("Client disconnected: %s", conn.client_ip.c_str());
+        } else {
+            UDS_LOG_WARN("Receive failed from client: %s", conn.client_ip.c_str());
+        }
+        close_connection(loop, conn);
+        return;
+    }
+
+    // 暂停读取后、取消生效前收到的数据只放入解码器，恢复读取时再处理
+    if (result > 0 && !conn.close_after_flush && !conn.read_paused) {
+        process_input(loop, conn);
+    }
+    // 缓冲区用尽（ENOBUFS）或内核结束了multishot时重新提交；暂停读取期间由on_send在发出一半后提交
+    if (!conn.recv_armed && !conn.close_after_flush && !conn.read_paused && !arm_recv(loop, conn)) {
+        return;
+    }
+    start_send(loop, conn);
+}
+
+// 重组请求，解码器中的完整请求按顺序处理，响应合并到下一次send
+// 只解码到待发数据达到output_limit为止，剩余的请求留在解码器中，随之暂停读取，发出一半后再处理
+void IoUringReactor::process_input(Loop& loop, Connection& conn) {
+    size_t unsent = unsent_bytes(conn);
+    size_t budget = unsent < options_.output_limit ? options_.output_limit - unsent : 0;
+    if (!process_frames(conn.decoder, handler_, conn.pending_output, budget)) {
+        conn.close_after_flush = true;
+        Metrics::instance().record_invalid_frame();
+        return;
+    }
+    if (!conn.read_paused && unsent_bytes(conn) >= options_.output_limit) {
+        pause_recv(loop, conn);
+    }
+}
+
+// 对端读得比请求产生响应慢：取消连接的multishot recv，内核接收缓冲区写满后由TCP流控让对端停止发送。
+// 取消生效前已收到的数据照常处理
+void IoUringReactor::pause_recv(Loop& loop, Connection& conn) {
+    UDS_LOG_DEBUG("Pausing reads from slow client %s (%zu bytes unsent)", conn.client_ip.c_str(),
+                  unsent_bytes(conn));
+    Metrics::instance().record_read_pause();
+    conn.read_paused = true;
+    if (!conn.recv_armed) {
+        return;
+    }
+    io_uring_sqe* sqe = loop.ring->get_sqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&conn) | OP_RECV;
+    sqe->user_data = OP_CANCEL;
+}
+
+size_t IoUringReactor::unsent_bytes(const Connection& conn) const {
+    return conn.sending.size() - conn.sending_offset + conn.pending_output.size();
+}
+
+// 提交待发数据；同一连接同时只有一个send在途，在途期间产生的响应留在pending_output中，完成后合并发送
+void IoUringReactor::start_send(Loop& loop, Connection& conn) {
+    if (conn.closing || conn.send_inflight) {
+        return;
+    }
+    if (conn.sending_offset == conn.sending.size()) {
+        if (conn.pending_output.empty()) {
+            if (conn.close_after_flush) {
+                close_connection(loop, conn);
+            }
+            return;
+        }
+        conn.sending.clear();
+        conn.sending.swap(conn.pending_output);
+        conn.sending_offset = 0;
+    }
+
+    io_uring_sqe* sqe = loop.ring->get_sqe();
+    if (sqe == nullptr) {
+        UDS_LOG_WARN("io_uring submission queue full, closing client: %s", conn.client_ip.c_str());
+        close_connection(loop, conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn.sending.data() + conn.sending_offset);
+    sqe->len = static_cast<uint32_t>(std::min<size_t>(conn.sending.size() - conn.sending_offset, 0x7FFFF000));
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = reinterpret_cast<uint64_t>(&conn) | OP_SEND;
+    conn.send_inflight = true;
+}
+
+void IoUringReactor::on_send(Loop& loop, Connection& conn, int result) {
+    conn.send_inflight = false;
+    if (conn.closing) {
+        release_if_idle(loop, conn);
+        return;
+    }
+    if (result < 0) {
+        if (result == -EINTR || result == -EAGAIN) {
+            start_send(loop, conn);
+            return;
+        }
+        if (!conn.close_after_flush) {
+            UDS_LOG_WARN("Send failed to client: %s", conn.client_ip.c_str());
+        }
+        close_connection(loop, conn);
+        return;
+    }
+    conn.sending_offset += static_cast<size_t>(result);
+    Metrics::instance().add_bytes_sent(static_cast<size_t>(result));
+    if (conn.read_paused && unsent_bytes(conn) <= options_.output_limit / 2) {
+        // 先处理暂停期间留在解码器中的请求，其响应又达到上限时继续暂停
+        conn.read_paused = false;
+        if (!conn.close_after_flush) {
+            process_input(loop, conn);
+        }
+        if (!conn.recv_armed && !conn.close_after_flush && !conn.read_paused && !arm_recv(loop, conn)) {
+            return;
+        }
+    }
+    start_send(loop, conn);
+}
+
+// 把其他线程推送的数据追加到各连接的输出缓冲区并发送
+void IoUringReactor::drain_pushes(Loop& loop) {
+    {
+        std::lock_guard<std::mutex> lock(loop.push_mutex);
+        loop.push_draining.swap(loop.push_ready);
+    }
+    for (size_t i = 0; i < loop.push_draining.size(); ++i) {
+        Connection* conn = loop.push_draining[i]->drain();
+        if (conn != nullptr) {
+            start_send(loop, *conn);
+        }
+    }
+    loop.push_draining.clear();
+}
+
+// shutdown让在途的recv/send尽快完成；socket等它们都完成后才关闭，避免fd被复用时收到旧操作的完成事件
+void IoUringReactor::close_connection(Loop& loop, Connection& conn) {
+    if (conn.closing) {
+        return;
+    }
+    conn.closing = true;
+    conn.channel->close();
+    shutdown(conn.fd, SHUT_RDWR);
+    release_if_idle(loop, conn);
+}
+
+void IoUringReactor::release_if_idle(Loop& loop, Connection& conn) {
+    if (conn.recv_armed || conn.send_inflight) {
+        return;
+    }
+    int fd = conn.fd;
+    close(fd);
+    loop.connections.erase(fd);
+    Metrics::instance().connection_closed();
+}
+
+#else // !UDS_HAVE_IO_URING
+
+struct IoUringReactor::Ring {
+};
+
+IoUringReactor::Loop::Loop() : index(0), listen_fd(-1), wakeup_fd(-1), wakeup_value(0) {
+}
+
+IoUringReactor::Loop::~Loop() {
+}
+
+IoUringReactor::IoUringReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler)
+    : options_(options), framing_(framing), handler_(handler), is_running_(false) {
+}
+
+IoUringReactor::~IoUringReactor() {
+}
+
+bool IoUringReactor::is_supported() {
+    return false;
+}
+
+bool IoUringReactor::start(const std::vector<int>&) {
+    UDS_LOG_ERROR("io_uring reactor is only available on Linux");
+    return false;
+}
+
+void IoUringReactor::stop() {
+}
+
+#endif // UDS_HAVE_IO_URING
+
+} // namespace uds
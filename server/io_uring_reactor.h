@@ -0,0 +1,108 @@
+#ifndef IO_URING_REACTOR_H
+#define IO_URING_REACTOR_H
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "frame_codec.h"
+#include "reactor_options.h"
+
+namespace uds {
+
+// 基于io_uring的事件驱动服务核心（仅Linux，内核6.0及以上）
+// 与EpollReactor一样由固定数量的事件循环线程服务所有连接，区别在于I/O以提交/完成队列的方式进行：
+//   - 每个循环在共享的监听socket上挂一个multishot accept，新连接不需要重新提交
+//   - 每个连接挂一个multishot recv，数据由内核直接收进循环预先交给它的一组缓冲区（provided buffers），不用每次带缓冲区提交
+//   - 一轮完成事件处理完后，期间产生的send、归还的缓冲区连同其他操作由一次io_uring_enter提交，并同时等待下一批完成事件
+// 流水线负载下一批请求只需一次系统调用，而不是每条请求一对recv/send。
+// 不依赖liburing，直接使用系统调用；响应中的文件片段不走sendfile，文件数据读到响应中。
+// 与EpollReactor一样，各循环可以共享一个监听socket，也可以各自使用一个SO_REUSEPORT监听socket；
+// 连接待发的数据超过options.output_limit时取消该连接的recv，发出一半后重新提交；
+// 一批数据中的请求也只解码到待发数据达到上限为止，其余的留在解码器中，发出一半后先处理它们
+class IoUringReactor {
+public:
+    IoUringReactor(const ReactorOptions& options, FramingMode framing, const RequestHandler& handler);
+    ~IoUringReactor();
+
+    // 当前平台与内核是否支持所需的io_uring功能（multishot accept/recv、provided buffers），启动时实测一次
+    static bool is_supported();
+
+    // 在已处于监听状态的socket上启动所有事件循环
+    // listen_sockets只有一个时所有循环共享，否则须与循环数相同，第i个循环只接受第i个socket上的连接
+    bool start(const std::vector<int>& listen_sockets);
+
+    // 停止所有事件循环并关闭全部客户端连接
+    void stop();
+
+private:
+    class Channel;
+    struct Ring;
+
+    // 单个客户端连接的状态
+    struct Connection {
+        int fd;
+        std::string client_ip;
+        FrameDecoder decoder;                 // 请求重组缓冲区
+        std::vector<uint8_t> pending_output;  // 尚未提交发送的响应数据
+        std::vector<uint8_t> sending;         // 已提交给内核发送的数据，send完成前不能改动
+        size_t sending_offset;
+        bool recv_armed;                      // multishot recv仍在内核中
+        bool send_inflight;
+        bool read_paused;        // 待发数据过多，已取消recv
+        bool close_after_flush;  // 发送完剩余数据后关闭连接
+        bool closing;            // 已shutdown，等在途操作全部完成后关闭socket并释放
+        std::shared_ptr<Channel> channel;     // 推送通道，其他线程推送的数据经它交给事件循环发送
+
+        explicit Connection(FramingMode framing)
+            : fd(-1), decoder(framing), sending_offset(0), recv_armed(false), send_inflight(false),
+              read_paused(false), close_after_flush(false), closing(false) {
+        }
+    };
+
+    // 单个事件循环：一个io_uring实例 + 一个线程
+    struct Loop {
+        size_t index;
+        int listen_fd;
+        std::unique_ptr<Ring> ring;
+        int wakeup_fd;            // eventfd，用于通知循环退出或有推送数据待发送
+        uint64_t wakeup_value;    // eventfd读操作的目标
+        std::thread thread;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::mutex push_mutex;
+        std::vector<std::shared_ptr<Channel>> push_ready;     // 有推送数据待发送的通道
+        std::vector<std::shared_ptr<Channel>> push_draining;  // 仅事件循环线程使用
+
+        Loop();
+        ~Loop();
+    };
+
+    void run_loop(Loop& loop);
+    void on_accept(Loop& loop, int result, uint32_t flags);
+    void on_recv(Loop& loop, Connection& conn, int result, uint32_t flags);
+    void on_send(Loop& loop, Connection& conn, int result);
+    void drain_pushes(Loop& loop);
+    void arm_accept(Loop& loop);
+    bool arm_recv(Loop& loop, Connection& conn);  // 失败时关闭连接，conn可能已释放
+    void arm_wakeup(Loop& loop);
+    void start_send(Loop& loop, Connection& conn);
+    void process_input(Loop& loop, Connection& conn);
+    void pause_recv(Loop& loop, Connection& conn);
+    size_t unsent_bytes(const Connection& conn) const;
+    void close_connection(Loop& loop, Connection& conn);
+    void release_if_idle(Loop& loop, Connection& conn);
+
+    ReactorOptions options_;
+    FramingMode framing_;
+    RequestHandler handler_;
+    std::atomic<bool> is_running_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+} // namespace uds
+
+#endif // IO_URING_REACTOR_H
@@ -0,0 +1,352 @@
+#include "isotp.h"
+#include <cstring>
+#include <algorithm>
+
+namespace uds {
+
+namespace {
+
+// 协议控制信息（首字节高4位）
+const uint8_t PCI_SINGLE_FRAME = 0x0;
+const uint8_t PCI_FIRST_FRAME = 0x1;
+const uint8_t PCI_CONSECUTIVE_FRAME = 0x2;
+const uint8_t PCI_FLOW_CONTROL = 0x3;
+
+// 流控状态
+const uint8_t FLOW_CONTINUE_TO_SEND = 0x0;
+const uint8_t FLOW_WAIT = 0x1;
+const uint8_t FLOW_OVERFLOW = 0x2;
+
+const size_t CAN_DATA_SIZE = 8;
+const size_t SINGLE_FRAME_MAX = 7;
+const size_t CONSECUTIVE_FRAME_DATA = 7;
+const size_t SHORT_FIRST_FRAME_MAX = 4095;   // 12位长度的首帧，更长的报文用32位长度的首帧
+
+} // namespace
+
+IsoTpLayer::IsoTpLayer(CanFrameSink& tx, const IsoTpOptions& options)
+    : tx_(tx), options_(options), now_us_(0) {
+    if (options_.tick_us == 0) {
+        options_.tick_us = 1;
+    }
+}
+
+IsoTpLayer::~IsoTpLayer() {
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        wheel_.cancel(&channels_[i]->tx_timer);
+        wheel_.cancel(&channels_[i]->rx_timer);
+    }
+}
+
+size_t IsoTpLayer::add_channel(uint32_t rx_id, uint32_t tx_id) {
+    if (by_rx_id_.find(rx_id) != by_rx_id_.end()) {
+        return static_cast<size_t>(-1);
+    }
+    std::unique_ptr<Channel> channel(new Channel());
+    channel->index = channels_.size();
+    channel->rx_id = rx_id;
+    channel->tx_id = tx_id;
+    channel->tx_state = TxState::IDLE;
+    channel->tx_offset = 0;
+    channel->tx_sequence = 0;
+    channel->tx_block_size = 0;
+    channel->tx_block_left = 0;
+    channel->tx_st_min_us = 0;
+    channel->tx_timer.channel = channel.get();
+    channel->tx_timer.tx = true;
+    channel->receiving = false;
+    channel->rx_size = 0;
+    channel->rx_offset = 0;
+    channel->rx_sequence = 0;
+    channel->rx_block_left = 0;
+    channel->rx_timer.channel = channel.get();
+    channel->rx_timer.tx = false;
+    by_rx_id_[rx_id] = channel.get();
+    channels_.push_back(std::move(channel));
+    return channels_.size() - 1;
+}
+
+bool IsoTpLayer::send(size_t index, const uint8_t* data, size_t size) {
+    Channel& channel = *channels_[index];
+    if (channel.tx_state != TxState::IDLE || size == 0 || static_cast<uint64_t>(size) > 0xFFFFFFFFULL) {
+        return false;
+    }
+
+    uint8_t frame[CAN_DATA_SIZE];
+    if (size <= SINGLE_FRAME_MAX) {
+        frame[0] = static_cast<uint8_t>((PCI_SINGLE_FRAME << 4) | size);
+        std::memcpy(frame + 1, data, size);
+        transmit(channel.tx_id, frame, 1 + size);
+        ++stats_.messages_sent;
+        return true;
+    }
+
+    size_t header;
+    if (size <= SHORT_FIRST_FRAME_MAX) {
+        frame[0] = static_cast<uint8_t>((PCI_FIRST_FRAME << 4) | (size >> 8));
+        frame[1] = static_cast<uint8_t>(size & 0xFF);
+        header = 2;
+    } else {
+        frame[0] = PCI_FIRST_FRAME << 4;
+        frame[1] = 0;
+        frame[2] = static_cast<uint8_t>(size >> 24);
+        frame[3] = static_cast<uint8_t>(size >> 16);
+        frame[4] = static_cast<uint8_t>(size >> 8);
+        frame[5] = static_cast<uint8_t>(size);
+        header = 6;
+    }
+    std::memcpy(frame + header, data, CAN_DATA_SIZE - header);
+    transmit(channel.tx_id, frame, CAN_DATA_SIZE);
+
+    channel.tx_data.assign(data, data + size);
+    channel.tx_offset = CAN_DATA_SIZE - header;
+    channel.tx_sequence = 1;
+    channel.tx_state = TxState::WAIT_FLOW_CONTROL;
+    schedule(channel.tx_timer, options_.timeout_us);
+    return true;
+}
+
+bool IsoTpLayer::sending(size_t index) const {
+    return channels_[index]->tx_state != TxState::IDLE;
+}
+
+void IsoTpLayer::on_frame(const CanFrame& frame) {
+    ++stats_.frames_received;
+    auto it = by_rx_id_.find(frame.id);
+    if (it == by_rx_id_.end() || frame.dlc == 0) {
+        return;
+    }
+    Channel& channel = *it->second;
+
+    switch (frame.data[0] >> 4) {
+        case PCI_SINGLE_FRAME: {
+            size_t size = frame.data[0] & 0x0F;
+            if (size == 0 || size > SINGLE_FRAME_MAX || frame.dlc < 1 + size) {
+                return;
+            }
+            // 接收多帧报文期间收到单帧：放弃正在接收的报文
+            if (channel.receiving) {
+                wheel_.cancel(&channel.rx_timer);
+                channel.receiving = false;
+                ++stats_.errors;
+            }
+            ++stats_.messages_received;
+            if (handler_) {
+                handler_(channel.index, frame.data + 1, size);
+            }
+            break;
+        }
+
+        case PCI_FIRST_FRAME:
+            on_first_frame(channel, frame);
+            break;
+
+        case PCI_CONSECUTIVE_FRAME:
+            on_consecutive_frame(channel, frame);
+            break;
+
+        case PCI_FLOW_CONTROL:
+            on_flow_control(channel, frame);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IsoTpLayer::on_first_frame(Channel& channel, const CanFrame& frame) {
+    if (frame.dlc < CAN_DATA_SIZE) {
+        return;
+    }
+    const uint8_t* data = frame.data;
+    size_t size = (static_cast<size_t>(data[0] & 0x0F) << 8) | data[1];
+    size_t header = 2;
+    if (size == 0) {
+        size = (static_cast<size_t>(data[2]) << 24) | (static_cast<size_t>(data[3]) << 16) |
+               (static_cast<size_t>(data[4]) << 8) | data[5];
+        header = 6;
+        if (size <= SHORT_FIRST_FRAME_MAX) {
+            return;
+        }
+    } else if (size <= SINGLE_FRAME_MAX) {
+        return;
+    }
+
+    // 新的首帧取代正在接收的报文
+    if (channel.receiving) {
+        wheel_.cancel(&channel.rx_timer);
+        channel.receiving = false;
+        ++stats_.errors;
+    }
+    if (size > options_.max_message_size) {
+        send_flow_control(channel, FLOW_OVERFLOW);
+        ++stats_.errors;
+        return;
+    }
+
+    if (channel.rx_data.size() < size) {
+        channel.rx_data.resize(size);
+    }
+    std::memcpy(channel.rx_data.data(), data + header, CAN_DATA_SIZE - header);
+    channel.rx_size = size;
+    channel.rx_offset = CAN_DATA_SIZE - header;
+    channel.rx_sequence = 1;
+    channel.rx_block_left = options_.block_size;
+    channel.receiving = true;
+    send_flow_control(channel, FLOW_CONTINUE_TO_SEND);
+    schedule(channel.rx_timer, options_.timeout_us);
+}
+
+void IsoTpLayer::on_consecutive_frame(Channel& channel, const CanFrame& frame) {
+    if (!channel.receiving) {
+        return;
+    }
+    size_t chunk = std::min(CONSECUTIVE_FRAME_DATA, channel.rx_size - channel.rx_offset);
+    if ((frame.data[0] & 0x0F) != channel.rx_sequence || frame.dlc < 1 + chunk) {
+        wheel_.cancel(&channel.rx_timer);
+        channel.receiving = false;
+        ++stats_.errors;
+        return;
+    }
+
+    // 直接复制到重组缓冲区中的最终位置
+    std::memcpy(channel.rx_data.data() + channel.rx_offset, frame.data + 1, chunk);
+    channel.rx_offset += chunk;
+    channel.rx_sequence = (channel.rx_sequence + 1) & 0x0F;
+    if (channel.rx_offset == channel.rx_size) {
+        wheel_.cancel(&channel.rx_timer);
+        channel.receiving = false;
+        ++stats_.messages_received;
+        if (handler_) {
+            handler_(channel.index, channel.rx_data.data(), channel.rx_size);
+        }
+        return;
+    }
+
+    if (options_.block_size != 0 && --channel.rx_block_left == 0) {
+        channel.rx_block_left = options_.block_size;
+        send_flow_control(channel, FLOW_CONTINUE_TO_SEND);
+    }
+    schedule(channel.rx_timer, options_.timeout_us);
+}
+
+void IsoTpLayer::on_flow_control(Channel& channel, const CanFrame& frame) {
+    if (channel.tx_state != TxState::WAIT_FLOW_CONTROL || frame.dlc < 3) {
+        return;
+    }
+    uint8_t status = frame.data[0] & 0x0F;
+    if (status == FLOW_WAIT) {
+        schedule(channel.tx_timer, options_.timeout_us);
+        return;
+    }
+    wheel_.cancel(&channel.tx_timer);
+    if (status != FLOW_CONTINUE_TO_SEND) {
+        // 对方溢出或状态无效：放弃发送
+        channel.tx_state = TxState::IDLE;
+        ++stats_.errors;
+        return;
+    }
+
+    channel.tx_block_size = frame.data[1];
+    channel.tx_block_left = frame.data[1];
+    channel.tx_st_min_us = decode_st_min(frame.data[2]);
+    channel.tx_state = TxState::SENDING;
+    send_consecutive_frames(channel);
+}
+
+// STmin为0时一次发完整个块；否则每次发一帧，下一帧由定时器在STmin之后发出
+void IsoTpLayer::send_consecutive_frames(Channel& channel) {
+    uint8_t frame[CAN_DATA_SIZE];
+    while (true) {
+        size_t chunk = std::min(CONSECUTIVE_FRAME_DATA, channel.tx_data.size() - channel.tx_offset);
+        frame[0] = static_cast<uint8_t>((PCI_CONSECUTIVE_FRAME << 4) | channel.tx_sequence);
+        std::memcpy(frame + 1, channel.tx_data.data() + channel.tx_offset, chunk);
+        transmit(channel.tx_id, frame, 1 + chunk);
+        channel.tx_offset += chunk;
+        channel.tx_sequence = (channel.tx_sequence + 1) & 0x0F;
+
+        if (channel.tx_offset == channel.tx_data.size()) {
+            channel.tx_state = TxState::IDLE;
+            ++stats_.messages_sent;
+            return;
+        }
+        if (channel.tx_block_size != 0 && --channel.tx_block_left == 0) {
+            channel.tx_state = TxState::WAIT_FLOW_CONTROL;
+            schedule(channel.tx_timer, options_.timeout_us);
+            return;
+        }
+        if (channel.tx_st_min_us != 0) {
+            schedule(channel.tx_timer, channel.tx_st_min_us);
+            return;
+        }
+    }
+}
+
+void IsoTpLayer::send_flow_control(Channel& channel, uint8_t status) {
+    uint8_t frame[3];
+    frame[0] = static_cast<uint8_t>((PCI_FLOW_CONTROL << 4) | status);
+    frame[1] = options_.block_size;
+    frame[2] = options_.st_min;
+    transmit(channel.tx_id, frame, sizeof(frame));
+}
+
+void IsoTpLayer::transmit(uint32_t id, const uint8_t* data, size_t size) {
+    CanFrame frame;
+    frame.id = id;
+    std::memcpy(frame.data, data, size);
+    if (options_.padding) {
+        std::memset(frame.data + size, options_.padding_byte, CAN_DATA_SIZE - size);
+        frame.dlc = CAN_DATA_SIZE;
+    } else {
+        frame.dlc = static_cast<uint8_t>(size);
+    }
+    ++stats_.frames_sent;
+    tx_.on_frame(frame);
+}
+
+void IsoTpLayer::schedule(ChannelTimer& timer, uint64_t delay_us) {
+    uint64_t ticks = (delay_us + options_.tick_us - 1) / options_.tick_us;
+    wheel_.schedule(&timer, now_us_ / options_.tick_us + (ticks == 0 ? 1 : ticks));
+}
+
+void IsoTpLayer::advance(uint64_t now_us) {
+    if (now_us < now_us_) {
+        return;
+    }
+    now_us_ = now_us;
+    expired_.clear();
+    wheel_.advance(now_us / options_.tick_us, expired_);
+    for (size_t i = 0; i < expired_.size(); ++i) {
+        on_timer(*static_cast<ChannelTimer*>(expired_[i]));
+    }
+}
+
+void IsoTpLayer::on_timer(ChannelTimer& timer) {
+    Channel& channel = *timer.channel;
+    if (timer.tx) {
+        if (channel.tx_state == TxState::SENDING) {
+            send_consecutive_frames(channel);
+        } else if (channel.tx_state == TxState::WAIT_FLOW_CONTROL) {
+            // N_Bs超时
+            channel.tx_state = TxState::IDLE;
+            ++stats_.timeouts;
+        }
+    } else if (channel.receiving) {
+        // N_Cr超时
+        channel.receiving = false;
+        ++stats_.timeouts;
+    }
+}
+
+uint32_t IsoTpLayer::decode_st_min(uint8_t st_min) {
+    if (st_min <= 0x7F) {
+        return static_cast<uint32_t>(st_min) * 1000;
+    }
+    if (st_min >= 0xF1 && st_min <= 0xF9) {
+        return static_cast<uint32_t>(st_min - 0xF0) * 100;
+    }
+    // 保留值按最大的127毫秒处理
+    return 127000;
+}
+
+} // namespace uds
@@ -0,0 +1,139 @@
+#ifndef ISOTP_H
+#define ISOTP_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "can_bus.h"
+#include "timer_wheel.h"
+
+namespace uds {
+
+// ISO-TP参数
+struct IsoTpOptions {
+    uint8_t block_size = 8;             // 接收时在流控帧中给出的BS，0表示发送方不必再等流控
+    uint8_t st_min = 0;                 // 接收时在流控帧中给出的STmin（原始编码：0x00~0x7F毫秒，0xF1~0xF9为100~900微秒）
+    size_t max_message_size = 4095;     // 接收的最大报文长度，超出时回复溢出流控帧
+    bool padding = true;                // 不足8字节的帧是否填充到8字节
+    uint8_t padding_byte = 0xCC;
+    uint32_t timeout_us = 1000000;      // N_Bs（等待流控）与N_Cr（等待连续帧）超时
+    uint32_t tick_us = 100;             // 计时粒度
+};
+
+// ISO-TP统计
+struct IsoTpStats {
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    uint64_t frames_sent;
+    uint64_t frames_received;
+    uint64_t timeouts;      // N_Bs/N_Cr超时而放弃的传输
+    uint64_t errors;        // 序号错误、对方溢出等原因放弃的传输
+
+    IsoTpStats() : messages_sent(0), messages_received(0), frames_sent(0), frames_received(0), timeouts(0), errors(0) {}
+};
+
+// ISO 15765-2传输层（经典CAN、常规寻址）：单帧、首帧/连续帧分段与流控（BS、STmin）
+// 一个实例承载任意多个通道，每个通道是一对CAN ID（接收、发送），收发方向各自独立，可同时进行。
+// 接收时连续帧直接复制到通道的重组缓冲区中的最终位置，完整报文以指向该缓冲区的视图交给处理函数，
+// 缓冲区在报文之间复用；单帧直接从CAN帧中交出，不经过缓冲区。
+// STmin节奏与超时共用一个时间轮，时间由使用者通过advance推进（可以是真实时间，也可以是模拟时间）。
+// 不加锁，由使用者在一个线程中驱动
+class IsoTpLayer : public CanFrameSink {
+public:
+    // 通道收到一条完整报文；data只在调用期间有效
+    typedef std::function<void(size_t channel, const uint8_t* data, size_t size)> MessageHandler;
+
+    explicit IsoTpLayer(CanFrameSink& tx, const IsoTpOptions& options = IsoTpOptions());
+    ~IsoTpLayer();
+
+    void set_handler(const MessageHandler& handler) { handler_ = handler; }
+
+    // 增加一个通道：接收CAN ID为rx_id的帧，从tx_id发出；返回通道号，rx_id已被占用时返回-1
+    size_t add_channel(uint32_t rx_id, uint32_t tx_id);
+
+    // 在通道上发送一条报文；通道正在发送或报文超过4GB时返回false
+    bool send(size_t channel, const uint8_t* data, size_t size);
+
+    // 通道是否有尚未发完的报文
+    bool sending(size_t channel) const;
+
+    // 收到一帧（由总线或CAN接口调用）
+    void on_frame(const CanFrame& frame) override;
+
+    // 把时间推进到now_us（微秒），按STmin发出到时的连续帧并处理超时
+    void advance(uint64_t now_us);
+
+    uint64_t now() const { return now_us_; }
+
+    // 没有等待中的定时器（没有按STmin节奏发送或等待对方的传输）
+    bool timers_idle() const { return wheel_.empty(); }
+
+    const IsoTpStats& stats() const { return stats_; }
+
+private:
+    IsoTpLayer(const IsoTpLayer&);
+    IsoTpLayer& operator=(const IsoTpLayer&);
+
+    enum class TxState : uint8_t {
+        IDLE,
+        WAIT_FLOW_CONTROL,   // 已发出首帧或一个块，等待流控帧
+        SENDING              // 按STmin逐帧发送连续帧
+    };
+
+    struct Channel;
+
+    struct ChannelTimer : TimerWheel::Timer {
+        Channel* channel;
+        bool tx;
+    };
+
+    struct Channel {
+        size_t index;
+        uint32_t rx_id;
+        uint32_t tx_id;
+
+        TxState tx_state;
+        std::vector<uint8_t> tx_data;   // 正在发送的报文，容量在报文之间复用
+        size_t tx_offset;               // 下一个连续帧的数据起点
+        uint8_t tx_sequence;
+        uint8_t tx_block_size;          // 对方流控帧给出的BS与STmin
+        uint8_t tx_block_left;
+        uint32_t tx_st_min_us;
+        ChannelTimer tx_timer;
+
+        bool receiving;
+        std::vector<uint8_t> rx_data;   // 重组缓冲区，只增不减
+        size_t rx_size;
+        size_t rx_offset;
+        uint8_t rx_sequence;
+        uint8_t rx_block_left;
+        ChannelTimer rx_timer;
+    };
+
+    void on_first_frame(Channel& channel, const CanFrame& frame);
+    void on_consecutive_frame(Channel& channel, const CanFrame& frame);
+    void on_flow_control(Channel& channel, const CanFrame& frame);
+    void send_consecutive_frames(Channel& channel);
+    void send_flow_control(Channel& channel, uint8_t status);
+    void transmit(uint32_t id, const uint8_t* data, size_t size);
+    void schedule(ChannelTimer& timer, uint64_t delay_us);
+    void on_timer(ChannelTimer& timer);
+    static uint32_t decode_st_min(uint8_t st_min);
+
+    CanFrameSink& tx_;
+    IsoTpOptions options_;
+    MessageHandler handler_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::unordered_map<uint32_t, Channel*> by_rx_id_;
+    TimerWheel wheel_;
+    uint64_t now_us_;
+    std::vector<TimerWheel::Timer*> expired_;
+    IsoTpStats stats_;
+};
+
+} // namespace uds
+
+#endif // ISOTP_H
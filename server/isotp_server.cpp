@@ -0,0 +1,45 @@
+#include "isotp_server.h"
+
+namespace uds {
+
+namespace {
+
+// CAN通道的连接号置最高位，与TCP连接的连接号区分（会话等按连接区分的状态不会串）
+const uint32_t CONNECTION_ID_BASE = 0x80000000u;
+
+} // namespace
+
+IsoTpServer::IsoTpServer(EcuGateway& gateway, CanFrameSink& tx, const IsoTpOptions& options)
+    : gateway_(gateway), layer_(tx, options), dropped_(0) {
+    layer_.set_handler([this](size_t channel, const uint8_t* data, size_t size) {
+        on_message(channel, data, size);
+    });
+}
+
+size_t IsoTpServer::add_route(uint32_t rx_id, uint32_t tx_id, uint16_t ecu_address, uint16_t tester_address) {
+    size_t channel = layer_.add_channel(rx_id, tx_id);
+    if (channel == static_cast<size_t>(-1)) {
+        return channel;
+    }
+    Route route;
+    route.ecu_address = ecu_address;
+    route.tester_address = tester_address;
+    routes_.push_back(route);
+    return channel;
+}
+
+// 请求直接从ISO-TP的重组缓冲区交给ECU，响应编码到复用的缓冲区后由传输层复制进通道的发送缓冲区
+void IsoTpServer::on_message(size_t channel, const uint8_t* data, size_t size) {
+    const Route& route = routes_[channel];
+    RequestContext context;
+    context.connection_id = CONNECTION_ID_BASE | static_cast<uint32_t>(channel);
+    context.tester_address = route.tester_address;
+    context.ecu_address = route.ecu_address;
+    response_.clear();
+    if (!gateway_.process_request(context, data, size, response_) ||
+        (!response_.empty() && !layer_.send(channel, response_.data(), response_.size()))) {
+        ++dropped_;
+    }
+}
+
+} // namespace uds
@@ -0,0 +1,49 @@
+#ifndef ISOTP_SERVER_H
+#define ISOTP_SERVER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "isotp.h"
+#include "ecu_gateway.h"
+
+namespace uds {
+
+// 经ISO-TP（CAN）访问网关中的ECU：每条路由是一对CAN ID，收到的完整请求交给对应ECU处理，
+// 响应从同一通道分段发回。与TCP传输共用同一个网关和各项服务；CAN上不能主动推送，
+// 需要推送通道的服务（0x2A、交给工作线程池的服务）按不支持推送的连接处理。不加锁
+class IsoTpServer {
+public:
+    IsoTpServer(EcuGateway& gateway, CanFrameSink& tx, const IsoTpOptions& options = IsoTpOptions());
+
+    // 登记一条路由：rx_id上的请求发往ecu_address上的ECU，请求方记为tester_address，响应从tx_id发出。
+    // 返回通道号，rx_id已被占用时返回-1
+    size_t add_route(uint32_t rx_id, uint32_t tx_id, uint16_t ecu_address, uint16_t tester_address);
+
+    // 传输层，总线把各路由的rx_id上的帧交给它，使用者用它推进时间
+    IsoTpLayer& layer() { return layer_; }
+
+    // 因网关中没有目标ECU或通道仍在发送上一条响应而丢弃的请求数
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    IsoTpServer(const IsoTpServer&);
+    IsoTpServer& operator=(const IsoTpServer&);
+
+    struct Route {
+        uint16_t ecu_address;
+        uint16_t tester_address;
+    };
+
+    void on_message(size_t channel, const uint8_t* data, size_t size);
+
+    EcuGateway& gateway_;
+    IsoTpLayer layer_;
+    std::vector<Route> routes_;
+    std::vector<uint8_t> response_;   // 响应缓冲区，在请求之间复用
+    uint64_t dropped_;
+};
+
+} // namespace uds
+
+#endif // ISOTP_SERVER_H
@@ -0,0 +1,105 @@
+#include "latency_histogram.h"
+#include <algorithm>
+
+namespace uds {
+
+const unsigned LatencyHistogram::SUB_BUCKET_BITS;
+const size_t LatencyHistogram::SUB_BUCKET_COUNT;
+const size_t LatencyHistogram::SUB_BUCKET_HALF;
+const unsigned LatencyHistogram::MAX_SHIFT;
+const size_t LatencyHistogram::BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(BUCKET_COUNT, 0),
+      count_(0),
+      min_(UINT64_MAX),
+      max_(0),
+      sum_(0) {
+}
+
+// 小于128的值直接作为下标；更大的值按最高位确定区间，保留最高7位作为子桶
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    unsigned msb = 63;
+    while ((value >> msb) == 0) {
+        --msb;
+    }
+    unsigned shift = msb - (SUB_BUCKET_BITS - 1);
+    if (shift > MAX_SHIFT) {
+        return BUCKET_COUNT - 1;
+    }
+    size_t sub_bucket = static_cast<size_t>(value >> shift);  // [64, 128)
+    return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + (sub_bucket - SUB_BUCKET_HALF);
+}
+
+uint64_t LatencyHistogram::bucket_value(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    size_t offset = index - SUB_BUCKET_COUNT;
+    unsigned shift = static_cast<unsigned>(offset / SUB_BUCKET_HALF) + 1;
+    uint64_t sub_bucket = SUB_BUCKET_HALF + offset % SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    ++counts_[bucket_index(value)];
+    ++count_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += static_cast<double>(value);
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    if (count == 0) {
+        return;
+    }
+    counts_[bucket_index(value)] += count;
+    count_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+    sum_ = 0;
+}
+
+double LatencyHistogram::mean() const {
+    return count_ > 0 ? sum_ / static_cast<double>(count_) : 0;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    // 第一个累计数量达到目标的子桶
+    uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+    target = std::max<uint64_t>(1, std::min(target, count_));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(bucket_value(i), max_);
+        }
+    }
+    return max_;
+}
+
+} // namespace uds
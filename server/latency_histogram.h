@@ -0,0 +1,61 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace uds {
+
+// HDR风格的对数-线性直方图，记录纳秒级延迟
+// 每个2的幂区间再均分为64个子桶，任意值的相对误差不超过1/64（约1.6%），
+// 覆盖1ns到2^41ns（约36分钟）；记录一次只是一次下标计算和一次自增，不分配内存
+class LatencyHistogram {
+private:
+    static const unsigned SUB_BUCKET_BITS = 7;  // 小于128的值精确记录
+    static const size_t SUB_BUCKET_COUNT = static_cast<size_t>(1) << SUB_BUCKET_BITS;
+    static const size_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static const unsigned MAX_SHIFT = 34;
+
+public:
+    // 子桶总数；多线程并发计数时可以在外部按子桶累加，再用record(bucket_value(i), n)汇总
+    static const size_t BUCKET_COUNT = SUB_BUCKET_COUNT + MAX_SHIFT * SUB_BUCKET_HALF;
+
+    LatencyHistogram();
+
+    // 值所在子桶的下标
+    static size_t bucket_index(uint64_t value);
+
+    // 子桶的上界
+    static uint64_t bucket_value(size_t index);
+
+    // 记录一个值（纳秒）
+    void record(uint64_t value);
+
+    // 记录count个相同的值
+    void record(uint64_t value, uint64_t count);
+
+    // 合并另一个直方图
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ > 0 ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const;
+
+    // 第percentile百分位（0~100）的值，返回所在子桶的上界
+    uint64_t percentile(double percentile) const;
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+};
+
+} // namespace uds
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,401 @@
+#include "live_did.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace uds {
+
+const size_t LiveDidSource::MAX_VALUE_SIZE;
+const uint32_t LiveDidSource::DEFAULT_TICK_MS;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const uint64_t NO_TICK = 0xFFFFFFFFull;   // 缓存中尚无值时的节拍号
+const uint64_t MAX_CATCH_UP_TICKS = 1024;  // 随机游走一次最多补算的节拍数
+
+bool parse_hex_did(const std::string& text, DID& did) {
+    char* end = nullptr;
+    unsigned long value = std::strtoul(text.c_str(), &end, 16);
+    if (text.empty() || *end != '\0' || value > 0xFFFF) {
+        return false;
+    }
+    did = static_cast<DID>(value);
+    return true;
+}
+
+bool is_absolute_path(const std::string& path) {
+    if (!path.empty() && (path[0] == '/' || path[0] == '\\')) {
+        return true;
+    }
+    return path.size() > 1 && path[1] == ':';
+}
+
+// 读取数值参数；缺少且没有默认值时报错
+bool get_number(const std::map<std::string, std::string>& params, const std::string& key,
+                double& value, bool required, std::string& error) {
+    std::map<std::string, std::string>::const_iterator it = params.find(key);
+    if (it == params.end()) {
+        if (required) {
+            error = "missing parameter '" + key + "'";
+        }
+        return !required;
+    }
+    char* end = nullptr;
+    value = std::strtod(it->second.c_str(), &end);
+    if (it->second.empty() || *end != '\0') {
+        error = "invalid value for '" + key + "': " + it->second;
+        return false;
+    }
+    return true;
+}
+
+class RampSignal : public SignalModel {
+public:
+    RampSignal(double min, double max, double period_s) : min_(min), max_(max), period_s_(period_s) {}
+
+    double sample(uint64_t, double time_s) override {
+        double phase = std::fmod(time_s, period_s_) / period_s_;
+        return min_ + (max_ - min_) * phase;
+    }
+
+private:
+    double min_;
+    double max_;
+    double period_s_;
+};
+
+class SineSignal : public SignalModel {
+public:
+    SineSignal(double min, double max, double period_s) : min_(min), max_(max), period_s_(period_s) {}
+
+    double sample(uint64_t, double time_s) override {
+        double middle = (min_ + max_) / 2;
+        return middle + (max_ - min_) / 2 * std::sin(2 * PI * time_s / period_s_);
+    }
+
+private:
+    double min_;
+    double max_;
+    double period_s_;
+};
+
+// 每个节拍的增量由xorshift生成，同一种子的序列可重现；
+// 长时间没有读取时只补算最近MAX_CATCH_UP_TICKS个节拍，之前的节拍视为没有变化
+class RandomWalkSignal : public SignalModel {
+public:
+    RandomWalkSignal(double min, double max, double step, double start, uint32_t seed)
+        : min_(min), max_(max), step_(step), value_(start), state_(seed != 0 ? seed : 1), tick_(0) {}
+
+    double sample(uint64_t tick, double) override {
+        uint64_t steps = tick > tick_ ? tick - tick_ : 0;
+        if (steps > MAX_CATCH_UP_TICKS) {
+            steps = MAX_CATCH_UP_TICKS;
+        }
+        for (uint64_t i = 0; i < steps; ++i) {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            double unit = static_cast<double>(state_) / 4294967295.0;   // [0, 1]
+            value_ = std::min(max_, std::max(min_, value_ + (unit * 2 - 1) * step_));
+        }
+        tick_ = std::max(tick_, tick);
+        return value_;
+    }
+
+private:
+    double min_;
+    double max_;
+    double step_;
+    double value_;
+    uint32_t state_;
+    uint64_t tick_;
+};
+
+// 回放CSV：第0列为时间（秒，递增），取时间不晚于当前时刻的最后一行
+class CsvSignal : public SignalModel {
+public:
+    CsvSignal(const std::vector<double>& times, const std::vector<double>& values, bool loop)
+        : times_(times), values_(values), loop_(loop) {}
+
+    double sample(uint64_t, double time_s) override {
+        double duration = times_.back();
+        if (loop_ && duration > 0 && time_s >= duration) {
+            time_s = std::fmod(time_s, duration);
+        }
+        size_t row = static_cast<size_t>(std::upper_bound(times_.begin(), times_.end(), time_s) - times_.begin());
+        return values_[row > 0 ? row - 1 : 0];
+    }
+
+private:
+    std::vector<double> times_;
+    std::vector<double> values_;
+    bool loop_;
+};
+
+std::unique_ptr<SignalModel> load_csv_signal(const std::string& path, size_t column, bool loop, std::string& error) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return std::unique_ptr<SignalModel>();
+    }
+
+    // 无法解析为数字的行（如表头）被跳过
+    std::vector<double> times;
+    std::vector<double> values;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<double> fields;
+        std::istringstream iss(line);
+        std::string field;
+        bool numeric = true;
+        while (std::getline(iss, field, ',')) {
+            char* end = nullptr;
+            double value = std::strtod(field.c_str(), &end);
+            while (*end == ' ' || *end == '\t' || *end == '\r') {
+                ++end;
+            }
+            if (end == field.c_str() || *end != '\0') {
+                numeric = false;
+                break;
+            }
+            fields.push_back(value);
+        }
+        if (!numeric || fields.size() <= column) {
+            continue;
+        }
+        if (!times.empty() && fields[0] < times.back()) {
+            error = path + ": time column must not decrease";
+            return std::unique_ptr<SignalModel>();
+        }
+        times.push_back(fields[0]);
+        values.push_back(fields[column]);
+    }
+    if (times.empty()) {
+        error = path + ": no numeric rows with column " + std::to_string(column);
+        return std::unique_ptr<SignalModel>();
+    }
+    return std::unique_ptr<SignalModel>(new CsvSignal(times, values, loop));
+}
+
+} // namespace
+
+std::unique_ptr<SignalModel> create_signal_model(const std::string& type,
+                                                 const std::map<std::string, std::string>& params,
+                                                 const std::string& base_dir, std::string& error) {
+    double min = 0;
+    double max = 0;
+    if (type == "ramp" || type == "sine") {
+        double period_s = 0;
+        if (!get_number(params, "min", min, true, error) || !get_number(params, "max", max, true, error) ||
+            !get_number(params, "period-s", period_s, true, error)) {
+            return std::unique_ptr<SignalModel>();
+        }
+        if (period_s <= 0) {
+            error = "period-s must be positive";
+            return std::unique_ptr<SignalModel>();
+        }
+        if (type == "ramp") {
+            return std::unique_ptr<SignalModel>(new RampSignal(min, max, period_s));
+        }
+        return std::unique_ptr<SignalModel>(new SineSignal(min, max, period_s));
+    }
+
+    if (type == "random-walk") {
+        double step = 0;
+        double seed = 1;
+        if (!get_number(params, "min", min, true, error) || !get_number(params, "max", max, true, error) ||
+            !get_number(params, "step", step, true, error)) {
+            return std::unique_ptr<SignalModel>();
+        }
+        double start = (min + max) / 2;
+        if (!get_number(params, "start", start, false, error) || !get_number(params, "seed", seed, false, error)) {
+            return std::unique_ptr<SignalModel>();
+        }
+        if (max < min || step < 0) {
+            error = "random-walk requires min <= max and step >= 0";
+            return std::unique_ptr<SignalModel>();
+        }
+        return std::unique_ptr<SignalModel>(new RandomWalkSignal(min, max, step, start, static_cast<uint32_t>(seed)));
+    }
+
+    if (type == "csv") {
+        std::map<std::string, std::string>::const_iterator file = params.find("file");
+        if (file == params.end()) {
+            error = "missing parameter 'file'";
+            return std::unique_ptr<SignalModel>();
+        }
+        double column = 1;
+        double loop = 1;
+        if (!get_number(params, "column", column, false, error) || !get_number(params, "loop", loop, false, error)) {
+            return std::unique_ptr<SignalModel>();
+        }
+        if (column < 1) {
+            error = "column must be at least 1 (column 0 is the time)";
+            return std::unique_ptr<SignalModel>();
+        }
+        std::string path = is_absolute_path(file->second) ? file->second : base_dir + file->second;
+        return load_csv_signal(path, static_cast<size_t>(column), loop != 0, error);
+    }
+
+    error = "unknown signal model '" + type + "'";
+    return std::unique_ptr<SignalModel>();
+}
+
+LiveDidSource::LiveDidSource(DidSource& inner)
+    : inner_(inner), start_time_(Clock::now()), index_(65536, 0) {
+}
+
+LiveDidSource::~LiveDidSource() {
+}
+
+bool LiveDidSource::add(DID did, std::unique_ptr<SignalModel> model, size_t size, uint32_t tick_ms,
+                        std::string& error) {
+    if (index_[did] != 0) {
+        error = "DID is already live";
+        return false;
+    }
+    if (size != 1 && size != 2 && size != 4) {
+        error = "size must be 1, 2 or 4";
+        return false;
+    }
+    if (tick_ms == 0) {
+        error = "tick-ms must be positive";
+        return false;
+    }
+    if (dids_.size() >= 0xFFFF) {
+        error = "too many live DIDs";
+        return false;
+    }
+
+    std::unique_ptr<LiveDid> live(new LiveDid());
+    live->did = did;
+    live->size = size;
+    live->tick_ns = static_cast<uint64_t>(tick_ms) * 1000000;
+    live->model = std::move(model);
+    live->cache.store(NO_TICK << 32, std::memory_order_relaxed);
+    dids_.push_back(std::move(live));
+    index_[did] = static_cast<uint16_t>(dids_.size());
+    return true;
+}
+
+bool LiveDidSource::load_config(const std::string& path, std::string& error) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        error = "cannot open live DID config " + path;
+        return false;
+    }
+
+    std::string base_dir;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        base_dir = path.substr(0, slash + 1);
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::string location = path + ":" + std::to_string(line_number) + ": ";
+        std::istringstream iss(line);
+        std::string did_text;
+        std::string type;
+        if (!(iss >> did_text) || did_text[0] == '#') {
+            continue;
+        }
+        DID did;
+        if (!parse_hex_did(did_text, did) || !(iss >> type)) {
+            error = location + "expected '<DID> <model> [key=value ...]'";
+            return false;
+        }
+
+        std::map<std::string, std::string> params;
+        std::string param;
+        while (iss >> param && param[0] != '#') {
+            size_t eq = param.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                error = location + "expected key=value, got '" + param + "'";
+                return false;
+            }
+            params[param.substr(0, eq)] = param.substr(eq + 1);
+        }
+
+        double size = 2;
+        double tick_ms = DEFAULT_TICK_MS;
+        if (!get_number(params, "size", size, false, error) || !get_number(params, "tick-ms", tick_ms, false, error)) {
+            error = location + error;
+            return false;
+        }
+        params.erase("size");
+        params.erase("tick-ms");
+
+        std::unique_ptr<SignalModel> model = create_signal_model(type, params, base_dir, error);
+        if (!model || !add(did, std::move(model), static_cast<size_t>(size), static_cast<uint32_t>(tick_ms), error)) {
+            error = location + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t LiveDidSource::current_value(LiveDid& live) const {
+    uint64_t tick = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start_time_).count()) / live.tick_ns;
+    uint64_t tag = tick & 0xFFFFFFFF;
+
+    // 本节拍已计算过时直接使用缓存
+    uint64_t cached = live.cache.load(std::memory_order_acquire);
+    if (cached >> 32 == tag) {
+        return static_cast<uint32_t>(cached);
+    }
+
+    std::lock_guard<std::mutex> lock(live.sample_mutex);
+    cached = live.cache.load(std::memory_order_relaxed);
+    if (cached >> 32 == tag) {
+        return static_cast<uint32_t>(cached);
+    }
+    double time_s = static_cast<double>(tick) * static_cast<double>(live.tick_ns) / 1e9;
+    double value = live.model->sample(tick, time_s);
+
+    // 四舍五入后限制在编码范围内
+    double limit = live.size == 4 ? 4294967295.0 : static_cast<double>((1u << (8 * live.size)) - 1);
+    double rounded = std::floor(value + 0.5);
+    uint32_t raw = rounded <= 0 ? 0 : rounded >= limit ? static_cast<uint32_t>(limit) : static_cast<uint32_t>(rounded);
+    live.cache.store((tag << 32) | raw, std::memory_order_release);
+    return raw;
+}
+
+size_t LiveDidSource::read_dids(DidLookup* lookups, size_t count) const {
+    // 先交给被包装的数据源，再用实时值替换
+    size_t found = inner_.read_dids(lookups, count);
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t index = index_[lookups[i].did];
+        if (index == 0) {
+            continue;
+        }
+        LiveDid& live = *dids_[index - 1];
+        uint32_t raw = current_value(live);
+        DidValueView& view = lookups[i].view;
+        view.data_ = nullptr;
+        view.size_ = live.size;
+        for (size_t b = 0; b < live.size; ++b) {
+            view.inline_[b] = static_cast<uint8_t>(raw >> (8 * (live.size - 1 - b)));
+        }
+        if (!lookups[i].found) {
+            lookups[i].found = true;
+            ++found;
+        }
+    }
+    return found;
+}
+
+bool LiveDidSource::write_did(DID did, const uint8_t* data, size_t size) {
+    if (index_[did] != 0) {
+        return false;
+    }
+    return inner_.write_did(did, data, size);
+}
+
+} // namespace uds
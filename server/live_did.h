@@ -0,0 +1,91 @@
+#ifndef LIVE_DID_H
+#define LIVE_DID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "uds_protocol.h"
+#include "did_store.h"
+#include "did_source.h"
+
+namespace uds {
+
+// 信号模型：按节拍计算信号的原始值（编码前）
+class SignalModel {
+public:
+    virtual ~SignalModel() {}
+
+    // 计算第tick个节拍（距开始time_s秒）的值；同一DID的调用已串行化，tick单调不减
+    virtual double sample(uint64_t tick, double time_s) = 0;
+};
+
+// 按名称和参数创建信号模型，csv文件的相对路径相对于base_dir：
+//   ramp         min max period-s         锯齿波，每个周期从min线性升到max
+//   sine         min max period-s         正弦波，在min与max之间摆动
+//   random-walk  min max step [start] [seed]  每个节拍随机增减不超过step，限制在[min, max]内
+//   csv          file [column] [loop]     按第0列的时间（秒）回放第column列（默认1），默认循环
+std::unique_ptr<SignalModel> create_signal_model(const std::string& type,
+                                                 const std::map<std::string, std::string>& params,
+                                                 const std::string& base_dir, std::string& error);
+
+// 实时计算的DID
+// 包装另一个DID数据源，登记的DID不读存储，而是在被读取时由信号模型计算：
+// 时间按节拍划分，同一节拍内只计算一次，结果与节拍号一起存放在一个原子字中，
+// 命中缓存的读取不加锁；没有被读取的DID不产生任何开销。其余DID原样交给被包装的数据源
+class LiveDidSource : public DidSource {
+public:
+    static const size_t MAX_VALUE_SIZE = 4;      // 值按无符号大端编码为1、2或4字节
+    static const uint32_t DEFAULT_TICK_MS = 100;
+
+    explicit LiveDidSource(DidSource& inner);
+    ~LiveDidSource();
+
+    // 登记一个实时DID
+    bool add(DID did, std::unique_ptr<SignalModel> model, size_t size, uint32_t tick_ms, std::string& error);
+
+    // 按配置文件登记实时DID，每行一项：
+    //   <DID（十六进制）> <模型> [key=value ...]
+    // 除模型参数外，size=1|2|4指定编码字节数（默认2），tick-ms=N指定节拍（默认100）；
+    // 空行和#开头的行被忽略
+    bool load_config(const std::string& path, std::string& error);
+
+    size_t read_dids(DidLookup* lookups, size_t count) const override;
+
+    // 实时DID只读，写入返回false
+    bool write_did(DID did, const uint8_t* data, size_t size) override;
+
+    size_t size() const { return dids_.size(); }
+
+private:
+    LiveDidSource(const LiveDidSource&);
+    LiveDidSource& operator=(const LiveDidSource&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct LiveDid {
+        DID did;
+        size_t size;
+        uint64_t tick_ns;
+        std::unique_ptr<SignalModel> model;
+        std::atomic<uint64_t> cache;   // 高32位为节拍号（低32位），低32位为编码后的值
+        std::mutex sample_mutex;       // 串行化模型计算
+    };
+
+    // 取得当前节拍的值，必要时计算并更新缓存
+    uint32_t current_value(LiveDid& live) const;
+
+    DidSource& inner_;
+    Clock::time_point start_time_;
+    std::vector<std::unique_ptr<LiveDid>> dids_;
+    std::vector<uint16_t> index_;      // 按DID直接索引，0表示不是实时DID，否则为dids_下标+1
+};
+
+} // namespace uds
+
+#endif // LIVE_DID_H
@@ -0,0 +1,278 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+namespace uds {
+
+const uint32_t LogRateLimiter::MESSAGES_PER_SECOND;
+const size_t Logger::RECORD_TEXT_SIZE;
+const size_t Logger::RING_CAPACITY;
+const int Logger::FLUSH_INTERVAL_MS;
+
+namespace {
+
+const char* level_name(int level) {
+    static const char* names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+    return (level >= 0 && level <= 5) ? names[level] : "?";
+}
+
+void shutdown_at_exit() {
+    Logger::instance().shutdown();
+}
+
+} // namespace
+
+bool parse_log_level(const std::string& name, LogLevel& level) {
+    if (name == "trace") {
+        level = LogLevel::TRACE;
+    } else if (name == "debug") {
+        level = LogLevel::DEBUG;
+    } else if (name == "info") {
+        level = LogLevel::INFO;
+    } else if (name == "warn") {
+        level = LogLevel::WARN;
+    } else if (name == "error") {
+        level = LogLevel::ERR;
+    } else if (name == "off") {
+        level = LogLevel::OFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool LogRateLimiter::allow(uint64_t& suppressed) {
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    uint64_t window = window_.load(std::memory_order_relaxed);
+    if (window != now && window_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+    if (count_.fetch_add(1, std::memory_order_relaxed) < MESSAGES_PER_SECOND) {
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+// 线程退出时归还本线程的缓冲区，未写出的日志仍由刷新线程写出
+struct LogRingHolder {
+    Logger::Ring* ring;
+
+    LogRingHolder() : ring(nullptr) {}
+
+    ~LogRingHolder() {
+        if (ring != nullptr) {
+            Logger::instance().release_ring(ring);
+        }
+    }
+};
+
+namespace {
+
+thread_local LogRingHolder tls_ring;
+
+} // namespace
+
+Logger::Ring::Ring() : reported_dropped(0), next(nullptr) {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    in_use.store(false, std::memory_order_relaxed);
+}
+
+Logger& Logger::instance() {
+    // 有意不析构，避免与线程局部缓冲区的析构顺序冲突；退出时由atexit写出剩余日志
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : level_(static_cast<int>(LogLevel::INFO)), rings_(nullptr), stopping_(false) {
+    flush_thread_ = std::thread(&Logger::flush_loop, this);
+    std::atexit(shutdown_at_exit);
+}
+
+Logger::Ring* Logger::acquire_ring() {
+    // 优先复用已退出线程留下的缓冲区
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        bool expected = false;
+        if (!ring->in_use.load(std::memory_order_relaxed) &&
+            ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return ring;
+        }
+    }
+
+    // 没有空闲缓冲区时新建并挂到链表头部，缓冲区永不释放
+    Ring* ring = new Ring();
+    ring->in_use.store(true, std::memory_order_relaxed);
+    Ring* head = rings_.load(std::memory_order_relaxed);
+    do {
+        ring->next = head;
+    } while (!rings_.compare_exchange_weak(head, ring, std::memory_order_release,
+                                           std::memory_order_relaxed));
+    return ring;
+}
+
+void Logger::release_ring(Ring* ring) {
+    ring->in_use.store(false, std::memory_order_release);
+}
+
+Logger::Ring* Logger::current_ring() {
+    if (tls_ring.ring == nullptr) {
+        tls_ring.ring = acquire_ring();
+    }
+    return tls_ring.ring;
+}
+
+void Logger::log(LogLevel level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(level, 0, format, args);
+    va_end(args);
+}
+
+void Logger::log_limited(LogLevel level, uint64_t suppressed, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(level, suppressed, format, args);
+    va_end(args);
+}
+
+// 在调用线程上格式化到缓冲区的空闲槽位中，缓冲区满时丢弃
+void Logger::vlog(LogLevel level, uint64_t suppressed, const char* format, va_list args) {
+    Ring* ring = current_ring();
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= RING_CAPACITY) {
+        ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring->records[tail % RING_CAPACITY];
+    record.timestamp_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    record.level = static_cast<uint8_t>(level);
+
+    int length = std::vsnprintf(record.text, RECORD_TEXT_SIZE, format, args);
+    size_t size = length < 0 ? 0 : std::min(static_cast<size_t>(length), RECORD_TEXT_SIZE - 1);
+    if (suppressed > 0 && size < RECORD_TEXT_SIZE - 1) {
+        int extra = std::snprintf(record.text + size, RECORD_TEXT_SIZE - size,
+                                  " (%llu similar message(s) suppressed)",
+                                  static_cast<unsigned long long>(suppressed));
+        if (extra > 0) {
+            size = std::min(size + static_cast<size_t>(extra), RECORD_TEXT_SIZE - 1);
+        }
+    }
+    record.length = static_cast<uint16_t>(size);
+
+    ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+void Logger::flush_loop() {
+    std::unique_lock<std::mutex> lock(flush_mutex_);
+    while (!stopping_) {
+        flush_cv_.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void Logger::flush() {
+    drain();
+}
+
+void Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        flush_cv_.notify_all();
+    }
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+    drain();
+}
+
+// 收集所有缓冲区中的日志，按时间排序后每个输出流一次写出
+void Logger::drain() {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+
+    struct Line {
+        uint64_t timestamp_us;
+        int level;
+        std::string text;
+    };
+    std::vector<Line> lines;
+
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const Record& record = ring->records[head % RING_CAPACITY];
+            Line line;
+            line.timestamp_us = record.timestamp_us;
+            line.level = record.level;
+            line.text.assign(record.text, record.length);
+            lines.push_back(line);
+        }
+        ring->head.store(head, std::memory_order_release);
+
+        uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped != ring->reported_dropped) {
+            Line line;
+            line.timestamp_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            line.level = static_cast<int>(LogLevel::WARN);
+            line.text = std::to_string(dropped - ring->reported_dropped) + " log message(s) dropped (buffer full)";
+            ring->reported_dropped = dropped;
+            lines.push_back(line);
+        }
+    }
+    if (lines.empty()) {
+        return;
+    }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+        return a.timestamp_us < b.timestamp_us;
+    });
+
+    std::string out;
+    std::string err;
+    char prefix[64];
+    for (size_t i = 0; i < lines.size(); ++i) {
+        std::time_t seconds = static_cast<std::time_t>(lines[i].timestamp_us / 1000000);
+        std::tm local_time;
+        #ifdef _WIN32
+        localtime_s(&local_time, &seconds);
+        #else
+        localtime_r(&seconds, &local_time);
+        #endif
+        size_t n = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local_time);
+        std::snprintf(prefix + n, sizeof(prefix) - n, ".%03u [%s] ",
+                      static_cast<unsigned>(lines[i].timestamp_us / 1000 % 1000), level_name(lines[i].level));
+
+        std::string& target = lines[i].level >= static_cast<int>(LogLevel::WARN) ? err : out;
+        target += prefix;
+        target += lines[i].text;
+        target += '\n';
+    }
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stderr);
+    }
+}
+
+} // namespace uds
@@ -0,0 +1,185 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "cache_aligned.h"
+
+// 编译期最低日志级别：0=TRACE 1=DEBUG 2=INFO 3=WARN 4=ERROR 5=关闭
+// 低于该级别的UDS_LOG_*调用展开为空语句，参数也不会被求值
+#ifndef UDS_LOG_MIN_LEVEL
+#define UDS_LOG_MIN_LEVEL 1
+#endif
+
+#if defined(__GNUC__)
+#define UDS_LOG_PRINTF_FORMAT(fmt_index, args_index) __attribute__((format(printf, fmt_index, args_index)))
+#else
+#define UDS_LOG_PRINTF_FORMAT(fmt_index, args_index)
+#endif
+
+namespace uds {
+
+enum class LogLevel : int {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERR = 4,      // 不用ERROR：Windows头文件中ERROR是宏
+    OFF = 5
+};
+
+// 解析日志级别名称（trace/debug/info/warn/error/off）
+bool parse_log_level(const std::string& name, LogLevel& level);
+
+// 单个调用点的限速：每秒最多放行若干条，其余计数后丢弃，
+// 下一条放行的日志附带被丢弃的条数。可常量初始化，作为调用点内的静态变量没有初始化开销
+class LogRateLimiter {
+public:
+    static const uint32_t MESSAGES_PER_SECOND = 10;
+
+    constexpr LogRateLimiter() : window_(0), count_(0), suppressed_(0) {}
+
+    // 是否放行本条日志；放行时suppressed返回此前被丢弃的条数
+    bool allow(uint64_t& suppressed);
+
+private:
+    std::atomic<uint64_t> window_;   // 当前计数窗口（秒）
+    std::atomic<uint32_t> count_;
+    std::atomic<uint64_t> suppressed_;
+};
+
+// 异步日志
+// 每个线程把格式化好的日志写入自己的无锁环形缓冲区（单生产者单消费者），不加锁也不做I/O；
+// 后台线程定期收集所有缓冲区，按时间排序后批量写到stdout（INFO及以下）和stderr（WARN及以上）。
+// 缓冲区满时丢弃新日志并计数，请求处理线程永远不会因为终端或管道阻塞
+class Logger {
+public:
+    static const size_t RECORD_TEXT_SIZE = 232;  // 单条日志正文上限，超出部分截断
+    static const size_t RING_CAPACITY = 256;     // 每个线程缓冲的日志条数
+    static const int FLUSH_INTERVAL_MS = 20;
+
+    static Logger& instance();
+
+    // 运行期日志级别，低于编译期级别时按编译期级别处理
+    void set_level(LogLevel level) {
+        int value = static_cast<int>(level) < UDS_LOG_MIN_LEVEL ? UDS_LOG_MIN_LEVEL : static_cast<int>(level);
+        level_.store(value, std::memory_order_relaxed);
+    }
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    void log(LogLevel level, const char* format, ...) UDS_LOG_PRINTF_FORMAT(3, 4);
+
+    // 附带被限速丢弃的条数
+    void log_limited(LogLevel level, uint64_t suppressed, const char* format, ...) UDS_LOG_PRINTF_FORMAT(4, 5);
+
+    // 立即写出所有已缓冲的日志
+    void flush();
+
+    // 停止后台线程并写出剩余日志（进程退出时自动调用）
+    void shutdown();
+
+private:
+    struct Record {
+        uint64_t timestamp_us;  // 墙上时间，微秒
+        uint8_t level;
+        uint8_t reserved;
+        uint16_t length;
+        char text[RECORD_TEXT_SIZE];
+    };
+
+    // 单生产者（所属线程）单消费者（刷新线程）环形缓冲区，堆上按缓存行对齐分配
+    struct Ring : CacheAligned {
+        alignas(64) std::atomic<uint64_t> head;   // 消费者位置
+        alignas(64) std::atomic<uint64_t> tail;   // 生产者位置
+        std::atomic<uint64_t> dropped;            // 缓冲区满时丢弃的条数，只有所属线程写入
+        uint64_t reported_dropped;                // 已报告的丢弃条数，只有消费者访问
+        std::atomic<bool> in_use;
+        Ring* next;
+        Record records[RING_CAPACITY];
+
+        Ring();
+    };
+
+    Logger();
+    Logger(const Logger&);
+    Logger& operator=(const Logger&);
+
+    void vlog(LogLevel level, uint64_t suppressed, const char* format, va_list args);
+    Ring* acquire_ring();
+    void release_ring(Ring* ring);
+    Ring* current_ring();
+    void flush_loop();
+    void drain();
+
+    std::atomic<int> level_;
+    std::atomic<Ring*> rings_;
+    std::mutex drain_mutex_;   // 串行化消费者（刷新线程与显式flush）
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    bool stopping_;
+    std::thread flush_thread_;
+
+    friend struct LogRingHolder;
+};
+
+} // namespace uds
+
+#define UDS_LOG_AT(level, ...) \
+    do { \
+        if (::uds::Logger::instance().enabled(level)) { \
+            ::uds::Logger::instance().log(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+// 同一调用点每秒最多输出LogRateLimiter::MESSAGES_PER_SECOND条
+#define UDS_LOG_AT_LIMITED(level, ...) \
+    do { \
+        if (::uds::Logger::instance().enabled(level)) { \
+            static ::uds::LogRateLimiter uds_log_limiter; \
+            uint64_t uds_log_suppressed; \
+            if (uds_log_limiter.allow(uds_log_suppressed)) { \
+                ::uds::Logger::instance().log_limited(level, uds_log_suppressed, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#if UDS_LOG_MIN_LEVEL <= 0
+#define UDS_LOG_TRACE(...) UDS_LOG_AT(::uds::LogLevel::TRACE, __VA_ARGS__)
+#else
+#define UDS_LOG_TRACE(...) do {} while (0)
+#endif
+
+#if UDS_LOG_MIN_LEVEL <= 1
+#define UDS_LOG_DEBUG(...) UDS_LOG_AT(::uds::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define UDS_LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if UDS_LOG_MIN_LEVEL <= 2
+#define UDS_LOG_INFO(...) UDS_LOG_AT(::uds::LogLevel::INFO, __VA_ARGS__)
+#else
+#define UDS_LOG_INFO(...) do {} while (0)
+#endif
+
+// WARN/ERROR按调用点限速，避免连接风暴或磁盘故障时刷屏
+#if UDS_LOG_MIN_LEVEL <= 3
+#define UDS_LOG_WARN(...) UDS_LOG_AT_LIMITED(::uds::LogLevel::WARN, __VA_ARGS__)
+#else
+#define UDS_LOG_WARN(...) do {} while (0)
+#endif
+
+#if UDS_LOG_MIN_LEVEL <= 4
+#define UDS_LOG_ERROR(...) UDS_LOG_AT_LIMITED(::uds::LogLevel::ERR, __VA_ARGS__)
+#else
+#define UDS_LOG_ERROR(...) do {} while (0)
+#endif
+
+#endif // LOGGER_H
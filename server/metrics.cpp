@@ -0,0 +1,336 @@
+#include "metrics.h"
+#include "uds_protocol.h"
+#include <iomanip>
+#include <sstream>
+
+namespace uds {
+
+const size_t MetricsSnapshot::SERVICE_COUNT;
+const size_t Metrics::SERVICE_COUNT;
+
+namespace {
+
+const uint8_t NEGATIVE_RESPONSE_SID = 0x7F;
+
+const size_t OTHER_SERVICE = MetricsSnapshot::SERVICE_COUNT - 1;
+
+// 各分类对应的服务ID，下标即分类编号
+const ServiceID CLASSIFIED_SERVICES[OTHER_SERVICE] = {
+    ServiceID::DIAGNOSTIC_SESSION_CONTROL,
+    ServiceID::READ_DATA_BY_IDENTIFIER,
+    ServiceID::READ_DATA_BY_PERIODIC_IDENTIFIER,
+    ServiceID::DYNAMICALLY_DEFINE_DATA_IDENTIFIER,
+    ServiceID::WRITE_DATA_BY_IDENTIFIER,
+    ServiceID::REQUEST_DOWNLOAD,
+    ServiceID::REQUEST_UPLOAD,
+    ServiceID::TRANSFER_DATA,
+    ServiceID::REQUEST_TRANSFER_EXIT,
+    ServiceID::TESTER_PRESENT
+};
+
+// 服务ID到分类的256项查找表，每次记录只需一次下标访问
+struct ServiceClassTable {
+    uint8_t classes[256];
+
+    ServiceClassTable() {
+        for (size_t i = 0; i < 256; ++i) {
+            classes[i] = static_cast<uint8_t>(OTHER_SERVICE);
+        }
+        for (size_t i = 0; i < OTHER_SERVICE; ++i) {
+            classes[static_cast<uint8_t>(CLASSIFIED_SERVICES[i])] = static_cast<uint8_t>(i);
+        }
+    }
+};
+
+const ServiceClassTable service_classes;
+
+std::string format_hex(uint8_t value) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << static_cast<int>(value);
+    return oss.str();
+}
+
+} // namespace
+
+// 线程退出时归还本线程的槽位，计数保留
+struct MetricsSlotHolder {
+    Metrics::Slot* slot;
+
+    MetricsSlotHolder() : slot(nullptr) {}
+
+    ~MetricsSlotHolder() {
+        if (slot != nullptr) {
+            Metrics::instance().release_slot(slot);
+        }
+    }
+};
+
+namespace {
+
+thread_local MetricsSlotHolder tls_slot;
+
+} // namespace
+
+MetricsSnapshot::MetricsSnapshot()
+    : nrc_counts(256, 0),
+      latency(SERVICE_COUNT),
+      unrouted_requests(0),
+      invalid_frames(0),
+      read_pauses(0),
+      slow_client_disconnects(0),
+      pushes_dropped(0),
+      push_overflow_disconnects(0),
+      bytes_received(0),
+      bytes_sent(0),
+      connections_opened(0),
+      connections_closed(0),
+      uptime_s(0) {
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        requests[i] = 0;
+        negative_responses[i] = 0;
+    }
+}
+
+const char* MetricsSnapshot::service_name(size_t service) {
+    static const char* names[SERVICE_COUNT] = {
+        "0x10", "0x22", "0x2A", "0x2C", "0x2E", "0x34", "0x35", "0x36", "0x37", "0x3E", "other"
+    };
+    return names[service];
+}
+
+size_t MetricsSnapshot::classify_service(uint8_t service_id) {
+    return service_classes.classes[service_id];
+}
+
+std::string MetricsSnapshot::to_text() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    oss << "uds_uptime_seconds " << uptime_s << "\n";
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        oss << "uds_requests_total{service=\"" << service_name(i) << "\"} " << requests[i] << "\n";
+    }
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        oss << "uds_negative_responses_total{service=\"" << service_name(i) << "\"} " << negative_responses[i] << "\n";
+    }
+    for (size_t nrc = 0; nrc < nrc_counts.size(); ++nrc) {
+        if (nrc_counts[nrc] > 0) {
+            oss << "uds_nrc_total{nrc=\"" << format_hex(static_cast<uint8_t>(nrc)) << "\"} " << nrc_counts[nrc] << "\n";
+        }
+    }
+    oss << "uds_unrouted_requests_total " << unrouted_requests << "\n";
+    oss << "uds_invalid_frames_total " << invalid_frames << "\n";
+    oss << "uds_read_pauses_total " << read_pauses << "\n";
+    oss << "uds_slow_client_disconnects_total " << slow_client_disconnects << "\n";
+    oss << "uds_pushes_dropped_total " << pushes_dropped << "\n";
+    oss << "uds_push_overflow_disconnects_total " << push_overflow_disconnects << "\n";
+    oss << "uds_bytes_received_total " << bytes_received << "\n";
+    oss << "uds_bytes_sent_total " << bytes_sent << "\n";
+    oss << "uds_connections_total " << connections_opened << "\n";
+    oss << "uds_connections_active " << active_connections() << "\n";
+
+    const double percentiles[] = {50, 90, 99, 99.9};
+    const char* labels[] = {"0.5", "0.9", "0.99", "0.999"};
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        const LatencyHistogram& histogram = latency[i];
+        for (size_t p = 0; p < 4; ++p) {
+            oss << "uds_request_latency_us{service=\"" << service_name(i) << "\",quantile=\"" << labels[p] << "\"} "
+                << histogram.percentile(percentiles[p]) / 1000.0 << "\n";
+        }
+        oss << "uds_request_latency_us_max{service=\"" << service_name(i) << "\"} " << histogram.max() / 1000.0 << "\n";
+        oss << "uds_request_latency_us_count{service=\"" << service_name(i) << "\"} " << histogram.count() << "\n";
+    }
+    return oss.str();
+}
+
+std::string MetricsSnapshot::to_json() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    oss << "{\n  \"uptime_s\": " << uptime_s << ",\n";
+    oss << "  \"services\": {\n";
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        const LatencyHistogram& histogram = latency[i];
+        oss << "    \"" << service_name(i) << "\": {\"requests\": " << requests[i]
+            << ", \"negative_responses\": " << negative_responses[i]
+            << ", \"latency_us\": {\"mean\": " << histogram.mean() / 1000.0
+            << ", \"p50\": " << histogram.percentile(50) / 1000.0
+            << ", \"p90\": " << histogram.percentile(90) / 1000.0
+            << ", \"p99\": " << histogram.percentile(99) / 1000.0
+            << ", \"p999\": " << histogram.percentile(99.9) / 1000.0
+            << ", \"max\": " << histogram.max() / 1000.0 << "}}"
+            << (i + 1 < SERVICE_COUNT ? "," : "") << "\n";
+    }
+    oss << "  },\n  \"nrc\": {";
+    bool first = true;
+    for (size_t nrc = 0; nrc < nrc_counts.size(); ++nrc) {
+        if (nrc_counts[nrc] > 0) {
+            oss << (first ? "" : ", ") << "\"" << format_hex(static_cast<uint8_t>(nrc)) << "\": " << nrc_counts[nrc];
+            first = false;
+        }
+    }
+    oss << "},\n";
+    oss << "  \"unrouted_requests\": " << unrouted_requests << ",\n";
+    oss << "  \"invalid_frames\": " << invalid_frames << ",\n";
+    oss << "  \"read_pauses\": " << read_pauses << ",\n";
+    oss << "  \"slow_client_disconnects\": " << slow_client_disconnects << ",\n";
+    oss << "  \"pushes_dropped\": " << pushes_dropped << ",\n";
+    oss << "  \"push_overflow_disconnects\": " << push_overflow_disconnects << ",\n";
+    oss << "  \"bytes_received\": " << bytes_received << ",\n";
+    oss << "  \"bytes_sent\": " << bytes_sent << ",\n";
+    oss << "  \"connections_total\": " << connections_opened << ",\n";
+    oss << "  \"connections_active\": " << active_connections() << "\n";
+    oss << "}\n";
+    return oss.str();
+}
+
+Metrics::Slot::Slot() : next(nullptr) {
+    in_use.store(false, std::memory_order_relaxed);
+    for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+        requests[i].store(0, std::memory_order_relaxed);
+        negative_responses[i].store(0, std::memory_order_relaxed);
+        for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b) {
+            latency[i][b].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (size_t i = 0; i < 256; ++i) {
+        nrc_counts[i].store(0, std::memory_order_relaxed);
+    }
+    unrouted_requests.store(0, std::memory_order_relaxed);
+    invalid_frames.store(0, std::memory_order_relaxed);
+    read_pauses.store(0, std::memory_order_relaxed);
+    slow_client_disconnects.store(0, std::memory_order_relaxed);
+    pushes_dropped.store(0, std::memory_order_relaxed);
+    push_overflow_disconnects.store(0, std::memory_order_relaxed);
+    bytes_received.store(0, std::memory_order_relaxed);
+    bytes_sent.store(0, std::memory_order_relaxed);
+    connections_opened.store(0, std::memory_order_relaxed);
+    connections_closed.store(0, std::memory_order_relaxed);
+}
+
+Metrics& Metrics::instance() {
+    // 有意不析构，避免与线程局部槽位的析构顺序冲突
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::Metrics()
+    : slots_(nullptr), start_time_(Clock::now()) {
+}
+
+Metrics::Slot* Metrics::acquire_slot() {
+    // 优先复用已退出线程留下的槽位
+    for (Slot* slot = slots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+        bool expected = false;
+        if (!slot->in_use.load(std::memory_order_relaxed) &&
+            slot->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return slot;
+        }
+    }
+
+    // 没有空闲槽位时新建并挂到链表头部，槽位永不释放
+    Slot* slot = new Slot();
+    slot->in_use.store(true, std::memory_order_relaxed);
+    Slot* head = slots_.load(std::memory_order_relaxed);
+    do {
+        slot->next = head;
+    } while (!slots_.compare_exchange_weak(head, slot, std::memory_order_release,
+                                           std::memory_order_relaxed));
+    return slot;
+}
+
+void Metrics::release_slot(Slot* slot) {
+    slot->in_use.store(false, std::memory_order_release);
+}
+
+Metrics::Slot* Metrics::current_slot() {
+    if (tls_slot.slot == nullptr) {
+        tls_slot.slot = acquire_slot();
+    }
+    return tls_slot.slot;
+}
+
+void Metrics::record_request(uint8_t service_id, const uint8_t* response, size_t response_size,
+                             uint64_t latency_ns) {
+    Slot* slot = current_slot();
+    size_t service = MetricsSnapshot::classify_service(service_id);
+    add(slot->requests[service], 1);
+    if (response_size >= 3 && response[0] == NEGATIVE_RESPONSE_SID) {
+        add(slot->negative_responses[service], 1);
+        add(slot->nrc_counts[response[2]], 1);
+    }
+    add(slot->latency[service][LatencyHistogram::bucket_index(latency_ns)], 1);
+}
+
+void Metrics::record_unrouted_request() {
+    add(current_slot()->unrouted_requests, 1);
+}
+
+void Metrics::record_invalid_frame() {
+    add(current_slot()->invalid_frames, 1);
+}
+
+void Metrics::record_read_pause() {
+    add(current_slot()->read_pauses, 1);
+}
+
+void Metrics::record_slow_client_disconnect() {
+    add(current_slot()->slow_client_disconnects, 1);
+}
+
+void Metrics::record_push_dropped() {
+    add(current_slot()->pushes_dropped, 1);
+}
+
+void Metrics::record_push_overflow_disconnect() {
+    add(current_slot()->push_overflow_disconnects, 1);
+}
+
+void Metrics::add_bytes_received(size_t bytes) {
+    add(current_slot()->bytes_received, bytes);
+}
+
+void Metrics::add_bytes_sent(size_t bytes) {
+    add(current_slot()->bytes_sent, bytes);
+}
+
+void Metrics::connection_opened() {
+    add(current_slot()->connections_opened, 1);
+}
+
+void Metrics::connection_closed() {
+    add(current_slot()->connections_closed, 1);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.uptime_s = std::chrono::duration<double>(Clock::now() - start_time_).count();
+
+    for (Slot* slot = slots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+        for (size_t i = 0; i < SERVICE_COUNT; ++i) {
+            snapshot.requests[i] += slot->requests[i].load(std::memory_order_relaxed);
+            snapshot.negative_responses[i] += slot->negative_responses[i].load(std::memory_order_relaxed);
+            // 子桶内的值按子桶上界计入，误差与直方图本身的精度相同
+            for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b) {
+                uint64_t count = slot->latency[i][b].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    snapshot.latency[i].record(LatencyHistogram::bucket_value(b), count);
+                }
+            }
+        }
+        for (size_t nrc = 0; nrc < 256; ++nrc) {
+            snapshot.nrc_counts[nrc] += slot->nrc_counts[nrc].load(std::memory_order_relaxed);
+        }
+        snapshot.unrouted_requests += slot->unrouted_requests.load(std::memory_order_relaxed);
+        snapshot.invalid_frames += slot->invalid_frames.load(std::memory_order_relaxed);
+        snapshot.read_pauses += slot->read_pauses.load(std::memory_order_relaxed);
+        snapshot.slow_client_disconnects += slot->slow_client_disconnects.load(std::memory_order_relaxed);
+        snapshot.pushes_dropped += slot->pushes_dropped.load(std::memory_order_relaxed);
+        snapshot.push_overflow_disconnects += slot->push_overflow_disconnects.load(std::memory_order_relaxed);
+        snapshot.bytes_received += slot->bytes_received.load(std::memory_order_relaxed);
+        snapshot.bytes_sent += slot->bytes_sent.load(std::memory_order_relaxed);
+        snapshot.connections_opened += slot->connections_opened.load(std::memory_order_relaxed);
+        snapshot.connections_closed += slot->connections_closed.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+} // namespace uds
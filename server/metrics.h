@@ -0,0 +1,126 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "latency_histogram.h"
+#include "cache_aligned.h"
+
+namespace uds {
+
+// 某一时刻的指标汇总
+struct MetricsSnapshot {
+    // 按服务分类：服务端实现的每个服务各一类，其余归入"其他"
+    static const size_t SERVICE_COUNT = 11;
+
+    uint64_t requests[SERVICE_COUNT];
+    uint64_t negative_responses[SERVICE_COUNT];
+    std::vector<uint64_t> nrc_counts;            // 按NRC（0x00~0xFF）统计的负响应数量
+    std::vector<LatencyHistogram> latency;       // 各服务分类的处理耗时（纳秒）
+    uint64_t unrouted_requests;                  // 目标地址未知、没有ECU处理的请求
+    uint64_t invalid_frames;                     // 分帧错误导致断开的次数
+    uint64_t read_pauses;                        // 连接的未发出数据达到上限、暂停读取的次数
+    uint64_t slow_client_disconnects;            // 发送超时断开的慢客户端数
+    uint64_t pushes_dropped;                     // 排队超过上限而丢弃推送数据（0x2A周期数据）的次数
+    uint64_t push_overflow_disconnects;          // 不能丢弃的推送数据（0x78及最终响应）排不下而断开的连接数
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t connections_opened;
+    uint64_t connections_closed;
+    double uptime_s;
+
+    MetricsSnapshot();
+
+    static const char* service_name(size_t service);
+
+    // 服务ID所属的分类
+    static size_t classify_service(uint8_t service_id);
+
+    uint64_t active_connections() const {
+        return connections_opened >= connections_closed ? connections_opened - connections_closed : 0;
+    }
+
+    // 纯文本格式（每行一个"名称{标签} 值"）
+    std::string to_text() const;
+
+    // JSON格式
+    std::string to_json() const;
+};
+
+// 运行时指标，进程内全局唯一
+// 每个线程写自己的计数槽位：只有所属线程写入，用relaxed原子读写即可，不加锁也不争用缓存行；
+// 读取时遍历所有槽位求和，开销只在读取方。槽位在线程退出后保留计数并供新线程复用
+class Metrics {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static Metrics& instance();
+
+    // 记录一次请求：服务ID、响应报文（用于识别负响应及NRC）和处理耗时
+    void record_request(uint8_t service_id, const uint8_t* response, size_t response_size, uint64_t latency_ns);
+
+    void record_unrouted_request();
+    void record_invalid_frame();
+    void record_read_pause();
+    void record_slow_client_disconnect();
+    void record_push_dropped();
+    void record_push_overflow_disconnect();
+    void add_bytes_received(size_t bytes);
+    void add_bytes_sent(size_t bytes);
+    void connection_opened();
+    void connection_closed();
+
+    // 汇总所有线程的计数
+    MetricsSnapshot snapshot() const;
+
+private:
+    static const size_t SERVICE_COUNT = MetricsSnapshot::SERVICE_COUNT;
+
+    // 每个线程一个槽位，按缓存行对齐（堆上分配同样对齐）
+    struct alignas(64) Slot : CacheAligned {
+        std::atomic<bool> in_use;
+        Slot* next;
+        std::atomic<uint64_t> requests[SERVICE_COUNT];
+        std::atomic<uint64_t> negative_responses[SERVICE_COUNT];
+        std::atomic<uint64_t> nrc_counts[256];
+        std::atomic<uint64_t> latency[SERVICE_COUNT][LatencyHistogram::BUCKET_COUNT];
+        std::atomic<uint64_t> unrouted_requests;
+        std::atomic<uint64_t> invalid_frames;
+        std::atomic<uint64_t> read_pauses;
+        std::atomic<uint64_t> slow_client_disconnects;
+        std::atomic<uint64_t> pushes_dropped;
+        std::atomic<uint64_t> push_overflow_disconnects;
+        std::atomic<uint64_t> bytes_received;
+        std::atomic<uint64_t> bytes_sent;
+        std::atomic<uint64_t> connections_opened;
+        std::atomic<uint64_t> connections_closed;
+
+        Slot();
+    };
+
+    Metrics();
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+
+    Slot* acquire_slot();
+    void release_slot(Slot* slot);
+    Slot* current_slot();
+
+    // 只有所属线程写入，读-改-写不需要原子指令
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<Slot*> slots_;
+    Clock::time_point start_time_;
+
+    friend struct MetricsSlotHolder;
+};
+
+} // namespace uds
+
+#endif // METRICS_H
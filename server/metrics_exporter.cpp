@@ -0,0 +1,195 @@
+#include "metrics_exporter.h"
+#include "metrics.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef SOCKET SocketType;
+    #define INVALID_SOCKET_VALUE INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SocketType;
+    #define INVALID_SOCKET_VALUE -1
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+namespace uds {
+
+namespace {
+
+bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void send_all(SocketType sock, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        int sent = send(sock, data.data() + offset, static_cast<int>(data.size() - offset), 0);
+        if (sent <= 0) {
+            return;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+}
+
+std::string http_response(const char* status, const char* content_type, const std::string& body) {
+    return std::string("HTTP/1.0 ") + status + "\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+MetricsExporter::MetricsExporter(const MetricsExportOptions& options)
+    : options_(options), is_running_(false), listen_socket_(static_cast<int>(INVALID_SOCKET_VALUE)) {
+    // 运行时长从服务端创建时算起
+    Metrics::instance();
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start() {
+    is_running_ = true;
+
+    if (options_.http_port > 0) {
+        SocketType sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock == INVALID_SOCKET_VALUE) {
+            UDS_LOG_ERROR("Failed to create metrics socket");
+            return false;
+        }
+        int opt = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt));
+
+        // 只对本机开放
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(options_.http_port));
+        if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(sock, 5) < 0) {
+            UDS_LOG_ERROR("Failed to listen on metrics port %d", options_.http_port);
+            CLOSE_SOCKET(sock);
+            return false;
+        }
+        listen_socket_ = static_cast<int>(sock);
+        http_thread_ = std::thread(&MetricsExporter::serve_http, this);
+        UDS_LOG_INFO("Metrics available at http://127.0.0.1:%d/metrics", options_.http_port);
+    }
+
+    if (!options_.dump_file_path.empty()) {
+        dump_thread_ = std::thread(&MetricsExporter::dump_loop, this);
+    }
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (!is_running_.exchange(false)) {
+        return;
+    }
+
+    if (listen_socket_ != static_cast<int>(INVALID_SOCKET_VALUE)) {
+        #ifndef _WIN32
+        shutdown(listen_socket_, SHUT_RDWR);
+        #endif
+        CLOSE_SOCKET(static_cast<SocketType>(listen_socket_));
+        listen_socket_ = static_cast<int>(INVALID_SOCKET_VALUE);
+    }
+    if (http_thread_.joinable()) {
+        http_thread_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dump_mutex_);
+        dump_cv_.notify_all();
+    }
+    if (dump_thread_.joinable()) {
+        dump_thread_.join();
+    }
+}
+
+void MetricsExporter::serve_http() {
+    while (is_running_) {
+        SocketType client = accept(static_cast<SocketType>(listen_socket_), nullptr, nullptr);
+        if (client == INVALID_SOCKET_VALUE) {
+            continue;
+        }
+        handle_http_client(static_cast<int>(client));
+        CLOSE_SOCKET(client);
+    }
+}
+
+// 只读取请求行，按路径返回对应格式
+void MetricsExporter::handle_http_client(int client_socket) {
+    SocketType client = static_cast<SocketType>(client_socket);
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n") == std::string::npos && request.size() < 4096) {
+        int received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    std::string line = request.substr(0, request.find("\r\n"));
+    if (line.compare(0, 4, "GET ") != 0) {
+        send_all(client, http_response("405 Method Not Allowed", "text/plain", "GET only\n"));
+        return;
+    }
+    std::string path = line.substr(4, line.find(' ', 4) - 4);
+    if (path == "/metrics") {
+        send_all(client, http_response("200 OK", "text/plain; charset=utf-8",
+                                       Metrics::instance().snapshot().to_text()));
+    } else if (path == "/metrics.json") {
+        send_all(client, http_response("200 OK", "application/json",
+                                       Metrics::instance().snapshot().to_json()));
+    } else {
+        send_all(client, http_response("404 Not Found", "text/plain", "try /metrics or /metrics.json\n"));
+    }
+}
+
+void MetricsExporter::dump_loop() {
+    std::unique_lock<std::mutex> lock(dump_mutex_);
+    while (is_running_) {
+        dump_cv_.wait_for(lock, std::chrono::milliseconds(options_.dump_interval_ms),
+                          [this]() { return !is_running_; });
+        // 停止时也写一次，保留最终计数
+        if (!write_dump_file()) {
+            UDS_LOG_ERROR("Failed to write metrics file: %s", options_.dump_file_path.c_str());
+        }
+    }
+}
+
+// 先写临时文件再改名，读取方不会看到写了一半的文件
+bool MetricsExporter::write_dump_file() {
+    MetricsSnapshot snapshot = Metrics::instance().snapshot();
+    std::string content = ends_with(options_.dump_file_path, ".json") ? snapshot.to_json() : snapshot.to_text();
+
+    std::string temp_path = options_.dump_file_path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    #ifdef _WIN32
+    std::remove(options_.dump_file_path.c_str());
+    #endif
+    return std::rename(temp_path.c_str(), options_.dump_file_path.c_str()) == 0;
+}
+
+} // namespace uds
@@ -0,0 +1,48 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace uds {
+
+// 指标导出参数
+struct MetricsExportOptions {
+    int http_port = 0;              // 本地HTTP端点端口（只监听127.0.0.1），0表示不启用
+    std::string dump_file_path;     // 定期写入的指标文件，为空表示不启用；以.json结尾时写JSON，否则写纯文本
+    int dump_interval_ms = 10000;
+};
+
+// 把Metrics的汇总结果导出到本地HTTP端点和/或定期写入的文件
+//   GET /metrics      纯文本
+//   GET /metrics.json JSON
+// 汇总只在导出时进行，不影响请求处理线程
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsExportOptions& options);
+    ~MetricsExporter();
+
+    bool start();
+    void stop();
+
+private:
+    void serve_http();
+    void handle_http_client(int client_socket);
+    void dump_loop();
+    bool write_dump_file();
+
+    MetricsExportOptions options_;
+    std::atomic<bool> is_running_;
+    int listen_socket_;
+    std::thread http_thread_;
+    std::thread dump_thread_;
+    std::mutex dump_mutex_;
+    std::condition_variable dump_cv_;
+};
+
+} // namespace uds
+
+#endif // METRICS_EXPORTER_H
@@ -0,0 +1,443 @@
+#include "periodic_scheduler.h"
+#include "uds_service.h"
+#include "push_channel.h"
+#include "frame_codec.h"
+#include "frame_capture.h"
+#include "did_store.h"
+#include "epoch.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace uds {
+
+namespace {
+
+// 调度线程批量读取DID的临时数组
+thread_local std::vector<DidLookup> t_lookups;
+
+bool less_pointer(const void* a, const void* b) {
+    return std::less<const void*>()(a, b);
+}
+
+} // namespace
+
+bool PeriodicScheduler::GroupKey::operator<(const GroupKey& other) const {
+    if (service != other.service) {
+        return less_pointer(service, other.service);
+    }
+    if (did != other.did) {
+        return did < other.did;
+    }
+    return rate < other.rate;
+}
+
+bool PeriodicScheduler::SubscriptionKey::operator<(const SubscriptionKey& other) const {
+    if (channel != other.channel) {
+        return less_pointer(channel, other.channel);
+    }
+    if (service != other.service) {
+        return less_pointer(service, other.service);
+    }
+    if (tester_address != other.tester_address) {
+        return tester_address < other.tester_address;
+    }
+    return pdid < other.pdid;
+}
+
+PeriodicScheduler::PeriodicScheduler(const PeriodicSchedulerOptions& options)
+    : options_(options),
+      tick_ns_(static_cast<uint64_t>(options.tick_ms == 0 ? 1 : options.tick_ms) * 1000000ULL),
+      running_(false),
+      epoch_(Clock::now()) {
+}
+
+PeriodicScheduler::~PeriodicScheduler() {
+    stop();
+    for (auto& entry : subscriptions_) {
+        delete entry.second;
+    }
+    for (auto& entry : groups_) {
+        wheel_.cancel(entry.second);
+        delete entry.second;
+    }
+    for (auto& entry : clients_) {
+        delete entry.second;
+    }
+    free_retired();
+}
+
+bool PeriodicScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return true;
+    }
+    running_ = true;
+    thread_ = std::thread(&PeriodicScheduler::run, this);
+    return true;
+}
+
+void PeriodicScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PeriodicScheduler::subscribe(const UdsService& service, const RequestContext& context, uint8_t pdid,
+                                  PeriodicRate rate) {
+    std::shared_ptr<PushChannel> channel = context.channel->shared_from_this();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    SubscriptionKey key = {context.channel, &service, context.tester_address, pdid};
+    auto existing = subscriptions_.find(key);
+    if (existing != subscriptions_.end()) {
+        if (existing->second->group->rate == rate) {
+            return;
+        }
+        remove(existing);
+    }
+
+    Client*& client = clients_[context.channel];
+    if (client == nullptr) {
+        client = new Client();
+        client->channel = channel;
+        client->subscriptions = 0;
+        client->closed = false;
+        client->batch_tick = std::numeric_limits<uint64_t>::max();
+        client->batch_index = 0;
+    }
+
+    DID did = static_cast<DID>(0xF200 | pdid);
+    GroupKey group_key = {&service, did, rate};
+    Group*& group = groups_[group_key];
+    bool was_idle = wheel_.empty();
+    if (group == nullptr) {
+        group = new Group();
+        group->service = &service;
+        group->did = did;
+        group->rate = rate;
+        // 相位只取决于ECU和DID，与速率无关
+        uint64_t hash = (reinterpret_cast<uintptr_t>(&service) >> 4) * 0x9E3779B97F4A7C15ULL + did * 0x85EBCA6BULL;
+        group->phase = static_cast<uint32_t>(hash >> 32);
+
+        // 空闲期间时间轮没有推进，先跳到当前节拍
+        uint64_t now = tick_at(Clock::now());
+        if (was_idle) {
+            std::vector<TimerWheel::Timer*> none;
+            wheel_.advance(now, none);
+        }
+        // 至少隔一个节拍，让正响应先发出
+        wheel_.schedule(group, next_due(*group, now + 1));
+    }
+
+    Subscription* subscription = new Subscription();
+    subscription->group = group;
+    subscription->index = group->subscribers.size();
+    subscription->client = client;
+    subscription->connection_id = context.connection_id;
+    subscription->tester_address = context.tester_address;
+    subscription->ecu_address = context.ecu_address;
+    subscription->protocol_version = context.protocol_version;
+    group->subscribers.push_back(subscription);
+    ++client->subscriptions;
+    subscriptions_[key] = subscription;
+
+    if (was_idle) {
+        wakeup_.notify_all();
+    }
+}
+
+void PeriodicScheduler::unsubscribe(const UdsService& service, const RequestContext& context, uint8_t pdid) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SubscriptionKey key = {context.channel, &service, context.tester_address, pdid};
+    auto it = subscriptions_.find(key);
+    if (it != subscriptions_.end()) {
+        remove(it);
+    }
+}
+
+void PeriodicScheduler::unsubscribe_all(const UdsService& service, const RequestContext& context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SubscriptionKey first = {context.channel, &service, context.tester_address, 0};
+    auto it = subscriptions_.lower_bound(first);
+    while (it != subscriptions_.end() && it->first.channel == context.channel &&
+           it->first.service == &service && it->first.tester_address == context.tester_address) {
+        remove(it++);
+    }
+}
+
+size_t PeriodicScheduler::subscription_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriptions_.size();
+}
+
+PeriodicSchedulerStats PeriodicScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PeriodicScheduler::remove(std::map<SubscriptionKey, Subscription*>::iterator it) {
+    Subscription* subscription = it->second;
+    subscriptions_.erase(it);
+
+    // 从组中移除：与最后一个交换后弹出
+    Group* group = subscription->group;
+    Subscription* last = group->subscribers.back();
+    group->subscribers[subscription->index] = last;
+    last->index = subscription->index;
+    group->subscribers.pop_back();
+    if (group->subscribers.empty()) {
+        wheel_.cancel(group);
+        groups_.erase(GroupKey{group->service, group->did, group->rate});
+        retired_groups_.push_back(group);
+    }
+
+    Client* client = subscription->client;
+    if (--client->subscriptions == 0) {
+        clients_.erase(client->channel.get());
+        retired_clients_.push_back(client);
+    }
+    retired_subscriptions_.push_back(subscription);
+}
+
+void PeriodicScheduler::remove_client(Client* client) {
+    const PushChannel* channel = client->channel.get();
+    SubscriptionKey first = {channel, nullptr, 0, 0};
+    auto it = subscriptions_.lower_bound(first);
+    while (it != subscriptions_.end() && it->first.channel == channel) {
+        remove(it++);
+    }
+}
+
+void PeriodicScheduler::free_retired() {
+    for (size_t i = 0; i < retired_subscriptions_.size(); ++i) {
+        delete retired_subscriptions_[i];
+    }
+    for (size_t i = 0; i < retired_groups_.size(); ++i) {
+        delete retired_groups_[i];
+    }
+    for (size_t i = 0; i < retired_clients_.size(); ++i) {
+        delete retired_clients_[i];
+    }
+    retired_subscriptions_.clear();
+    retired_groups_.clear();
+    retired_clients_.clear();
+}
+
+uint64_t PeriodicScheduler::period_ticks(PeriodicRate rate) const {
+    uint32_t period_ms = options_.slow_ms;
+    if (rate == PeriodicRate::MEDIUM) {
+        period_ms = options_.medium_ms;
+    } else if (rate == PeriodicRate::FAST) {
+        period_ms = options_.fast_ms;
+    }
+    uint64_t ticks = static_cast<uint64_t>(period_ms) * 1000000ULL / tick_ns_;
+    return ticks == 0 ? 1 : ticks;
+}
+
+// after之后第一个与组的相位对齐的节拍
+uint64_t PeriodicScheduler::next_due(const Group& group, uint64_t after) const {
+    uint64_t period = period_ticks(group.rate);
+    uint64_t due = after - after % period + group.phase % period;
+    return due > after ? due : due + period;
+}
+
+uint64_t PeriodicScheduler::tick_at(Clock::time_point time) const {
+    if (time <= epoch_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch_).count()) / tick_ns_;
+}
+
+PeriodicScheduler::Clock::time_point PeriodicScheduler::tick_time(uint64_t tick) const {
+    return epoch_ + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(tick * tick_ns_));
+}
+
+void PeriodicScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Client*> closed_clients;
+    while (running_) {
+        // 没有订阅时一直睡眠，直到有新订阅；否则按绝对时刻逐节拍唤醒，误差不累积
+        if (wheel_.empty()) {
+            wakeup_.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline = tick_time(wheel_.current());
+        Clock::time_point now = Clock::now();
+        if (now < deadline) {
+            wakeup_.wait_until(lock, deadline);
+            continue;
+        }
+
+        uint64_t tick = tick_at(now);
+        free_retired();
+        expired_.clear();
+        wheel_.advance(tick, expired_);
+
+        // 到期的组取快照后立即按周期重新登记，处理过程不持锁
+        due_groups_.clear();
+        due_subscribers_.clear();
+        for (size_t i = 0; i < expired_.size(); ++i) {
+            Group* group = static_cast<Group*>(expired_[i]);
+            DueGroup due;
+            due.service = group->service;
+            due.did = group->did;
+            due.first = due_subscribers_.size();
+            due.count = group->subscribers.size();
+            due.payload_offset = 0;
+            due.payload_size = 0;
+            due_groups_.push_back(due);
+            due_subscribers_.insert(due_subscribers_.end(), group->subscribers.begin(), group->subscribers.end());
+
+            uint64_t next = group->expires + period_ticks(group->rate);
+            if (next <= tick) {
+                // 落后超过一个周期时跳过错过的发送，仍保持相位
+                next = next_due(*group, tick);
+            }
+            wheel_.schedule(group, next);
+        }
+
+        lock.unlock();
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        closed_clients.clear();
+        if (!due_groups_.empty()) {
+            process_tick(tick);
+            for (size_t i = 0; i < batch_clients_.size(); ++i) {
+                Client* client = batch_clients_[i];
+                const std::vector<uint8_t>& batch = batches_[client->batch_index];
+                if (!client->channel->push(batch.data(), batch.size(), PushPolicy::LOSSY)) {
+                    client->closed = true;
+                    closed_clients.push_back(client);
+                    continue;
+                }
+                bytes += batch.size();
+            }
+            for (size_t i = 0; i < due_groups_.size(); ++i) {
+                if (due_groups_[i].payload_size > 0) {
+                    messages += due_groups_[i].count;
+                }
+            }
+        }
+        Clock::time_point end = Clock::now();
+        lock.lock();
+
+        // 连接已关闭：删除它的全部订阅（可能已被取消订阅，此时对象尚未释放）
+        for (size_t i = 0; i < closed_clients.size(); ++i) {
+            remove_client(closed_clients[i]);
+        }
+        ++stats_.ticks;
+        stats_.messages += messages;
+        stats_.bytes += bytes;
+        stats_.lateness.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count()));
+        stats_.tick_duration.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - now).count()));
+    }
+}
+
+// 读取到期的DID并为每个连接拼出本节拍的推送数据（不持锁）
+void PeriodicScheduler::process_tick(uint64_t tick) {
+    std::sort(due_groups_.begin(), due_groups_.end(), [](const DueGroup& a, const DueGroup& b) {
+        if (a.service != b.service) {
+            return less_pointer(a.service, b.service);
+        }
+        return a.did < b.did;
+    });
+
+    // 每个ECU一次批量读取；同一DID的多个速率在同一节拍到期时只读取、编码一次
+    payloads_.clear();
+    std::vector<DidLookup>& lookups = t_lookups;
+    size_t begin = 0;
+    while (begin < due_groups_.size()) {
+        const UdsService* service = due_groups_[begin].service;
+        size_t end = begin;
+        size_t unique = 0;
+        while (end < due_groups_.size() && due_groups_[end].service == service) {
+            if (end == begin || due_groups_[end].did != due_groups_[end - 1].did) {
+                if (lookups.size() <= unique) {
+                    lookups.resize(unique + 1);
+                }
+                lookups[unique].did = due_groups_[end].did;
+                lookups[unique].found = false;
+                ++unique;
+            }
+            ++end;
+        }
+
+        {
+            EpochManager::Guard guard;
+            service->read_dids(lookups.data(), unique);
+            size_t lookup = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (i != begin && due_groups_[i].did != due_groups_[i - 1].did) {
+                    ++lookup;
+                }
+                DueGroup& due = due_groups_[i];
+                if (!lookups[lookup].found) {
+                    continue;
+                }
+                if (i != begin && due.did == due_groups_[i - 1].did) {
+                    due.payload_offset = due_groups_[i - 1].payload_offset;
+                    due.payload_size = due_groups_[i - 1].payload_size;
+                    continue;
+                }
+                // 周期报文：0x6A + 周期DID + 数据
+                due.payload_offset = payloads_.size();
+                payloads_.push_back(static_cast<uint8_t>(ServiceID::READ_DATA_BY_PERIODIC_IDENTIFIER) + 0x40);
+                payloads_.push_back(static_cast<uint8_t>(due.did & 0xFF));
+                payloads_.insert(payloads_.end(), lookups[lookup].view.data(),
+                                 lookups[lookup].view.data() + lookups[lookup].view.size());
+                due.payload_size = payloads_.size() - due.payload_offset;
+            }
+        }
+        begin = end;
+    }
+
+    // 按连接合并：每个连接在本节拍只推送一次
+    FrameCapture& capture = FrameCapture::instance();
+    bool capturing = capture.active();
+    batch_clients_.clear();
+    for (size_t i = 0; i < due_groups_.size(); ++i) {
+        const DueGroup& due = due_groups_[i];
+        if (due.payload_size == 0) {
+            continue;
+        }
+        const uint8_t* payload = payloads_.data() + due.payload_offset;
+        for (size_t j = 0; j < due.count; ++j) {
+            const Subscription* subscription = due_subscribers_[due.first + j];
+            Client* client = subscription->client;
+            if (client->closed) {
+                continue;
+            }
+            if (client->batch_tick != tick) {
+                client->batch_tick = tick;
+                client->batch_index = batch_clients_.size();
+                batch_clients_.push_back(client);
+                if (batches_.size() < batch_clients_.size()) {
+                    batches_.resize(batch_clients_.size());
+                }
+                batches_[client->batch_index].clear();
+            }
+
+            std::vector<uint8_t>& out = batches_[client->batch_index];
+            FramingMode framing = client->channel->framing();
+            size_t header_offset = begin_message(framing, subscription->ecu_address, subscription->tester_address,
+                                                 subscription->protocol_version, out);
+            out.insert(out.end(), payload, payload + due.payload_size);
+            end_response(framing, header_offset, out);
+            if (capturing) {
+                capture.record(TraceRecord::PUSH, subscription->connection_id, subscription->tester_address,
+                               subscription->ecu_address, payload, due.payload_size, 0);
+            }
+        }
+    }
+}
+
+} // namespace uds
@@ -0,0 +1,185 @@
+#ifndef PERIODIC_SCHEDULER_H
+#define PERIODIC_SCHEDULER_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "uds_protocol.h"
+#include "timer_wheel.h"
+#include "latency_histogram.h"
+
+namespace uds {
+
+class UdsService;
+class PushChannel;
+struct RequestContext;
+
+// 0x2A的发送速率（transmissionMode 0x01~0x03）
+enum class PeriodicRate : uint8_t {
+    SLOW = 0,
+    MEDIUM = 1,
+    FAST = 2
+};
+
+// 周期调度参数；各速率的周期应为节拍的整数倍
+struct PeriodicSchedulerOptions {
+    uint32_t tick_ms = 10;
+    uint32_t slow_ms = 1000;
+    uint32_t medium_ms = 200;
+    uint32_t fast_ms = 50;
+};
+
+// 调度统计
+struct PeriodicSchedulerStats {
+    uint64_t ticks;                   // 处理过的节拍数（空闲时不计）
+    uint64_t messages;                // 推送的周期报文数
+    uint64_t bytes;                   // 推送的字节数（含分帧头）
+    LatencyHistogram lateness;        // 每个节拍实际开始处理的时刻比计划晚多少（纳秒）
+    LatencyHistogram tick_duration;   // 每个节拍的处理耗时（纳秒）
+
+    PeriodicSchedulerStats() : ticks(0), messages(0), bytes(0) {}
+};
+
+// 0x2A周期数据调度器，所有ECU、所有连接共用一个调度线程
+// 同一ECU上同一DID、同一速率的订阅合为一组，每组在分层时间轮中只有一个定时器。
+// 各组按(ECU, DID)的散列错开相位，负载均匀分布到周期内的各个节拍，避免所有订阅挤在同一节拍造成抖动；
+// 各速率的周期互为整数倍，同一DID的不同速率仍在同一节拍到期。同一节拍到期的组一起处理：
+// 每个ECU一次批量读取，每个DID每个节拍只编码一次，再按订阅者的分帧方式封装，
+// 同一连接在一个节拍内的所有周期报文合并为一次推送。订阅增删是O(log n)，节拍处理只与到期的订阅数有关
+class PeriodicScheduler {
+public:
+    explicit PeriodicScheduler(const PeriodicSchedulerOptions& options = PeriodicSchedulerOptions());
+    ~PeriodicScheduler();
+
+    // 启动调度线程
+    bool start();
+
+    // 停止调度线程；之后订阅仍可增删，但不再推送
+    void stop();
+
+    // 订阅：按rate把service上的周期DID（0xF200 + pdid）推送给context所在的连接。
+    // 同一连接（同一测试端地址）已订阅该DID时改为新速率。context须带有推送通道
+    void subscribe(const UdsService& service, const RequestContext& context, uint8_t pdid, PeriodicRate rate);
+
+    // 取消连接在service上对一个周期DID的订阅
+    void unsubscribe(const UdsService& service, const RequestContext& context, uint8_t pdid);
+
+    // 取消连接在service上的全部订阅
+    void unsubscribe_all(const UdsService& service, const RequestContext& context);
+
+    size_t subscription_count() const;
+
+    PeriodicSchedulerStats stats() const;
+
+private:
+    PeriodicScheduler(const PeriodicScheduler&);
+    PeriodicScheduler& operator=(const PeriodicScheduler&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Group;
+
+    // 一个连接，被它的所有订阅共享
+    struct Client {
+        std::shared_ptr<PushChannel> channel;
+        size_t subscriptions;
+        bool closed;             // 推送失败，连接已关闭
+        uint64_t batch_tick;     // 以下两项只由调度线程使用：本节拍的合并推送缓冲区
+        size_t batch_index;
+    };
+
+    // 一个连接对一个周期DID的订阅，创建后只读
+    struct Subscription {
+        Group* group;
+        size_t index;            // 在group->subscribers中的下标
+        Client* client;
+        uint32_t connection_id;  // 抓包时标识推送报文所属的连接
+        uint16_t tester_address;
+        uint16_t ecu_address;
+        uint8_t protocol_version;
+    };
+
+    // 同一ECU、同一DID、同一速率的订阅
+    struct Group : TimerWheel::Timer {
+        const UdsService* service;
+        DID did;
+        PeriodicRate rate;
+        uint32_t phase;          // 到期节拍对周期取模的余数（取模前）
+        std::vector<Subscription*> subscribers;
+    };
+
+    struct GroupKey {
+        const UdsService* service;
+        DID did;
+        PeriodicRate rate;
+
+        bool operator<(const GroupKey& other) const;
+    };
+
+    struct SubscriptionKey {
+        const PushChannel* channel;
+        const UdsService* service;
+        uint16_t tester_address;
+        uint8_t pdid;
+
+        bool operator<(const SubscriptionKey& other) const;
+    };
+
+    // 一个节拍中到期的组（快照，处理时不持锁）
+    struct DueGroup {
+        const UdsService* service;
+        DID did;
+        size_t first;            // 订阅者在due_subscribers_中的范围
+        size_t count;
+        size_t payload_offset;   // 编码好的周期报文在payloads_中的位置，size为0表示DID不存在
+        size_t payload_size;
+    };
+
+    void run();
+    void process_tick(uint64_t tick);
+    uint64_t period_ticks(PeriodicRate rate) const;
+    uint64_t next_due(const Group& group, uint64_t after) const;
+    uint64_t tick_at(Clock::time_point time) const;
+    Clock::time_point tick_time(uint64_t tick) const;
+
+    // 以下函数的调用者需持有mutex_
+    void remove(std::map<SubscriptionKey, Subscription*>::iterator it);
+    void remove_client(Client* client);
+    void free_retired();
+
+    PeriodicSchedulerOptions options_;
+    uint64_t tick_ns_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::thread thread_;
+    bool running_;
+    Clock::time_point epoch_;            // 第0个节拍的时刻
+    TimerWheel wheel_;
+    std::map<GroupKey, Group*> groups_;
+    std::map<SubscriptionKey, Subscription*> subscriptions_;
+    std::map<const PushChannel*, Client*> clients_;
+    // 已删除的对象可能仍在调度线程正在处理的快照中，到下一个节拍开始时再释放
+    std::vector<Subscription*> retired_subscriptions_;
+    std::vector<Group*> retired_groups_;
+    std::vector<Client*> retired_clients_;
+    PeriodicSchedulerStats stats_;
+
+    // 以下只由调度线程使用，容量在节拍之间复用
+    std::vector<TimerWheel::Timer*> expired_;
+    std::vector<DueGroup> due_groups_;
+    std::vector<Subscription*> due_subscribers_;
+    std::vector<uint8_t> payloads_;
+    std::vector<Client*> batch_clients_;
+    std::vector<std::vector<uint8_t> > batches_;
+};
+
+} // namespace uds
+
+#endif // PERIODIC_SCHEDULER_H
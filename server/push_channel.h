@@ -0,0 +1,40 @@
+#ifndef PUSH_CHANNEL_H
+#define PUSH_CHANNEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "frame_codec.h"
+
+namespace uds {
+
+// 推送数据在连接内排不下时的处理方式
+enum class PushPolicy {
+    LOSSY,     // 可以丢弃（如0x2A的周期数据）：整段丢弃并计入uds_pushes_dropped_total
+    RELIABLE   // 不能丢弃（如NRC 0x78及之后的最终响应）：关闭连接，测试端不会一直等待不会到来的响应
+};
+
+// 服务端主动向连接发送报文的通道（如0x2A的周期数据），由传输层为每个连接实现
+// 可在任意线程调用，实现不能阻塞调用者：发送不出去的数据在连接内排队，超出上限时按PushPolicy处理；
+// 两类数据各自计算上限，周期数据占满队列时最终响应仍能排入
+class PushChannel : public std::enable_shared_from_this<PushChannel> {
+public:
+    explicit PushChannel(FramingMode framing) : framing_(framing) {}
+    virtual ~PushChannel() {}
+
+    // 追加一段已按连接分帧方式封装好的数据，整段发送或整段丢弃；
+    // 连接已关闭，或RELIABLE数据排不下而关闭连接时返回false
+    virtual bool push(const uint8_t* data, size_t size, PushPolicy policy) = 0;
+
+    FramingMode framing() const { return framing_; }
+
+private:
+    PushChannel(const PushChannel&);
+    PushChannel& operator=(const PushChannel&);
+
+    FramingMode framing_;
+};
+
+} // namespace uds
+
+#endif // PUSH_CHANNEL_H
@@ -0,0 +1,19 @@
+#ifndef REACTOR_OPTIONS_H
+#define REACTOR_OPTIONS_H
+
+#include <cstddef>
+
+namespace uds {
+
+// 事件循环（EpollReactor/IoUringReactor）参数
+struct ReactorOptions {
+    size_t loops = 1;                   // 事件循环数量
+    bool pin_cpus = false;              // 第i个事件循环绑定到第i个可用CPU
+    // 连接未发出的响应数据达到该值时暂停读取该连接，发到一半以下时恢复；
+    // 每个连接的输出缓冲区不超过该值加上一次接收的请求产生的响应
+    size_t output_limit = 1024 * 1024;
+};
+
+} // namespace uds
+
+#endif // REACTOR_OPTIONS_H
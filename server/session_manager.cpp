@@ -0,0 +1,202 @@
+#include "session_manager.h"
+#include "uds_service.h"
+#include "push_channel.h"
+
+namespace uds {
+
+const size_t SessionManager::SHARD_COUNT;
+
+size_t SessionManager::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = (reinterpret_cast<uintptr_t>(key.service) >> 4) * 0x9E3779B97F4A7C15ULL;
+    hash ^= (static_cast<uint64_t>(key.connection_id) << 16 | key.tester_address) * 0xC2B2AE3D27D4EB4FULL;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+SessionManager::SessionManager(const SessionManagerOptions& options)
+    : options_(options),
+      tick_ns_(static_cast<uint64_t>(options.tick_ms == 0 ? 1 : options.tick_ms) * 1000000ULL),
+      s3_ticks_(0),
+      epoch_(Clock::now()),
+      entries_(0),
+      active_(0),
+      timeouts_(0),
+      running_(false) {
+    s3_ticks_ = (static_cast<uint64_t>(options.s3_ms) * 1000000ULL + tick_ns_ - 1) / tick_ns_;
+    if (s3_ticks_ == 0) {
+        s3_ticks_ = 1;
+    }
+}
+
+SessionManager::~SessionManager() {
+    stop();
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        for (auto& entry : shards_[i].sessions) {
+            wheel_.cancel(entry.second);
+            delete entry.second;
+        }
+    }
+}
+
+bool SessionManager::start() {
+    std::lock_guard<std::mutex> lock(wheel_mutex_);
+    if (running_) {
+        return true;
+    }
+    running_ = true;
+    thread_ = std::thread(&SessionManager::run, this);
+    return true;
+}
+
+void SessionManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+DiagnosticSession SessionManager::touch(UdsService& service, const RequestContext& context) {
+    if (entries_.load(std::memory_order_relaxed) == 0) {
+        return DiagnosticSession::DEFAULT;
+    }
+
+    Key key = {&service, context.connection_id, context.tester_address};
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it == shard.sessions.end()) {
+        return DiagnosticSession::DEFAULT;
+    }
+    Session* session = it->second;
+    if (session->session != DiagnosticSession::DEFAULT) {
+        session->last_active = now_tick();
+    }
+    return session->session;
+}
+
+DiagnosticSession SessionManager::change(UdsService& service, const RequestContext& context,
+                                         DiagnosticSession session) {
+    Key key = {&service, context.connection_id, context.tester_address};
+    uint64_t now = now_tick();
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it != shard.sessions.end()) {
+        // 已有记录（回到默认会话的记录在定时器到期前保留），定时器到期时按最新状态处理
+        Session* existing = it->second;
+        DiagnosticSession previous = existing->session;
+        if (previous == DiagnosticSession::DEFAULT && session != DiagnosticSession::DEFAULT) {
+            active_.fetch_add(1, std::memory_order_relaxed);
+        } else if (previous != DiagnosticSession::DEFAULT && session == DiagnosticSession::DEFAULT) {
+            active_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        existing->session = session;
+        existing->last_active = now;
+        return previous;
+    }
+    if (session == DiagnosticSession::DEFAULT) {
+        return DiagnosticSession::DEFAULT;
+    }
+
+    Session* created = new Session();
+    created->key = key;
+    created->service = &service;
+    created->ecu_address = context.ecu_address;
+    created->protocol_version = context.protocol_version;
+    if (context.channel != nullptr) {
+        created->channel = context.channel->shared_from_this();
+    }
+    created->session = session;
+    created->last_active = now;
+    shard.sessions[key] = created;
+    entries_.fetch_add(1, std::memory_order_relaxed);
+    active_.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> wheel_lock(wheel_mutex_);
+    bool was_idle = wheel_.empty();
+    if (was_idle) {
+        // 空闲期间时间轮没有推进，先跳到当前节拍
+        std::vector<TimerWheel::Timer*> none;
+        wheel_.advance(now, none);
+    }
+    wheel_.schedule(created, now + s3_ticks_);
+    if (was_idle) {
+        wakeup_.notify_all();
+    }
+    return DiagnosticSession::DEFAULT;
+}
+
+void SessionManager::run() {
+    std::unique_lock<std::mutex> lock(wheel_mutex_);
+    std::vector<TimerWheel::Timer*> expired;
+    while (running_) {
+        if (wheel_.empty()) {
+            wakeup_.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline =
+            epoch_ + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(wheel_.current() * tick_ns_));
+        if (Clock::now() < deadline) {
+            wakeup_.wait_until(lock, deadline);
+            continue;
+        }
+
+        uint64_t now = now_tick();
+        expired.clear();
+        wheel_.advance(now, expired);
+        lock.unlock();
+        for (size_t i = 0; i < expired.size(); ++i) {
+            expire(static_cast<Session*>(expired[i]), now);
+        }
+        lock.lock();
+    }
+}
+
+// 定时器到期：期间有过活动则顺延，否则删除记录；非默认会话就此超时，回到默认会话
+// 会话结束时的清理（停止周期DID、中止块传输）也在分片锁内进行：同一测试端随后的0x10要等清理完成
+// 才能建立新会话，新会话的订阅和传输不会被旧会话的清理撤销。清理只获取调度器和传输管理器的锁，
+// 它们不会反过来获取分片锁
+void SessionManager::expire(Session* session, uint64_t now) {
+    {
+        Shard& shard = shard_of(session->key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (session->session != DiagnosticSession::DEFAULT && session->last_active + s3_ticks_ > now) {
+            std::lock_guard<std::mutex> wheel_lock(wheel_mutex_);
+            wheel_.schedule(session, session->last_active + s3_ticks_);
+            return;
+        }
+        shard.sessions.erase(session->key);
+        entries_.fetch_sub(1, std::memory_order_relaxed);
+        if (session->session != DiagnosticSession::DEFAULT) {
+            active_.fetch_sub(1, std::memory_order_relaxed);
+            timeouts_.fetch_add(1, std::memory_order_relaxed);
+
+            std::shared_ptr<PushChannel> channel = session->channel.lock();
+            RequestContext context;
+            context.connection_id = session->key.connection_id;
+            context.tester_address = session->key.tester_address;
+            context.ecu_address = session->ecu_address;
+            context.protocol_version = session->protocol_version;
+            context.channel = channel.get();
+            session->service->end_session(context);
+        }
+    }
+    delete session;
+}
+
+SessionManager::Shard& SessionManager::shard_of(const Key& key) {
+    return shards_[KeyHash()(key) % SHARD_COUNT];
+}
+
+uint64_t SessionManager::now_tick() const {
+    Clock::time_point now = Clock::now();
+    if (now <= epoch_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - epoch_).count()) / tick_ns_;
+}
+
+} // namespace uds
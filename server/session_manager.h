@@ -0,0 +1,119 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "uds_protocol.h"
+#include "timer_wheel.h"
+
+namespace uds {
+
+class UdsService;
+class PushChannel;
+struct RequestContext;
+
+// 会话管理参数
+struct SessionManagerOptions {
+    uint32_t s3_ms = 5000;     // S3：非默认会话在没有任何请求时保持的时间
+    uint32_t tick_ms = 100;    // 超时检查的粒度
+};
+
+// 各测试端在各ECU上的诊断会话与S3超时，所有ECU、所有连接共用
+// 会话按（ECU、连接、测试端地址）区分，只记录非默认会话，没有记录即默认会话；
+// 没有任何非默认会话时查询不加锁。会话表分片加锁，每个会话在时间轮中有一个定时器：
+// 请求只更新会话的最后活动节拍，不改动时间轮；定时器到期时若期间有过活动，按最后活动重新登记，
+// 否则回到默认会话。因此每条请求（包括TesterPresent）的开销是O(1)且不争用时间轮
+class SessionManager {
+public:
+    explicit SessionManager(const SessionManagerOptions& options = SessionManagerOptions());
+    ~SessionManager();
+
+    // 启动超时检查线程
+    bool start();
+
+    // 停止超时检查线程
+    void stop();
+
+    // 返回测试端在service上的当前会话，并把本次请求记为活动（重置S3计时）
+    DiagnosticSession touch(UdsService& service, const RequestContext& context);
+
+    // 切换测试端在service上的会话，返回切换前的会话；处于非默认会话时开始S3计时
+    DiagnosticSession change(UdsService& service, const RequestContext& context, DiagnosticSession session);
+
+    // 当前处于非默认会话的测试端数
+    size_t active_count() const { return active_.load(std::memory_order_relaxed); }
+
+    // 累计的S3超时次数
+    uint64_t timeouts() const { return timeouts_.load(std::memory_order_relaxed); }
+
+private:
+    SessionManager(const SessionManager&);
+    SessionManager& operator=(const SessionManager&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    static const size_t SHARD_COUNT = 16;
+
+    struct Key {
+        const UdsService* service;
+        uint32_t connection_id;
+        uint16_t tester_address;
+
+        bool operator==(const Key& other) const {
+            return service == other.service && connection_id == other.connection_id &&
+                   tester_address == other.tester_address;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // 一个测试端在一个ECU上的会话；只由超时检查线程删除
+    struct Session : TimerWheel::Timer {
+        Key key;
+        UdsService* service;
+        uint16_t ecu_address;
+        uint8_t protocol_version;
+        std::weak_ptr<PushChannel> channel;
+        DiagnosticSession session;       // 以下两项受所在分片的锁保护
+        uint64_t last_active;            // 最后一次活动的节拍
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, Session*, KeyHash> sessions;
+    };
+
+    void run();
+    void expire(Session* session, uint64_t now);
+    Shard& shard_of(const Key& key);
+    uint64_t now_tick() const;
+
+    SessionManagerOptions options_;
+    uint64_t tick_ns_;
+    uint64_t s3_ticks_;
+    Clock::time_point epoch_;
+    Shard shards_[SHARD_COUNT];
+    std::atomic<size_t> entries_;        // 会话表中的记录数，为0时查询直接返回默认会话
+    std::atomic<size_t> active_;
+    std::atomic<uint64_t> timeouts_;
+
+    std::mutex wheel_mutex_;             // 保护时间轮与以下成员
+    std::condition_variable wakeup_;
+    TimerWheel wheel_;
+    bool running_;
+    std::thread thread_;
+};
+
+} // namespace uds
+
+#endif // SESSION_MANAGER_H
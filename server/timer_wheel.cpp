@@ -0,0 +1,145 @@
+#include "timer_wheel.h"
+
+namespace uds {
+
+const unsigned TimerWheel::ROOT_BITS;
+const unsigned TimerWheel::LEVEL_BITS;
+const size_t TimerWheel::LEVEL_COUNT;
+const size_t TimerWheel::ROOT_SIZE;
+const size_t TimerWheel::LEVEL_SIZE;
+
+TimerWheel::TimerWheel(uint64_t current) : current_(current), size_(0) {
+    for (size_t i = 0; i < ROOT_SIZE; ++i) {
+        root_[i].prev = &root_[i];
+        root_[i].next = &root_[i];
+    }
+    for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+        for (size_t i = 0; i < LEVEL_SIZE; ++i) {
+            levels_[level][i].prev = &levels_[level][i];
+            levels_[level][i].next = &levels_[level][i];
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // 把仍登记的定时器标记为未登记，使用者之后可以安全地检查或释放它们
+    for (size_t i = 0; i < ROOT_SIZE; ++i) {
+        while (root_[i].next != &root_[i]) {
+            unlink(root_[i].next);
+        }
+    }
+    for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+        for (size_t i = 0; i < LEVEL_SIZE; ++i) {
+            while (levels_[level][i].next != &levels_[level][i]) {
+                unlink(levels_[level][i].next);
+            }
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer* timer, uint64_t expires) {
+    cancel(timer);
+    timer->expires = expires;
+    insert(timer);
+    ++size_;
+}
+
+void TimerWheel::cancel(Timer* timer) {
+    if (timer->scheduled()) {
+        unlink(timer);
+        --size_;
+    }
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<Timer*>& expired) {
+    while (current_ <= now) {
+        if (size_ == 0) {
+            // 轮中没有定时器，直接跳到目标节拍
+            current_ = now + 1;
+            return;
+        }
+
+        // 根层转完一圈时，把上层对应槽位的定时器下移；上层也转完一圈时继续向上
+        size_t index = static_cast<size_t>(current_ & (ROOT_SIZE - 1));
+        if (index == 0) {
+            for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+                size_t level_index = static_cast<size_t>(
+                    (current_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1));
+                cascade(level, level_index);
+                if (level_index != 0) {
+                    break;
+                }
+            }
+        }
+
+        Timer* head = &root_[index];
+        while (head->next != head) {
+            Timer* timer = head->next;
+            unlink(timer);
+            --size_;
+            expired.push_back(timer);
+        }
+        ++current_;
+    }
+}
+
+void TimerWheel::insert(Timer* timer) {
+    uint64_t expires = timer->expires;
+    if (expires < current_) {
+        link(&root_[current_ & (ROOT_SIZE - 1)], timer);
+        return;
+    }
+
+    uint64_t delta = expires - current_;
+    if (delta < ROOT_SIZE) {
+        link(&root_[expires & (ROOT_SIZE - 1)], timer);
+        return;
+    }
+    for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+        unsigned shift = static_cast<unsigned>(ROOT_BITS + level * LEVEL_BITS);
+        if (delta < (static_cast<uint64_t>(1) << (shift + LEVEL_BITS))) {
+            link(&levels_[level][(expires >> shift) & (LEVEL_SIZE - 1)], timer);
+            return;
+        }
+    }
+
+    // 超出最大跨度：先挂在最高层的最远槽位，下移时按真实到期节拍重新放置
+    unsigned shift = static_cast<unsigned>(ROOT_BITS + (LEVEL_COUNT - 1) * LEVEL_BITS);
+    uint64_t limit = current_ + (static_cast<uint64_t>(1) << (shift + LEVEL_BITS)) - 1;
+    link(&levels_[LEVEL_COUNT - 1][(limit >> shift) & (LEVEL_SIZE - 1)], timer);
+}
+
+void TimerWheel::cascade(size_t level, size_t index) {
+    Timer* head = &levels_[level][index];
+    if (head->next == head) {
+        return;
+    }
+
+    // 先把整条链表摘下，再逐个按剩余时间重新放置（可能回到同一层的其他槽位）
+    Timer* first = head->next;
+    Timer* last = head->prev;
+    head->prev = head;
+    head->next = head;
+    last->next = nullptr;
+    while (first != nullptr) {
+        Timer* timer = first;
+        first = first->next;
+        insert(timer);
+    }
+}
+
+void TimerWheel::link(Timer* head, Timer* timer) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+void TimerWheel::unlink(Timer* timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = nullptr;
+    timer->next = nullptr;
+}
+
+} // namespace uds
@@ -0,0 +1,70 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace uds {
+
+// 分层时间轮（与Linux内核早期的定时器实现相同）
+// 时间以整数节拍计；根层256个槽位各对应一个节拍，其上4层各64个槽位，每层的槽位跨度是下一层的整圈。
+// 定时器以侵入式双向链表挂在槽位上：登记、取消都是O(1)，推进一个节拍是O(1)加上到期的定时器数，
+// 远期定时器随时间推进逐层下移。不加锁，由使用者串行调用
+class TimerWheel {
+public:
+    // 侵入式定时器节点，通常作为使用者结构体的基类或成员，存活期间不能移动
+    struct Timer {
+        Timer* prev;
+        Timer* next;
+        uint64_t expires;    // 到期节拍
+
+        Timer() : prev(nullptr), next(nullptr), expires(0) {}
+
+        bool scheduled() const { return prev != nullptr; }
+    };
+
+    // current为起始节拍
+    explicit TimerWheel(uint64_t current = 0);
+    ~TimerWheel();
+
+    // 登记定时器在expires节拍到期，已登记的先取消；已过期的节拍视为下一个节拍
+    void schedule(Timer* timer, uint64_t expires);
+
+    // 取消定时器，未登记时什么也不做
+    void cancel(Timer* timer);
+
+    // 把时间推进到now（含），到期的定时器从轮中摘下并按到期顺序追加到expired
+    void advance(uint64_t now, std::vector<Timer*>& expired);
+
+    // 下一个尚未处理的节拍
+    uint64_t current() const { return current_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+
+    static const unsigned ROOT_BITS = 8;
+    static const unsigned LEVEL_BITS = 6;
+    static const size_t LEVEL_COUNT = 4;
+    static const size_t ROOT_SIZE = static_cast<size_t>(1) << ROOT_BITS;
+    static const size_t LEVEL_SIZE = static_cast<size_t>(1) << LEVEL_BITS;
+
+    void insert(Timer* timer);
+    void cascade(size_t level, size_t index);
+
+    static void link(Timer* head, Timer* timer);
+    static void unlink(Timer* timer);
+
+    Timer root_[ROOT_SIZE];                     // 各槽位的哨兵节点
+    Timer levels_[LEVEL_COUNT][LEVEL_SIZE];
+    uint64_t current_;
+    size_t size_;
+};
+
+} // namespace uds
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,74 @@
+// DID数据文件格式转换：JSON（did_data.json） <-> 二进制数据库（*.bin）
+// 用法：did_convert <输入文件> <输出文件>
+// 输入格式按文件魔数识别，输出文件以.bin结尾时写成二进制数据库，否则写成JSON
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+#include "did_database.h"
+
+using namespace uds;
+
+namespace {
+
+bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool write_file(const std::string& path, const void* data, size_t size) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, file) == size;
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.json|input.bin> <output.json|output.bin>" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argv[2];
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    DidDatabase database;
+    std::string error;
+    bool input_binary = DidDatabase::is_binary_file(input);
+    bool ok = input_binary ? database.map_file(input, error) : database.load_json_file(input, error);
+    if (!ok) {
+        std::cerr << "Failed to load " << input << ": " << error << std::endl;
+        return 1;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    bool output_binary = ends_with(output, ".bin");
+    start = Clock::now();
+    if (output_binary) {
+        std::vector<uint8_t> content = database.to_binary();
+        ok = write_file(output, content.data(), content.size());
+    } else {
+        std::string content = database.to_json();
+        ok = write_file(output, content.data(), content.size());
+    }
+    if (!ok) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    double write_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "Converted " << database.count() << " DIDs: "
+              << input << " (" << (input_binary ? "binary" : "JSON") << ", " << load_ms << " ms) -> "
+              << output << " (" << (output_binary ? "binary" : "JSON") << ", " << write_ms << " ms)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,524 @@
+// 抓包回放：把uds_server --capture记录的请求重新发送给服务端，并与记录的响应逐条比对
+// 抓包中的每个连接在回放时各用一个TCP连接，连接内保持原有顺序（包括流水线发送的请求）：
+//   original模式：按记录的时间间隔发送（--scale=2表示两倍速）
+//   max模式     ：不等待，收到记录中对应的响应后立即继续
+// 写请求会改变DID数据，服务端应使用抓包开始时的数据文件副本启动，否则响应会不一致
+// 0x2A周期报文的时刻和内容取决于回放时的调度，不参与比对：抓包中的PUSH记录和回放时收到的周期报文都只计数
+// 服务端回复7F xx 78（ResponsePending）后，最终响应与抓包中同一服务的推送记录比对，期间重复的0x78跳过
+// 用法：uds_replay <抓包文件> [--host=127.0.0.1] [--port=8888] [--speed=original|max] [--scale=F]
+//                  [--framing=raw|length|doip] [--max-diffs=N]
+// 返回值：0 全部一致，1 参数错误或连接失败，2 存在不一致的响应
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET SocketType;
+    #define INVALID_SOCKET_VALUE INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SocketType;
+    #define INVALID_SOCKET_VALUE -1
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+#include "frame_capture.h"
+#include "frame_codec.h"
+#include "latency_histogram.h"
+
+using namespace uds;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::duration SPIN_WINDOW = std::chrono::microseconds(200);
+const int RECEIVE_TIMEOUT_MS = 5000;
+const size_t HEX_DUMP_LIMIT = 64;
+
+struct ReplayOptions {
+    std::string trace_path;
+    std::string host = "127.0.0.1";
+    int port = 8888;
+    bool original_timing = true;
+    double scale = 1.0;            // original模式下的加速倍数
+    bool framing_set = false;      // 未指定时沿用抓包时的分帧方式
+    FramingMode framing = FramingMode::RAW;
+    size_t max_diffs = 10;
+};
+
+// 单个连接的回放结果
+struct ConnectionResult {
+    uint64_t requests = 0;
+    uint64_t matched = 0;
+    uint64_t mismatched = 0;
+    LatencyHistogram histogram;
+    uint64_t periodic_captured = 0;   // 抓包中的周期报文
+    uint64_t periodic_received = 0;   // 回放时收到并跳过的周期报文
+    uint64_t final_responses = 0;     // 0x78之后比对的最终响应（计入matched/mismatched）
+    std::vector<std::string> diffs;   // 最多max_diffs条
+    bool failed = false;
+    std::string error;
+};
+
+std::string to_hex(const uint8_t* data, size_t size) {
+    std::ostringstream oss;
+    oss << std::hex << std::uppercase << std::setfill('0');
+    for (size_t i = 0; i < size && i < HEX_DUMP_LIMIT; ++i) {
+        oss << (i > 0 ? " " : "") << std::setw(2) << static_cast<int>(data[i]);
+    }
+    if (size > HEX_DUMP_LIMIT) {
+        oss << " ... (" << std::dec << size << " bytes)";
+    }
+    return oss.str();
+}
+
+SocketType connect_to(const ReplayOptions& options, std::string& error) {
+    SocketType sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET_VALUE) {
+        error = "socket() failed";
+        return sock;
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) {
+        CLOSE_SOCKET(sock);
+        error = "invalid host " + options.host;
+        return INVALID_SOCKET_VALUE;
+    }
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        CLOSE_SOCKET(sock);
+        error = "connect to " + options.host + ":" + std::to_string(options.port) + " failed";
+        return INVALID_SOCKET_VALUE;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+
+    // 服务端不再响应时不要无限等待
+    #ifdef _WIN32
+    DWORD timeout = RECEIVE_TIMEOUT_MS;
+    #else
+    timeval timeout;
+    timeout.tv_sec = RECEIVE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (RECEIVE_TIMEOUT_MS % 1000) * 1000;
+    #endif
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    return sock;
+}
+
+bool send_all(SocketType sock, const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        int sent = send(sock, reinterpret_cast<const char*>(data.data()) + offset,
+                        static_cast<int>(data.size() - offset), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// 周期报文：0x6A + 周期DID + 数据；0x2A请求本身的响应只有0x6A一个字节
+bool is_periodic(const uint8_t* data, size_t size) {
+    return size >= 2 && data[0] == 0x6A;
+}
+
+// 7F <服务ID> 78：请求已收到，最终响应稍后发送
+bool is_response_pending(const uint8_t* data, size_t size) {
+    return size == 3 && data[0] == 0x7F && data[2] == 0x78;
+}
+
+// 响应所属的服务ID
+uint8_t response_service(const uint8_t* data, size_t size) {
+    if (size >= 2 && data[0] == 0x7F) {
+        return data[1];
+    }
+    return static_cast<uint8_t>(data[0] - 0x40);
+}
+
+// 按顺序读取服务端发来的报文，跳过与请求无关的周期报文
+class ResponseReader {
+public:
+    ResponseReader(SocketType sock, FramingMode framing) : sock_(sock), decoder_(framing), periodic_(0) {}
+
+    // 读取下一条报文；连接关闭或超时返回false，error给出原因
+    bool next(std::vector<uint8_t>& response, bool& nack, std::string& error) {
+        if (!stashed_.empty()) {
+            response.swap(stashed_.front().first);
+            nack = stashed_.front().second;
+            stashed_.pop_front();
+            return true;
+        }
+        return receive(response, nack, error);
+    }
+
+    // 读取service_id的请求在0x78之后的最终响应：跳过重复的0x78，
+    // 期间收到的其他报文（其他请求的响应）按顺序留给之后的next()
+    bool next_final(uint8_t service_id, std::vector<uint8_t>& response, std::string& error) {
+        bool nack = false;
+        while (receive(response, nack, error)) {
+            if (nack || response.empty() || response_service(response.data(), response.size()) != service_id) {
+                stashed_.push_back(std::make_pair(response, nack));
+                continue;
+            }
+            if (is_response_pending(response.data(), response.size())) {
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t periodic() const { return periodic_; }
+
+private:
+    bool receive(std::vector<uint8_t>& response, bool& nack, std::string& error) {
+        ByteView view;
+        while (true) {
+            while (!decoder_.next(view, nack)) {
+                int received = recv(sock_, buffer_, sizeof(buffer_), 0);
+                if (received <= 0) {
+                    error = received == 0 ? "connection closed by server" : "timed out waiting for response";
+                    return false;
+                }
+                decoder_.feed(reinterpret_cast<const uint8_t*>(buffer_), static_cast<size_t>(received));
+            }
+            if (!nack && is_periodic(view.data, view.size)) {
+                ++periodic_;
+                continue;
+            }
+            response.assign(view.data, view.data + view.size);
+            return true;
+        }
+    }
+
+    SocketType sock_;
+    ResponseDecoder decoder_;
+    char buffer_[16384];
+    std::deque<std::pair<std::vector<uint8_t>, bool>> stashed_;
+    uint64_t periodic_;
+};
+
+void wait_until(Clock::time_point when) {
+    // 睡眠的唤醒误差有几十微秒，最后一小段改为让出CPU等待
+    Clock::time_point now = Clock::now();
+    if (when - now > SPIN_WINDOW) {
+        std::this_thread::sleep_until(when - SPIN_WINDOW);
+    }
+    while (Clock::now() < when) {
+        std::this_thread::yield();
+    }
+}
+
+// 按记录顺序回放一个连接：请求记录发送，响应记录等待服务端的响应并比对
+void replay_connection(const ReplayOptions& options, const Trace& trace, const std::vector<size_t>& records,
+                       uint64_t first_timestamp_ns, Clock::time_point start, ConnectionResult& result) {
+    SocketType sock = connect_to(options, result.error);
+    if (sock == INVALID_SOCKET_VALUE) {
+        result.failed = true;
+        return;
+    }
+
+    std::unique_ptr<ResponseReader> reader(new ResponseReader(sock, options.framing));
+    std::deque<Clock::time_point> sent_times;
+    std::deque<size_t> pending_requests;     // 尚未比对响应的请求记录
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> response;
+
+    // 抓包中各服务在0x78之后推送的最终响应，按时间顺序；推送记录由工作线程写入，
+    // 时间戳可能早于连接线程记录的0x78响应，因此不按记录顺序而是按服务取用
+    std::map<uint8_t, std::deque<size_t>> final_records;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const TraceRecord& record = trace.records[records[i]];
+        const std::vector<uint8_t>& payload = record.payload;
+        if (record.direction == TraceRecord::PUSH && !payload.empty() &&
+            !is_periodic(payload.data(), payload.size()) && !is_response_pending(payload.data(), payload.size())) {
+            final_records[response_service(payload.data(), payload.size())].push_back(records[i]);
+        }
+    }
+
+    // 比对一条响应，不一致时记录差异
+    auto compare = [&](const TraceRecord& request, const TraceRecord& expected, bool expect_nack,
+                       const std::vector<uint8_t>& actual, bool nack) {
+        bool match = expect_nack ? nack
+                                 : !nack && actual.size() == expected.payload.size() &&
+                                   std::equal(expected.payload.begin(), expected.payload.end(), actual.begin());
+        if (match) {
+            ++result.matched;
+            return;
+        }
+        ++result.mismatched;
+        if (result.diffs.size() < options.max_diffs) {
+            std::ostringstream oss;
+            oss << "connection " << expected.connection_id << " @ " << std::fixed << std::setprecision(6)
+                << static_cast<double>(request.timestamp_ns) / 1e9 << " s"
+                << (expected.direction == TraceRecord::PUSH ? " (final response)" : "") << std::endl
+                << "  request  " << to_hex(request.payload.data(), request.payload.size()) << std::endl
+                << "  expected " << (expect_nack ? std::string("<negative ack>")
+                                                 : to_hex(expected.payload.data(), expected.payload.size())) << std::endl
+                << "  actual   " << (nack ? std::string("<negative ack>") : to_hex(actual.data(), actual.size()));
+            result.diffs.push_back(oss.str());
+        }
+    };
+
+    // 所有连接建立后同时开始
+    wait_until(start);
+    for (size_t i = 0; i < records.size() && !result.failed; ++i) {
+        const TraceRecord& record = trace.records[records[i]];
+
+        if (record.direction == TraceRecord::REQUEST) {
+            if (options.original_timing) {
+                wait_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(
+                    static_cast<int64_t>(static_cast<double>(record.timestamp_ns - first_timestamp_ns) /
+                                         options.scale))));
+            }
+            frame.clear();
+            encode_request(options.framing, record.source_address, record.target_address, record.payload, frame);
+            sent_times.push_back(Clock::now());
+            pending_requests.push_back(records[i]);
+            if (!send_all(sock, frame)) {
+                result.failed = true;
+                result.error = "send failed";
+            }
+            ++result.requests;
+            continue;
+        }
+
+        // 最终响应在对应的0x78之后按服务取用，重复的0x78不比对
+        if (record.direction == TraceRecord::PUSH) {
+            if (is_periodic(record.payload.data(), record.payload.size())) {
+                ++result.periodic_captured;
+            }
+            continue;
+        }
+
+        if (pending_requests.empty()) {
+            continue;   // 请求记录因缓冲区满被丢弃
+        }
+        const TraceRecord& request = trace.records[pending_requests.front()];
+        bool expect_nack = (record.flags & TraceRecord::FLAG_UNROUTED) != 0;
+
+        // 服务端对该请求不发送任何内容（例如抑制肯定响应），没有可比对的数据
+        if (record.payload.empty() && !expect_nack) {
+            ++result.matched;
+            sent_times.pop_front();
+            pending_requests.pop_front();
+            continue;
+        }
+
+        bool nack = false;
+        if (!reader->next(response, nack, result.error)) {
+            result.failed = true;
+            break;
+        }
+
+        result.histogram.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent_times.front()).count()));
+        sent_times.pop_front();
+        pending_requests.pop_front();
+        compare(request, record, expect_nack, response, nack);
+
+        // 服务端回复了0x78：等待该请求的最终响应，与抓包中同一服务的下一条最终响应比对
+        if (nack || !is_response_pending(response.data(), response.size())) {
+            continue;
+        }
+        uint8_t service_id = response[1];
+        if (!reader->next_final(service_id, response, result.error)) {
+            result.failed = true;
+            break;
+        }
+        std::deque<size_t>& finals = final_records[service_id];
+        if (finals.empty()) {
+            continue;   // 最终响应的推送记录因缓冲区满被丢弃
+        }
+        ++result.final_responses;
+        compare(request, trace.records[finals.front()], false, response, false);
+        finals.pop_front();
+    }
+
+    result.periodic_received = reader->periodic();
+    CLOSE_SOCKET(sock);
+}
+
+bool parse_options(int argc, char* argv[], ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            if (!options.trace_path.empty()) {
+                return false;
+            }
+            options.trace_path = arg;
+            continue;
+        }
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--host") {
+                options.host = value;
+            } else if (key == "--port") {
+                options.port = std::stoi(value);
+            } else if (key == "--speed") {
+                if (value == "original") {
+                    options.original_timing = true;
+                } else if (value == "max") {
+                    options.original_timing = false;
+                } else {
+                    return false;
+                }
+            } else if (key == "--scale") {
+                options.scale = std::stod(value);
+            } else if (key == "--framing") {
+                if (!parse_framing_mode(value, options.framing)) {
+                    return false;
+                }
+                options.framing_set = true;
+            } else if (key == "--max-diffs") {
+                options.max_diffs = static_cast<size_t>(std::stoul(value));
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return !options.trace_path.empty() && options.scale > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " <trace_file> [--host=127.0.0.1] [--port=8888]"
+                  << " [--speed=original|max] [--scale=F] [--framing=raw|length|doip] [--max-diffs=N]" << std::endl;
+        return 1;
+    }
+
+    Trace trace;
+    std::string error;
+    if (!load_trace(options.trace_path, trace, error)) {
+        std::cerr << "Failed to load trace: " << error << std::endl;
+        return 1;
+    }
+    if (!options.framing_set) {
+        options.framing = trace.framing;
+    }
+
+    // 按连接分组，连接内按时间排序（不同线程的记录在文件中可能交错）
+    std::map<uint32_t, std::vector<size_t>> connections;
+    uint64_t first_timestamp_ns = UINT64_MAX;
+    uint64_t last_timestamp_ns = 0;
+    for (size_t i = 0; i < trace.records.size(); ++i) {
+        connections[trace.records[i].connection_id].push_back(i);
+        first_timestamp_ns = std::min(first_timestamp_ns, trace.records[i].timestamp_ns);
+        last_timestamp_ns = std::max(last_timestamp_ns, trace.records[i].timestamp_ns);
+    }
+    if (connections.empty()) {
+        std::cerr << "Trace contains no records" << std::endl;
+        return 1;
+    }
+    for (std::map<uint32_t, std::vector<size_t>>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        std::stable_sort(it->second.begin(), it->second.end(), [&trace](size_t a, size_t b) {
+            return trace.records[a].timestamp_ns < trace.records[b].timestamp_ns;
+        });
+    }
+
+    #ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+    #endif
+
+    // 留出建立连接的时间，再统一开始计时
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+    std::vector<std::unique_ptr<ConnectionResult>> results;
+    std::vector<std::thread> workers;
+    for (std::map<uint32_t, std::vector<size_t>>::const_iterator it = connections.begin();
+         it != connections.end(); ++it) {
+        results.push_back(std::unique_ptr<ConnectionResult>(new ConnectionResult()));
+        workers.push_back(std::thread(replay_connection, std::cref(options), std::cref(trace), std::cref(it->second),
+                                      first_timestamp_ns, start, std::ref(*results.back())));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram total;
+    uint64_t requests = 0;
+    uint64_t matched = 0;
+    uint64_t mismatched = 0;
+    uint64_t periodic_captured = 0;
+    uint64_t periodic_received = 0;
+    uint64_t final_responses = 0;
+    size_t failed = 0;
+    size_t printed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ConnectionResult& result = *results[i];
+        total.merge(result.histogram);
+        requests += result.requests;
+        matched += result.matched;
+        mismatched += result.mismatched;
+        periodic_captured += result.periodic_captured;
+        periodic_received += result.periodic_received;
+        final_responses += result.final_responses;
+        for (size_t d = 0; d < result.diffs.size() && printed < options.max_diffs; ++d, ++printed) {
+            std::cout << "MISMATCH " << result.diffs[d] << std::endl;
+        }
+        if (result.failed) {
+            std::cerr << "connection " << i << ": " << result.error << std::endl;
+            ++failed;
+        }
+    }
+
+    const double us = 1000.0;
+    std::cout << "replayed " << requests << " request(s) on " << connections.size() << " connection(s), "
+              << (options.original_timing ? "original timing" : "max speed");
+    if (options.original_timing && options.scale != 1.0) {
+        std::cout << " x" << options.scale;
+    }
+    std::cout << std::endl << std::fixed << std::setprecision(3)
+              << "  trace span " << static_cast<double>(last_timestamp_ns - first_timestamp_ns) / 1e9
+              << " s, replay took " << elapsed_s << " s" << std::endl
+              << std::setprecision(1)
+              << "  matched " << matched << ", mismatched " << mismatched << ", failed connection(s) " << failed
+              << std::endl
+              << "  final responses after 0x78 " << final_responses << std::endl
+              << "  periodic frames captured " << periodic_captured << ", received " << periodic_received
+              << " (not compared)" << std::endl
+              << "  throughput " << static_cast<double>(requests) / elapsed_s << " req/s" << std::endl
+              << std::setprecision(2)
+              << "  latency us p50 " << total.percentile(50) / us << "  p99 " << total.percentile(99) / us
+              << "  max " << total.max() / us << std::endl;
+
+    #ifdef _WIN32
+    WSACleanup();
+    #endif
+    if (failed > 0) {
+        return 1;
+    }
+    return mismatched > 0 ? 2 : 0;
+}
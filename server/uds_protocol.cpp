@@ -30,6 +30,40 @@ UdsMessage parse_request(const std::vector<uint8_t>& raw_message) {
     return message;
 }
 
+// 原地解析UDS请求报文
+bool parse_request(const uint8_t* raw_message, size_t size, UdsRequestView& request) {
+    if (size == 0) {
+        return false;
+    }
+    
+    request.service_id = static_cast<ServiceID>(raw_message[0]);
+    request.has_did = size >= 3;
+    request.did = request.has_did ? static_cast<DID>((raw_message[1] << 8) | raw_message[2]) : 0;
+    request.payload = size > 3 ? ByteView(raw_message + 3, size - 3) : ByteView();
+    return true;
+}
+
+// 把正响应直接追加到out
+void encode_positive_response(ServiceID service_id, DID did, const uint8_t* data, size_t size,
+                              std::vector<uint8_t>& out) {
+    out.push_back(static_cast<uint8_t>(static_cast<uint8_t>(service_id) + 0x40));
+    append_did(out, did);
+    out.insert(out.end(), data, data + size);
+}
+
+// 把负响应直接追加到out
+void encode_negative_response(uint8_t service_id, ResponseCode response_code, std::vector<uint8_t>& out) {
+    out.push_back(static_cast<uint8_t>(ResponseCode::NEGATIVE_RESPONSE));
+    out.push_back(service_id);
+    out.push_back(static_cast<uint8_t>(response_code));
+}
+
+// 把DID按大端追加到out
+void append_did(std::vector<uint8_t>& out, DID did) {
+    out.push_back(static_cast<uint8_t>((did >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>(did & 0xFF));
+}
+
 // 生成UDS响应报文
 std::vector<uint8_t> generate_response(const UdsMessage& message) {
     std::vector<uint8_t> response;
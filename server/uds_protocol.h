@@ -3,15 +3,34 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace uds {
 
 // UDS服务ID
 enum class ServiceID : uint8_t {
+    DIAGNOSTIC_SESSION_CONTROL = 0x10,
     READ_DATA_BY_IDENTIFIER = 0x22,
-    WRITE_DATA_BY_IDENTIFIER = 0x2E
+    READ_DATA_BY_PERIODIC_IDENTIFIER = 0x2A,
+    DYNAMICALLY_DEFINE_DATA_IDENTIFIER = 0x2C,
+    WRITE_DATA_BY_IDENTIFIER = 0x2E,
+    REQUEST_DOWNLOAD = 0x34,
+    REQUEST_UPLOAD = 0x35,
+    TRANSFER_DATA = 0x36,
+    REQUEST_TRANSFER_EXIT = 0x37,
+    TESTER_PRESENT = 0x3E
 };
 
+// 诊断会话（0x10的子功能）
+enum class DiagnosticSession : uint8_t {
+    DEFAULT = 0x01,
+    PROGRAMMING = 0x02,
+    EXTENDED = 0x03
+};
+
+// 子功能字节的最高位：抑制肯定响应（suppressPosRspMsgIndicationBit）
+const uint8_t SUPPRESS_POSITIVE_RESPONSE = 0x80;
+
 // UDS响应码
 enum class ResponseCode : uint8_t {
     POSITIVE_RESPONSE = 0x7F,  // 注意：正响应是服务ID+0x40
@@ -20,6 +39,10 @@ enum class ResponseCode : uint8_t {
     SERVICE_NOT_SUPPORTED = 0x11,
     SUB_FUNCTION_NOT_SUPPORTED = 0x12,
     INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT = 0x13,
+    RESPONSE_TOO_LONG = 0x14,
+    BUSY_REPEAT_REQUEST = 0x21,
+    CONDITIONS_NOT_CORRECT = 0x22,
+    REQUEST_SEQUENCE_ERROR = 0x24,
     REQUEST_OUT_OF_RANGE = 0x31,
     SECURITY_ACCESS_DENIED = 0x33,
     INVALID_KEY = 0x35,
@@ -46,9 +69,39 @@ struct UdsMessage {
     ResponseCode response_code;
 };
 
+// 只读字节视图，不持有数据
+struct ByteView {
+    const uint8_t* data;
+    size_t size;
+
+    ByteView() : data(nullptr), size(0) {}
+    ByteView(const uint8_t* d, size_t n) : data(d), size(n) {}
+};
+
+// 原地解析的UDS请求：不复制报文，payload指向接收缓冲区中DID之后的数据
+struct UdsRequestView {
+    ServiceID service_id;
+    DID did;
+    bool has_did;       // 报文长度足以包含DID
+    ByteView payload;
+};
+
 // 解析UDS请求报文
 UdsMessage parse_request(const std::vector<uint8_t>& raw_message);
 
+// 原地解析UDS请求报文，报文为空时返回false
+bool parse_request(const uint8_t* raw_message, size_t size, UdsRequestView& request);
+
+// 把正响应（服务ID+0x40、DID、数据）直接追加到out
+void encode_positive_response(ServiceID service_id, DID did, const uint8_t* data, size_t size,
+                              std::vector<uint8_t>& out);
+
+// 把负响应（0x7F、原始服务ID、响应码）直接追加到out
+void encode_negative_response(uint8_t service_id, ResponseCode response_code, std::vector<uint8_t>& out);
+
+// 把DID按大端追加到out
+void append_did(std::vector<uint8_t>& out, DID did);
+
 // 生成UDS响应报文
 std::vector<uint8_t> generate_response(const UdsMessage& message);
 
@@ -4,6 +4,10 @@
 #include <cstring>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <bitset>
+#include <algorithm>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -13,26 +17,339 @@
     #define INVALID_SOCKET_VALUE INVALID_SOCKET
     #define CLOSE_SOCKET(s) closesocket(s)
     #define SOCKET_ERROR_VALUE SOCKET_ERROR
+    #define PUSH_SEND_FLAGS 0
+    #define SEND_FLAGS 0
+    #define SEND_MORE_FLAGS 0
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
+    #include <sys/uio.h>
     #include <unistd.h>
+    #include <signal.h>
+    #include <errno.h>
     typedef int SocketType;
     #define INVALID_SOCKET_VALUE -1
     #define CLOSE_SOCKET(s) close(s)
     #define SOCKET_ERROR_VALUE -1
+    #define PUSH_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+    #define SEND_FLAGS MSG_NOSIGNAL  // 对端已关闭时返回EPIPE而不是让进程收到SIGPIPE
+    // 后面紧跟文件片段的数据（如0x76响应头）：内核暂不发出，与sendfile的数据合并成满长度的TCP段
+    #ifdef MSG_MORE
+    #define SEND_MORE_FLAGS (MSG_NOSIGNAL | MSG_MORE)
+    #else
+    #define SEND_MORE_FLAGS MSG_NOSIGNAL
+    #endif
 #endif
 
 #include "uds_protocol.h"
 #include "did_manager.h"
+#include "uds_service.h"
+#include "ecu_gateway.h"
+#include "live_did.h"
+#include "frame_codec.h"
+#include "epoll_reactor.h"
+#include "io_uring_reactor.h"
+#include "metrics.h"
+#include "metrics_exporter.h"
+#include "frame_capture.h"
+#include "periodic_scheduler.h"
+#include "session_manager.h"
+#include "worker_pool.h"
+#include "block_transfer.h"
+#include "cpu_affinity.h"
+#include "push_channel.h"
+#include "logger.h"
 
 using namespace uds;
 
+// 服务端运行模式
+enum class ServerMode {
+    THREAD_PER_CLIENT,  // 每个客户端一个线程（默认）
+    EPOLL,              // 基于epoll的事件驱动模式，固定数量的事件循环线程
+    IO_URING            // 基于io_uring的事件驱动模式，内核不支持时退回epoll模式
+};
+
+// 服务端启动参数
+struct ServerOptions {
+    int port = 8888;
+    std::string data_file_path = "../data/did_data.json";
+    ServerMode mode = ServerMode::THREAD_PER_CLIENT;
+    size_t io_threads = 0;  // epoll/io_uring模式下的事件循环数量，0表示按CPU核数
+    int listen_backlog = SOMAXCONN;  // 监听队列长度（Linux下受net.core.somaxconn限制）
+    bool reuse_port = false;  // 每个事件循环（线程模式下每个接受连接线程）使用各自的SO_REUSEPORT监听socket
+    bool pin_cpus = false;    // 把事件循环（线程模式下接受连接线程）绑定到各自的CPU
+    size_t output_limit = ReactorOptions().output_limit;  // 每个连接待发数据的上限，超过时暂停读取（线程模式下为一次发送的响应上限）
+    int send_timeout_ms = 30000;  // 线程模式下阻塞发送的超时时间，超时断开客户端，0表示不超时
+    FramingMode framing = FramingMode::RAW;  // TCP分帧方式
+    PersistenceOptions persistence;          // DID数据持久化参数
+    ServiceOptions service;                  // 诊断服务参数
+    std::string ecu_config_path;             // 网关ECU配置文件，为空时只有默认ECU
+    std::string live_did_config_path;        // 默认ECU的实时DID配置文件，为空表示不启用
+    MetricsExportOptions metrics;            // 运行时指标的导出方式
+    std::string capture_path;                // 请求/响应抓包文件，为空表示不抓包
+    SessionManagerOptions sessions;          // 诊断会话与S3超时参数
+    WorkerPoolOptions workers;               // 慢服务的工作线程池参数
+    bool block_transfer = false;             // 是否支持0x34~0x37块传输（指定了映像目录时启用）
+    BlockTransferOptions transfers;          // 块传输参数
+};
+
+// 设置阻塞发送的超时时间，0表示不超时
+void set_send_timeout(SocketType client_socket, int timeout_ms) {
+    if (timeout_ms <= 0) {
+        return;
+    }
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(timeout_ms);
+#else
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+    setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// 关闭Nagle算法：应答报文和MSG_MORE合并后的尾段立即发出，不等对端的延迟ACK
+void set_no_delay(SocketType client_socket) {
+    int enabled = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+// 上一次发送失败是否因为发送超时
+bool send_timed_out() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// 阻塞发送全部数据，处理部分发送
+bool send_all(SocketType client_socket, const uint8_t* data, size_t size, int flags = SEND_FLAGS) {
+    size_t offset = 0;
+    while (offset < size) {
+        int bytes_sent = send(client_socket, reinterpret_cast<const char*>(data) + offset,
+                            static_cast<int>(size - offset), flags);
+        if (bytes_sent < 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(bytes_sent);
+    }
+    return true;
+}
+
+// 阻塞发送前后两段数据，两段合成一次sendmsg发出，处理部分发送
+bool send_all(SocketType client_socket, const uint8_t* first, size_t first_size,
+              const uint8_t* second, size_t second_size, int flags = SEND_FLAGS) {
+#ifdef _WIN32
+    return send_all(client_socket, first, first_size, flags) && send_all(client_socket, second, second_size, flags);
+#else
+    while (first_size + second_size > 0) {
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<uint8_t*>(first);
+        iov[0].iov_len = first_size;
+        iov[1].iov_base = const_cast<uint8_t*>(second);
+        iov[1].iov_len = second_size;
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = first_size > 0 ? iov : iov + 1;
+        message.msg_iovlen = first_size > 0 ? 2 : 1;
+        ssize_t bytes_sent = sendmsg(client_socket, &message, flags);
+        if (bytes_sent < 0) {
+            return false;
+        }
+        size_t sent = static_cast<size_t>(bytes_sent);
+        size_t from_first = std::min(sent, first_size);
+        first += from_first;
+        first_size -= from_first;
+        second += sent - from_first;
+        second_size -= sent - from_first;
+    }
+    return true;
+#endif
+}
+
+// 阻塞发送排队的推送数据和响应数据：推送数据与响应的第一段合成一次系统调用发出，
+// 响应中的文件片段在各自的位置用sendfile从文件直接发出；片段前的数据带MSG_MORE发送，
+// 不会作为单独的小段先发出（否则Nagle算法使片段数据等待对端确认）
+bool send_all(SocketType client_socket, const std::vector<uint8_t>& queued, const std::vector<uint8_t>& data,
+              const std::vector<FileSlice>& files) {
+    size_t offset = files.empty() ? data.size() : files[0].position;
+    if (!send_all(client_socket, queued.data(), queued.size(), data.data(), offset,
+                  files.empty() ? SEND_FLAGS : SEND_MORE_FLAGS)) {
+        return false;
+    }
+    for (size_t i = 0; i < files.size(); ++i) {
+        #ifdef _WIN32
+        return false;
+        #else
+        size_t sent = 0;
+        while (sent < files[i].size) {
+            long bytes_sent = send_file_slice(client_socket, files[i], sent);
+            if (bytes_sent <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(bytes_sent);
+        }
+        #endif
+        size_t next = i + 1 < files.size() ? files[i + 1].position : data.size();
+        if (!send_all(client_socket, data.data() + offset, next - offset,
+                      i + 1 < files.size() ? SEND_MORE_FLAGS : SEND_FLAGS)) {
+            return false;
+        }
+        offset = next;
+    }
+    return true;
+}
+
+// 每客户端一个线程模式下连接的推送通道
+// 客户端线程阻塞在recv上，推送数据由推送方线程以非阻塞方式直接发送；发不出去的部分在通道内排队，
+// 由之后的推送或客户端线程发送响应前先行发出，两路数据共用一把发送锁，字节流不会交错。
+// 客户端线程处理请求期间推送的数据（如工作线程的最终响应）暂存，等本次响应发出后再发送，不会超到响应前面
+class SocketChannel : public PushChannel {
+public:
+    // 排队的推送数据超过该值时丢弃新的可丢弃数据；不能丢弃的数据可以排到两倍，
+    // 周期数据占满队列时最终响应仍能排入，再超过时关闭连接
+    static const size_t MAX_PENDING_BYTES = 256 * 1024;
+
+    SocketChannel(FramingMode framing, SocketType client_socket)
+        : PushChannel(framing), socket_(client_socket), holding_(false), closed_(false), overflowed_(false),
+          appends_(0) {
+    }
+    
+    bool push(const uint8_t* data, size_t size, PushPolicy policy) override {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (closed_ || overflowed_) {
+                return false;
+            }
+            size_t limit = policy == PushPolicy::RELIABLE ? 2 * MAX_PENDING_BYTES : MAX_PENDING_BYTES;
+            if (pending_.size() + held_.size() + size > limit) {
+                if (policy == PushPolicy::LOSSY) {
+                    Metrics::instance().record_push_dropped();
+                    return true;
+                }
+                // 不能丢弃的数据排不下：关闭socket的收发，客户端线程的recv随之返回并关闭连接
+                UDS_LOG_WARN("Push queue overflow, closing client connection");
+                Metrics::instance().record_push_overflow_disconnect();
+                overflowed_ = true;
+                #ifdef _WIN32
+                shutdown(socket_, SD_BOTH);
+                #else
+                shutdown(socket_, SHUT_RDWR);
+                #endif
+                return false;
+            }
+            if (holding_) {
+                held_.insert(held_.end(), data, data + size);
+                return true;
+            }
+            pending_.insert(pending_.end(), data, data + size);
+            ++appends_;
+        }
+        try_flush();
+        return true;
+    }
+    
+    // 客户端线程开始处理请求：之后的推送数据暂存到send_response发出响应之后
+    void hold() {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        holding_ = true;
+    }
+    
+    // 客户端线程发送响应：排队的推送数据与响应（连同其中的文件片段）一起阻塞发出，然后放行处理期间暂存的推送数据
+    bool send_response(const std::vector<uint8_t>& data, const std::vector<FileSlice>& files) {
+        bool sent;
+        {
+            std::lock_guard<std::mutex> send_lock(send_mutex_);
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                sending_.swap(pending_);
+            }
+            sent = send_all(socket_, sending_, data, files);
+            Metrics::instance().add_bytes_sent(sending_.size());
+            sending_.clear();
+            
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            holding_ = false;
+            if (!held_.empty()) {
+                pending_.insert(pending_.end(), held_.begin(), held_.end());
+                held_.clear();
+                ++appends_;
+            }
+        }
+        // 发送期间到达的推送数据
+        try_flush();
+        return sent;
+    }
+    
+    // 客户端线程关闭socket前调用，之后的推送返回false
+    void close() {
+        std::lock_guard<std::mutex> send_lock(send_mutex_);
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        closed_ = true;
+        pending_.clear();
+        held_.clear();
+    }
+    
+private:
+    // 拿到发送锁时以非阻塞方式发出排队的数据；拿不到时由持有者在释放后处理。
+    // 发送期间又有新数据排队时再试一次
+    void try_flush() {
+        while (true) {
+            std::unique_lock<std::mutex> send_lock(send_mutex_, std::try_to_lock);
+            if (!send_lock.owns_lock()) {
+                return;
+            }
+            uint64_t flushed_appends;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                flushed_appends = appends_;
+                size_t offset = 0;
+                while (!closed_ && offset < pending_.size()) {
+                    int bytes_sent = send(socket_, reinterpret_cast<const char*>(pending_.data()) + offset,
+                                        static_cast<int>(pending_.size() - offset), PUSH_SEND_FLAGS);
+                    if (bytes_sent <= 0) {
+                        break;
+                    }
+                    offset += static_cast<size_t>(bytes_sent);
+                }
+                pending_.erase(pending_.begin(), pending_.begin() + offset);
+                Metrics::instance().add_bytes_sent(offset);
+            }
+            send_lock.unlock();
+
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (appends_ == flushed_appends || pending_.empty()) {
+                return;
+            }
+        }
+    }
+    
+    SocketType socket_;
+    std::mutex send_mutex_;          // 持有者独占socket的发送方向
+    std::mutex queue_mutex_;         // 保护以下成员
+    std::vector<uint8_t> pending_;   // 尚未发出的推送数据
+    std::vector<uint8_t> sending_;   // 客户端线程正在发送的推送数据，只在持有send_mutex_时访问
+    std::vector<uint8_t> held_;      // 处理请求期间暂存的推送数据
+    bool holding_;
+    bool closed_;
+    bool overflowed_;                // 不能丢弃的数据排不下，已关闭socket的收发
+    uint64_t appends_;               // 推送次数，用于发现发送期间新排队的数据
+};
+
+const size_t SocketChannel::MAX_PENDING_BYTES;
+
 class UDSServer {
 public:
-    UDSServer(int port, const std::string& data_file_path)
-        : port_(port), did_manager_(data_file_path) {
+    UDSServer(const ServerOptions& options)
+        : port_(options.port), options_(options), did_manager_(options.data_file_path, options.persistence),
+          session_manager_(options.sessions),
+          worker_pool_(options.workers), block_transfer_(options.transfers),
+          gateway_(with_services(options.service, &periodic_scheduler_, &session_manager_, &worker_pool_,
+                                 options.block_transfer ? &block_transfer_ : nullptr)),
+          metrics_exporter_(options.metrics) {
     }
     
     ~UDSServer() {
@@ -40,109 +357,274 @@ public:
     }
     
     bool start() {
+        // 登记默认ECU（数据文件，可叠加实时DID）和配置文件中的模板ECU
+        if (gateway_.ecu_count() == 0) {
+            std::string error;
+            DidSource* default_source = &did_manager_;
+            if (!options_.live_did_config_path.empty()) {
+                live_dids_.reset(new LiveDidSource(did_manager_));
+                if (!live_dids_->load_config(options_.live_did_config_path, error)) {
+                    UDS_LOG_ERROR("Failed to load live DIDs: %s", error.c_str());
+                    return false;
+                }
+                default_source = live_dids_.get();
+                UDS_LOG_INFO("%zu live DID(s) on the default ECU", live_dids_->size());
+            }
+            if (!gateway_.add_ecu(DOIP_ENTITY_ADDRESS, *default_source, error) ||
+                (!options_.ecu_config_path.empty() && !gateway_.load_config(options_.ecu_config_path, error))) {
+                UDS_LOG_ERROR("Failed to set up ECUs: %s", error.c_str());
+                return false;
+            }
+            if (!options_.ecu_config_path.empty()) {
+                UDS_LOG_INFO("Gateway hosting %zu ECUs from %zu template(s)",
+                             gateway_.ecu_count(), gateway_.template_count());
+            }
+        }
+        
         #ifdef _WIN32
         // 初始化Winsock
         WSADATA wsa_data;
         int result = WSAStartup(MAKEWORD(2, 2), &wsa_data);
         if (result != 0) {
-            std::cerr << "WSAStartup failed: " << result << std::endl;
+            UDS_LOG_ERROR("WSAStartup failed: %d", result);
             return false;
         }
         #endif
         
-        // 创建socket
-        server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_socket_ == INVALID_SOCKET_VALUE) {
-            std::cerr << "Failed to create socket" << std::endl;
-            #ifdef _WIN32
-            WSACleanup();
-            #endif
+        // 指标端点与定期转储
+        if (!metrics_exporter_.start()) {
             return false;
         }
         
-        // 设置socket选项：允许地址重用
-        int opt = 1;
-        if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, 
-                      reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
-            std::cerr << "setsockopt failed" << std::endl;
-            CLOSE_SOCKET(server_socket_);
-            #ifdef _WIN32
-            WSACleanup();
-            #endif
-            return false;
+        // 0x2A周期数据调度与S3超时检查
+        periodic_scheduler_.start();
+        session_manager_.start();
+        
+        // 慢服务的工作线程池
+        worker_pool_.start();
+        if (worker_pool_.threads() > 0) {
+            UDS_LOG_INFO("%zu worker thread(s) for offloaded services", worker_pool_.threads());
+        }
+        if (options_.block_transfer) {
+            UDS_LOG_INFO("Block transfer images in %s (max block length %u)", options_.transfers.directory.c_str(),
+                         options_.transfers.max_block_length);
         }
         
-        // 绑定socket到地址和端口
-        sockaddr_in server_addr;
-        std::memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(port_);
+        // 抓包
+        if (!options_.capture_path.empty()) {
+            std::string error;
+            if (!FrameCapture::instance().start(options_.capture_path, options_.framing, error)) {
+                UDS_LOG_ERROR("Failed to start capture: %s", error.c_str());
+                return false;
+            }
+            UDS_LOG_INFO("Capturing requests and responses to %s", options_.capture_path.c_str());
+        }
         
-        if (bind(server_socket_, reinterpret_cast<struct sockaddr*>(&server_addr), 
-                sizeof(server_addr)) < 0) {
-            std::cerr << "Bind failed" << std::endl;
-            CLOSE_SOCKET(server_socket_);
-            #ifdef _WIN32
-            WSACleanup();
+        // 事件循环数量；启用SO_REUSEPORT时每个事件循环（线程模式下每个接受连接线程）各有一个监听socket
+        size_t io_threads = options_.io_threads;
+        if (io_threads == 0) {
+            io_threads = std::thread::hardware_concurrency();
+        }
+        if (io_threads == 0) {
+            io_threads = 1;
+        }
+        size_t listeners = 1;
+        if (options_.reuse_port) {
+            #ifdef SO_REUSEPORT
+            listeners = io_threads;
+            #else
+            UDS_LOG_WARN("SO_REUSEPORT is not supported on this platform, using a single listen socket");
             #endif
-            return false;
         }
         
-        // 开始监听
-        if (listen(server_socket_, 5) < 0) {
-            std::cerr << "Listen failed" << std::endl;
-            CLOSE_SOCKET(server_socket_);
-            #ifdef _WIN32
-            WSACleanup();
-            #endif
-            return false;
+        for (size_t i = 0; i < listeners; ++i) {
+            SocketType listen_socket = open_listener(listeners > 1);
+            if (listen_socket == INVALID_SOCKET_VALUE) {
+                close_listeners();
+                #ifdef _WIN32
+                WSACleanup();
+                #endif
+                return false;
+            }
+            listen_sockets_.push_back(listen_socket);
         }
         
-        std::cout << "UDS Server started, listening on port " << port_ << std::endl;
+        UDS_LOG_INFO("UDS Server started, listening on port %d (%zu listen socket(s), backlog %d)", port_,
+                     listen_sockets_.size(), options_.listen_backlog);
         
-        // 启动接受连接的线程
         is_running_ = true;
-        accept_thread_ = std::thread(&UDSServer::accept_connections, this);
+        
+        std::vector<int> listen_fds(listen_sockets_.begin(), listen_sockets_.end());
+        ReactorOptions reactor_options;
+        reactor_options.loops = io_threads;
+        reactor_options.pin_cpus = options_.pin_cpus;
+        reactor_options.output_limit = options_.output_limit;
+        ServerMode mode = options_.mode;
+        if (mode == ServerMode::IO_URING) {
+            if (IoUringReactor::is_supported()) {
+                uring_reactor_.reset(new IoUringReactor(reactor_options, options_.framing,
+                    [this](const Frame& frame, std::vector<uint8_t>& out) {
+                        return route_request(frame, out);
+                    }));
+                if (uring_reactor_->start(listen_fds)) {
+                    return true;
+                }
+                uring_reactor_.reset();
+                UDS_LOG_WARN("Failed to start io_uring reactor, falling back to epoll mode");
+            } else {
+                UDS_LOG_WARN("io_uring mode is not supported by this kernel, falling back to epoll mode");
+            }
+            mode = ServerMode::EPOLL;
+        }
+        
+        if (mode == ServerMode::EPOLL) {
+            if (EpollReactor::is_supported()) {
+                // 事件驱动模式：由固定数量的事件循环线程服务所有连接
+                reactor_.reset(new EpollReactor(reactor_options, options_.framing,
+                    [this](const Frame& frame, std::vector<uint8_t>& out) {
+                        return route_request(frame, out);
+                    }));
+                if (reactor_->start(listen_fds)) {
+                    return true;
+                }
+                reactor_.reset();
+                UDS_LOG_WARN("Failed to start epoll reactor, falling back to thread-per-client mode");
+            } else {
+                UDS_LOG_WARN("Epoll mode is not supported on this platform, falling back to thread-per-client mode");
+            }
+        }
+        
+        // 启动接受连接的线程，每个监听socket一个
+        for (size_t i = 0; i < listen_sockets_.size(); ++i) {
+            accept_threads_.push_back(std::thread(&UDSServer::accept_connections, this, listen_sockets_[i], i));
+        }
         
         return true;
     }
     
+    // 请求后台线程重新加载DID数据文件，可在信号处理函数中调用
+    void request_data_reload() {
+        did_manager_.request_reload();
+    }
+    
+    // 请求后台线程把DID数据的一致快照导出到数据文件旁，可在信号处理函数中调用
+    void request_data_export() {
+        did_manager_.request_export();
+    }
+    
     void stop() {
         is_running_ = false;
         
-        // 关闭服务器socket
-        if (server_socket_ != INVALID_SOCKET_VALUE) {
-            CLOSE_SOCKET(server_socket_);
-            server_socket_ = INVALID_SOCKET_VALUE;
+        // 先停止工作线程、S3超时检查和周期推送，之后不再访问连接和ECU
+        worker_pool_.stop();
+        session_manager_.stop();
+        periodic_scheduler_.stop();
+        
+        // 停止事件循环
+        if (reactor_) {
+            reactor_->stop();
+            reactor_.reset();
+        }
+        if (uring_reactor_) {
+            uring_reactor_->stop();
+            uring_reactor_.reset();
         }
         
-        // 等待接受连接线程结束
-        if (accept_thread_.joinable()) {
-            accept_thread_.join();
+        metrics_exporter_.stop();
+        FrameCapture::instance().stop();
+        
+        // 关闭监听socket，并等待接受连接的线程结束
+        close_listeners();
+        for (size_t i = 0; i < accept_threads_.size(); ++i) {
+            accept_threads_[i].join();
         }
+        accept_threads_.clear();
         
         #ifdef _WIN32
         WSACleanup();
         #endif
         
-        std::cout << "UDS Server stopped" << std::endl;
+        UDS_LOG_INFO("UDS Server stopped");
     }
     
 private:
-    void accept_connections() {
+    // 创建、绑定并开始监听一个socket，失败时返回INVALID_SOCKET_VALUE
+    SocketType open_listener(bool reuse_port) {
+        SocketType listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_socket == INVALID_SOCKET_VALUE) {
+            UDS_LOG_ERROR("Failed to create socket");
+            return INVALID_SOCKET_VALUE;
+        }
+        
+        // 设置socket选项：允许地址重用；多个监听socket时还需允许绑定同一端口，由内核按连接分配
+        int opt = 1;
+        if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, 
+                      reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+            UDS_LOG_ERROR("setsockopt failed");
+            CLOSE_SOCKET(listen_socket);
+            return INVALID_SOCKET_VALUE;
+        }
+        #ifdef SO_REUSEPORT
+        if (reuse_port && setsockopt(listen_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            UDS_LOG_ERROR("setsockopt(SO_REUSEPORT) failed");
+            CLOSE_SOCKET(listen_socket);
+            return INVALID_SOCKET_VALUE;
+        }
+        #else
+        (void)reuse_port;
+        #endif
+        
+        // 绑定socket到地址和端口
+        sockaddr_in server_addr;
+        std::memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(port_);
+        
+        if (bind(listen_socket, reinterpret_cast<struct sockaddr*>(&server_addr), 
+                sizeof(server_addr)) < 0) {
+            UDS_LOG_ERROR("Bind failed");
+            CLOSE_SOCKET(listen_socket);
+            return INVALID_SOCKET_VALUE;
+        }
+        
+        // 开始监听；重连风暴时队列太短会丢弃SYN，客户端要等约1秒重传
+        if (listen(listen_socket, options_.listen_backlog) < 0) {
+            UDS_LOG_ERROR("Listen failed");
+            CLOSE_SOCKET(listen_socket);
+            return INVALID_SOCKET_VALUE;
+        }
+        return listen_socket;
+    }
+    
+    // 关闭所有监听socket（Linux下需先shutdown才能唤醒阻塞在accept上的线程）
+    void close_listeners() {
+        for (size_t i = 0; i < listen_sockets_.size(); ++i) {
+            #ifndef _WIN32
+            shutdown(listen_sockets_[i], SHUT_RDWR);
+            #endif
+            CLOSE_SOCKET(listen_sockets_[i]);
+        }
+        listen_sockets_.clear();
+    }
+    
+    // 线程模式下接受一个监听socket上的连接；绑定CPU时，之后创建的客户端线程继承同一CPU
+    void accept_connections(SocketType listen_socket, size_t index) {
+        if (options_.pin_cpus && !pin_current_thread(index)) {
+            UDS_LOG_WARN("Failed to pin accept thread %zu to a CPU", index);
+        }
         while (is_running_) {
             sockaddr_in client_addr;
             socklen_t client_addr_len = sizeof(client_addr);
             
             // 接受客户端连接
-            SocketType client_socket = accept(server_socket_, 
+            SocketType client_socket = accept(listen_socket, 
                                             reinterpret_cast<struct sockaddr*>(&client_addr), 
                                             &client_addr_len);
             
             if (client_socket == INVALID_SOCKET_VALUE) {
                 if (is_running_) {
-                    std::cerr << "Accept failed" << std::endl;
+                    UDS_LOG_ERROR("Accept failed");
                 }
                 continue;
             }
@@ -150,128 +632,359 @@ private:
             // 获取客户端IP地址
             char client_ip[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
-            std::cout << "New client connected: " << client_ip << std::endl;
+            UDS_LOG_INFO("New client connected: %s", client_ip);
+            Metrics::instance().connection_opened();
             
             // 为每个客户端创建一个处理线程
-            std::thread client_thread(&UDSServer::handle_client, this, client_socket, client_ip);
+            std::thread client_thread(&UDSServer::handle_client, this, client_socket, std::string(client_ip));
             client_thread.detach();
         }
     }
     
     void handle_client(SocketType client_socket, const std::string& client_ip) {
-        const int BUFFER_SIZE = 1024;
-        char buffer[BUFFER_SIZE];
+        const int BUFFER_SIZE = 16384;
+        
+        // 每个连接一个重组缓冲区和一个输出缓冲区，在连接生命周期内复用
+        FrameDecoder decoder(options_.framing);
+        std::shared_ptr<SocketChannel> channel = std::make_shared<SocketChannel>(options_.framing, client_socket);
+        decoder.set_push_channel(channel.get());
+        RequestHandler handler = [this](const Frame& frame, std::vector<uint8_t>& out) {
+            return route_request(frame, out);
+        };
+        std::vector<uint8_t> response_data;
+        std::vector<FileSlice> response_files;
+        #ifndef _WIN32
+        decoder.set_file_slices(&response_files);
+        #endif
+        // 客户端长时间不读取响应时断开，不让它一直占着客户端线程
+        set_send_timeout(client_socket, options_.send_timeout_ms);
+        set_no_delay(client_socket);
         
         while (is_running_) {
-            // 接收客户端数据
-            std::memset(buffer, 0, BUFFER_SIZE);
-            int bytes_received = recv(client_socket, buffer, BUFFER_SIZE, 0);
+            // 接收客户端数据，直接写入重组缓冲区；大报文未收全时按剩余长度一次接收
+            int size = static_cast<int>(std::max<size_t>(BUFFER_SIZE, decoder.missing()));
+            char* buffer = reinterpret_cast<char*>(decoder.prepare(static_cast<size_t>(size)));
+            int bytes_received = recv(client_socket, buffer, size, 0);
             
             if (bytes_received <= 0) {
                 if (bytes_received == 0) {
-                    std::cout << "Client disconnected: " << client_ip << std::endl;
+                    UDS_LOG_INFO("Client disconnected: %s", client_ip.c_str());
                 } else {
-                    std::cerr << "Receive failed from client: " << client_ip << std::endl;
+                    UDS_LOG_WARN("Receive failed from client: %s", client_ip.c_str());
                 }
                 break;
             }
             
-            // 处理接收到的数据
-            std::vector<uint8_t> request_data(buffer, buffer + bytes_received);
-            std::vector<uint8_t> response_data = process_request(request_data);
-            
-            // 发送响应
-            int bytes_sent = send(client_socket, reinterpret_cast<const char*>(response_data.data()), 
-                                response_data.size(), 0);
+            // 处理本次收到的所有完整请求，响应按请求顺序合并发送；
+            // 每次最多解码出output_limit字节的响应，发出后再处理剩下的请求，一次接收中的大量请求不会一次积压在内存中
+            decoder.commit(static_cast<size_t>(bytes_received));
+            Metrics::instance().add_bytes_received(static_cast<size_t>(bytes_received));
+            bool keep_open = true;
+            bool frames_held = true;
+            bool sent = true;
+            while (keep_open && frames_held) {
+                response_data.clear();
+                channel->hold();
+                keep_open = process_frames(decoder, handler, response_data, options_.output_limit);
+                size_t response_bytes = response_data.size() + file_slice_bytes(response_files);
+                frames_held = response_bytes >= options_.output_limit;
+                
+                // 发送响应（连同之前未发出的推送数据）
+                sent = channel->send_response(response_data, response_files);
+                response_files.clear();
+                if (!sent) {
+                    break;
+                }
+                Metrics::instance().add_bytes_sent(response_bytes);
+            }
+            if (!sent) {
+                if (send_timed_out()) {
+                    UDS_LOG_WARN("Send timed out, disconnecting slow client: %s", client_ip.c_str());
+                    Metrics::instance().record_slow_client_disconnect();
+                } else {
+                    UDS_LOG_WARN("Send failed to client: %s", client_ip.c_str());
+                }
+                break;
+            }
             
-            if (bytes_sent < 0) {
-                std::cerr << "Send failed to client: " << client_ip << std::endl;
+            if (!keep_open) {
+                UDS_LOG_WARN("Invalid frame from client: %s", client_ip.c_str());
+                Metrics::instance().record_invalid_frame();
                 break;
             }
         }
         
-        // 关闭客户端socket
+        // 关闭客户端socket；调度器中的订阅在下次推送失败时删除
+        channel->close();
         CLOSE_SOCKET(client_socket);
+        Metrics::instance().connection_closed();
     }
     
-    std::vector<uint8_t> process_request(const std::vector<uint8_t>& request_data) {
-        // 解析UDS请求
-        UdsMessage request = parse_request(request_data);
-        UdsMessage response = request;
-        response.is_positive_response = true;
-        
-        // 处理不同的服务
-        switch (request.service_id) {
-            case ServiceID::READ_DATA_BY_IDENTIFIER:
-                handle_read_data_by_identifier(request, response);
-                break;
-            
-            case ServiceID::WRITE_DATA_BY_IDENTIFIER:
-                handle_write_data_by_identifier(request, response);
-                break;
-            
-            default:
-                response.is_positive_response = false;
-                response.response_code = ResponseCode::SERVICE_NOT_SUPPORTED;
-                break;
+    // 按目标地址把请求交给网关中的ECU；不带地址的分帧方式总是发往默认ECU
+    // 同时按服务记录请求数、负响应和处理耗时；开启抓包时记录请求与响应
+    bool route_request(const Frame& frame, std::vector<uint8_t>& out) {
+        uint16_t target_address = options_.framing == FramingMode::DOIP ? frame.target_address : DOIP_ENTITY_ADDRESS;
+        size_t response_start = out.size();
+        FrameCapture& capture = FrameCapture::instance();
+        bool capturing = capture.active();
+        if (capturing) {
+            capture.record(TraceRecord::REQUEST, frame, frame.request.data, frame.request.size, 0);
         }
-        
-        // 生成响应报文
-        return generate_response(response);
-    }
-    
-    void handle_read_data_by_identifier(const UdsMessage& request, UdsMessage& response) {
-        std::vector<uint8_t> data;
-        if (did_manager_.read_did(request.did, data)) {
-            response.data = data;
-            response.is_positive_response = true;
-        } else {
-            response.is_positive_response = false;
-            response.response_code = ResponseCode::REQUEST_OUT_OF_RANGE;
+        RequestContext context;
+        context.connection_id = frame.connection_id;
+        context.tester_address = frame.source_address;
+        context.ecu_address = target_address;
+        context.protocol_version = frame.protocol_version;
+        context.channel = frame.channel;
+        // 抓包需要完整的响应内容，抓包时文件数据复制到响应中
+        context.files = capturing ? nullptr : frame.files;
+        Metrics::Clock::time_point start = Metrics::Clock::now();
+        bool routed = gateway_.process_request(context, frame.request.data, frame.request.size, out);
+        if (!routed) {
+            Metrics::instance().record_unrouted_request();
+        } else if (frame.request.size > 0) {
+            uint64_t latency_ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Metrics::Clock::now() - start).count());
+            Metrics::instance().record_request(frame.request.data[0], out.data() + response_start,
+                                               out.size() - response_start, latency_ns);
+        }
+        if (capturing) {
+            capture.record(TraceRecord::RESPONSE, frame, out.data() + response_start, out.size() - response_start,
+                           routed ? 0 : TraceRecord::FLAG_UNROUTED);
         }
+        return routed;
     }
     
-    void handle_write_data_by_identifier(const UdsMessage& request, UdsMessage& response) {
-        if (did_manager_.write_did(request.did, request.data)) {
-            response.data = request.data;
-            response.is_positive_response = true;
-        } else {
-            response.is_positive_response = false;
-            response.response_code = ResponseCode::GENERAL_PROGRAMMING_FAILURE;
+    static ServiceOptions with_services(const ServiceOptions& options, PeriodicScheduler* scheduler,
+                                        SessionManager* sessions, WorkerPool* workers,
+                                        BlockTransferManager* transfers) {
+        ServiceOptions result = options;
+        result.periodic_scheduler = scheduler;
+        result.session_manager = sessions;
+        result.block_transfer = transfers;
+        if (workers->threads() > 0) {
+            result.worker_pool = workers;
         }
+        return result;
     }
     
     int port_;
-    SocketType server_socket_ = INVALID_SOCKET_VALUE;
-    bool is_running_ = false;
-    std::thread accept_thread_;
+    ServerOptions options_;
+    std::vector<SocketType> listen_sockets_;
+    std::atomic<bool> is_running_{false};
+    std::vector<std::thread> accept_threads_;
+    std::unique_ptr<EpollReactor> reactor_;
+    std::unique_ptr<IoUringReactor> uring_reactor_;
     DIDManager did_manager_;
+    std::unique_ptr<LiveDidSource> live_dids_;
+    PeriodicScheduler periodic_scheduler_;
+    SessionManager session_manager_;
+    WorkerPool worker_pool_;
+    BlockTransferManager block_transfer_;
+    EcuGateway gateway_;
+    MetricsExporter metrics_exporter_;
 };
 
+// 解析逗号分隔的十六进制服务ID列表（如"2E,2C"）
+bool parse_service_list(const std::string& list, std::bitset<256>& services) {
+    size_t begin = 0;
+    while (begin < list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        unsigned long service_id = std::stoul(list.substr(begin, end - begin), nullptr, 16);
+        if (service_id > 0xFF) {
+            std::cerr << "Invalid service ID: " << list.substr(begin, end - begin) << std::endl;
+            return false;
+        }
+        services.set(service_id);
+        begin = end + 1;
+    }
+    return true;
+}
+
+// 解析命令行参数：[端口] [数据文件] [--mode=thread|epoll|io_uring] [--threads=N] [--framing=raw|length|doip]
+//                 [--fsync=always|interval|never] [--compact-interval-ms=N] [--watch-data] [--max-response-length=N]
+//                 [--ecus=配置文件] [--live-dids=配置文件] [--metrics-port=N] [--metrics-file=文件] [--metrics-interval-ms=N]
+//                 [--log-level=trace|debug|info|warn|error|off] [--capture=抓包文件]
+//                 [--s3-ms=N] [--non-default-services=2E,2C,...]
+//                 [--workers=N] [--worker-queue=N] [--offload-services=2E,...]
+//                 [--transfer-dir=映像目录] [--transfer-block=N]
+//                 [--backlog=N] [--reuseport] [--pin-cpus] [--output-limit=N] [--send-timeout-ms=N]
+bool parse_options(int argc, char* argv[], ServerOptions& options) {
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--mode=") == 0) {
+            std::string mode = arg.substr(7);
+            if (mode == "thread") {
+                options.mode = ServerMode::THREAD_PER_CLIENT;
+            } else if (mode == "epoll") {
+                options.mode = ServerMode::EPOLL;
+            } else if (mode == "io_uring") {
+                options.mode = ServerMode::IO_URING;
+            } else {
+                std::cerr << "Unknown server mode: " << mode << std::endl;
+                return false;
+            }
+        } else if (arg.compare(0, 10, "--framing=") == 0) {
+            if (!parse_framing_mode(arg.substr(10), options.framing)) {
+                std::cerr << "Unknown framing mode: " << arg.substr(10) << std::endl;
+                return false;
+            }
+        } else if (arg.compare(0, 8, "--fsync=") == 0) {
+            if (!parse_fsync_policy(arg.substr(8), options.persistence.fsync_policy)) {
+                std::cerr << "Unknown fsync policy: " << arg.substr(8) << std::endl;
+                return false;
+            }
+        } else if (arg.compare(0, 22, "--compact-interval-ms=") == 0) {
+            options.persistence.compact_interval_ms = std::stoi(arg.substr(22));
+        } else if (arg == "--watch-data") {
+            options.persistence.watch_file = true;
+        } else if (arg.compare(0, 22, "--max-response-length=") == 0) {
+            options.service.max_response_length = static_cast<size_t>(std::stoul(arg.substr(22)));
+        } else if (arg.compare(0, 7, "--ecus=") == 0) {
+            options.ecu_config_path = arg.substr(7);
+        } else if (arg.compare(0, 12, "--live-dids=") == 0) {
+            options.live_did_config_path = arg.substr(12);
+        } else if (arg.compare(0, 15, "--metrics-port=") == 0) {
+            options.metrics.http_port = std::stoi(arg.substr(15));
+        } else if (arg.compare(0, 15, "--metrics-file=") == 0) {
+            options.metrics.dump_file_path = arg.substr(15);
+        } else if (arg.compare(0, 22, "--metrics-interval-ms=") == 0) {
+            options.metrics.dump_interval_ms = std::stoi(arg.substr(22));
+        } else if (arg.compare(0, 12, "--log-level=") == 0) {
+            LogLevel level;
+            if (!parse_log_level(arg.substr(12), level)) {
+                std::cerr << "Unknown log level: " << arg.substr(12) << std::endl;
+                return false;
+            }
+            Logger::instance().set_level(level);
+        } else if (arg.compare(0, 10, "--capture=") == 0) {
+            options.capture_path = arg.substr(10);
+        } else if (arg.compare(0, 8, "--s3-ms=") == 0) {
+            options.sessions.s3_ms = static_cast<uint32_t>(std::stoul(arg.substr(8)));
+        } else if (arg.compare(0, 23, "--non-default-services=") == 0) {
+            // 这些服务只能在扩展/编程会话中使用
+            if (!parse_service_list(arg.substr(23), options.service.non_default_services)) {
+                return false;
+            }
+        } else if (arg.compare(0, 10, "--workers=") == 0) {
+            options.workers.threads = static_cast<size_t>(std::stoul(arg.substr(10)));
+        } else if (arg.compare(0, 15, "--worker-queue=") == 0) {
+            options.workers.queue_capacity = static_cast<size_t>(std::stoul(arg.substr(15)));
+        } else if (arg.compare(0, 19, "--offload-services=") == 0) {
+            if (!parse_service_list(arg.substr(19), options.service.offloaded_services)) {
+                return false;
+            }
+        } else if (arg.compare(0, 15, "--transfer-dir=") == 0) {
+            options.block_transfer = true;
+            options.transfers.directory = arg.substr(15);
+        } else if (arg.compare(0, 17, "--transfer-block=") == 0) {
+            // 一个块须能放进一条请求帧（解码器的载荷上限为1MB，DoIP载荷含4字节地址）
+            unsigned long block_length = std::stoul(arg.substr(17));
+            if (block_length < 3 || block_length > 1024 * 1024 - 4) {
+                std::cerr << "Invalid transfer block length: " << arg.substr(17) << std::endl;
+                return false;
+            }
+            options.transfers.max_block_length = static_cast<uint32_t>(block_length);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            options.io_threads = static_cast<size_t>(std::stoul(arg.substr(10)));
+        } else if (arg.compare(0, 10, "--backlog=") == 0) {
+            options.listen_backlog = std::stoi(arg.substr(10));
+            if (options.listen_backlog <= 0) {
+                std::cerr << "Invalid listen backlog: " << arg.substr(10) << std::endl;
+                return false;
+            }
+        } else if (arg == "--reuseport") {
+            options.reuse_port = true;
+        } else if (arg == "--pin-cpus") {
+            options.pin_cpus = true;
+        } else if (arg.compare(0, 15, "--output-limit=") == 0) {
+            options.output_limit = static_cast<size_t>(std::stoul(arg.substr(15)));
+            if (options.output_limit == 0) {
+                std::cerr << "Invalid output limit: " << arg.substr(15) << std::endl;
+                return false;
+            }
+        } else if (arg.compare(0, 18, "--send-timeout-ms=") == 0) {
+            options.send_timeout_ms = std::stoi(arg.substr(18));
+        } else if (positional == 0) {
+            options.port = std::stoi(arg);
+            ++positional;
+        } else if (positional == 1) {
+            options.data_file_path = arg;
+            ++positional;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    // 启用工作线程池但未指定服务时，交给线程池的是可能等待落盘的2E写入
+    if (options.workers.threads > 0 && options.service.offloaded_services.none()) {
+        options.service.offloaded_services.set(static_cast<uint8_t>(ServiceID::WRITE_DATA_BY_IDENTIFIER));
+    }
+    return true;
+}
+
+#ifndef _WIN32
+// SIGHUP时重新加载DID数据文件，SIGUSR1时导出DID数据快照；
+// 处理函数只置位标志，由DIDManager的后台线程完成加载或导出
+UDSServer* signal_target = nullptr;
+
+void handle_data_signal(int sig) {
+    if (signal_target == nullptr) {
+        return;
+    }
+    if (sig == SIGHUP) {
+        signal_target->request_data_reload();
+    } else {
+        signal_target->request_data_export();
+    }
+}
+#endif
+
 int main(int argc, char* argv[]) {
-    int port = 8888;
-    std::string data_file_path = "../data/did_data.json";
-    
-    // 解析命令行参数
-    if (argc > 1) {
-        port = std::stoi(argv[1]);
+    ServerOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [port] [data_file] [--mode=thread|epoll|io_uring] [--threads=N] [--framing=raw|length|doip]"
+                  << " [--fsync=always|interval|never] [--compact-interval-ms=N] [--watch-data] [--max-response-length=N]"
+                  << " [--ecus=FILE] [--live-dids=FILE] [--metrics-port=N] [--metrics-file=FILE] [--metrics-interval-ms=N]"
+                  << " [--log-level=trace|debug|info|warn|error|off] [--capture=FILE]"
+                  << " [--s3-ms=N] [--non-default-services=2E,2C,...]"
+                  << " [--workers=N] [--worker-queue=N] [--offload-services=2E,...]"
+                  << " [--transfer-dir=DIR] [--transfer-block=N]"
+                  << " [--backlog=N] [--reuseport] [--pin-cpus] [--output-limit=N] [--send-timeout-ms=N]" << std::endl;
+        return 1;
     }
     
-    if (argc > 2) {
-        data_file_path = argv[2];
-    }
+    UDSServer server(options);
     
-    UDSServer server(port, data_file_path);
+    #ifndef _WIN32
+    signal_target = &server;
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_data_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGHUP, &action, nullptr);
+    sigaction(SIGUSR1, &action, nullptr);
+    #endif
     
     if (!server.start()) {
-        std::cerr << "Failed to start UDS Server" << std::endl;
+        UDS_LOG_ERROR("Failed to start UDS Server");
         return 1;
     }
     
+    // 启动日志先于提示输出
+    Logger::instance().flush();
     std::cout << "Press Enter to stop the server..." << std::endl;
     std::cin.get();
     
     server.stop();
+    #ifndef _WIN32
+    signal_target = nullptr;
+    #endif
     
     return 0;
 }
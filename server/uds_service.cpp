@@ -0,0 +1,531 @@
+#include "uds_service.h"
+#include "periodic_scheduler.h"
+#include "session_manager.h"
+#include "worker_pool.h"
+#include "block_transfer.h"
+#include "epoch.h"
+#include <algorithm>
+
+namespace uds {
+
+namespace {
+
+// 每个线程一份批量读取的临时数组，容量增长后复用，不在每次请求中分配
+thread_local std::vector<DidLookup> t_lookups;
+
+} // namespace
+
+UdsService::UdsService(DidSource& did_source, const ServiceOptions& options)
+    : did_source_(did_source), options_(options), dynamic_dids_(nullptr) {
+}
+
+UdsService::~UdsService() {
+    delete dynamic_dids_.load(std::memory_order_relaxed);
+}
+
+DynamicDidTable& UdsService::dynamic_dids() {
+    DynamicDidTable* table = dynamic_dids_.load(std::memory_order_acquire);
+    if (table == nullptr) {
+        // 并发创建时只保留先发布的一个
+        DynamicDidTable* created = new DynamicDidTable();
+        if (dynamic_dids_.compare_exchange_strong(table, created, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+            table = created;
+        } else {
+            delete created;
+        }
+    }
+    return *table;
+}
+
+void UdsService::process_request(const uint8_t* request_data, size_t size, std::vector<uint8_t>& out) {
+    process_request(RequestContext(), request_data, size, out);
+}
+
+void UdsService::process_request(const RequestContext& context, const uint8_t* request_data, size_t size,
+                                 std::vector<uint8_t>& out) {
+    UdsRequestView request;
+    if (!parse_request(request_data, size, request)) {
+        encode_negative_response(0x00, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    // 每条请求都算作测试端的活动，重置S3计时；没有会话管理时总在默认会话
+    SessionManager* sessions = options_.session_manager;
+    DiagnosticSession session = sessions != nullptr ? sessions->touch(*this, context) : DiagnosticSession::DEFAULT;
+    uint8_t service_id = static_cast<uint8_t>(request.service_id);
+    if (session == DiagnosticSession::DEFAULT && options_.non_default_services.test(service_id)) {
+        encode_negative_response(service_id, ResponseCode::SERVICE_NOT_SUPPORTED_IN_ACTIVE_SESSION, out);
+        return;
+    }
+
+    // 慢服务交给工作线程池，连接线程不等待；不支持推送的连接仍在本线程处理
+    if (options_.worker_pool != nullptr && context.channel != nullptr && options_.offloaded_services.test(service_id)) {
+        offload(context, session, request_data, size, out);
+        return;
+    }
+    dispatch(context, session, request, request_data, size, out);
+}
+
+void UdsService::dispatch(const RequestContext& context, DiagnosticSession session, const UdsRequestView& request,
+                          const uint8_t* request_data, size_t size, std::vector<uint8_t>& out) {
+    switch (request.service_id) {
+        case ServiceID::DIAGNOSTIC_SESSION_CONTROL:
+            handle_diagnostic_session_control(context, session, request_data, size, out);
+            break;
+
+        case ServiceID::TESTER_PRESENT:
+            handle_tester_present(request_data, size, out);
+            break;
+
+        case ServiceID::READ_DATA_BY_IDENTIFIER:
+            handle_read_data_by_identifier(request, out);
+            break;
+
+        case ServiceID::WRITE_DATA_BY_IDENTIFIER:
+            handle_write_data_by_identifier(request, out);
+            break;
+
+        case ServiceID::DYNAMICALLY_DEFINE_DATA_IDENTIFIER:
+            handle_dynamically_define_data_identifier(request_data, size, out);
+            break;
+
+        case ServiceID::READ_DATA_BY_PERIODIC_IDENTIFIER:
+            handle_read_data_by_periodic_identifier(context, request_data, size, out);
+            break;
+
+        case ServiceID::REQUEST_DOWNLOAD:
+        case ServiceID::REQUEST_UPLOAD:
+            handle_request_transfer(context, request_data, size, out);
+            break;
+
+        case ServiceID::TRANSFER_DATA:
+            handle_transfer_data(context, request_data, size, out);
+            break;
+
+        case ServiceID::REQUEST_TRANSFER_EXIT:
+            handle_request_transfer_exit(context, out);
+            break;
+
+        default:
+            encode_negative_response(static_cast<uint8_t>(request.service_id),
+                                     ResponseCode::SERVICE_NOT_SUPPORTED, out);
+            break;
+    }
+}
+
+void UdsService::offload(const RequestContext& context, DiagnosticSession session, const uint8_t* request_data,
+                         size_t size, std::vector<uint8_t>& out) {
+    uint8_t service_id = request_data[0];
+    // 接收缓冲区在返回后即被复用，请求复制一份交给工作线程
+    std::vector<uint8_t> request(request_data, request_data + size);
+    WorkerPool::Job job = [this, session, request](const RequestContext& job_context, std::vector<uint8_t>& job_out) {
+        UdsRequestView view;
+        parse_request(request.data(), request.size(), view);
+        dispatch(job_context, session, view, request.data(), request.size(), job_out);
+    };
+    // 在P2*到期前留出余量重复发送0x78
+    uint32_t repeat_ms = options_.p2_star_ms - options_.p2_star_ms / 10;
+    if (!options_.worker_pool->submit(context, service_id, repeat_ms, job)) {
+        encode_negative_response(service_id, ResponseCode::BUSY_REPEAT_REQUEST, out);
+        return;
+    }
+    encode_negative_response(service_id, ResponseCode::REQUEST_CORRECTLY_RECEIVED_BUT_RESPONSE_PENDING, out);
+}
+
+std::vector<uint8_t> UdsService::process_request(const std::vector<uint8_t>& request) {
+    std::vector<uint8_t> response;
+    process_request(request.data(), request.size(), response);
+    return response;
+}
+
+size_t UdsService::read_dids(DidLookup* lookups, size_t count) const {
+    size_t found = did_source_.read_dids(lookups, count);
+    const DynamicDidTable* dynamic = dynamic_dids_.load(std::memory_order_acquire);
+    if (dynamic != nullptr) {
+        found += dynamic->resolve(did_source_, lookups, count);
+    }
+    return found;
+}
+
+void UdsService::end_session(const RequestContext& context) {
+    if (options_.periodic_scheduler != nullptr) {
+        options_.periodic_scheduler->unsubscribe_all(*this, context);
+    }
+    if (options_.block_transfer != nullptr) {
+        options_.block_transfer->abort(*this, context);
+    }
+}
+
+// 请求格式：0x10 + 会话类型（最高位为抑制肯定响应）
+// 响应格式：0x50 + 会话类型 + P2（2字节，毫秒）+ P2*（2字节，10毫秒为单位）
+// 默认会话不能直接进入编程会话（NRC 0x7E）；回到默认会话时停止该测试端在本ECU上的周期DID
+void UdsService::handle_diagnostic_session_control(const RequestContext& context, DiagnosticSession current,
+                                                   const uint8_t* request, size_t size, std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::DIAGNOSTIC_SESSION_CONTROL);
+    if (size != 2) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    uint8_t sub_function = request[1] & static_cast<uint8_t>(~SUPPRESS_POSITIVE_RESPONSE);
+    SessionManager* sessions = options_.session_manager;
+    bool supported = sub_function == static_cast<uint8_t>(DiagnosticSession::DEFAULT) ||
+                     (sessions != nullptr && (sub_function == static_cast<uint8_t>(DiagnosticSession::PROGRAMMING) ||
+                                              sub_function == static_cast<uint8_t>(DiagnosticSession::EXTENDED)));
+    if (!supported) {
+        encode_negative_response(service_id, ResponseCode::SUB_FUNCTION_NOT_SUPPORTED, out);
+        return;
+    }
+
+    DiagnosticSession target = static_cast<DiagnosticSession>(sub_function);
+    if (target == DiagnosticSession::PROGRAMMING && current == DiagnosticSession::DEFAULT) {
+        encode_negative_response(service_id, ResponseCode::SUB_FUNCTION_NOT_SUPPORTED_IN_ACTIVE_SESSION, out);
+        return;
+    }
+    if (sessions != nullptr) {
+        DiagnosticSession previous = sessions->change(*this, context, target);
+        if (target == DiagnosticSession::DEFAULT && previous != DiagnosticSession::DEFAULT) {
+            end_session(context);
+        }
+    }
+
+    if (request[1] & SUPPRESS_POSITIVE_RESPONSE) {
+        return;
+    }
+    uint16_t p2_star = static_cast<uint16_t>(options_.p2_star_ms / 10);
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+    out.push_back(sub_function);
+    out.push_back(static_cast<uint8_t>(options_.p2_ms >> 8));
+    out.push_back(static_cast<uint8_t>(options_.p2_ms & 0xFF));
+    out.push_back(static_cast<uint8_t>(p2_star >> 8));
+    out.push_back(static_cast<uint8_t>(p2_star & 0xFF));
+}
+
+// 请求格式：0x3E + 0x00（最高位为抑制肯定响应）；响应格式：0x7E + 0x00
+// S3计时已在分发前重置，这里只负责应答
+void UdsService::handle_tester_present(const uint8_t* request, size_t size, std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::TESTER_PRESENT);
+    if (size != 2) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+    if ((request[1] & static_cast<uint8_t>(~SUPPRESS_POSITIVE_RESPONSE)) != 0x00) {
+        encode_negative_response(service_id, ResponseCode::SUB_FUNCTION_NOT_SUPPORTED, out);
+        return;
+    }
+    if (request[1] & SUPPRESS_POSITIVE_RESPONSE) {
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+    out.push_back(0x00);
+}
+
+// 请求格式：0x22 + N个2字节DID；响应格式：0x62 + N组（DID + 数据）
+// 不支持的DID从响应中略去，全部不支持时返回NRC 0x31；动态DID按0x2C定义的复制计划拼出
+void UdsService::handle_read_data_by_identifier(const UdsRequestView& request, std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(request.service_id);
+    size_t did_count = request.has_did ? 1 + request.payload.size / 2 : 0;
+    if (!request.has_did || request.payload.size % 2 != 0 || did_count > options_.max_dids_per_read) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    std::vector<DidLookup>& lookups = t_lookups;
+    if (lookups.size() < did_count) {
+        lookups.resize(did_count);
+    }
+    lookups[0].did = request.did;
+    for (size_t i = 1; i < did_count; ++i) {
+        const uint8_t* p = request.payload.data + 2 * (i - 1);
+        lookups[i].did = static_cast<DID>((p[0] << 8) | p[1]);
+    }
+
+    // 持有Guard期间视图有效，所有DID在同一张表上一次查完，数据直接从DID表复制到输出缓冲区
+    EpochManager::Guard guard;
+    size_t found = read_dids(lookups.data(), did_count);
+    if (found == 0) {
+        encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+        return;
+    }
+
+    size_t response_length = 1;
+    for (size_t i = 0; i < did_count; ++i) {
+        if (lookups[i].found) {
+            response_length += 2 + lookups[i].view.size();
+        }
+    }
+    if (options_.max_response_length != 0 && response_length > options_.max_response_length) {
+        encode_negative_response(service_id, ResponseCode::RESPONSE_TOO_LONG, out);
+        return;
+    }
+
+    // 按响应总长度预留空间，逐项追加时不再扩容；out在流水线中被多条响应复用，
+    // 扩容时至少翻倍，保持几何增长，避免每条响应都重新分配
+    size_t needed = out.size() + response_length;
+    if (needed > out.capacity()) {
+        out.reserve(std::max(out.capacity() * 2, needed));
+    }
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+    for (size_t i = 0; i < did_count; ++i) {
+        if (lookups[i].found) {
+            append_did(out, lookups[i].did);
+            out.insert(out.end(), lookups[i].view.data(), lookups[i].view.data() + lookups[i].view.size());
+        }
+    }
+}
+
+void UdsService::handle_write_data_by_identifier(const UdsRequestView& request, std::vector<uint8_t>& out) {
+    if (!request.has_did) {
+        encode_negative_response(static_cast<uint8_t>(request.service_id),
+                                 ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    if (did_source_.write_did(request.did, request.payload.data, request.payload.size)) {
+        encode_positive_response(request.service_id, request.did,
+                                 request.payload.data, request.payload.size, out);
+    } else {
+        encode_negative_response(static_cast<uint8_t>(request.service_id),
+                                 ResponseCode::GENERAL_PROGRAMMING_FAILURE, out);
+    }
+}
+
+// 请求格式：0x2C + 子功能 + 参数
+//   0x01 按标识符定义：动态DID + N组（源DID、起始位置（从1开始）、字节数）
+//   0x03 清除：[动态DID]，不带DID时清除全部
+// 响应格式：0x6C + 子功能 [+ 动态DID]。不支持按内存地址定义（0x02）
+void UdsService::handle_dynamically_define_data_identifier(const uint8_t* request, size_t size,
+                                                           std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::DYNAMICALLY_DEFINE_DATA_IDENTIFIER);
+    if (size < 2) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    uint8_t sub_function = request[1];
+    DID did = size >= 4 ? static_cast<DID>((request[2] << 8) | request[3]) : 0;
+    switch (sub_function) {
+        case 0x01: {
+            if (size < 8 || (size - 4) % 4 != 0) {
+                encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+                return;
+            }
+            size_t count = (size - 4) / 4;
+            if (count > DynamicDidTable::MAX_ELEMENTS) {
+                encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+                return;
+            }
+            DynamicDidElement elements[DynamicDidTable::MAX_ELEMENTS];
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t* p = request + 4 + 4 * i;
+                elements[i].source = static_cast<DID>((p[0] << 8) | p[1]);
+                elements[i].position = p[2];
+                elements[i].size = p[3];
+            }
+            ResponseCode nrc;
+            if (!dynamic_dids().define(did, elements, count, did_source_, nrc)) {
+                encode_negative_response(service_id, nrc, out);
+                return;
+            }
+            break;
+        }
+
+        case 0x03:
+            if (size == 2) {
+                dynamic_dids().clear_all();
+            } else if (size == 4) {
+                if (!DynamicDidTable::is_dynamic(did)) {
+                    encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+                    return;
+                }
+                dynamic_dids().clear(did);
+            } else {
+                encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+                return;
+            }
+            break;
+
+        default:
+            encode_negative_response(service_id, ResponseCode::SUB_FUNCTION_NOT_SUPPORTED, out);
+            return;
+    }
+
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+    out.push_back(sub_function);
+    if (size >= 4) {
+        append_did(out, did);
+    }
+}
+
+// 请求格式：0x2A + 发送方式 + N个周期DID（0xF2xx的低字节）
+//   发送方式0x01/0x02/0x03按慢/中/快速率发送，0x04停止（不带周期DID时停止本连接在该ECU上的全部周期DID）
+// 响应格式：0x6A；之后由调度器按速率推送周期报文：0x6A + 周期DID + 数据
+// 开始发送时所有周期DID必须当前可读，否则返回NRC 0x31；连接不支持推送时返回NRC 0x22
+void UdsService::handle_read_data_by_periodic_identifier(const RequestContext& context, const uint8_t* request,
+                                                         size_t size, std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::READ_DATA_BY_PERIODIC_IDENTIFIER);
+    PeriodicScheduler* scheduler = options_.periodic_scheduler;
+    if (scheduler == nullptr) {
+        encode_negative_response(service_id, ResponseCode::SERVICE_NOT_SUPPORTED, out);
+        return;
+    }
+    if (size < 2) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    uint8_t mode = request[1];
+    const uint8_t* pdids = request + 2;
+    size_t count = size - 2;
+    if (mode < 0x01 || mode > 0x04) {
+        encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+        return;
+    }
+    if ((mode != 0x04 && count == 0) || count > options_.max_dids_per_read) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    if (mode == 0x04) {
+        if (count == 0) {
+            scheduler->unsubscribe_all(*this, context);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                scheduler->unsubscribe(*this, context, pdids[i]);
+            }
+        }
+    } else {
+        if (context.channel == nullptr) {
+            encode_negative_response(service_id, ResponseCode::CONDITIONS_NOT_CORRECT, out);
+            return;
+        }
+
+        std::vector<DidLookup>& lookups = t_lookups;
+        if (lookups.size() < count) {
+            lookups.resize(count);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            lookups[i].did = static_cast<DID>(0xF200 | pdids[i]);
+            lookups[i].found = false;
+        }
+        {
+            EpochManager::Guard guard;
+            if (read_dids(lookups.data(), count) != count) {
+                encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+                return;
+            }
+        }
+
+        PeriodicRate rate = mode == 0x01 ? PeriodicRate::SLOW
+                          : mode == 0x02 ? PeriodicRate::MEDIUM
+                                         : PeriodicRate::FAST;
+        for (size_t i = 0; i < count; ++i) {
+            scheduler->subscribe(*this, context, pdids[i], rate);
+        }
+    }
+
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+}
+
+// 请求格式：0x34/0x35 + dataFormatIdentifier + addressAndLengthFormatIdentifier + 内存地址 + 内存大小
+//   dataFormatIdentifier只支持0x00（不压缩、不加密）；地址与大小各1~4字节，长度由格式字节的低/高4位给出
+// 响应格式：0x74/0x75 + lengthFormatIdentifier + maxNumberOfBlockLength（含0x36与块序号）
+// 测试端在本ECU上已有传输时返回NRC 0x22，映像文件无法创建时返回NRC 0x70，上传的映像不存在或过短时返回NRC 0x31
+void UdsService::handle_request_transfer(const RequestContext& context, const uint8_t* request, size_t size,
+                                         std::vector<uint8_t>& out) {
+    uint8_t service_id = request[0];
+    BlockTransferManager* transfers = options_.block_transfer;
+    if (transfers == nullptr) {
+        encode_negative_response(service_id, ResponseCode::SERVICE_NOT_SUPPORTED, out);
+        return;
+    }
+    if (size < 3) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    size_t address_length = request[2] & 0x0F;
+    size_t size_length = request[2] >> 4;
+    if (request[1] != 0x00 || address_length < 1 || address_length > 4 || size_length < 1 || size_length > 4) {
+        encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+        return;
+    }
+    if (size != 3 + address_length + size_length) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+    uint32_t address = 0;
+    uint32_t memory_size = 0;
+    for (size_t i = 0; i < address_length; ++i) {
+        address = (address << 8) | request[3 + i];
+    }
+    for (size_t i = 0; i < size_length; ++i) {
+        memory_size = (memory_size << 8) | request[3 + address_length + i];
+    }
+    if (memory_size == 0) {
+        encode_negative_response(service_id, ResponseCode::REQUEST_OUT_OF_RANGE, out);
+        return;
+    }
+
+    ResponseCode nrc;
+    bool upload = service_id == static_cast<uint8_t>(ServiceID::REQUEST_UPLOAD);
+    if (!transfers->start(*this, context, upload, address, memory_size, nrc)) {
+        encode_negative_response(service_id, nrc, out);
+        return;
+    }
+
+    // maxNumberOfBlockLength按实际需要的字节数编码
+    uint32_t block_length = transfers->max_block_length();
+    size_t length_bytes = 1;
+    while (length_bytes < 4 && (block_length >> (8 * length_bytes)) != 0) {
+        ++length_bytes;
+    }
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+    out.push_back(static_cast<uint8_t>(length_bytes << 4));
+    for (size_t i = length_bytes; i > 0; --i) {
+        out.push_back(static_cast<uint8_t>(block_length >> (8 * (i - 1))));
+    }
+}
+
+// 请求格式：0x36 + 块序号 [+ 数据（下载）]；响应格式：0x76 + 块序号 [+ 数据（上传）]
+// 没有进行中的传输时返回NRC 0x24，块序号既不是下一个也不是上一个（重发）时返回NRC 0x73，
+// 下载的数据超出memorySize时返回NRC 0x71
+void UdsService::handle_transfer_data(const RequestContext& context, const uint8_t* request, size_t size,
+                                      std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::TRANSFER_DATA);
+    BlockTransferManager* transfers = options_.block_transfer;
+    if (transfers == nullptr) {
+        encode_negative_response(service_id, ResponseCode::SERVICE_NOT_SUPPORTED, out);
+        return;
+    }
+    if (size < 2) {
+        encode_negative_response(service_id, ResponseCode::INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT, out);
+        return;
+    }
+
+    ResponseCode nrc;
+    if (!transfers->transfer(*this, context, request[1], request + 2, size - 2, out, nrc)) {
+        encode_negative_response(service_id, nrc, out);
+    }
+}
+
+// 请求格式：0x37 [+ transferRequestParameterRecord（忽略）]；响应格式：0x77
+// 没有进行中的传输或数据未传完时返回NRC 0x24（未传完的传输同时被放弃）
+void UdsService::handle_request_transfer_exit(const RequestContext& context, std::vector<uint8_t>& out) {
+    uint8_t service_id = static_cast<uint8_t>(ServiceID::REQUEST_TRANSFER_EXIT);
+    BlockTransferManager* transfers = options_.block_transfer;
+    if (transfers == nullptr) {
+        encode_negative_response(service_id, ResponseCode::SERVICE_NOT_SUPPORTED, out);
+        return;
+    }
+
+    ResponseCode nrc;
+    if (!transfers->finish(*this, context, nrc)) {
+        encode_negative_response(service_id, nrc, out);
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(service_id + 0x40));
+}
+
+} // namespace uds
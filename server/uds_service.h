@@ -0,0 +1,105 @@
+#ifndef UDS_SERVICE_H
+#define UDS_SERVICE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <bitset>
+#include "uds_protocol.h"
+#include "did_source.h"
+#include "dynamic_did.h"
+
+namespace uds {
+
+class PushChannel;
+class PeriodicScheduler;
+class SessionManager;
+class WorkerPool;
+class BlockTransferManager;
+struct FileSlice;
+
+// 服务参数
+struct ServiceOptions {
+    size_t max_response_length = 0;   // 响应报文最大长度，超出时返回NRC 0x14；0表示不限制
+    size_t max_dids_per_read = 256;   // 一条0x22请求中允许的DID数量上限，超出时返回NRC 0x13
+    PeriodicScheduler* periodic_scheduler = nullptr;  // 0x2A周期数据调度器，为空时不支持0x2A
+    SessionManager* session_manager = nullptr;        // 会话与S3超时管理，为空时只有默认会话
+    std::bitset<256> non_default_services;            // 只能在非默认会话中使用的服务，默认会话中返回NRC 0x7F
+    uint16_t p2_ms = 50;                              // 0x10正响应中报告的P2（毫秒）
+    uint16_t p2_star_ms = 5000;                       // 0x10正响应中报告的P2*（毫秒）
+    WorkerPool* worker_pool = nullptr;                // 慢服务的工作线程池，为空时所有服务在调用线程上处理
+    std::bitset<256> offloaded_services;              // 交给工作线程池处理的服务，先回复NRC 0x78
+    BlockTransferManager* block_transfer = nullptr;   // 0x34~0x37块传输，为空时不支持这些服务
+};
+
+// 请求的来源：所属连接与地址，需要连接状态或向连接推送报文的服务据此区分测试端
+struct RequestContext {
+    uint32_t connection_id = 0;
+    uint16_t tester_address = 0;      // DoIP源地址
+    uint16_t ecu_address = 0;         // DoIP目标地址
+    uint8_t protocol_version = 0x02;  // DoIP协议版本，推送报文沿用
+    PushChannel* channel = nullptr;   // 连接的推送通道，为空表示不支持推送
+    std::vector<FileSlice>* files = nullptr;  // 连接的文件片段表，为空时文件数据复制到响应中
+};
+
+// UDS诊断服务分发
+// 原地解析请求并把响应直接编码到调用者提供的输出缓冲区：
+// 输出缓冲区按连接复用时，一次请求/响应往返不在堆上分配内存
+class UdsService {
+public:
+    explicit UdsService(DidSource& did_source, const ServiceOptions& options = ServiceOptions());
+    ~UdsService();
+
+    // 处理一条请求报文，把响应报文追加到out
+    void process_request(const uint8_t* request, size_t size, std::vector<uint8_t>& out);
+
+    // 处理来自context所在连接的一条请求报文，把响应报文追加到out
+    void process_request(const RequestContext& context, const uint8_t* request, size_t size,
+                         std::vector<uint8_t>& out);
+
+    // 处理一条请求报文，返回响应报文（每次分配新的vector）
+    std::vector<uint8_t> process_request(const std::vector<uint8_t>& request);
+
+    // 批量读取DID的当前值，动态DID按0x2C的定义拼出，返回找到的个数；调用者需持有EpochManager::Guard
+    size_t read_dids(DidLookup* lookups, size_t count) const;
+
+private:
+    friend class SessionManager;
+
+    // 测试端回到默认会话（0x10切换或S3超时）时调用：停止它在本ECU上的周期DID，放弃未完成的块传输
+    void end_session(const RequestContext& context);
+
+    // 按服务ID分发已通过会话检查的请求
+    void dispatch(const RequestContext& context, DiagnosticSession session, const UdsRequestView& request,
+                  const uint8_t* request_data, size_t size, std::vector<uint8_t>& out);
+
+    // 把请求交给工作线程池并回复NRC 0x78，最终响应由工作线程经推送通道发送；队列已满时回复NRC 0x21
+    void offload(const RequestContext& context, DiagnosticSession session, const uint8_t* request_data, size_t size,
+                 std::vector<uint8_t>& out);
+
+    void handle_diagnostic_session_control(const RequestContext& context, DiagnosticSession current,
+                                           const uint8_t* request, size_t size, std::vector<uint8_t>& out);
+    void handle_tester_present(const uint8_t* request, size_t size, std::vector<uint8_t>& out);
+    void handle_read_data_by_identifier(const UdsRequestView& request, std::vector<uint8_t>& out);
+    void handle_write_data_by_identifier(const UdsRequestView& request, std::vector<uint8_t>& out);
+    void handle_dynamically_define_data_identifier(const uint8_t* request, size_t size, std::vector<uint8_t>& out);
+    void handle_read_data_by_periodic_identifier(const RequestContext& context, const uint8_t* request, size_t size,
+                                                 std::vector<uint8_t>& out);
+    void handle_request_transfer(const RequestContext& context, const uint8_t* request, size_t size,
+                                 std::vector<uint8_t>& out);
+    void handle_transfer_data(const RequestContext& context, const uint8_t* request, size_t size,
+                              std::vector<uint8_t>& out);
+    void handle_request_transfer_exit(const RequestContext& context, std::vector<uint8_t>& out);
+
+    // 动态DID表，第一次使用0x2C时才创建
+    DynamicDidTable& dynamic_dids();
+
+    DidSource& did_source_;
+    ServiceOptions options_;
+    std::atomic<DynamicDidTable*> dynamic_dids_;
+};
+
+} // namespace uds
+
+#endif // UDS_SERVICE_H
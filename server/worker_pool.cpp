@@ -0,0 +1,217 @@
+#include "worker_pool.h"
+#include "uds_service.h"
+#include "push_channel.h"
+#include "frame_codec.h"
+#include "frame_capture.h"
+
+namespace uds {
+
+WorkerPool::WorkerPool(const WorkerPoolOptions& options)
+    : options_(options),
+      tick_ns_(static_cast<uint64_t>(options.tick_ms == 0 ? 1 : options.tick_ms) * 1000000ULL),
+      epoch_(Clock::now()),
+      in_flight_(0),
+      running_(false) {
+    stats_.completed = 0;
+    stats_.rejected = 0;
+    stats_.repeats = 0;
+    stats_.undelivered = 0;
+    stats_.queued = 0;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+bool WorkerPool::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || options_.threads == 0) {
+        return true;
+    }
+    running_ = true;
+    for (size_t i = 0; i < options_.threads; ++i) {
+        workers_.push_back(std::thread(&WorkerPool::work, this));
+    }
+    timer_thread_ = std::thread(&WorkerPool::run_timer, this);
+    return true;
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    work_cv_.notify_all();
+    timer_cv_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+    workers_.clear();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+
+    // 丢弃尚未开始处理的请求
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        wheel_.cancel(queue_[i]);
+        delete queue_[i];
+    }
+    in_flight_ -= queue_.size();
+    queue_.clear();
+}
+
+bool WorkerPool::submit(const RequestContext& context, uint8_t service_id, uint32_t repeat_ms, const Job& job) {
+    Task* task = new Task();
+    task->job = job;
+    task->channel = context.channel->shared_from_this();
+    task->connection_id = context.connection_id;
+    task->tester_address = context.tester_address;
+    task->ecu_address = context.ecu_address;
+    task->protocol_version = context.protocol_version;
+    task->service_id = service_id;
+    task->repeat_ticks = repeat_ms == 0 ? 0 : (static_cast<uint64_t>(repeat_ms) * 1000000ULL) / tick_ns_;
+    if (repeat_ms != 0 && task->repeat_ticks == 0) {
+        task->repeat_ticks = 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || in_flight_ >= options_.queue_capacity) {
+            ++stats_.rejected;
+            delete task;
+            return false;
+        }
+        ++in_flight_;
+        queue_.push_back(task);
+        if (task->repeat_ticks != 0) {
+            uint64_t now = now_tick();
+            bool was_idle = wheel_.empty();
+            if (was_idle) {
+                // 空闲期间时间轮没有推进，先跳到当前节拍
+                std::vector<TimerWheel::Timer*> none;
+                wheel_.advance(now, none);
+            }
+            wheel_.schedule(task, now + task->repeat_ticks);
+            if (was_idle) {
+                timer_cv_.notify_one();
+            }
+        }
+    }
+    work_cv_.notify_one();
+    return true;
+}
+
+WorkerPoolStats WorkerPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerPoolStats stats = stats_;
+    stats.queued = in_flight_;
+    return stats;
+}
+
+void WorkerPool::work() {
+    // 最终响应直接编码到帧头之后，缓冲区在请求之间复用
+    std::vector<uint8_t> frame;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        while (running_ && queue_.empty()) {
+            work_cv_.wait(lock);
+        }
+        if (!running_) {
+            return;
+        }
+        Task* task = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+
+        RequestContext context;
+        context.connection_id = task->connection_id;
+        context.tester_address = task->tester_address;
+        context.ecu_address = task->ecu_address;
+        context.protocol_version = task->protocol_version;
+        context.channel = task->channel.get();
+        FramingMode framing = task->channel->framing();
+        frame.clear();
+        size_t header_offset = begin_message(framing, task->ecu_address, task->tester_address,
+                                             task->protocol_version, frame);
+        size_t body_offset = frame.size();
+        task->job(context, frame);
+        if (frame.size() > body_offset) {
+            end_response(framing, header_offset, frame);
+        }
+
+        lock.lock();
+        wheel_.cancel(task);
+        if (frame.size() > body_offset) {
+            // 最终响应不能丢弃：连接排不下时由传输层关闭，测试端不会一直等待
+            if (!task->channel->push(frame.data(), frame.size(), PushPolicy::RELIABLE)) {
+                ++stats_.undelivered;
+            }
+            record_push(*task, frame, body_offset);
+        }
+        --in_flight_;
+        ++stats_.completed;
+        delete task;
+    }
+}
+
+void WorkerPool::run_timer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<TimerWheel::Timer*> expired;
+    while (running_) {
+        if (wheel_.empty()) {
+            timer_cv_.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline =
+            epoch_ + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(wheel_.current() * tick_ns_));
+        if (Clock::now() < deadline) {
+            timer_cv_.wait_until(lock, deadline);
+            continue;
+        }
+
+        // 到期的请求仍在排队或处理中：再推送一次0x78，并登记下一次
+        uint64_t now = now_tick();
+        expired.clear();
+        wheel_.advance(now, expired);
+        for (size_t i = 0; i < expired.size(); ++i) {
+            Task* task = static_cast<Task*>(expired[i]);
+            push_pending(*task);
+            ++stats_.repeats;
+            wheel_.schedule(task, now + task->repeat_ticks);
+        }
+    }
+}
+
+// 调用者需持有mutex_
+void WorkerPool::push_pending(const Task& task) {
+    FramingMode framing = task.channel->framing();
+    pending_frame_.clear();
+    size_t header_offset = begin_message(framing, task.ecu_address, task.tester_address,
+                                         task.protocol_version, pending_frame_);
+    size_t body_offset = pending_frame_.size();
+    encode_negative_response(task.service_id, ResponseCode::REQUEST_CORRECTLY_RECEIVED_BUT_RESPONSE_PENDING,
+                             pending_frame_);
+    end_response(framing, header_offset, pending_frame_);
+    task.channel->push(pending_frame_.data(), pending_frame_.size(), PushPolicy::RELIABLE);
+    record_push(task, pending_frame_, body_offset);
+}
+
+// 抓包时把推送的报文记为PUSH，回放工具据此比对0x78之后的最终响应
+void WorkerPool::record_push(const Task& task, const std::vector<uint8_t>& frame, size_t body_offset) {
+    FrameCapture& capture = FrameCapture::instance();
+    if (capture.active()) {
+        capture.record(TraceRecord::PUSH, task.connection_id, task.tester_address, task.ecu_address,
+                       frame.data() + body_offset, frame.size() - body_offset, 0);
+    }
+}
+
+uint64_t WorkerPool::now_tick() const {
+    Clock::time_point now = Clock::now();
+    if (now <= epoch_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - epoch_).count()) / tick_ns_;
+}
+
+} // namespace uds
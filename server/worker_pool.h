@@ -0,0 +1,107 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "timer_wheel.h"
+
+namespace uds {
+
+class PushChannel;
+struct RequestContext;
+
+// 工作线程池参数
+struct WorkerPoolOptions {
+    size_t threads = 0;            // 工作线程数，0表示不启用（所有服务在连接线程上处理）
+    size_t queue_capacity = 1024;  // 排队和正在处理的请求总数上限，超出时拒绝
+    uint32_t tick_ms = 10;         // 重复发送0x78的计时粒度
+};
+
+// 工作线程池统计
+struct WorkerPoolStats {
+    uint64_t completed;   // 已处理完并推送最终响应的请求数
+    uint64_t rejected;    // 队列满被拒绝的请求数
+    uint64_t repeats;     // 处理超过P2*时重复发送的0x78次数
+    uint64_t undelivered; // 连接已关闭或推送队列排不下（随之断开），未能送出最终响应的请求数
+    size_t queued;        // 当前排队和正在处理的请求数
+};
+
+// 慢服务的有界工作线程池
+// 连接线程把请求交给线程池后立即回复NRC 0x78（ResponsePending），不等待处理结果；
+// 工作线程处理完后经连接的推送通道发送最终响应（不可丢弃，排不下时传输层关闭连接）。处理时间接近P2*时由计时线程再推送一次0x78，
+// 每个请求在时间轮中只有一个定时器。最终响应与重复的0x78在同一把锁下推送，最终响应之后不会再有0x78
+class WorkerPool {
+public:
+    // 处理一条请求，把响应报文追加到out；context带有连接的推送通道
+    typedef std::function<void(const RequestContext& context, std::vector<uint8_t>& out)> Job;
+
+    explicit WorkerPool(const WorkerPoolOptions& options = WorkerPoolOptions());
+    ~WorkerPool();
+
+    // 启动工作线程和计时线程；threads为0时什么也不做
+    bool start();
+
+    // 停止所有线程：正在处理的请求处理完，排队的请求丢弃
+    void stop();
+
+    // 交给线程池处理来自context所在连接的一条service_id请求，每隔repeat_ms推送一次0x78直到处理完；
+    // context须带有推送通道。队列已满时返回false，调用者应回复NRC 0x21
+    bool submit(const RequestContext& context, uint8_t service_id, uint32_t repeat_ms, const Job& job);
+
+    size_t threads() const { return options_.threads; }
+
+    WorkerPoolStats stats() const;
+
+private:
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    // 一条交给线程池的请求，由完成它的工作线程释放
+    struct Task : TimerWheel::Timer {
+        Job job;
+        std::shared_ptr<PushChannel> channel;
+        uint32_t connection_id;
+        uint16_t tester_address;
+        uint16_t ecu_address;
+        uint8_t protocol_version;
+        uint8_t service_id;
+        uint64_t repeat_ticks;   // 重复发送0x78的间隔，0表示不重复
+    };
+
+    void work();
+    void run_timer();
+    void push_pending(const Task& task);
+    void record_push(const Task& task, const std::vector<uint8_t>& frame, size_t body_offset);
+    uint64_t now_tick() const;
+
+    WorkerPoolOptions options_;
+    uint64_t tick_ns_;
+    Clock::time_point epoch_;
+
+    mutable std::mutex mutex_;           // 保护以下所有成员，推送也在锁内进行
+    std::condition_variable work_cv_;
+    std::condition_variable timer_cv_;
+    std::deque<Task*> queue_;
+    size_t in_flight_;                   // 排队和正在处理的请求数
+    TimerWheel wheel_;
+    bool running_;
+    WorkerPoolStats stats_;
+    std::vector<uint8_t> pending_frame_; // 计时线程编码0x78的缓冲区
+
+    std::vector<std::thread> workers_;
+    std::thread timer_thread_;
+};
+
+} // namespace uds
+
+#endif // WORKER_POOL_H
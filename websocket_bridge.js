@@ -8,6 +8,12 @@ const wsPort = 8080;
 const tcpHost = '127.0.0.1';
 const tcpPort = 8888;
 
+// 日志级别（环境变量LOG_LEVEL）：error < warn < info < debug，默认info
+// 每条报文的十六进制内容只在debug级别输出，默认不在转发路径上做格式化和控制台I/O
+const LOG_LEVELS = { error: 0, warn: 1, info: 2, debug: 3 };
+const logLevel = LOG_LEVELS[process.env.LOG_LEVEL] !== undefined ? LOG_LEVELS[process.env.LOG_LEVEL] : LOG_LEVELS.info;
+const debugEnabled = logLevel >= LOG_LEVELS.debug;
+
 // 创建WebSocket服务器
 const wss = new WebSocket.Server({ port: wsPort });
 
@@ -24,7 +30,9 @@ wss.on('connection', (ws) => {
     
     // 处理TCP数据
     tcpClient.on('data', (data) => {
-        console.log(`从TCP接收到数据: ${data.toString('hex')}`);
+        if (debugEnabled) {
+            console.log(`从TCP接收到数据: ${data.toString('hex')}`);
+        }
         // 将TCP数据转发到WebSocket客户端
         ws.send(data);
     });
@@ -43,7 +51,9 @@ wss.on('connection', (ws) => {
     
     // 处理WebSocket消息
     ws.on('message', (message) => {
-        console.log(`从WebSocket接收到消息: ${Buffer.isBuffer(message) ? message.toString('hex') : message}`);
+        if (debugEnabled) {
+            console.log(`从WebSocket接收到消息: ${Buffer.isBuffer(message) ? message.toString('hex') : message}`);
+        }
         // 将WebSocket消息转发到TCP服务器
         tcpClient.write(message);
     });